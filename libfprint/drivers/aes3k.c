@@ -82,7 +82,6 @@ img_cb (FpiUsbTransfer *transfer, FpDevice *device,
   FpiDeviceAes3kPrivate *priv = fpi_device_aes3k_get_instance_private (self);
   FpiDeviceAes3kClass *cls = FPI_DEVICE_AES3K_GET_CLASS (self);
   unsigned char *ptr = transfer->buffer;
-  FpImage *tmp;
   FpImage *img;
   int i;
 
@@ -107,22 +106,21 @@ img_cb (FpiUsbTransfer *transfer, FpDevice *device,
 
   fpi_image_device_report_finger_status (dev, TRUE);
 
-  tmp = fp_image_new (cls->frame_width, cls->frame_width);
-  tmp->width = cls->frame_width;
-  tmp->height = cls->frame_width;
-  tmp->flags = FPI_IMAGE_COLORS_INVERTED | FPI_IMAGE_V_FLIPPED | FPI_IMAGE_H_FLIPPED;
+  img = fp_image_new (cls->frame_width, cls->frame_width);
+  img->width = cls->frame_width;
+  img->height = cls->frame_width;
+  img->flags = FPI_IMAGE_COLORS_INVERTED | FPI_IMAGE_V_FLIPPED | FPI_IMAGE_H_FLIPPED;
   for (i = 0; i < cls->frame_number; i++)
     {
       fp_dbg ("frame header byte %02x", *ptr);
       ptr++;
-      aes3k_assemble_image (ptr, cls->frame_width, AES3K_FRAME_HEIGHT, tmp->data + (i * cls->frame_width * AES3K_FRAME_HEIGHT));
+      aes3k_assemble_image (ptr, cls->frame_width, AES3K_FRAME_HEIGHT, img->data + (i * cls->frame_width * AES3K_FRAME_HEIGHT));
       ptr += cls->frame_size;
     }
 
   /* FIXME: this is an ugly hack to make the image big enough for NBIS
-   * to process reliably */
-  img = fpi_image_resize (tmp, cls->enlarge_factor, cls->enlarge_factor);
-  g_object_unref (tmp);
+   * to process reliably. The image is enlarged during minutiae detection. */
+  fpi_image_set_upscale (img, cls->enlarge_factor, cls->enlarge_factor);
   fpi_image_device_image_captured (dev, img);
 
   /* FIXME: rather than assuming finger has gone, we should poll regs until
@@ -34,40 +34,27 @@
 
 struct write_regv_data
 {
-  unsigned int               num_regs;
-  const struct aes_regwrite *regs;
-  unsigned int               offset;
-  aes_write_regv_cb          callback;
-  void                      *user_data;
+  aes_write_regv_cb callback;
+  void             *user_data;
 };
 
-static void continue_write_regv (FpImageDevice          *dev,
-                                 struct write_regv_data *wdata);
-
-/* libusb bulk callback for regv write completion transfer. continues the
- * transaction */
 static void
-write_regv_trf_complete (FpiUsbTransfer *transfer, FpDevice *device,
-                         gpointer user_data, GError *error)
+write_regv_done (FpDevice *device, gpointer user_data, GError *error)
 {
   struct write_regv_data *wdata = user_data;
 
-  if (error)
-    {
-      wdata->callback (FP_IMAGE_DEVICE (device), error, wdata->user_data);
-      g_free (wdata);
-    }
-  else
-    {
-      continue_write_regv (FP_IMAGE_DEVICE (device), wdata);
-    }
+  if (!error)
+    fp_dbg ("all registers written");
+
+  wdata->callback (FP_IMAGE_DEVICE (device), error, wdata->user_data);
+  g_free (wdata);
 }
 
-/* write from wdata->offset to upper_bound (inclusive) of wdata->regs */
-static void
-do_write_regv (FpImageDevice *dev, struct write_regv_data *wdata, int upper_bound)
+/* write regs from offset to upper_bound (inclusive) in a single URB */
+static FpiUsbTransfer *
+write_regv_transfer (FpImageDevice *dev, const struct aes_regwrite *regs,
+                     unsigned int offset, unsigned int upper_bound)
 {
-  unsigned int offset = wdata->offset;
   unsigned int num = upper_bound - offset + 1;
   size_t alloc_size = num * 2;
   unsigned int i;
@@ -78,79 +65,74 @@ do_write_regv (FpImageDevice *dev, struct write_regv_data *wdata, int upper_boun
 
   for (i = offset; i < offset + num; i++)
     {
-      const struct aes_regwrite *regwrite = &wdata->regs[i];
+      const struct aes_regwrite *regwrite = &regs[i];
       transfer->buffer[data_offset++] = regwrite->reg;
       transfer->buffer[data_offset++] = regwrite->value;
     }
 
   transfer->short_is_error = TRUE;
-  fpi_usb_transfer_submit (transfer, BULK_TIMEOUT, NULL,
-                           write_regv_trf_complete, wdata);
-}
-
-/* write the next batch of registers to be written, or if there are no more,
- * indicate completion to the caller */
-static void
-continue_write_regv (FpImageDevice *dev, struct write_regv_data *wdata)
-{
-  unsigned int offset = wdata->offset;
-  unsigned int regs_remaining;
-  unsigned int limit;
-  unsigned int upper_bound;
-  int i;
-
-  /* skip all zeros and ensure there is still work to do */
-  while (TRUE)
-    {
-      if (offset >= wdata->num_regs)
-        {
-          fp_dbg ("all registers written");
-          wdata->callback (dev, 0, wdata->user_data);
-          g_free (wdata);
-          return;
-        }
-      if (wdata->regs[offset].reg)
-        break;
-      offset++;
-    }
 
-  wdata->offset = offset;
-  regs_remaining = wdata->num_regs - offset;
-  limit = MIN (regs_remaining, MAX_REGWRITES_PER_REQUEST);
-  upper_bound = offset + limit - 1;
-
-  /* determine if we can write the entire of the regs at once, or if there
-   * is a zero dividing things up */
-  for (i = offset; i <= upper_bound; i++)
-    if (!wdata->regs[i].reg)
-      {
-        upper_bound = i - 1;
-        break;
-      }
-
-  do_write_regv (dev, wdata, upper_bound);
-
-  wdata->offset = upper_bound + 1;
+  return transfer;
 }
 
 /* write a load of registers to the device, combining multiple writes in a
  * single URB up to a limit. insert writes to non-existent register 0 to force
- * specific groups of writes to be separated by different URBs. */
+ * specific groups of writes to be separated by different URBs. All URBs are
+ * submitted at once, the device receives them in order. */
 void
 aes_write_regv (FpImageDevice *dev, const struct aes_regwrite *regs,
                 unsigned int num_regs, aes_write_regv_cb callback,
                 void *user_data)
 {
+  g_autoptr(GPtrArray) transfers = g_ptr_array_new ();
   struct write_regv_data *wdata;
+  unsigned int offset = 0;
+  unsigned int limit;
+  unsigned int upper_bound;
+  unsigned int i;
 
   fp_dbg ("write %d regs", num_regs);
-  wdata = g_malloc (sizeof (*wdata));
-  wdata->num_regs = num_regs;
-  wdata->regs = regs;
-  wdata->offset = 0;
+
+  while (TRUE)
+    {
+      /* skip all zeros and ensure there is still work to do */
+      while (offset < num_regs && !regs[offset].reg)
+        offset++;
+      if (offset >= num_regs)
+        break;
+
+      limit = MIN (num_regs - offset, MAX_REGWRITES_PER_REQUEST);
+      upper_bound = offset + limit - 1;
+
+      /* determine if we can write the entire of the regs at once, or if
+       * there is a zero dividing things up */
+      for (i = offset; i <= upper_bound; i++)
+        if (!regs[i].reg)
+          {
+            upper_bound = i - 1;
+            break;
+          }
+
+      g_ptr_array_add (transfers,
+                       write_regv_transfer (dev, regs, offset, upper_bound));
+      offset = upper_bound + 1;
+    }
+
+  if (transfers->len == 0)
+    {
+      fp_dbg ("all registers written");
+      callback (dev, NULL, user_data);
+      return;
+    }
+
+  wdata = g_new (struct write_regv_data, 1);
   wdata->callback = callback;
   wdata->user_data = user_data;
-  continue_write_regv (dev, wdata);
+
+  fpi_usb_transfer_submit_batch ((FpiUsbTransfer **) transfers->pdata,
+                                 transfers->len,
+                                 BULK_TIMEOUT, NULL,
+                                 write_regv_done, wdata);
 }
 
 unsigned char
@@ -34,6 +34,7 @@ struct _FpDeviceEgis0570
 
   gboolean      running;
   gboolean      stop;
+  FpiSsmPoller  poller;
 
   GSList       *strips;
   guint8       *background;
@@ -156,6 +157,7 @@ data_resp_cb (FpiUsbTransfer *transfer, FpDevice *dev, gpointer user_data, GErro
     {
       FpiImageDeviceState state;
 
+      fpi_ssm_poller_activity (&self->poller);
       fpi_image_device_report_finger_status (img_self, TRUE);
 
       g_object_get (dev, "fpi-image-device-state", &state, NULL);
@@ -198,8 +200,8 @@ data_resp_cb (FpiUsbTransfer *transfer, FpDevice *dev, gpointer user_data, GErro
           g_slist_free_full (self->strips, g_free);
           self->strips = NULL;
           self->strips_len = 0;
-          FpImage *resizeImage = fpi_image_resize (img, EGIS0570_RESIZE, EGIS0570_RESIZE);
-          fpi_image_device_image_captured (img_self, resizeImage);
+          fpi_image_set_upscale (img, EGIS0570_RESIZE, EGIS0570_RESIZE);
+          fpi_image_device_image_captured (img_self, img);
         }
 
       fpi_image_device_report_finger_status (img_self, FALSE);
@@ -322,7 +324,7 @@ ssm_run_state (FpiSsm *ssm, FpDevice *dev)
       break;
 
     case SM_DONE:
-      fpi_ssm_jump_to_state (ssm, SM_START);
+      fpi_ssm_jump_to_state_polled (ssm, SM_START, &self->poller);
       break;
 
     default:
@@ -354,6 +356,7 @@ dev_activate (FpImageDevice *dev)
   FpiSsm *ssm = fpi_ssm_new (FP_DEVICE (dev), ssm_run_state, SM_STATES_NUM);
 
   self->stop    = FALSE;
+  fpi_ssm_poller_activity (&self->poller);
 
   fpi_ssm_start (ssm, loop_complete);
 
@@ -418,6 +421,8 @@ static const FpIdEntry id_table[] = {
 static void
 fpi_device_egis0570_init (FpDeviceEgis0570 *self)
 {
+  fpi_ssm_poller_init (&self->poller, 0,
+                       EGIS0570_POLL_MAX_DELAY, EGIS0570_POLL_BACKOFF_AFTER);
 }
 
 static void
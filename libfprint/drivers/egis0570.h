@@ -174,4 +174,11 @@ static unsigned char repeat_pkts[][EGIS0570_PKTSIZE] =
 
 #define EGIS0570_RESIZE 2
 
+/*
+ * Frames are requested back to back while a finger is seen, and then
+ * less often the longer the sensor stays empty
+ */
+#define EGIS0570_POLL_MAX_DELAY 50
+#define EGIS0570_POLL_BACKOFF_AFTER 2000
+
 #endif
@@ -88,12 +88,6 @@ struct _FpiDeviceElan
 };
 G_DEFINE_TYPE (FpiDeviceElan, fpi_device_elan, FP_TYPE_IMAGE_DEVICE);
 
-static int
-cmp_short (const void *a, const void *b)
-{
-  return (int) (*(short *) a - *(short *) b);
-}
-
 static void
 elan_dev_reset_state (FpiDeviceElan *elandev)
 {
@@ -204,20 +198,13 @@ elan_save_img_frame (FpiDeviceElan *elandev)
 
   unsigned int frame_size = elandev->frame_width * elandev->frame_height;
   unsigned short *frame = g_malloc (frame_size * sizeof (short));
+  guint16 max;
 
   elan_save_frame (elandev, frame);
-  unsigned int sum = 0;
-
-  for (int i = 0; i < frame_size; i++)
-    {
-      if (elandev->background[i] > frame[i])
-        frame[i] = 0;
-      else
-        frame[i] -= elandev->background[i];
-      sum += frame[i];
-    }
+  fpi_sensor_subtract_background (frame, frame, elandev->background,
+                                  frame_size, &max);
 
-  if (sum == 0)
+  if (max == 0)
     {
       fp_dbg
         ("frame darker than background; finger present during calibration?");
@@ -239,28 +226,18 @@ elan_process_frame_linear (unsigned short *raw_frame,
   struct fpi_frame *frame =
     g_malloc (frame_size + sizeof (struct fpi_frame));
 
-  G_DEBUG_HERE ();
-
-  unsigned short min = 0xffff, max = 0;
-
-  for (int i = 0; i < frame_size; i++)
-    {
-      if (raw_frame[i] < min)
-        min = raw_frame[i];
-      if (raw_frame[i] > max)
-        max = raw_frame[i];
-    }
+  const gsize ranks[] = { 0, frame_size - 1 };
+  const guint8 values[] = { 0, 0xff };
+  guint16 levels[G_N_ELEMENTS (ranks)];
 
-  g_assert (max != min);
+  G_DEBUG_HERE ();
 
-  unsigned short px;
+  fpi_sensor_select_ranks (raw_frame, frame_size, ranks, levels,
+                           G_N_ELEMENTS (ranks));
+  g_assert (levels[0] != levels[1]);
 
-  for (int i = 0; i < frame_size; i++)
-    {
-      px = raw_frame[i];
-      px = (px - min) * 0xff / (max - min);
-      frame->data[i] = (unsigned char) px;
-    }
+  fpi_sensor_map_levels (frame->data, raw_frame, frame_size, levels, values,
+                         G_N_ELEMENTS (levels));
 
   *frames = g_slist_prepend (*frames, frame);
 }
@@ -276,30 +253,16 @@ elan_process_frame_thirds (unsigned short *raw_frame,
   struct fpi_frame *frame =
     g_malloc (frame_size + sizeof (struct fpi_frame));
 
-  unsigned short lvl0, lvl1, lvl2, lvl3;
-  unsigned short *sorted = g_malloc (frame_size * sizeof (short));
-
-  memcpy (sorted, raw_frame, frame_size * sizeof (short));
-  qsort (sorted, frame_size, sizeof (short), cmp_short);
-  lvl0 = sorted[0];
-  lvl1 = sorted[frame_size * 3 / 10];
-  lvl2 = sorted[frame_size * 65 / 100];
-  lvl3 = sorted[frame_size - 1];
-  g_free (sorted);
-
-  unsigned short px;
+  const gsize ranks[] = {
+    0, frame_size * 3 / 10, frame_size * 65 / 100, frame_size - 1
+  };
+  const guint8 values[] = { 0, 99, 155, 255 };
+  guint16 levels[G_N_ELEMENTS (ranks)];
 
-  for (int i = 0; i < frame_size; i++)
-    {
-      px = raw_frame[i];
-      if (lvl0 <= px && px < lvl1)
-        px = (px - lvl0) * 99 / (lvl1 - lvl0);
-      else if (lvl1 <= px && px < lvl2)
-        px = 99 + ((px - lvl1) * 56 / (lvl2 - lvl1));
-      else                      // (lvl2 <= px && px <= lvl3)
-        px = 155 + ((px - lvl2) * 100 / (lvl3 - lvl2));
-      frame->data[i] = (unsigned char) px;
-    }
+  fpi_sensor_select_ranks (raw_frame, frame_size, ranks, levels,
+                           G_N_ELEMENTS (ranks));
+  fpi_sensor_map_levels (frame->data, raw_frame, frame_size, levels, values,
+                         G_N_ELEMENTS (levels));
 
   *frames = g_slist_prepend (*frames, frame);
 }
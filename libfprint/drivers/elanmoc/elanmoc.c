@@ -41,18 +41,19 @@ typedef struct
 
 static uint8_t *
 elanmoc_compose_cmd (
+  FpDevice                 *device,
   const struct elanmoc_cmd *cmd_info
                     )
 {
-  g_autofree char *cmd_buf = NULL;
+  guint8 *cmd_buf = NULL;
 
-  cmd_buf = g_malloc0 (cmd_info->cmd_len);
+  cmd_buf = fpi_usb_buffer_new (device, cmd_info->cmd_len);
   if(cmd_info->cmd_len < ELAN_MAX_HDR_LEN)
     memcpy (cmd_buf, &cmd_info->cmd_header, cmd_info->cmd_len);
   else
     memcpy (cmd_buf, &cmd_info->cmd_header, ELAN_MAX_HDR_LEN);
 
-  return g_steal_pointer (&cmd_buf);
+  return cmd_buf;
 }
 
 static void
@@ -210,7 +211,7 @@ elanmoc_get_cmd (FpDevice *device, guint8 *buffer_out,
   transfer = fpi_usb_transfer_new (device);
   transfer->short_is_error = TRUE;
   fpi_usb_transfer_fill_bulk_full (transfer, ELAN_EP_CMD_OUT, buffer_out,
-                                   length_out, g_free);
+                                   length_out, fpi_usb_buffer_free);
   data->callback = callback;
 
   self->cmd_transfer = g_steal_pointer (&transfer);
@@ -425,19 +426,19 @@ elan_enroll_run_state (FpiSsm *ssm, FpDevice *dev)
   switch (fpi_ssm_get_cur_state (ssm))
     {
     case MOC_ENROLL_GET_ENROLLED_NUM:
-      cmd_buf = elanmoc_compose_cmd (&enrolled_number_cmd);
+      cmd_buf = elanmoc_compose_cmd (dev, &enrolled_number_cmd);
       elanmoc_get_cmd (dev, cmd_buf, enrolled_number_cmd.cmd_len, enrolled_number_cmd.resp_len, 0, elanmoc_get_enrolled_cb);
       break;
 
     case MOC_ENROLL_REENROLL_CHECK:
       data = fpi_ssm_get_data (ssm);
-      cmd_buf = elanmoc_compose_cmd (&elanmoc_check_reenroll_cmd);
+      cmd_buf = elanmoc_compose_cmd (dev, &elanmoc_check_reenroll_cmd);
       memcpy (cmd_buf + 3, data, ELAN_USERDATE_SIZE);
       elanmoc_get_cmd (dev, cmd_buf, elanmoc_check_reenroll_cmd.cmd_len, elanmoc_check_reenroll_cmd.resp_len, 0, elanmoc_reenroll_cb);
       break;
 
     case MOC_ENROLL_WAIT_FINGER:
-      cmd_buf = elanmoc_compose_cmd (&elanmoc_enroll_cmd);
+      cmd_buf = elanmoc_compose_cmd (dev, &elanmoc_enroll_cmd);
       cmd_buf[3] = self->curr_enrolled;
       cmd_buf[4] = ELAN_MOC_ENROLL_TIMES;
       cmd_buf[5] = self->num_frames;
@@ -446,7 +447,7 @@ elan_enroll_run_state (FpiSsm *ssm, FpDevice *dev)
 
     case MOC_ENROLL_COMMIT_RESULT:
       data = fpi_ssm_get_data (ssm);
-      cmd_buf = elanmoc_compose_cmd (&elanmoc_enroll_commit_cmd);
+      cmd_buf = elanmoc_compose_cmd (dev, &elanmoc_enroll_commit_cmd);
       memcpy (cmd_buf + 5, data, ELAN_USERDATE_SIZE);
       elanmoc_get_cmd (dev, cmd_buf, elanmoc_enroll_commit_cmd.cmd_len, elanmoc_enroll_commit_cmd.resp_len, 0, elanmoc_commit_cb);
       break;
@@ -585,13 +586,13 @@ elan_list_run_state (FpiSsm *ssm, FpDevice *dev)
   switch (fpi_ssm_get_cur_state (ssm))
     {
     case MOC_LIST_GET_ENROLLED:
-      cmd_buf = elanmoc_compose_cmd (&enrolled_number_cmd);
+      cmd_buf = elanmoc_compose_cmd (dev, &enrolled_number_cmd);
       elanmoc_get_cmd (dev, cmd_buf, enrolled_number_cmd.cmd_len, enrolled_number_cmd.resp_len, 0, elanmoc_get_enrolled_cb);
       self->list_index = 0;
       break;
 
     case MOC_LIST_GET_FINGER:
-      cmd_buf = elanmoc_compose_cmd (&elanmoc_get_userid_cmd);
+      cmd_buf = elanmoc_compose_cmd (dev, &elanmoc_get_userid_cmd);
       cmd_buf[2] = self->list_index;
       elanmoc_get_cmd (dev, cmd_buf, elanmoc_get_userid_cmd.cmd_len, elanmoc_get_userid_cmd.resp_len, 0, elanmoc_get_userid_cb);
       break;
@@ -747,7 +748,7 @@ identify_status_report (FpiDeviceElanmoc *self, int verify_status_id,
     case RSP_VERIFY_OK:
       {
         fp_dbg ("Verify was successful! for user: %d mesg_code: %d ", data, verify_status_id);
-        cmd_buf = elanmoc_compose_cmd (&elanmoc_get_userid_cmd);
+        cmd_buf = elanmoc_compose_cmd (device, &elanmoc_get_userid_cmd);
         cmd_buf[2] = data;
         elanmoc_get_cmd (device, cmd_buf, elanmoc_get_userid_cmd.cmd_len, elanmoc_get_userid_cmd.resp_len, 0, elanmoc_match_report_cb);
         break;
@@ -793,7 +794,7 @@ elan_identify_run_state (FpiSsm *ssm, FpDevice *dev)
     {
     case IDENTIFY_WAIT_FINGER:
       fp_info ("elanmoc %s VERIFY_WAIT_FINGER", __func__);
-      cmd_buf = elanmoc_compose_cmd (&elanmoc_verify_cmd);
+      cmd_buf = elanmoc_compose_cmd (dev, &elanmoc_verify_cmd);
       elanmoc_get_cmd (dev, cmd_buf, elanmoc_verify_cmd.cmd_len, elanmoc_verify_cmd.resp_len, 1, elanmoc_identify_cb);
       break;
     }
@@ -873,7 +874,7 @@ elan_delete_run_state (FpiSsm *ssm, FpDevice *dev)
   switch (fpi_ssm_get_cur_state (ssm))
     {
     case DELETE_SEND_CMD:
-      cmd_buf = elanmoc_compose_cmd (&elanmoc_delete_cmd);
+      cmd_buf = elanmoc_compose_cmd (dev, &elanmoc_delete_cmd);
       memcpy (cmd_buf + 3, data, ELAN_USERDATE_SIZE);
       elanmoc_get_cmd (dev, cmd_buf, elanmoc_delete_cmd.cmd_len, elanmoc_delete_cmd.resp_len, 0, elanmoc_delete_cb);
       break;
@@ -1006,7 +1007,7 @@ elanmoc_get_status_cb (FpiDeviceElanmoc *self,
           return;
         }
       self->cmd_retry_cnt--;
-      cmd_buf = elanmoc_compose_cmd (&cal_status_cmd);
+      cmd_buf = elanmoc_compose_cmd (FP_DEVICE (self), &cal_status_cmd);
       elanmoc_get_cmd (FP_DEVICE (self), cmd_buf, cal_status_cmd.cmd_len, cal_status_cmd.resp_len, 0, elanmoc_get_status_cb);
     }
   else
@@ -1025,28 +1026,28 @@ dev_init_handler (FpiSsm *ssm, FpDevice *dev)
     {
     case DEV_WAIT_READY:
       self->cmd_retry_cnt = ELAN_MOC_CAL_RETRY;
-      cmd_buf = elanmoc_compose_cmd (&cal_status_cmd);
+      cmd_buf = elanmoc_compose_cmd (dev, &cal_status_cmd);
       elanmoc_get_cmd (dev, cmd_buf, cal_status_cmd.cmd_len, cal_status_cmd.resp_len, 0, elanmoc_get_status_cb);
       break;
 
     case DEV_SET_MODE:
-      cmd_buf = elanmoc_compose_cmd (&elanmoc_set_mod_cmd);
+      cmd_buf = elanmoc_compose_cmd (dev, &elanmoc_set_mod_cmd);
       cmd_buf[3] = 0x03;
       elanmoc_get_cmd (dev, cmd_buf, elanmoc_set_mod_cmd.cmd_len, elanmoc_set_mod_cmd.resp_len, 0, elanmoc_cmd_ack_cb);
       break;
 
     case DEV_GET_VER:
-      cmd_buf = elanmoc_compose_cmd (&fw_ver_cmd);
+      cmd_buf = elanmoc_compose_cmd (dev, &fw_ver_cmd);
       elanmoc_get_cmd (dev, cmd_buf, fw_ver_cmd.cmd_len, fw_ver_cmd.resp_len, 0, elanmoc_cmd_ver_cb);
       break;
 
     case DEV_GET_DIM:
-      cmd_buf = elanmoc_compose_cmd (&sensor_dim_cmd);
+      cmd_buf = elanmoc_compose_cmd (dev, &sensor_dim_cmd);
       elanmoc_get_cmd (dev, cmd_buf, sensor_dim_cmd.cmd_len, sensor_dim_cmd.resp_len, 0, elanmoc_cmd_dim_cb);
       break;
 
     case DEV_GET_ENROLLED:
-      cmd_buf = elanmoc_compose_cmd (&enrolled_number_cmd);
+      cmd_buf = elanmoc_compose_cmd (dev, &enrolled_number_cmd);
       elanmoc_get_cmd (dev, cmd_buf, enrolled_number_cmd.cmd_len, enrolled_number_cmd.resp_len, 0, elanmoc_get_enrolled_cb);
       break;
 
@@ -1091,7 +1092,7 @@ dev_exit_handler (FpiSsm *ssm, FpDevice *dev)
   switch (fpi_ssm_get_cur_state (ssm))
     {
     case DEV_EXIT_ABOVE:
-      cmd_buf = elanmoc_compose_cmd (&elanmoc_above_cmd);
+      cmd_buf = elanmoc_compose_cmd (dev, &elanmoc_above_cmd);
       elanmoc_get_cmd (dev, cmd_buf, elanmoc_above_cmd.cmd_len, elanmoc_above_cmd.resp_len, 0, elanmoc_cmd_ack_cb);
       break;
     }
@@ -1126,6 +1127,7 @@ fpi_device_elanmoc_class_init (FpiDeviceElanmocClass *klass)
   dev_class->id_table = id_table;
   dev_class->nr_enroll_stages = ELAN_MOC_ENROLL_TIMES;
   dev_class->temp_hot_seconds = -1;
+  dev_class->cache_stored_prints = TRUE;
 
   dev_class->open = elanmoc_open;
   dev_class->close = elanmoc_close;
@@ -21,6 +21,8 @@
 #define FP_COMPONENT "elanspi"
 
 #include "drivers_api.h"
+#include "fpi-byte-utils.h"
+#include "fpi-calibration-cache.h"
 #include "elanspi.h"
 
 #include <linux/hidraw.h>
@@ -72,6 +74,8 @@ struct _FpiDeviceElanSpi
 
   /* background / calibration parameters */
   guint16 *bg_image;
+  gboolean calib_from_cache, calib_cache_rejected;
+  guint16  cached_dac_value;
   guint16 *last_image;
   guint16 *prev_frame_image;
 
@@ -79,7 +83,8 @@ struct _FpiDeviceElanSpi
   GSList  *fp_frame_list;
 
   /* wait ctx */
-  gint     finger_wait_debounce;
+  gint         finger_wait_debounce;
+  FpiSsmPoller finger_poller;
 
   gboolean deactivating, capturing;
 
@@ -216,7 +221,6 @@ enum elanspi_capture_hv_state {
 
 enum elanspi_write_regtable_state {
   ELANSPI_WRTABLE_WRITE,
-  ELANSPI_WRTABLE_ITERATE,
   ELANSPI_WRTABLE_NSTATES
 };
 
@@ -234,6 +238,12 @@ enum elanspi_fp_capture_state {
   ELANSPI_FPCAPT_NSTATES
 };
 
+enum elanspi_guess_result {
+  ELANSPI_GUESS_FINGERPRINT,
+  ELANSPI_GUESS_EMPTY,
+  ELANSPI_GUESS_UNKNOWN
+};
+
 /* helpers */
 
 static FpiSpiTransfer *
@@ -500,30 +510,62 @@ elanspi_capture_old_handler (FpiSsm *ssm, FpDevice *dev)
     }
 }
 
+struct elanspi_regtable_data
+{
+  const struct elanspi_reg_entry *table;
+  guint                           pending;
+  GError                         *error;
+};
+
+static void
+elanspi_regtable_data_free (struct elanspi_regtable_data *data)
+{
+  g_clear_error (&data->error);
+  g_free (data);
+}
+
+static void
+elanspi_regtable_write_cb (FpiSpiTransfer *transfer, FpDevice *dev, gpointer user_data, GError *error)
+{
+  struct elanspi_regtable_data *data = fpi_ssm_get_data (transfer->ssm);
+
+  if (error && !data->error)
+    data->error = error;
+  else
+    g_clear_error (&error);
+
+  data->pending -= 1;
+  if (data->pending > 0)
+    return;
+
+  if (data->error)
+    fpi_ssm_mark_failed (transfer->ssm, g_steal_pointer (&data->error));
+  else
+    fpi_ssm_next_state (transfer->ssm);
+}
+
 static void
 elanspi_send_regtable_handler (FpiSsm *ssm, FpDevice *dev)
 {
   FpiDeviceElanSpi *self  = FPI_DEVICE_ELANSPI (dev);
   FpiSpiTransfer *xfer  = NULL;
-  const struct elanspi_reg_entry *entry = fpi_ssm_get_data (ssm);
+  struct elanspi_regtable_data *data = fpi_ssm_get_data (ssm);
+  const struct elanspi_reg_entry *entry = data->table;
 
   switch (fpi_ssm_get_cur_state (ssm))
     {
     case ELANSPI_WRTABLE_WRITE:
-      xfer = elanspi_write_register (self, entry->addr, entry->value);
-      xfer->ssm = ssm;
-      fpi_spi_transfer_submit (xfer, fpi_device_get_cancellable (dev), fpi_ssm_spi_transfer_cb, NULL);
-      return;
-
-    case ELANSPI_WRTABLE_ITERATE:
-      entry += 1;
-      if (entry->addr != 0xff)
+      /* Queue the whole table at once, the writes are done in order and
+       * sent in batches by the SPI worker. */
+      do
         {
-          fpi_ssm_set_data (ssm, (gpointer) entry, NULL);
-          fpi_ssm_jump_to_state (ssm, ELANSPI_WRTABLE_WRITE);
-          return;
+          xfer = elanspi_write_register (self, entry->addr, entry->value);
+          xfer->ssm = ssm;
+          data->pending += 1;
+          fpi_spi_transfer_submit (xfer, fpi_device_get_cancellable (dev), elanspi_regtable_write_cb, NULL);
+          entry += 1;
         }
-      fpi_ssm_mark_completed (ssm);
+      while (entry->addr != 0xff);
       return;
     }
 }
@@ -549,8 +591,10 @@ elanspi_write_regtable (FpiDeviceElanSpi *self, const struct elanspi_regtable *
     }
 
   FpiSsm * ssm = fpi_ssm_new (FP_DEVICE (self), elanspi_send_regtable_handler, ELANSPI_WRTABLE_NSTATES);
+  struct elanspi_regtable_data *data = g_new0 (struct elanspi_regtable_data, 1);
 
-  fpi_ssm_set_data (ssm, (gpointer) starting_entry, NULL);
+  data->table = starting_entry;
+  fpi_ssm_set_data (ssm, data, (GDestroyNotify) elanspi_regtable_data_free);
   return ssm;
 }
 
@@ -605,15 +649,31 @@ elanspi_calibrate_old_handler (FpiSsm *ssm, FpDevice *dev)
     case ELANSPI_CALIBOLD_DACBASE_CAPTURE:
     case ELANSPI_CALIBOLD_CHECKFIN_CAPTURE:
     case ELANSPI_CALIBOLD_DACFINE_CAPTURE:
+      /* cached calibration values are written without searching for them */
+      if (self->calib_from_cache)
+        {
+          if (fpi_ssm_get_cur_state (ssm) == ELANSPI_CALIBOLD_DACFINE_CAPTURE)
+            fpi_ssm_jump_to_state (ssm, ELANSPI_CALIBOLD_PROTECT);
+          else
+            fpi_ssm_next_state (ssm);
+          return;
+        }
       chld = fpi_ssm_new (dev, elanspi_capture_old_handler, ELANSPI_CAPTOLD_NSTATES);
       fpi_ssm_start_subsm (ssm, chld);
       return;
 
     case ELANSPI_CALIBOLD_DACBASE_WRITE_DAC1:
       /* compute dac */
-      self->old_data.dac_value = ((elanspi_mean_image (self, self->last_image) & 0xffff) + 0x80) >> 8;
-      if (0x3f < self->old_data.dac_value)
-        self->old_data.dac_value = 0x3f;
+      if (self->calib_from_cache)
+        {
+          self->old_data.dac_value = self->cached_dac_value;
+        }
+      else
+        {
+          self->old_data.dac_value = ((elanspi_mean_image (self, self->last_image) & 0xffff) + 0x80) >> 8;
+          if (0x3f < self->old_data.dac_value)
+            self->old_data.dac_value = 0x3f;
+        }
       fp_dbg ("<calibold> dac init is 0x%02x", self->old_data.dac_value);
       /* write it */
       xfer = elanspi_write_register (self, 0x6, self->old_data.dac_value - 0x40);
@@ -623,7 +683,8 @@ elanspi_calibrate_old_handler (FpiSsm *ssm, FpDevice *dev)
 
     case ELANSPI_CALIBOLD_WRITE_GAIN:
       /* check if finger was present */
-      if (elanspi_mean_image (self, self->last_image) >= ELANSPI_MAX_OLD_STAGE1_CALIBRATION_MEAN)
+      if (!self->calib_from_cache &&
+          elanspi_mean_image (self, self->last_image) >= ELANSPI_MAX_OLD_STAGE1_CALIBRATION_MEAN)
         {
           err = fpi_device_retry_new_msg (FP_DEVICE_RETRY_REMOVE_FINGER, "finger on sensor during calibration");
           fpi_ssm_mark_failed (ssm, err);
@@ -795,6 +856,8 @@ elanspi_calibrate_hv_handler (FpiSsm *ssm, FpDevice *dev)
       self->hv_data.gdac_step  = 0x100;
       self->hv_data.best_gdac  = 0x0;
       self->hv_data.best_meandiff = 0xffff;
+      if (self->calib_from_cache)
+        self->hv_data.gdac_value = self->cached_dac_value;
 
     case ELANSPI_CALIBHV_SELECT_PAGE0_1:
       xfer = elanspi_do_selectpage (self, 0);
@@ -859,6 +922,12 @@ elanspi_calibrate_hv_handler (FpiSsm *ssm, FpDevice *dev)
       return;
 
     case ELANSPI_CALIBHV_CAPTURE:
+      /* the cached gdac has been written, no need to search for it */
+      if (self->calib_from_cache)
+        {
+          fpi_ssm_jump_to_state (ssm, ELANSPI_CALIBHV_PROTECT);
+          return;
+        }
       chld = fpi_ssm_new (dev, elanspi_capture_hv_handler, ELANSPI_CAPTHV_NSTATES);
       fpi_ssm_start_subsm (ssm, chld);
       return;
@@ -906,6 +975,66 @@ elanspi_calibrate_hv_handler (FpiSsm *ssm, FpDevice *dev)
     }
 }
 
+static enum elanspi_guess_result elanspi_guess_image (FpiDeviceElanSpi *self,
+                                                      guint16          *raw_image);
+
+static gchar *
+elanspi_get_calibration_version (FpiDeviceElanSpi *self)
+{
+  return g_strdup_printf ("%02x-%02x-%02x-%dx%d", self->sensor_raw_version,
+                          self->sensor_id, self->sensor_reg_17,
+                          self->sensor_width, self->sensor_height);
+}
+
+/* load the dac value and background of a previous calibration */
+static gboolean
+elanspi_load_calibration (FpiDeviceElanSpi *self)
+{
+  g_autofree gchar *version = elanspi_get_calibration_version (self);
+  g_autoptr(GBytes) cached = NULL;
+  gsize n_pixels = self->sensor_width * self->sensor_height;
+  const guint8 *data;
+  gsize len;
+
+  cached = fpi_calibration_cache_load (FP_DEVICE (self), version);
+  if (!cached)
+    return FALSE;
+
+  data = g_bytes_get_data (cached, &len);
+  if (len != (n_pixels + 1) * 2)
+    return FALSE;
+
+  self->cached_dac_value = FP_READ_UINT16_LE (data);
+  for (gsize i = 0; i < n_pixels; i += 1)
+    self->bg_image[i] = FP_READ_UINT16_LE (data + (i + 1) * 2);
+
+  return TRUE;
+}
+
+static void
+elanspi_store_calibration (FpiDeviceElanSpi *self)
+{
+  g_autofree gchar *version = NULL;
+  g_autoptr(GBytes) cached = NULL;
+  gsize n_pixels = self->sensor_width * self->sensor_height;
+  guint8 *data;
+
+  if (!fpi_calibration_cache_enabled ())
+    return;
+
+  data = g_malloc ((n_pixels + 1) * 2);
+  if (self->sensor_id == 0xe)
+    FP_WRITE_UINT16_LE (data, self->hv_data.gdac_value);
+  else
+    FP_WRITE_UINT16_LE (data, self->old_data.dac_value);
+  for (gsize i = 0; i < n_pixels; i += 1)
+    FP_WRITE_UINT16_LE (data + (i + 1) * 2, self->bg_image[i]);
+
+  version = elanspi_get_calibration_version (self);
+  cached = g_bytes_new_take (data, (n_pixels + 1) * 2);
+  fpi_calibration_cache_store (FP_DEVICE (self), version, cached);
+}
+
 static void
 elanspi_init_ssm_handler (FpiSsm *ssm, FpDevice *dev)
 {
@@ -917,6 +1046,8 @@ elanspi_init_ssm_handler (FpiSsm *ssm, FpDevice *dev)
   switch (fpi_ssm_get_cur_state (ssm))
     {
     case ELANSPI_INIT_READ_STATUS1:
+      self->calib_from_cache = FALSE;
+      self->calib_cache_rejected = FALSE;
       xfer = elanspi_read_status (self, &self->sensor_status);
       xfer->ssm = ssm;
       fpi_spi_transfer_submit (xfer, fpi_device_get_cancellable (dev), fpi_ssm_spi_transfer_cb, NULL);
@@ -1109,7 +1240,9 @@ do_sw_reset:
       return;
 
     case ELANSPI_INIT_CALIBRATE:
-      fp_dbg ("<init/calibrate> starting calibrate");
+      if (!self->calib_cache_rejected)
+        self->calib_from_cache = elanspi_load_calibration (self);
+      fp_dbg ("<init/calibrate> starting calibrate%s", self->calib_from_cache ? " from cache" : "");
       /* if sensor is hv */
       if (self->sensor_id == 0xe)
         chld = fpi_ssm_new_full (dev, elanspi_calibrate_hv_handler, ELANSPI_CALIBHV_NSTATES, ELANSPI_CALIBHV_PROTECT, "HV calibrate");
@@ -1127,97 +1260,81 @@ do_sw_reset:
       return;
 
     case ELANSPI_INIT_BG_SAVE:
+      if (self->calib_from_cache)
+        {
+          /* the sanity frame has to look like the cached background */
+          if (elanspi_guess_image (self, self->last_image) != ELANSPI_GUESS_EMPTY)
+            {
+              fp_dbg ("<init/calibrate> cached calibration rejected, recalibrating");
+              fpi_calibration_cache_discard (dev);
+              self->calib_from_cache = FALSE;
+              self->calib_cache_rejected = TRUE;
+              fpi_ssm_jump_to_state (ssm, ELANSPI_INIT_CALIBRATE);
+              return;
+            }
+        }
       memcpy (self->bg_image, self->last_image, self->sensor_height * self->sensor_width * 2);
+      if (!self->calib_from_cache)
+        elanspi_store_calibration (self);
       fpi_ssm_mark_completed (ssm);
       return;
     }
 }
 
-enum elanspi_guess_result {
-  ELANSPI_GUESS_FINGERPRINT,
-  ELANSPI_GUESS_EMPTY,
-  ELANSPI_GUESS_UNKNOWN
-};
-
-/* in place correct image, returning number of invalid pixels */
+/* correct image, returning number of invalid pixels */
 static gint
-elanspi_correct_with_bg (FpiDeviceElanSpi *self, guint16 *raw_image)
+elanspi_correct_with_bg (FpiDeviceElanSpi *self, guint16 *image, const guint16 *raw_image)
 {
-  gint count = 0;
-
-  for (int i = 0; i < self->sensor_width * self->sensor_height; i += 1)
-    {
-      if (raw_image[i] < self->bg_image[i])
-        {
-          count += 1;
-          raw_image[i] = 0;
-        }
-      else
-        {
-          raw_image[i] -= self->bg_image[i];
-        }
-    }
-
-  return count;
+  return fpi_sensor_subtract_background (image, raw_image, self->bg_image,
+                                         self->sensor_width * self->sensor_height,
+                                         NULL);
 }
 
-static guint16
-elanspi_lookup_pixel_with_rotation (FpiDeviceElanSpi *self, const guint16 *data_in, int y, int x)
+static void
+elanspi_rotate_frame (FpiDeviceElanSpi *self, guint16 *frame, const guint16 *data_in)
 {
-  int rotation = fpi_device_get_driver_data (FP_DEVICE (self)) & 3;
-  gint x1 = x, y1 = y;
+  FpiSensorRotation rotation = fpi_device_get_driver_data (FP_DEVICE (self)) & 3;
 
-  if (rotation == ELANSPI_180_ROTATE)
-    {
-      x1 = (self->sensor_width - x - 1);
-      y1 = (self->sensor_height - y - 1);
-    }
-  else if (rotation == ELANSPI_90LEFT_ROTATE)
-    {
-      x1 = y;
-      y1 = (self->sensor_width - x - 1);
-    }
-  else if (rotation == ELANSPI_90RIGHT_ROTATE)
-    {
-      x1 = (self->sensor_height - y - 1);
-      y1 = x;
-    }
-  return data_in[y1 * self->sensor_width + x1];
+  fpi_sensor_rotate (frame, self->frame_width, self->frame_height,
+                     data_in, self->sensor_width, self->sensor_height,
+                     rotation);
 }
 
 static enum elanspi_guess_result
 elanspi_guess_image (FpiDeviceElanSpi *self, guint16 *raw_image)
 {
-  g_autofree guint16 * image_copy = g_malloc0 (self->sensor_height * self->sensor_width * 2);
+  g_autofree guint16 * image_copy = g_new (guint16, self->sensor_height * self->sensor_width);
+  g_autofree guint16 * frame = NULL;
   guint8 frame_width, frame_height;
+  gint frame_size;
 
   /* make clang happy about div0 */
   frame_width = self->frame_width;
   frame_height = self->frame_height;
   g_assert (frame_width && frame_height);
+  frame_size = frame_width * frame_height;
 
-  memcpy (image_copy, raw_image, self->sensor_height * self->sensor_width * 2);
-
-  gint invalid_percent = (100 * elanspi_correct_with_bg (self, image_copy)) / (self->sensor_height * self->sensor_width);
+  gint invalid_percent = (100 * elanspi_correct_with_bg (self, image_copy, raw_image)) / (self->sensor_height * self->sensor_width);
   gint is_fp = 0, is_empty = 0;
 
   gint64 mean = 0;
   gint64 sq_stddev = 0;
 
-  for (int j = 0; j < frame_height; j += 1)
-    for (int i = 0; i < frame_width; i += 1)
-      mean += (gint64) elanspi_lookup_pixel_with_rotation (self, image_copy, j, i);
+  frame = g_new (guint16, frame_size);
+  elanspi_rotate_frame (self, frame, image_copy);
 
-  mean /= (frame_width * frame_height);
+  for (int i = 0; i < frame_size; i += 1)
+    mean += (gint64) frame[i];
 
-  for (int j = 0; j < frame_height; j += 1)
-    for (int i = 0; i < frame_width; i += 1)
-      {
-        gint64 k = (gint64) elanspi_lookup_pixel_with_rotation (self, image_copy, j, i) - mean;
-        sq_stddev += k * k;
-      }
+  mean /= frame_size;
 
-  sq_stddev /= (frame_width * frame_height);
+  for (int i = 0; i < frame_size; i += 1)
+    {
+      gint64 k = (gint64) frame[i] - mean;
+      sq_stddev += k * k;
+    }
+
+  sq_stddev /= frame_size;
 
   fp_dbg ("<guess> stddev=%" G_GUINT64_FORMAT "d, ip=%d, is_fp=%d, is_empty=%d", sq_stddev, invalid_percent, is_fp, is_empty);
 
@@ -1245,6 +1362,10 @@ elanspi_check_waitupdown_done (FpiDeviceElanSpi *self, enum elanspi_guess_result
 {
   enum elanspi_guess_result guess = elanspi_guess_image (self, self->last_image);
 
+  /* Anything but an empty frame hints at a finger being placed */
+  if (target == ELANSPI_GUESS_FINGERPRINT && guess != ELANSPI_GUESS_EMPTY)
+    fpi_ssm_poller_activity (&self->finger_poller);
+
   if (guess == ELANSPI_GUESS_UNKNOWN)
     return FALSE;
   if (guess == target)
@@ -1259,58 +1380,25 @@ elanspi_check_waitupdown_done (FpiDeviceElanSpi *self, enum elanspi_guess_result
     }
 }
 
-static int
-cmp_u16 (const void *a, const void *b)
-{
-  return (int) (*(guint16 *) a - *(guint16 *) b);
-}
-
 static void
 elanspi_process_frame (FpiDeviceElanSpi *self, const guint16 *data_in, guint8 *data_out)
 {
-  size_t frame_size = self->frame_width * self->frame_height;
-  guint16 data_in_sorted[frame_size];
-
-  for (int i = 0, offset = 0; i < self->frame_height; i += 1)
-    for (int j = 0; j < self->frame_width; j += 1)
-      data_in_sorted[offset++] = elanspi_lookup_pixel_with_rotation (self, data_in, i, j);
+  gsize frame_size = self->frame_width * self->frame_height;
+  g_autofree guint16 * frame = g_new (guint16, frame_size);
+  const gsize ranks[] = {
+    0, frame_size * 3 / 10, frame_size * 65 / 100, frame_size - 1
+  };
+  const guint8 values[] = { 0, 99, 155, 255 };
+  guint16 lvl[G_N_ELEMENTS (ranks)];
 
-  qsort (data_in_sorted, frame_size, 2, cmp_u16);
-  guint16 lvl0 = data_in_sorted[0];
-  guint16 lvl1 = data_in_sorted[frame_size * 3 / 10];
-  guint16 lvl2 = data_in_sorted[frame_size * 65 / 100];
-  guint16 lvl3 = data_in_sorted[frame_size - 1];
+  elanspi_rotate_frame (self, frame, data_in);
 
-  lvl1 = MAX (lvl1, lvl0 + 1);
-  lvl2 = MAX (lvl2, lvl1 + 1);
-  lvl3 = MAX (lvl3, lvl2 + 1);
+  fpi_sensor_select_ranks (frame, frame_size, ranks, lvl, G_N_ELEMENTS (ranks));
+  lvl[1] = MAX (lvl[1], lvl[0] + 1);
+  lvl[2] = MAX (lvl[2], lvl[1] + 1);
+  lvl[3] = MAX (lvl[3], lvl[2] + 1);
 
-  for (int i = 0; i < self->frame_height; i += 1)
-    {
-      for (int j = 0; j < self->frame_width; j += 1)
-        {
-          guint16 px = elanspi_lookup_pixel_with_rotation (self, data_in, i, j);
-          if (px < lvl0)
-            {
-              px = 0;
-            }
-          else if (px > lvl3)
-            {
-              px = 255;
-            }
-          else
-            {
-              if (lvl0 <= px && px < lvl1)
-                px = (px - lvl0) * 99 / (lvl1 - lvl0);
-              else if (lvl1 <= px && px < lvl2)
-                px = 99 + ((px - lvl1) * 56 / (lvl2 - lvl1));
-              else /* (lvl2 <= px && px <= lvl3) */
-                px = 155 + ((px - lvl2) * 100 / (lvl3 - lvl2));
-            }
-          *data_out = px;
-          data_out += 1;
-        }
-    }
+  fpi_sensor_map_levels (data_out, frame, frame_size, lvl, values, G_N_ELEMENTS (lvl));
 }
 
 static unsigned char
@@ -1323,7 +1411,6 @@ static void
 elanspi_fp_frame_stitch_and_submit (FpiDeviceElanSpi *self)
 {
   g_autoptr(FpImage) img = NULL;
-  g_autoptr(FpImage) scaled = NULL;
   struct fpi_frame_asmbl_ctx assembling_ctx = {
     .image_width = (self->frame_width * 3) / 2,
 
@@ -1338,12 +1425,12 @@ elanspi_fp_frame_stitch_and_submit (FpiDeviceElanSpi *self)
 
   fpi_do_movement_estimation (&assembling_ctx, frame_start);
   img = fpi_assemble_frames (&assembling_ctx, frame_start);
-  scaled = fpi_image_resize (img, 2, 2);
+  fpi_image_set_upscale (img, 2, 2);
 
-  scaled->flags |= FPI_IMAGE_PARTIAL | FPI_IMAGE_COLORS_INVERTED;
+  img->flags |= FPI_IMAGE_PARTIAL | FPI_IMAGE_COLORS_INVERTED;
 
   /* submit image */
-  fpi_image_device_image_captured (FP_IMAGE_DEVICE (self), g_steal_pointer (&scaled));
+  fpi_image_device_image_captured (FP_IMAGE_DEVICE (self), g_steal_pointer (&img));
 
   /* clean out frame data */
   g_slist_free_full (g_steal_pointer (&self->fp_frame_list), g_free);
@@ -1428,7 +1515,7 @@ elanspi_fp_frame_handler (FpiSsm *ssm, FpiDeviceElanSpi *self)
 
       /* append image */
       this_frame = g_malloc0 (self->sensor_height * self->sensor_width + sizeof (struct fpi_frame));
-      elanspi_correct_with_bg (self, self->last_image);
+      elanspi_correct_with_bg (self, self->last_image, self->last_image);
       elanspi_process_frame (self, self->last_image, this_frame->data);
 
       if (self->fp_frame_list)
@@ -1471,6 +1558,7 @@ elanspi_fp_capture_ssm_handler (FpiSsm *ssm, FpDevice *dev)
     {
     case ELANSPI_FPCAPT_INIT:
       self->finger_wait_debounce = 0;
+      fpi_ssm_poller_activity (&self->finger_poller);
 
       fpi_ssm_next_state (ssm);
       return;
@@ -1502,7 +1590,7 @@ elanspi_fp_capture_ssm_handler (FpiSsm *ssm, FpDevice *dev)
       if (!elanspi_check_waitupdown_done (self, ELANSPI_GUESS_FINGERPRINT))
         {
           /* take another image */
-          fpi_ssm_jump_to_state (ssm, ELANSPI_FPCAPT_WAITDOWN_CAPTURE);
+          fpi_ssm_jump_to_state_polled (ssm, ELANSPI_FPCAPT_WAITDOWN_CAPTURE, &self->finger_poller);
           return;
         }
 
@@ -1661,6 +1749,8 @@ fpi_device_elanspi_init (FpiDeviceElanSpi *self)
 {
   self->spi_fd = -1;
   self->sensor_id = 0xff;
+  fpi_ssm_poller_init (&self->finger_poller, 0,
+                       ELANSPI_WAITDOWN_MAX_DELAY, ELANSPI_WAITDOWN_BACKOFF_AFTER);
 }
 
 static void
@@ -336,6 +336,11 @@ static const FpIdEntry elanspi_id_table[] = {
 
 #define ELANSPI_MIN_FRAMES_DEBOUNCE 2
 
+/* Waiting for a finger polls back to back at first, and backs off to
+ * this delay once nothing happened for a while */
+#define ELANSPI_WAITDOWN_MAX_DELAY 100
+#define ELANSPI_WAITDOWN_BACKOFF_AFTER 2000
+
 #define ELANSPI_SWIPE_FRAMES_DISCARD 1
 #define ELANSPI_MIN_FRAMES_SWIPE (7 + ELANSPI_SWIPE_FRAMES_DISCARD)
 #define ELANSPI_MAX_FRAMES_SWIPE (20 + ELANSPI_SWIPE_FRAMES_DISCARD)
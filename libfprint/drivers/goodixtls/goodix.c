@@ -22,8 +22,6 @@
 #include <gio/gio.h>
 #include <glib.h>
 #include <gusb.h>
-#include <openssl/ssl.h>
-#include <pthread.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -33,9 +31,10 @@
 #include "goodixtls.h"
 
 typedef struct {
-  pthread_t tls_server_thread;
-  gint tls_server_sock;
-  SSL_CTX *tls_server_ctx;
+  GoodixTlsServer tls_server;
+  FpiSsm *tls_ssm;
+  GSource *tls_timeout;
+  GByteArray *tls_data;
 
   GSource *timeout;
 
@@ -54,6 +53,9 @@ typedef struct {
 G_DEFINE_ABSTRACT_TYPE_WITH_PRIVATE(FpiDeviceGoodixTls, fpi_device_goodixtls,
                                     FP_TYPE_IMAGE_DEVICE);
 
+// Unread application data is dropped beyond this, nothing consumes it yet.
+#define GOODIX_TLS_MAX_DATA (64 * 1024)
+
 // TODO remove every GDestroyNotify
 // TODO add cmd timeouts
 
@@ -311,6 +313,54 @@ void goodix_receive_protocol(FpDevice *dev, guint8 *data, guint32 length) {
   goodix_receive_done(dev, payload, payload_len, NULL);
 }
 
+void goodix_receive_tls(FpDevice *dev, guint8 *data, guint16 length) {
+  FpiDeviceGoodixTls *self = FPI_DEVICE_GOODIXTLS(dev);
+  FpiDeviceGoodixTlsPrivate *priv =
+      fpi_device_goodixtls_get_instance_private(self);
+  FpiSsm *ssm = priv->tls_ssm;
+  GError *error = NULL;
+  gboolean established;
+
+  if (!ssm) {
+    // Application data is kept until goodix_tls_steal_data() is called.
+    if (!goodix_tls_server_receive(&priv->tls_server, data, length,
+                                   priv->tls_data, &error) ||
+        !goodix_send_tls(dev, &error)) {
+      if (fpi_device_get_current_action(dev) == FPI_DEVICE_ACTION_NONE) {
+        fp_warn("Dropping TLS message: %s", error->message);
+        g_error_free(error);
+      } else {
+        fpi_image_device_session_error(FP_IMAGE_DEVICE(dev), error);
+      }
+      return;
+    }
+
+    if (priv->tls_data->len > GOODIX_TLS_MAX_DATA) {
+      fp_warn("Dropping %u bytes of unread TLS data", priv->tls_data->len);
+      g_byte_array_set_size(priv->tls_data, 0);
+    }
+    return;
+  }
+
+  g_clear_pointer(&priv->tls_timeout, g_source_destroy);
+
+  if (!goodix_tls_server_handshake(&priv->tls_server, data, length,
+                                   &established, &error) ||
+      !goodix_send_tls(dev, &error)) {
+    priv->tls_ssm = NULL;
+    fpi_ssm_mark_failed(ssm, error);
+    return;
+  }
+
+  if (!established) {
+    goodix_tls_wait(dev);
+    return;
+  }
+
+  priv->tls_ssm = NULL;
+  fpi_ssm_next_state(ssm);
+}
+
 void goodix_receive_pack(FpDevice *dev, guint8 *data, guint32 length) {
   FpiDeviceGoodixTls *self = FPI_DEVICE_GOODIXTLS(dev);
   FpiDeviceGoodixTlsPrivate *priv =
@@ -335,8 +385,7 @@ void goodix_receive_pack(FpDevice *dev, guint8 *data, guint32 length) {
       break;
 
     case GOODIX_FLAGS_TLS:
-      // TLS message sending it to TLS server.
-      // TODO
+      goodix_receive_tls(dev, payload, payload_len);
       break;
 
     default:
@@ -376,6 +425,29 @@ void goodix_receive_timeout_cb(FpDevice *dev, gpointer user_data) {
   goodix_receive_done(dev, NULL, 0, error);
 }
 
+void goodix_tls_timeout_cb(FpDevice *dev, gpointer user_data) {
+  FpiDeviceGoodixTls *self = FPI_DEVICE_GOODIXTLS(dev);
+  FpiDeviceGoodixTlsPrivate *priv =
+      fpi_device_goodixtls_get_instance_private(self);
+  FpiSsm *ssm = priv->tls_ssm;
+
+  priv->tls_timeout = NULL;
+  priv->tls_ssm = NULL;
+
+  fpi_ssm_mark_failed(ssm, g_error_new(G_IO_ERROR, G_IO_ERROR_TIMED_OUT,
+                                       "TLS handshake timed out"));
+}
+
+void goodix_tls_wait(FpDevice *dev) {
+  FpiDeviceGoodixTls *self = FPI_DEVICE_GOODIXTLS(dev);
+  FpiDeviceGoodixTlsPrivate *priv =
+      fpi_device_goodixtls_get_instance_private(self);
+
+  g_clear_pointer(&priv->tls_timeout, g_source_destroy);
+  priv->tls_timeout = fpi_device_add_timeout(dev, GOODIX_TIMEOUT,
+                                             goodix_tls_timeout_cb, NULL, NULL);
+}
+
 void goodix_receive_data(FpDevice *dev) {
   FpiDeviceGoodixTls *self = FPI_DEVICE_GOODIXTLS(dev);
   FpiDeviceGoodixTlsClass *class = FPI_DEVICE_GOODIXTLS_GET_CLASS(self);
@@ -430,6 +502,20 @@ gboolean goodix_send_pack(FpDevice *dev, guint8 flags, guint8 *payload,
   return goodix_send_data(dev, data, data_len, g_free, error);
 }
 
+gboolean goodix_send_tls(FpDevice *dev, GError **error) {
+  FpiDeviceGoodixTls *self = FPI_DEVICE_GOODIXTLS(dev);
+  FpiDeviceGoodixTlsPrivate *priv =
+      fpi_device_goodixtls_get_instance_private(self);
+  guint8 *data;
+  guint16 length;
+
+  while ((data = goodix_tls_server_read_output(&priv->tls_server, &length)))
+    if (!goodix_send_pack(dev, GOODIX_FLAGS_TLS, data, length, g_free, error))
+      return FALSE;
+
+  return TRUE;
+}
+
 void goodix_send_protocol(FpDevice *dev, guint8 cmd, guint8 *payload,
                           guint16 length, GDestroyNotify free_func,
                           gboolean calc_checksum, guint timeout_ms,
@@ -946,6 +1032,7 @@ gboolean goodix_dev_init(FpDevice *dev, GError **error) {
   priv->user_data = NULL;
   priv->data = NULL;
   priv->length = 0;
+  priv->tls_data = g_byte_array_new();
 
   return g_usb_device_claim_interface(fpi_device_get_usb_device(dev),
                                       class->interface, 0, error);
@@ -958,7 +1045,11 @@ gboolean goodix_dev_deinit(FpDevice *dev, GError **error) {
       fpi_device_goodixtls_get_instance_private(self);
 
   if (priv->timeout) g_source_destroy(priv->timeout);
+  g_clear_pointer(&priv->tls_timeout, g_source_destroy);
   g_free(priv->data);
+  priv->tls_ssm = NULL;
+  goodix_tls_server_deinit(&priv->tls_server);
+  g_clear_pointer(&priv->tls_data, g_byte_array_unref);
 
   return g_usb_device_release_interface(fpi_device_get_usb_device(dev),
                                         class->interface, 0, error);
@@ -972,23 +1063,80 @@ gboolean goodix_dev_deinit(FpDevice *dev, GError **error) {
 
 enum tls_states {
   TLS_SERVER_INIT,
-  TLS_SERVER_HANDSHAKE_INIT,
+  TLS_SERVER_HANDSHAKE,
+  TLS_SERVER_ESTABLISHED,
   TLS_NUM_STATES,
 };
 
+static void goodix_tls_handshake_requested(FpDevice *dev, gpointer user_data,
+                                           GError *error) {
+  FpiDeviceGoodixTls *self = FPI_DEVICE_GOODIXTLS(dev);
+  FpiDeviceGoodixTlsPrivate *priv =
+      fpi_device_goodixtls_get_instance_private(self);
+
+  // On success the handshake continues in goodix_receive_tls().
+  if (error && priv->tls_ssm) {
+    g_clear_pointer(&priv->tls_timeout, g_source_destroy);
+    priv->tls_ssm = NULL;
+    fpi_ssm_mark_failed(user_data, error);
+    return;
+  }
+
+  if (error) g_error_free(error);
+}
+
+static void goodix_tls_established(FpDevice *dev, gpointer user_data,
+                                   GError *error) {
+  if (error) {
+    fpi_ssm_mark_failed(user_data, error);
+    return;
+  }
+
+  fpi_ssm_next_state(user_data);
+}
+
 void goodix_tls_run_state(FpiSsm *ssm, FpDevice *dev) {
+  FpiDeviceGoodixTls *self = FPI_DEVICE_GOODIXTLS(dev);
+  FpiDeviceGoodixTlsPrivate *priv =
+      fpi_device_goodixtls_get_instance_private(self);
+  GError *error = NULL;
+
   switch (fpi_ssm_get_cur_state(ssm)) {
     case TLS_SERVER_INIT:
-      tls_server_init(ssm);
+      goodix_tls_server_deinit(&priv->tls_server);
+      g_byte_array_set_size(priv->tls_data, 0);
+
+      if (!goodix_tls_server_init(&priv->tls_server, &error)) {
+        fpi_ssm_mark_failed(ssm, error);
+        break;
+      }
+
+      fpi_ssm_next_state(ssm);
       break;
 
-    case TLS_SERVER_HANDSHAKE_INIT:
-      tls_server_handshake_init();
+    case TLS_SERVER_HANDSHAKE:
+      // The sensor answers with its ClientHello as a TLS packet.
+      priv->tls_ssm = ssm;
+      goodix_tls_wait(dev);
+      goodix_send_request_tls_connection(dev, goodix_tls_handshake_requested,
+                                         ssm);
+      break;
+
+    case TLS_SERVER_ESTABLISHED:
+      goodix_send_tls_successfully_established(dev, goodix_tls_established,
+                                               ssm);
       break;
   }
 }
 
 void goodix_tls_complete(FpiSsm *ssm, FpDevice *dev, GError *error) {
+  FpiDeviceGoodixTls *self = FPI_DEVICE_GOODIXTLS(dev);
+  FpiDeviceGoodixTlsPrivate *priv =
+      fpi_device_goodixtls_get_instance_private(self);
+
+  g_clear_pointer(&priv->tls_timeout, g_source_destroy);
+  priv->tls_ssm = NULL;
+
   fpi_image_device_activate_complete(FP_IMAGE_DEVICE(dev), error);
 }
 
@@ -997,6 +1145,17 @@ void goodix_tls(FpDevice *dev) {
                 goodix_tls_complete);
 }
 
+GByteArray *goodix_tls_steal_data(FpDevice *dev) {
+  FpiDeviceGoodixTls *self = FPI_DEVICE_GOODIXTLS(dev);
+  FpiDeviceGoodixTlsPrivate *priv =
+      fpi_device_goodixtls_get_instance_private(self);
+  GByteArray *data = priv->tls_data;
+
+  priv->tls_data = g_byte_array_new();
+
+  return data;
+}
+
 // ---- TLS SECTION END ----
 
 static void fpi_device_goodixtls_init(FpiDeviceGoodixTls *self) {}
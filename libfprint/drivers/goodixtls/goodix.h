@@ -101,6 +101,8 @@ void goodix_receive_firmware_version(FpDevice *dev, guint8 *data,
 
 void goodix_receive_protocol(FpDevice *dev, guint8 *data, guint32 length);
 
+void goodix_receive_tls(FpDevice *dev, guint8 *data, guint16 length);
+
 void goodix_receive_pack(FpDevice *dev, guint8 *data, guint32 length);
 
 void goodix_receive_data_cb(FpiUsbTransfer *transfer, FpDevice *dev,
@@ -108,6 +110,10 @@ void goodix_receive_data_cb(FpiUsbTransfer *transfer, FpDevice *dev,
 
 void goodix_receive_timeout_cb(FpDevice *dev, gpointer user_data);
 
+void goodix_tls_timeout_cb(FpDevice *dev, gpointer user_data);
+
+void goodix_tls_wait(FpDevice *dev);
+
 void goodix_receive_data(FpDevice *dev);
 
 // ---- GOODIX RECEIVE SECTION END ----
@@ -123,6 +129,8 @@ gboolean goodix_send_pack(FpDevice *dev, guint8 flags, guint8 *payload,
                           guint16 length, GDestroyNotify free_func,
                           GError **error);
 
+gboolean goodix_send_tls(FpDevice *dev, GError **error);
+
 void goodix_send_protocol(FpDevice *dev, guint8 cmd, guint8 *payload,
                           guint16 length, GDestroyNotify free_func,
                           gboolean calc_checksum, guint timeout_ms,
@@ -231,4 +239,6 @@ void goodix_tls_complete(FpiSsm *ssm, FpDevice *dev, GError *error);
 
 void goodix_tls(FpDevice *dev);
 
+GByteArray *goodix_tls_steal_data(FpDevice *dev);
+
 // ---- TLS SECTION END ----
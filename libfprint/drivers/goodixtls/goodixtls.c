@@ -17,25 +17,18 @@
 // License along with this library; if not, write to the Free Software
 // Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
 
-#include <arpa/inet.h>
-#include <errno.h>
 #include <glib.h>
-#include <netinet/in.h>
-#include <openssl/crypto.h>
 #include <openssl/err.h>
 #include <openssl/ssl.h>
-#include <pthread.h>
-#include <signal.h>
 #include <string.h>
-#include <sys/socket.h>
 
 #include "drivers_api.h"
 #include "goodixtls.h"
 
-int sock;
-FpiSsm *fpi_ssm;
-pthread_t server;
-SSL_CTX *ctx;
+static const guint8 goodix_511_psk_0[] = {
+    0xba, 0x1a, 0x86, 0x03, 0x7c, 0x1d, 0x3c, 0x71, 0xc3, 0xaf, 0x34,
+    0x49, 0x55, 0xbd, 0x69, 0xa9, 0xa9, 0x86, 0x1d, 0x9e, 0x91, 0x1f,
+    0xa2, 0x49, 0x85, 0xb6, 0x77, 0xe8, 0xdb, 0xd7, 0x2d, 0x43};
 
 static unsigned int tls_server_psk_server_callback(SSL *ssl,
                                                    const char *identity,
@@ -46,167 +39,149 @@ static unsigned int tls_server_psk_server_callback(SSL *ssl,
     return 0;
   }
 
-  psk = (unsigned char *)&goodix_511_psk_0;
+  memcpy(psk, goodix_511_psk_0, sizeof(goodix_511_psk_0));
 
   return sizeof(goodix_511_psk_0);
 }
 
-int tls_server_create_socket(int port) {
-  int s;
-  struct sockaddr_in addr;
-
-  addr.sin_family = AF_INET;
-  addr.sin_port = htons(port);
-  addr.sin_addr.s_addr = htonl(INADDR_ANY);
-
-  s = socket(AF_INET, SOCK_STREAM, 0);
-  if (s < 0) {
-    fp_dbg("Unable to create TLS server socket");
-    fpi_ssm_mark_failed(fpi_ssm, fpi_device_error_new_msg(
-                                     FP_DEVICE_ERROR_GENERAL,
-                                     "Unable to create TLS server socket"));
-    return -1;
+static void tls_server_set_error(GError **error, const gchar *msg) {
+  gulong err = ERR_get_error();
+  gchar buf[256];
+
+  if (!err) {
+    g_propagate_error(error,
+                      fpi_device_error_new_msg(FP_DEVICE_ERROR_PROTO, "%s", msg));
+    return;
   }
 
-  if (bind(s, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
-    fp_dbg("Unable to bind to TLS server socket");
-    fpi_ssm_mark_failed(fpi_ssm, fpi_device_error_new_msg(
-                                     FP_DEVICE_ERROR_GENERAL,
-                                     "Unable to bind to TLS server socket"));
-    return -1;
+  ERR_error_string_n(err, buf, sizeof(buf));
+  ERR_clear_error();
+  g_propagate_error(error, fpi_device_error_new_msg(FP_DEVICE_ERROR_PROTO,
+                                                    "%s: %s", msg, buf));
+}
+
+gboolean goodix_tls_server_init(GoodixTlsServer *server, GError **error) {
+  server->ctx = SSL_CTX_new(TLS_server_method());
+  if (!server->ctx) {
+    tls_server_set_error(error, "Unable to create TLS server context");
+    return FALSE;
   }
 
-  if (listen(s, 1) < 0) {
-    fp_dbg("Unable to listen to TLS server socket");
-    fpi_ssm_mark_failed(fpi_ssm, fpi_device_error_new_msg(
-                                     FP_DEVICE_ERROR_GENERAL,
-                                     "Unable to listen to TLS server socket"));
-    return -1;
+  SSL_CTX_set_min_proto_version(server->ctx, TLS1_2_VERSION);
+  SSL_CTX_set_max_proto_version(server->ctx, TLS1_2_VERSION);
+  SSL_CTX_set_cipher_list(server->ctx, "ALL");
+  SSL_CTX_set_psk_server_callback(server->ctx, tls_server_psk_server_callback);
+
+  server->ssl = SSL_new(server->ctx);
+  server->rbio = BIO_new(BIO_s_mem());
+  server->wbio = BIO_new(BIO_s_mem());
+  if (!server->ssl || !server->rbio || !server->wbio) {
+    tls_server_set_error(error, "Unable to create TLS server session");
+    BIO_free(server->rbio);
+    BIO_free(server->wbio);
+    server->rbio = NULL;
+    server->wbio = NULL;
+    goodix_tls_server_deinit(server);
+    return FALSE;
   }
 
-  return s;
+  // An empty read BIO means we are waiting for the sensor, not EOF.
+  BIO_set_mem_eof_return(server->rbio, -1);
+  SSL_set_bio(server->ssl, server->rbio, server->wbio);
+  SSL_set_accept_state(server->ssl);
+
+  return TRUE;
 }
 
-SSL_CTX *tls_server_create_ctx(void) {
-  const SSL_METHOD *method;
+void goodix_tls_server_deinit(GoodixTlsServer *server) {
+  // The BIOs are freed together with the session.
+  g_clear_pointer(&server->ssl, SSL_free);
+  g_clear_pointer(&server->ctx, SSL_CTX_free);
+  server->rbio = NULL;
+  server->wbio = NULL;
+}
 
-  method = SSLv23_server_method();
+gboolean goodix_tls_server_handshake(GoodixTlsServer *server, guint8 *data,
+                                     guint16 length, gboolean *established,
+                                     GError **error) {
+  int ret;
 
-  ctx = SSL_CTX_new(method);
-  if (!ctx) {
-    return NULL;
-  }
+  *established = FALSE;
 
-  return ctx;
-}
+  if (length && BIO_write(server->rbio, data, length) != length) {
+    tls_server_set_error(error, "Unable to buffer TLS record");
+    return FALSE;
+  }
 
-void tls_server_config_ctx(void) {
-  SSL_CTX_set_ecdh_auto(ctx, 1);
-  SSL_CTX_set_dh_auto(ctx, 1);
-  SSL_CTX_set_min_proto_version(ctx, TLS1_2_VERSION);
-  SSL_CTX_set_max_proto_version(ctx, TLS1_2_VERSION);
-  SSL_CTX_set_cipher_list(ctx, "ALL");
+  ret = SSL_do_handshake(server->ssl);
+  if (ret == 1) {
+    fp_dbg("TLS handshake done, cipher: %s", SSL_get_cipher(server->ssl));
+    *established = TRUE;
+    return TRUE;
+  }
 
-  SSL_CTX_set_psk_server_callback(ctx, tls_server_psk_server_callback);
-}
+  switch (SSL_get_error(server->ssl, ret)) {
+    case SSL_ERROR_WANT_READ:
+    case SSL_ERROR_WANT_WRITE:
+      // Records to send are queued in the write BIO.
+      return TRUE;
 
-void *tls_server_loop(void *arg) {
-  // Handle connections
-  while (1) {
-    struct sockaddr_in addr;
-    guint len = sizeof(addr);
-    SSL *ssl;
-    const char reply[] = "Hello Goodix\n";
-
-    int client = accept(sock, (struct sockaddr *)&addr, &len);
-    if (client < 0) {
-      printf("%s\n", strerror(errno));
-      fp_dbg("TLS server unable to accept request");
-      kill(getpid(), SIGKILL);
-      // exit(EXIT_FAILURE);
-    }
-
-    ssl = SSL_new(ctx);
-    SSL_set_fd(ssl, client);
-
-    if (SSL_accept(ssl) <= 0) {
-      ERR_print_errors_fp(stderr);
-    } else {
-      SSL_write(ssl, reply, strlen(reply));
-    }
-    SSL_shutdown(ssl);
-    SSL_free(ssl);
-    close(client);
-
-    kill(getpid(), SIGKILL);
+    default:
+      tls_server_set_error(error, "TLS handshake failed");
+      return FALSE;
   }
 }
 
-void tls_server_stop(void) {
-  close(sock);
-  SSL_CTX_free(ctx);
-}
-
-void *tls_server_handshake_loop(void *arg) {
-  struct sockaddr_in addr;
-  guint len = sizeof(addr);
-  SSL *ssl;
-
-  int client = accept(sock, (struct sockaddr *)&addr, &len);
-  if (client < 0) {
-    printf("%s\n", strerror(errno));
-    fp_dbg("TLS server unable to accept socket request");
-  } else {
-    ssl = SSL_new(ctx);
-    SSL_set_fd(ssl, client);
-
-    if (SSL_accept(ssl) <= 0) {
-      printf("%s\n", strerror(errno));
-      fp_dbg("TLS server unable to accept handshake request");
-    }
+gboolean goodix_tls_server_receive(GoodixTlsServer *server, guint8 *data,
+                                   guint16 length, GByteArray *plaintext,
+                                   GError **error) {
+  guint8 buf[SSL3_RT_MAX_PLAIN_LENGTH];
+  int ret;
+
+  if (!server->ssl || !SSL_is_init_finished(server->ssl)) {
+    g_propagate_error(error,
+                      fpi_device_error_new_msg(FP_DEVICE_ERROR_PROTO,
+                                               "No TLS connection established"));
+    return FALSE;
   }
-  return 0;
-}
 
-void tls_server_handshake_init(void) {
-  int err = pthread_create(&server, NULL, &tls_server_handshake_loop, NULL);
-  if (err != 0) {
-    fp_dbg("Unable to create TLS server thread");
-    fpi_ssm_mark_failed(fpi_ssm, fpi_device_error_new_msg(
-                                     FP_DEVICE_ERROR_GENERAL,
-                                     "Unable to create TLS server thread"));
-  } else {
-    fp_dbg("TLS server thread created");
-    fpi_ssm_next_state(fpi_ssm);
+  if (length && BIO_write(server->rbio, data, length) != length) {
+    tls_server_set_error(error, "Unable to buffer TLS record");
+    return FALSE;
   }
-}
 
-void tls_server_init(FpiSsm *ssm) {
-  fpi_ssm = ssm;
+  // A packet can hold several records, or only part of one.
+  while ((ret = SSL_read(server->ssl, buf, sizeof(buf))) > 0)
+    g_byte_array_append(plaintext, buf, ret);
 
-  SSL_load_error_strings();
-  OpenSSL_add_ssl_algorithms();
+  switch (SSL_get_error(server->ssl, ret)) {
+    case SSL_ERROR_WANT_READ:
+    case SSL_ERROR_WANT_WRITE:
+      return TRUE;
 
-  ctx = tls_server_create_ctx();
+    case SSL_ERROR_ZERO_RETURN:
+      g_propagate_error(error, fpi_device_error_new_msg(
+                                   FP_DEVICE_ERROR_PROTO,
+                                   "TLS connection closed by the sensor"));
+      return FALSE;
 
-  if (ctx == NULL) {
-    fp_dbg("Unable to create TLS server context");
-    fpi_ssm_mark_failed(
-        ssm, fpi_device_error_new_msg(FP_DEVICE_ERROR_GENERAL,
-                                      "Unable to create TLS server context"));
-    return;
+    default:
+      tls_server_set_error(error, "Unable to decrypt TLS record");
+      return FALSE;
   }
+}
 
-  tls_server_config_ctx();
+guint8 *goodix_tls_server_read_output(GoodixTlsServer *server,
+                                      guint16 *length) {
+  size_t pending = BIO_ctrl_pending(server->wbio);
+  guint8 *data;
 
-  sock = tls_server_create_socket(GOODIX_TLS_SERVER_PORT);
-  if (sock == -1) {
-    fp_dbg("Unable to create TLS server socket");
-    fpi_ssm_mark_failed(
-        ssm, fpi_device_error_new_msg(FP_DEVICE_ERROR_GENERAL,
-                                      "Unable to create TLS server context"));
-    return;
-  }
+  if (!pending) return NULL;
+
+  // A flight larger than a single packet is split over several calls.
+  *length = MIN(pending, G_MAXUINT16);
+  data = g_malloc(*length);
+  BIO_read(server->wbio, data, *length);
 
-  fpi_ssm_next_state(ssm);
+  return data;
 }
@@ -19,25 +19,29 @@
 
 #pragma once
 
-#define GOODIX_TLS_SERVER_PORT 4433
+#include <glib.h>
+#include <openssl/ssl.h>
 
-static const guint8 goodix_511_psk_0[] = {
-    0xba, 0x1a, 0x86, 0x03, 0x7c, 0x1d, 0x3c, 0x71, 0xc3, 0xaf, 0x34,
-    0x49, 0x55, 0xbd, 0x69, 0xa9, 0xa9, 0x86, 0x1d, 0x9e, 0x91, 0x1f,
-    0xa2, 0x49, 0x85, 0xb6, 0x77, 0xe8, 0xdb, 0xd7, 0x2d, 0x43};
+// TLS server the sensor connects to. Records are exchanged through memory
+// BIOs and carried in GOODIX_FLAGS_TLS packets, see goodix_receive_tls().
+typedef struct {
+  SSL_CTX *ctx;
+  SSL *ssl;
+  BIO *rbio;  // Records received from the sensor, owned by ssl.
+  BIO *wbio;  // Records to be sent to the sensor, owned by ssl.
+} GoodixTlsServer;
 
-SSL_CTX *tls_server_create_ctx(void);
+gboolean goodix_tls_server_init(GoodixTlsServer *server, GError **error);
 
-int tls_server_create_socket(int port);
+void goodix_tls_server_deinit(GoodixTlsServer *server);
 
-void tls_server_config_ctx(void);
+gboolean goodix_tls_server_handshake(GoodixTlsServer *server, guint8 *data,
+                                     guint16 length, gboolean *established,
+                                     GError **error);
 
-__attribute__((__noreturn__)) void *tls_server_loop(void *arg);
+gboolean goodix_tls_server_receive(GoodixTlsServer *server, guint8 *data,
+                                   guint16 length, GByteArray *plaintext,
+                                   GError **error);
 
-void tls_server_stop(void);
-
-void *tls_server_handshake_loop(void *arg);
-
-void tls_server_handshake_init(void);
-
-void tls_server_init(FpiSsm *ssm);
+guint8 *goodix_tls_server_read_output(GoodixTlsServer *server,
+                                      guint16 *length);
@@ -42,6 +42,13 @@
 #define NB1010_DEFAULT_TIMEOUT 500
 #define NB1010_TRANSITION_DELAY 50
 
+/* Polling for a finger backs off to this delay after a while */
+#define NB1010_POLL_MAX_DELAY 250
+#define NB1010_POLL_BACKOFF_AFTER 3000
+
+/* Readings above this mean that a finger is on the sensor */
+#define NB1010_FINGER_PRESENT 0x30
+
 /* Loop ssm states */
 enum {
   M_WAIT_PRINT,
@@ -91,6 +98,7 @@ struct _FpiDeviceNb1010
 {
   FpImageDevice parent;
   FpiSsm       *ssm;
+  FpiSsmPoller  poller;
   guint8       *scanline_buf;
   gboolean      deactivating;
   int           partial_received;
@@ -187,7 +195,7 @@ nb1010_check_fingerprint_cb (FpiUsbTransfer *transfer, FpDevice *dev,
       return;
     }
 
-  if (transfer->buffer[NB1010_SENSITIVITY_BIT] > 0x30)
+  if (transfer->buffer[NB1010_SENSITIVITY_BIT] > NB1010_FINGER_PRESENT)
     fpi_ssm_next_state (transfer->ssm);
   else
     fpi_ssm_jump_to_state (transfer->ssm, M_WAIT_PRINT);
@@ -353,7 +361,7 @@ m_loop_state (FpiSsm *ssm, FpDevice *_dev)
     {
     case M_WAIT_PRINT:
       /* Wait fingerprint scanning */
-      fpi_ssm_next_state_delayed (ssm, NB1010_TRANSITION_DELAY);
+      fpi_ssm_jump_to_state_polled (ssm, M_REQUEST_PRINT, &self->poller);
       break;
 
     case M_REQUEST_PRINT:
@@ -403,6 +411,7 @@ nb1010_dev_change_state (FpImageDevice *dev, FpiImageDeviceState state)
 
   if (state == FPI_IMAGE_DEVICE_STATE_AWAIT_FINGER_ON)
     {
+      fpi_ssm_poller_activity (&self->poller);
       ssm_loop = fpi_ssm_new (FP_DEVICE (dev), m_loop_state, M_LOOP_NUM_STATES);
       self->ssm = ssm_loop;
       fpi_ssm_start (ssm_loop, m_loop_complete);
@@ -418,6 +427,8 @@ static const FpIdEntry id_table[] = {
 static void
 fpi_device_nb1010_init (FpiDeviceNb1010 *self)
 {
+  fpi_ssm_poller_init (&self->poller, NB1010_TRANSITION_DELAY,
+                       NB1010_POLL_MAX_DELAY, NB1010_POLL_BACKOFF_AFTER);
 }
 
 static void
@@ -1,28 +0,0 @@
-/*
- * Code copied from gstreamer-plugins-bad gst/gdp/dataprotocol.c
- *
- * Copyright (C) <1999> Erik Walthinsen <omega@cse.ogi.edu>
- * Copyright (C) 2004,2006 Thomas Vander Stichele <thomas at apestaart dot org>
- * Copyright (C) 2014 Tim-Philipp Müller <tim centricular com>
- *
- * This library is free software; you can redistribute it and/or modify
- * it under the terms of the GNU Lesser General Public License as
- * published by the Free Software Foundation; either version 2.1 of the
- * License, or (at your option) any later version.
- *
- * This library is distributed in the hope that it will be useful, but
- * WITHOUT ANY WARRANTY; without even the implied warranty of
- * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
- * Lesser General Public License for more details.
- *
- * You should have received a copy of the GNU Lesser General Public
- * License along with this library; if not, write to the Free Software
- * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
- * 02110-1301 USA
- */
-
-#include <stdint.h>
-#include <stddef.h>
-
-uint16_t udf_crc (unsigned char *buffer,
-                  size_t         size);
@@ -74,9 +74,7 @@ struct _FpiDeviceUpeksonly
   FpiSsm       *loopsm;
 
   /* Do we really need multiple concurrent transfers? */
-  GCancellable                    *img_cancellable;
-  GPtrArray                       *img_transfers;
-  int                              num_flying;
+  FpiUsbStream                    *img_stream;
 
   GSList                          *rows;
   unsigned                         num_rows;
@@ -154,9 +152,9 @@ upeksonly_get_pixel (struct fpi_line_asmbl_ctx *ctx,
 static void
 free_img_transfers (FpiDeviceUpeksonly *sdev)
 {
-  g_cancellable_cancel (sdev->img_cancellable);
-  g_clear_object (&sdev->img_cancellable);
-  g_clear_pointer (&sdev->img_transfers, g_ptr_array_unref);
+  /* On error the stream may still be running, freeing it cancels the
+   * transfers and releases it once they have returned. */
+  g_clear_pointer (&sdev->img_stream, fpi_usb_stream_free);
 }
 
 static void
@@ -187,9 +185,9 @@ cancel_img_transfers (FpImageDevice *dev)
 {
   FpiDeviceUpeksonly *self = FPI_DEVICE_UPEKSONLY (dev);
 
-  g_cancellable_cancel (self->img_cancellable);
-
-  if (self->num_flying == 0)
+  if (fpi_usb_stream_is_running (self->img_stream))
+    fpi_usb_stream_stop (self->img_stream);
+  else
     last_transfer_killed (dev);
 }
 
@@ -498,25 +496,21 @@ handle_packet (FpImageDevice *dev, unsigned char *data)
 }
 
 static void
-img_data_cb (FpiUsbTransfer *transfer, FpDevice *device,
-             gpointer user_data, GError *error)
+img_stream_stopped_cb (FpiUsbStream *stream, FpDevice *device,
+                       gpointer user_data, GError *error)
+{
+  g_clear_error (&error);
+  last_transfer_killed (FP_IMAGE_DEVICE (device));
+}
+
+static void
+img_data_cb (FpiUsbStream *stream, FpiUsbTransfer *transfer,
+             FpDevice *device, gpointer user_data, GError *error)
 {
   FpImageDevice *dev = FP_IMAGE_DEVICE (device);
   FpiDeviceUpeksonly *self = FPI_DEVICE_UPEKSONLY (dev);
   int i;
 
-  self->num_flying--;
-
-  if (self->killing_transfers)
-    {
-      if (self->num_flying == 0)
-        last_transfer_killed (dev);
-
-      /* don't care about error or success if we're terminating */
-      g_clear_error (&error);
-      return;
-    }
-
   /* NOTE: The old code assume 4096 bytes are received each time
    * but there is no reason we need to enforce that. However, we
    * always need full lines. */
@@ -551,105 +545,63 @@ img_data_cb (FpiUsbTransfer *transfer, FpDevice *device,
         return;
       handle_packet (dev, transfer->buffer + i);
     }
-
-  if (is_capturing (self))
-    {
-      fpi_usb_transfer_submit (fpi_usb_transfer_ref (transfer),
-                               0,
-                               self->img_cancellable,
-                               img_data_cb,
-                               user_data);
-      self->num_flying++;
-    }
 }
 
 /***** STATE MACHINE HELPERS *****/
 
-struct write_regs_data
-{
-  FpDevice                    *dev;
-  FpiSsm                      *ssm;
-  FpiUsbTransfer              *transfer;
-  const struct sonly_regwrite *regs;
-  size_t                       num_regs;
-  size_t                       regs_written;
-};
-
 static void
-write_regs_finished (struct write_regs_data *wrdata, GError *error)
+write_regs_cb (FpDevice *device, gpointer user_data, GError *error)
 {
+  FpiSsm *ssm = user_data;
+
   if (!error)
-    fpi_ssm_next_state (wrdata->ssm);
+    fpi_ssm_next_state (ssm);
   else
-    fpi_ssm_mark_failed (wrdata->ssm, error);
-
-  g_free (wrdata);
+    fpi_ssm_mark_failed (ssm, error);
 }
 
-static void write_regs_iterate (struct write_regs_data *wrdata);
-
 static void
-write_regs_cb (FpiUsbTransfer *transfer, FpDevice *device,
-               gpointer user_data, GError *error)
+sm_write_regs (FpiSsm                      *ssm,
+               FpDevice                    *dev,
+               const struct sonly_regwrite *regs,
+               size_t                       num_regs)
 {
-  struct write_regs_data *wrdata = user_data;
+  g_autoptr(GPtrArray) transfers = g_ptr_array_new ();
+  size_t i;
 
-  if (error)
+  /* Each register needs its own control transfer, but they are all
+   * queued up at once rather than waiting for every single one. */
+  for (i = 0; i < num_regs; i++)
     {
-      write_regs_finished (wrdata, error);
-      return;
-    }
-
-  wrdata->regs_written++;
-  write_regs_iterate (wrdata);
-}
+      FpiUsbTransfer *transfer;
 
-static void
-write_regs_iterate (struct write_regs_data *wrdata)
-{
-  FpiUsbTransfer *transfer;
-  const struct sonly_regwrite *regwrite;
+      fp_dbg ("set %02x=%02x", regs[i].reg, regs[i].value);
+
+      transfer = fpi_usb_transfer_new (dev);
+      fpi_usb_transfer_fill_control (transfer,
+                                     G_USB_DEVICE_DIRECTION_HOST_TO_DEVICE,
+                                     G_USB_DEVICE_REQUEST_TYPE_VENDOR,
+                                     G_USB_DEVICE_RECIPIENT_DEVICE,
+                                     0x0c,
+                                     0,
+                                     regs[i].reg,
+                                     1);
+      transfer->short_is_error = TRUE;
+      transfer->buffer[0] = regs[i].value;
+
+      g_ptr_array_add (transfers, transfer);
+    }
 
-  if (wrdata->regs_written >= wrdata->num_regs)
+  if (transfers->len == 0)
     {
-      write_regs_finished (wrdata, NULL);
+      fpi_ssm_next_state (ssm);
       return;
     }
 
-  regwrite = &wrdata->regs[wrdata->regs_written];
-  fp_dbg ("set %02x=%02x", regwrite->reg, regwrite->value);
-
-  transfer = fpi_usb_transfer_new (wrdata->dev);
-  fpi_usb_transfer_fill_control (transfer,
-                                 G_USB_DEVICE_DIRECTION_HOST_TO_DEVICE,
-                                 G_USB_DEVICE_REQUEST_TYPE_VENDOR,
-                                 G_USB_DEVICE_RECIPIENT_DEVICE,
-                                 0x0c,
-                                 0,
-                                 regwrite->reg,
-                                 1);
-  transfer->short_is_error = TRUE;
-  transfer->ssm = wrdata->ssm;
-  transfer->buffer[0] = regwrite->value;
-
-  fpi_usb_transfer_submit (transfer, CTRL_TIMEOUT, NULL, write_regs_cb, wrdata);
-}
-
-static void
-sm_write_regs (FpiSsm                      *ssm,
-               FpDevice                    *dev,
-               const struct sonly_regwrite *regs,
-               size_t                       num_regs)
-{
-  struct write_regs_data *wrdata = g_malloc (sizeof (*wrdata));
-
-  wrdata->ssm = ssm;
-  wrdata->regs = regs;
-  wrdata->num_regs = num_regs;
-  wrdata->regs_written = 0;
-  wrdata->dev = dev;
-
-  write_regs_iterate (wrdata);
+  fpi_usb_transfer_submit_batch ((FpiUsbTransfer **) transfers->pdata,
+                                 transfers->len,
+                                 CTRL_TIMEOUT, NULL,
+                                 write_regs_cb, ssm);
 }
 
 static void
@@ -892,21 +844,11 @@ capsm_fire_bulk (FpiSsm   *ssm,
                  FpDevice *dev)
 {
   FpiDeviceUpeksonly *self = FPI_DEVICE_UPEKSONLY (dev);
-  int i;
 
   g_assert (self->capturing == FALSE);
 
-  g_clear_object (&self->img_cancellable);
-  self->img_cancellable = g_cancellable_new ();
-  for (i = 0; i < self->img_transfers->len; i++)
-    {
-      fpi_usb_transfer_submit (fpi_usb_transfer_ref (g_ptr_array_index (self->img_transfers, i)),
-                               0,
-                               self->img_cancellable,
-                               img_data_cb,
-                               NULL);
-      self->num_flying++;
-    }
+  fpi_usb_stream_start (self->img_stream, 0, NULL,
+                        img_data_cb, img_stream_stopped_cb, NULL);
   self->capturing = TRUE;
   fpi_ssm_next_state (ssm);
 }
@@ -1392,26 +1334,15 @@ dev_activate (FpImageDevice *dev)
 {
   FpiDeviceUpeksonly *self = FPI_DEVICE_UPEKSONLY (dev);
   FpiSsm *ssm = NULL;
-  int i;
 
   self->deactivating = FALSE;
   self->capturing = FALSE;
 
-  self->num_flying = 0;
-  self->img_transfers = g_ptr_array_new_with_free_func ((GFreeFunc) fpi_usb_transfer_unref);
-
   /* This might seem odd, but we do need multiple in-flight URBs so that
    * we never stop polling the device for more data.
    */
-  for (i = 0; i < NUM_BULK_TRANSFERS; i++)
-    {
-      FpiUsbTransfer *transfer;
-
-      transfer = fpi_usb_transfer_new (FP_DEVICE (dev));
-      fpi_usb_transfer_fill_bulk (transfer, 0x81, 4096);
-
-      g_ptr_array_add (self->img_transfers, transfer);
-    }
+  self->img_stream = fpi_usb_stream_new (FP_DEVICE (dev), 0x81, 4096,
+                                         NUM_BULK_TRANSFERS);
 
   switch (self->dev_model)
     {
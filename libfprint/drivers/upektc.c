@@ -77,22 +77,22 @@ upektc_next_init_cmd (FpiSsm        *ssm,
 }
 
 static void
-write_init_cb (FpiUsbTransfer *transfer, FpDevice *device,
-               gpointer user_data, GError *error)
+write_init_cb (FpDevice *device, gpointer user_data, GError *error)
 {
   FpImageDevice *dev = FP_IMAGE_DEVICE (device);
   FpiDeviceUpektc *self = FPI_DEVICE_UPEKTC (dev);
+  FpiSsm *ssm = user_data;
 
   if (!error)
     {
       if (self->setup_commands[self->init_idx].response_len)
-        fpi_ssm_next_state (transfer->ssm);
+        fpi_ssm_next_state (ssm);
       else
-        upektc_next_init_cmd (transfer->ssm, dev);
+        upektc_next_init_cmd (ssm, dev);
     }
   else
     {
-      fpi_ssm_mark_failed (transfer->ssm, error);
+      fpi_ssm_mark_failed (ssm, error);
     }
 }
 
@@ -117,17 +117,33 @@ activate_run_state (FpiSsm *ssm, FpDevice *dev)
     {
     case WRITE_INIT:
       {
-        FpiUsbTransfer *transfer = fpi_usb_transfer_new (dev);
-
-        fpi_usb_transfer_fill_bulk_full (transfer,
-                                         self->ep_out,
-                                         (unsigned char *) self->setup_commands[self->init_idx].cmd,
-                                         UPEKTC_CMD_LEN,
-                                         NULL);
-        transfer->ssm = ssm;
-        transfer->short_is_error = TRUE;
-        fpi_usb_transfer_submit (transfer, BULK_TIMEOUT, NULL,
-                                 write_init_cb, NULL);
+        g_autoptr(GPtrArray) transfers = g_ptr_array_new ();
+
+        /* Queue all commands up to the next one that has a response,
+         * init_idx is left pointing to the last queued command. */
+        while (TRUE)
+          {
+            FpiUsbTransfer *transfer = fpi_usb_transfer_new (dev);
+
+            fpi_usb_transfer_fill_bulk_full (transfer,
+                                             self->ep_out,
+                                             (unsigned char *) self->setup_commands[self->init_idx].cmd,
+                                             UPEKTC_CMD_LEN,
+                                             NULL);
+            transfer->short_is_error = TRUE;
+            g_ptr_array_add (transfers, transfer);
+
+            if (self->setup_commands[self->init_idx].response_len ||
+                self->init_idx + 1 == self->setup_commands_len)
+              break;
+
+            self->init_idx += 1;
+          }
+
+        fpi_usb_transfer_submit_batch ((FpiUsbTransfer **) transfers->pdata,
+                                       transfers->len,
+                                       BULK_TIMEOUT, NULL,
+                                       write_init_cb, ssm);
       }
       break;
 
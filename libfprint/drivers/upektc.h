@@ -33,7 +33,7 @@
 struct setup_cmd
 {
   unsigned char cmd[0x40];
-  int           response_len;
+  unsigned char response_len;
 };
 
 static const struct setup_cmd upektc_setup_commands[] = {
@@ -20,7 +20,6 @@
 #define FP_COMPONENT "upektc_img"
 
 #include "drivers_api.h"
-#include "upek_proto.h"
 #include "upektc_img.h"
 
 static void start_capture (FpImageDevice *dev);
@@ -72,7 +71,7 @@ static void
 upektc_img_cmd_update_crc (unsigned char *cmd_buf, size_t size)
 {
   /* CRC does not cover Ciao prefix (4 bytes) and CRC location (2 bytes) */
-  uint16_t crc = udf_crc (cmd_buf + 4, size - 6);
+  uint16_t crc = fpi_crc16_ccitt (0, cmd_buf + 4, size - 6);
 
   cmd_buf[size - 2] = (crc & 0x00ff);
   cmd_buf[size - 1] = (crc & 0xff00) >> 8;
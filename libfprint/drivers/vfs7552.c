@@ -33,6 +33,11 @@
 #define FINGER_OFF_VARIANCE_THRESHOLD 100
 #define NOISE_VARIANCE_THRESHOLD 4000
 
+/* Waiting for a finger polls back to back at first, and backs off to
+ * this delay once nothing happened for a while */
+#define FINGER_POLL_MAX_DELAY 100
+#define FINGER_POLL_BACKOFF_AFTER 2000
+
 /* =================== sync/async USB transfer sequence ==================== */
 
 enum {
@@ -108,6 +113,7 @@ struct _FpDeviceVfs7552
 
   gboolean                deactivating;
   gboolean                loop_running;
+  FpiSsmPoller            finger_poller;
   struct usbexchange_data init_sequence;
   FpiUsbTransfer         *flying_transfer;
 };
@@ -631,6 +637,8 @@ activate_run_state (FpiSsm *ssm, FpDevice *_dev)
   switch (fpi_ssm_get_cur_state (ssm))
     {
     case ACTIVATE_INIT:
+      fpi_ssm_poller_activity (&self->finger_poller);
+
       // This sequence prepares the sensor for capturing the image.
       self->init_sequence.stepcount = G_N_ELEMENTS (vfs7552_initiate_capture);
       self->init_sequence.actions = vfs7552_initiate_capture;
@@ -651,7 +659,7 @@ activate_run_state (FpiSsm *ssm, FpDevice *_dev)
       if (receive_buf[0] == interrupt_ok[0])
         {
           // This seems to mean: "Sensor is all good"
-          fpi_ssm_jump_to_state (ssm, ACTIVATE_INTERRUPT_QUERY);
+          fpi_ssm_jump_to_state_polled (ssm, ACTIVATE_INTERRUPT_QUERY, &self->finger_poller);
         }
       else if (receive_buf[0] == interrupt_ready[0])
         {
@@ -1045,6 +1053,8 @@ static const FpIdEntry id_table[] = {
 static void
 fpi_device_vfs7552_init (FpDeviceVfs7552 *self)
 {
+  fpi_ssm_poller_init (&self->finger_poller, 0,
+                       FINGER_POLL_MAX_DELAY, FINGER_POLL_BACKOFF_AFTER);
 }
 
 static void
@@ -72,8 +72,14 @@ struct _FpDeviceVirtualDevice
   GCancellable             *cancellable;
 
   char                      recv_buf[MAX_LINE_LEN];
-
-  GPtrArray                *pending_commands;
+  GByteArray               *recv_stream;
+  gboolean                  recv_framed;
+  /* Serial of the current client connection and of the one the pending
+   * read was started for, 0 if no read is pending. */
+  guint                     recv_connection;
+  guint                     recv_read_connection;
+
+  GQueue                   *pending_commands;
 
   GHashTable               *prints_storage;
 
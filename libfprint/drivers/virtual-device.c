@@ -25,11 +25,17 @@
  * python script is provided to connect to it via a socket, allowing
  * prints to registered programmatically.
  * Using this, it is possible to test libfprint and fprintd.
+ *
+ * A client either sends a single plain text command and closes the
+ * connection, or it keeps the connection open and sends any number of
+ * commands, each prefixed by its length as a 32 bit big endian integer.
+ * The leading zero byte of the length selects the second mode.
  */
 
 #define FP_COMPONENT "virtual_device"
 
 #include "virtual-device-private.h"
+#include "fpi-byte-utils.h"
 #include "fpi-log.h"
 
 G_DEFINE_TYPE (FpDeviceVirtualDevice, fpi_device_virtual_device, FP_TYPE_DEVICE)
@@ -50,6 +56,8 @@ G_DEFINE_TYPE (FpDeviceVirtualDevice, fpi_device_virtual_device, FP_TYPE_DEVICE)
 #define LIST_CMD "LIST"
 #define UNPLUG_CMD "UNPLUG"
 
+#define FRAME_HEADER_LEN 4
+
 static void
 maybe_continue_current_action (FpDeviceVirtualDevice *self)
 {
@@ -161,14 +169,9 @@ process_cmds (FpDeviceVirtualDevice * self,
       return TRUE;
     }
 
-  while (self->pending_commands->len > 0)
+  while (!g_queue_is_empty (self->pending_commands))
     {
-      g_autofree gchar *cmd = NULL;
-
-      /* TODO: g_ptr_array_steal_index requires GLib 2.58, we depend on 2.56 */
-      cmd = g_ptr_array_index (self->pending_commands, 0);
-      g_ptr_array_index (self->pending_commands, 0) = NULL;
-      g_ptr_array_remove_index (self->pending_commands, 0);
+      g_autofree gchar *cmd = g_queue_pop_head (self->pending_commands);
 
       g_debug ("Processing command %s", cmd);
 
@@ -261,15 +264,94 @@ process_cmds (FpDeviceVirtualDevice * self,
 }
 
 static void
-write_key_to_listener (void *key, void *val, void *user_data)
+append_key (void *key, void *val, void *user_data)
 {
-  FpiDeviceVirtualListener *listener = FPI_DEVICE_VIRTUAL_LISTENER (user_data);
+  GString *reply = user_data;
+
+  g_string_append (reply, key);
+  g_string_append_c (reply, '\n');
+}
 
-  if (!fpi_device_virtual_listener_write_sync (listener, key, strlen (key), NULL) ||
-      !fpi_device_virtual_listener_write_sync (listener, "\n", 1, NULL))
+static void
+write_list_reply (FpDeviceVirtualDevice *self, gboolean framed)
+{
+  g_autoptr(GString) reply = g_string_new (NULL);
+  guint8 header[FRAME_HEADER_LEN];
+
+  if (self->prints_storage)
+    g_hash_table_foreach (self->prints_storage, append_key, reply);
+
+  /* Without framing, the reply ends when the connection is closed */
+  FP_WRITE_UINT32_BE (header, reply->len);
+  if ((framed && !fpi_device_virtual_listener_write_sync (self->listener,
+                                                           (const char *) header,
+                                                           sizeof (header),
+                                                           NULL)) ||
+      !fpi_device_virtual_listener_write_sync (self->listener, reply->str,
+                                               reply->len, NULL))
     g_warning ("Error writing reply to LIST command");
 }
 
+static void
+handle_instruction (FpDeviceVirtualDevice *self,
+                    const char            *cmd,
+                    gboolean               framed)
+{
+  fp_dbg ("Received command %s", cmd);
+
+  if (g_str_has_prefix (cmd, LIST_CMD))
+    {
+      write_list_reply (self, framed);
+    }
+  else if (g_str_has_prefix (cmd, UNPLUG_CMD))
+    {
+      fpi_device_remove (FP_DEVICE (self));
+      maybe_continue_current_action (self);
+    }
+  else if (g_str_has_prefix (cmd, SET_ENROLL_STAGES_PREFIX))
+    {
+      guint stages;
+
+      stages = g_ascii_strtoull (cmd + strlen (SET_ENROLL_STAGES_PREFIX), NULL, 10);
+      fpi_device_set_nr_enroll_stages (FP_DEVICE (self), stages);
+    }
+  else if (g_str_has_prefix (cmd, SET_SCAN_TYPE_PREFIX))
+    {
+      const char *scan_type = cmd + strlen (SET_SCAN_TYPE_PREFIX);
+      g_autoptr(GEnumClass) scan_types = g_type_class_ref (fp_scan_type_get_type ());
+      GEnumValue *value = g_enum_get_value_by_nick (scan_types, scan_type);
+
+      if (value)
+        fpi_device_set_scan_type (FP_DEVICE (self), value->value);
+      else
+        g_warning ("Scan type '%s' not found", scan_type);
+    }
+  else if (g_str_has_prefix (cmd, SET_CANCELLATION_PREFIX))
+    {
+      self->supports_cancellation = g_ascii_strtoull (
+        cmd + strlen (SET_CANCELLATION_PREFIX), NULL, 10) != 0;
+
+      g_debug ("Cancellation support toggled: %d",
+               self->supports_cancellation);
+    }
+  else if (g_str_has_prefix (cmd, SET_KEEP_ALIVE_PREFIX))
+    {
+      self->keep_alive = g_ascii_strtoull (
+        cmd + strlen (SET_KEEP_ALIVE_PREFIX), NULL, 10) != 0;
+
+      g_debug ("Keep alive toggled: %d", self->keep_alive);
+    }
+  else
+    {
+      g_queue_push_tail (self->pending_commands, g_strdup (cmd));
+      g_clear_handle_id (&self->wait_command_id, g_source_remove);
+
+      maybe_continue_current_action (self);
+    }
+}
+
+static void recv_instruction (FpDeviceVirtualDevice *self);
+
 static void
 recv_instruction_cb (GObject      *source_object,
                      GAsyncResult *res,
@@ -277,88 +359,100 @@ recv_instruction_cb (GObject      *source_object,
 {
   g_autoptr(GError) error = NULL;
   FpiDeviceVirtualListener *listener = FPI_DEVICE_VIRTUAL_LISTENER (source_object);
-  gsize bytes;
+  FpDeviceVirtualDevice *self;
+  gsize bytes, consumed;
 
   bytes = fpi_device_virtual_listener_read_finish (listener, res, &error);
   fp_dbg ("Got instructions of length %" G_GSIZE_FORMAT, bytes);
 
+  if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    return;
+
+  self = FP_DEVICE_VIRTUAL_DEVICE (user_data);
+
+  /* The client reconnected while this read was pending, which closed the
+   * old connection. Whatever it returned is stale, start reading from the
+   * new connection instead. */
+  if (self->recv_read_connection != self->recv_connection)
+    {
+      self->recv_read_connection = 0;
+      recv_instruction (self);
+      return;
+    }
+  self->recv_read_connection = 0;
+
   if (error)
     {
-      if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+      if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CONNECTION_CLOSED))
         return;
 
       g_warning ("Error receiving instruction data: %s", error->message);
       return;
     }
 
-  if (bytes > 0)
+  if (bytes == 0)
     {
-      FpDeviceVirtualDevice *self;
-      g_autofree char *cmd = NULL;
-
-      self = FP_DEVICE_VIRTUAL_DEVICE (user_data);
-
-      cmd = g_strndup (self->recv_buf, bytes);
-      fp_dbg ("Received command %s", cmd);
+      fpi_device_virtual_listener_connection_close (listener);
+      return;
+    }
 
-      if (g_str_has_prefix (cmd, LIST_CMD))
-        {
-          if (self->prints_storage)
-            g_hash_table_foreach (self->prints_storage, write_key_to_listener, listener);
-        }
-      else if (g_str_has_prefix (cmd, UNPLUG_CMD))
-        {
-          fpi_device_remove (FP_DEVICE (self));
-          maybe_continue_current_action (self);
-        }
-      else if (g_str_has_prefix (cmd, SET_ENROLL_STAGES_PREFIX))
+  if (!self->recv_framed)
+    {
+      if (self->recv_buf[0] != '\0')
         {
-          guint stages;
+          g_autofree char *cmd = g_strndup (self->recv_buf, bytes);
 
-          stages = g_ascii_strtoull (cmd + strlen (SET_ENROLL_STAGES_PREFIX), NULL, 10);
-          fpi_device_set_nr_enroll_stages (FP_DEVICE (self), stages);
+          handle_instruction (self, cmd, FALSE);
+          fpi_device_virtual_listener_connection_close (listener);
+          return;
         }
-      else if (g_str_has_prefix (cmd, SET_SCAN_TYPE_PREFIX))
-        {
-          const char *scan_type = cmd + strlen (SET_SCAN_TYPE_PREFIX);
-          g_autoptr(GEnumClass) scan_types = g_type_class_ref (fp_scan_type_get_type ());
-          GEnumValue *value = g_enum_get_value_by_nick (scan_types, scan_type);
 
-          if (value)
-            fpi_device_set_scan_type (FP_DEVICE (self), value->value);
-          else
-            g_warning ("Scan type '%s' not found", scan_type);
-        }
-      else if (g_str_has_prefix (cmd, SET_CANCELLATION_PREFIX))
-        {
-          self->supports_cancellation = g_ascii_strtoull (
-            cmd + strlen (SET_CANCELLATION_PREFIX), NULL, 10) != 0;
+      self->recv_framed = TRUE;
+    }
 
-          g_debug ("Cancellation support toggled: %d",
-                   self->supports_cancellation);
-        }
-      else if (g_str_has_prefix (cmd, SET_KEEP_ALIVE_PREFIX))
-        {
-          self->keep_alive = g_ascii_strtoull (
-            cmd + strlen (SET_KEEP_ALIVE_PREFIX), NULL, 10) != 0;
+  g_byte_array_append (self->recv_stream, (guint8 *) self->recv_buf, bytes);
 
-          g_debug ("Keep alive toggled: %d", self->keep_alive);
-        }
-      else
-        {
-          g_ptr_array_add (self->pending_commands, g_steal_pointer (&cmd));
-          g_clear_handle_id (&self->wait_command_id, g_source_remove);
+  consumed = 0;
+  while (self->recv_stream->len - consumed >= FRAME_HEADER_LEN)
+    {
+      g_autofree char *cmd = NULL;
+      guint32 len;
 
-          maybe_continue_current_action (self);
+      len = FP_READ_UINT32_BE (self->recv_stream->data + consumed);
+      if (len >= MAX_LINE_LEN)
+        {
+          g_warning ("Command of %u bytes is too long, disconnecting client", len);
+          g_byte_array_set_size (self->recv_stream, 0);
+          fpi_device_virtual_listener_connection_close (listener);
+          return;
         }
+
+      if (self->recv_stream->len - consumed < FRAME_HEADER_LEN + len)
+        break;
+
+      cmd = g_strndup ((char *) self->recv_stream->data + consumed + FRAME_HEADER_LEN, len);
+      consumed += FRAME_HEADER_LEN + len;
+
+      handle_instruction (self, cmd, TRUE);
+
+      /* The command may have closed the device */
+      if (self->listener != listener)
+        return;
     }
+  g_byte_array_remove_range (self->recv_stream, 0, consumed);
 
-  fpi_device_virtual_listener_connection_close (listener);
+  /* Keep the connection and wait for further commands */
+  recv_instruction (self);
 }
 
 static void
 recv_instruction (FpDeviceVirtualDevice *self)
 {
+  /* Only one read may be pending, a new connection waits for it */
+  if (self->recv_read_connection)
+    return;
+
+  self->recv_read_connection = self->recv_connection;
   fpi_device_virtual_listener_read (self->listener,
                                     FALSE,
                                     self->recv_buf,
@@ -373,6 +467,10 @@ on_listener_connected (FpiDeviceVirtualListener *listener,
 {
   FpDeviceVirtualDevice *self = FP_DEVICE_VIRTUAL_DEVICE (user_data);
 
+  self->recv_connection += 1;
+  self->recv_framed = FALSE;
+  g_byte_array_set_size (self->recv_stream, 0);
+
   recv_instruction (self);
 }
 
@@ -475,10 +573,10 @@ should_wait_to_sleep (FpDeviceVirtualDevice *self,
   if (self->sleep_timeout_id)
     return TRUE;
 
-  if (!self->pending_commands->len)
+  if (g_queue_is_empty (self->pending_commands))
     return FALSE;
 
-  cmd = g_ptr_array_index (self->pending_commands, 0);
+  cmd = g_queue_peek_head (self->pending_commands);
 
   if (g_str_has_prefix (cmd, SLEEP_CMD_PREFIX))
     {
@@ -491,7 +589,7 @@ should_wait_to_sleep (FpDeviceVirtualDevice *self,
       g_assert (!self->injected_synthetic_cmd);
       g_assert (self->sleep_timeout_id != 0);
 
-      if (!self->pending_commands->len)
+      if (g_queue_is_empty (self->pending_commands))
         {
           g_autofree char *injected_cmd = NULL;
 
@@ -506,7 +604,7 @@ should_wait_to_sleep (FpDeviceVirtualDevice *self,
 
           g_debug ("Sleeping now, command queued for later: %s", injected_cmd);
 
-          g_ptr_array_insert (self->pending_commands, 0, g_steal_pointer (&injected_cmd));
+          g_queue_push_head (self->pending_commands, g_steal_pointer (&injected_cmd));
           self->injected_synthetic_cmd = TRUE;
         }
     }
@@ -691,7 +789,7 @@ dev_cancel (FpDevice *dev)
   if (self->injected_synthetic_cmd)
     {
       self->injected_synthetic_cmd = FALSE;
-      g_ptr_array_remove_index (self->pending_commands, 0);
+      g_free (g_queue_pop_head (self->pending_commands));
     }
 
   if (!self->supports_cancellation)
@@ -745,7 +843,8 @@ fpi_device_virtual_device_finalize (GObject *object)
 
   G_DEBUG_HERE ();
   stop_listener (self);
-  g_clear_pointer (&self->pending_commands, g_ptr_array_unref);
+  g_queue_free_full (self->pending_commands, g_free);
+  g_clear_pointer (&self->recv_stream, g_byte_array_unref);
   G_OBJECT_CLASS (fpi_device_virtual_device_parent_class)->finalize (object);
 }
 
@@ -753,7 +852,8 @@ static void
 fpi_device_virtual_device_init (FpDeviceVirtualDevice *self)
 {
   self->supports_cancellation = TRUE;
-  self->pending_commands = g_ptr_array_new_with_free_func (g_free);
+  self->pending_commands = g_queue_new ();
+  self->recv_stream = g_byte_array_new ();
 }
 
 static const FpIdEntry driver_ids[] = {
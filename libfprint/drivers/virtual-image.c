@@ -23,6 +23,11 @@
  * python script is provided to connect to it via a socket, allowing
  * prints to be sent to this device programmatically.
  * Using this it is possible to test libfprint and fprintd.
+ *
+ * In streaming mode, images that arrive while the device is not waiting
+ * for a finger are held back and the socket is not read any further. A
+ * client can then write a continuous sequence of images and each one is
+ * consumed as soon as the next scan starts.
  */
 
 #define FP_COMPONENT "virtual_image"
@@ -42,7 +47,9 @@ struct _FpDeviceVirtualImage
   GCancellable             *cancellable;
 
   gboolean                  automatic_finger;
+  gboolean                  stream_mode;
   FpImage                  *recv_img;
+  FpImage                  *held_img;
   gint                      recv_img_hdr[2];
 };
 
@@ -51,6 +58,30 @@ G_DEFINE_TYPE (FpDeviceVirtualImage, fpi_device_virtual_image, FP_TYPE_IMAGE_DEV
 
 static void recv_image (FpDeviceVirtualImage *self);
 
+static void
+submit_image (FpDeviceVirtualImage *self, FpImage *image)
+{
+  FpImageDevice *device = FP_IMAGE_DEVICE (self);
+
+  if (self->automatic_finger)
+    fpi_image_device_report_finger_status (device, TRUE);
+  fpi_image_device_image_captured (device, image);
+  if (self->automatic_finger)
+    fpi_image_device_report_finger_status (device, FALSE);
+}
+
+static gboolean
+awaiting_finger (FpDeviceVirtualImage *self)
+{
+  FpiImageDeviceState state;
+
+  g_object_get (self,
+                "fpi-image-device-state", &state,
+                NULL);
+
+  return state == FPI_IMAGE_DEVICE_STATE_AWAIT_FINGER_ON;
+}
+
 static void
 recv_image_img_recv_cb (GObject      *source_object,
                         GAsyncResult *res,
@@ -59,7 +90,6 @@ recv_image_img_recv_cb (GObject      *source_object,
   g_autoptr(GError) error = NULL;
   FpiDeviceVirtualListener *listener = FPI_DEVICE_VIRTUAL_LISTENER (source_object);
   FpDeviceVirtualImage *self;
-  FpImageDevice *device;
   gsize bytes;
 
   bytes = fpi_device_virtual_listener_read_finish (listener, res, &error);
@@ -69,13 +99,16 @@ recv_image_img_recv_cb (GObject      *source_object,
     return;
 
   self = FPI_DEVICE_VIRTUAL_IMAGE (user_data);
-  device = FP_IMAGE_DEVICE (self);
 
-  if (self->automatic_finger)
-    fpi_image_device_report_finger_status (device, TRUE);
-  fpi_image_device_image_captured (device, g_steal_pointer (&self->recv_img));
-  if (self->automatic_finger)
-    fpi_image_device_report_finger_status (device, FALSE);
+  if (self->stream_mode && !awaiting_finger (self))
+    {
+      /* Stop reading until the device is ready, see dev_change_state() */
+      fp_dbg ("Holding back image until the next scan");
+      self->held_img = g_steal_pointer (&self->recv_img);
+      return;
+    }
+
+  submit_image (self, g_steal_pointer (&self->recv_img));
 
   /* And, listen for more images from the same client. */
   recv_image (self);
@@ -112,6 +145,7 @@ recv_image_hdr_recv_cb (GObject      *source_object,
     {
       g_warning ("Image header suggests an unrealistically large image, disconnecting client.");
       fpi_device_virtual_listener_connection_close (listener);
+      return;
     }
 
   if (self->recv_img_hdr[0] < 0 || self->recv_img_hdr[1] < 0)
@@ -145,6 +179,11 @@ recv_image_hdr_recv_cb (GObject      *source_object,
           fpi_device_remove (FP_DEVICE (self));
           break;
 
+        case -6:
+          /* -6 enables/disables streaming mode */
+          self->stream_mode = !!self->recv_img_hdr[1];
+          break;
+
         default:
           /* disconnect client, it didn't play fair */
           fpi_device_virtual_listener_connection_close (listener);
@@ -184,6 +223,8 @@ on_listener_connected (FpiDeviceVirtualListener *listener,
   FpiImageDeviceState state;
 
   self->automatic_finger = TRUE;
+  self->stream_mode = FALSE;
+  g_clear_object (&self->held_img);
 
   g_object_get (self,
                 "fpi-image-device-state", &state,
@@ -246,6 +287,7 @@ dev_deinit (FpImageDevice *dev)
   g_cancellable_cancel (self->cancellable);
   g_clear_object (&self->cancellable);
   g_clear_object (&self->listener);
+  g_clear_object (&self->held_img);
 
   /* Delay result to open up the possibility of testing race conditions. */
   fpi_device_add_timeout (FP_DEVICE (dev), 100, (FpTimeoutFunc) fpi_image_device_close_complete, NULL, NULL);
@@ -256,8 +298,9 @@ dev_activate (FpImageDevice *dev)
 {
   FpDeviceVirtualImage *self = FPI_DEVICE_VIRTUAL_IMAGE (dev);
 
-  /* Start reading (again). */
-  recv_image (self);
+  /* Start reading (again), unless an image is held back. */
+  if (!self->held_img)
+    recv_image (self);
 
   fpi_image_device_activate_complete (dev, NULL);
 }
@@ -268,6 +311,31 @@ dev_deactivate (FpImageDevice *dev)
   fpi_image_device_deactivate_complete (dev, NULL);
 }
 
+static void
+submit_held_image (FpDevice *dev, gpointer user_data)
+{
+  FpDeviceVirtualImage *self = FPI_DEVICE_VIRTUAL_IMAGE (dev);
+
+  if (!self->held_img || !awaiting_finger (self))
+    return;
+
+  submit_image (self, g_steal_pointer (&self->held_img));
+
+  /* Continue reading from the stream */
+  if (self->listener)
+    recv_image (self);
+}
+
+static void
+dev_change_state (FpImageDevice *dev, FpiImageDeviceState state)
+{
+  FpDeviceVirtualImage *self = FPI_DEVICE_VIRTUAL_IMAGE (dev);
+
+  /* Submit from the main loop, we are inside the state change here */
+  if (self->held_img && state == FPI_IMAGE_DEVICE_STATE_AWAIT_FINGER_ON)
+    fpi_device_add_timeout (FP_DEVICE (dev), 0, submit_held_image, NULL, NULL);
+}
+
 static void
 dev_notify_removed_cb (FpDevice *dev)
 {
@@ -321,4 +389,5 @@ fpi_device_virtual_image_class_init (FpDeviceVirtualImageClass *klass)
 
   img_class->activate = dev_activate;
   img_class->deactivate = dev_deactivate;
+  img_class->change_state = dev_change_state;
 }
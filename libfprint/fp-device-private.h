@@ -21,6 +21,7 @@
 #pragma once
 
 #include "fpi-device.h"
+#include "fpi-transfer-trace.h"
 
 /* Chosen so that if we turn on after WARM -> COLD, it takes exactly one time
  * constant to go from COLD -> HOT.
@@ -39,6 +40,34 @@
 #define DEFAULT_TEMP_HOT_SECONDS (3 * 60)
 #define DEFAULT_TEMP_COLD_SECONDS (9 * 60)
 
+/* Transfer latencies are counted in buckets of power of two milliseconds,
+ * i.e. < 1ms, < 2ms, < 4ms, ..., >= 8192ms.
+ */
+#define TRANSFER_STATS_LATENCY_BUCKETS 15
+/* Transfer sizes are counted in the same way, with a first bucket for
+ * transfers without data, i.e. 0, 1, 2-3, 4-7, ..., >= 64KiB.
+ */
+#define TRANSFER_STATS_BYTES_BUCKETS 18
+/* One slot per USB endpoint and direction, followed by one for SPI */
+#define TRANSFER_STATS_SPI_SLOT 32
+#define TRANSFER_STATS_SLOTS 33
+
+typedef struct _FpiUsbTransferPool FpiUsbTransferPool;
+typedef struct _FpiSpiWorker       FpiSpiWorker;
+
+typedef struct
+{
+  guint64 transfers;
+  guint64 bytes;
+  guint64 errors;
+  guint64 timeouts;
+  guint64 cancelled;
+  guint64 latency_total;
+  guint64 latency_max;
+  guint64 latency_histogram[TRANSFER_STATS_LATENCY_BUCKETS];
+  guint64 bytes_histogram[TRANSFER_STATS_BYTES_BUCKETS];
+} FpTransferStats;
+
 typedef struct
 {
   FpDeviceType type;
@@ -99,8 +128,35 @@ typedef struct
   gint64        temp_last_update;
   gboolean      temp_last_active;
   gdouble       temp_current_ratio;
+  gboolean      temp_kept_active;
+
+  /* Transfer recording, see fpi-transfer-trace.c */
+  FpiTransferTrace *transfer_trace;
+  /* Updated from SPI and synchronous USB transfers on other threads */
+  GMutex            transfer_stats_mutex;
+  FpTransferStats  *transfer_stats;
+
+  /* Recycled USB transfers and buffers, see fpi-usb-transfer.c */
+  FpiUsbTransferPool *usb_transfer_pool;
+
+  /* Thread executing SPI transfers, see fpi-spi-transfer.c */
+  FpiSpiWorker *spi_worker;
+
+  /* Result of the last list operation, see fpi_device_list_complete() */
+  GPtrArray *stored_prints_cache;
 } FpDevicePrivate;
 
+/* Same as the fp_device_get_instance_private() that G_DEFINE_* creates in
+ * fp-device.c, for the helpers that are implemented in other files. */
+static inline FpDevicePrivate *
+fpi_device_get_private (FpDevice *device)
+{
+  FpDeviceClass *dev_class = g_type_class_peek_static (FP_TYPE_DEVICE);
+
+  return G_STRUCT_MEMBER_P (device,
+                            g_type_class_get_instance_private_offset (dev_class));
+}
+
 
 typedef struct
 {
@@ -134,3 +190,16 @@ void fpi_device_configure_wakeup (FpDevice *device,
                                   gboolean  enabled);
 void fpi_device_update_temp (FpDevice *device,
                              gboolean  is_active);
+void fpi_device_set_kept_active (FpDevice *device,
+                                 gboolean  kept_active);
+void fpi_device_update_transfer_stats (FpDevice           *device,
+                                       FpiTransferTraceBus bus,
+                                       guint8              endpoint,
+                                       gssize              length,
+                                       gint64              latency,
+                                       const GError       *error);
+
+GPtrArray *fpi_device_get_cached_stored_prints (FpDevice *device);
+
+void fpi_usb_transfer_pool_release (FpiUsbTransferPool *pool);
+void fpi_spi_worker_free (FpiSpiWorker *worker);
@@ -22,6 +22,7 @@
 #include "fpi-log.h"
 
 #include "fp-device-private.h"
+#include "fp-image-device-private.h"
 
 /**
  * SECTION: fp-device
@@ -49,6 +50,7 @@ enum {
   PROP_SCAN_TYPE,
   PROP_FINGER_STATUS,
   PROP_TEMPERATURE,
+  PROP_TRANSFER_STATS,
   PROP_FPI_ENVIRON,
   PROP_FPI_USB_DEVICE,
   PROP_FPI_UDEV_DATA_SPIDEV,
@@ -234,6 +236,13 @@ fp_device_finalize (GObject *object)
   g_clear_pointer (&priv->udev_data.spidev_path, g_free);
   g_clear_pointer (&priv->udev_data.hidraw_path, g_free);
 
+  g_clear_pointer (&priv->transfer_trace, fpi_transfer_trace_free);
+  g_clear_pointer (&priv->transfer_stats, g_free);
+  g_mutex_clear (&priv->transfer_stats_mutex);
+  g_clear_pointer (&priv->usb_transfer_pool, fpi_usb_transfer_pool_release);
+  g_clear_pointer (&priv->spi_worker, fpi_spi_worker_free);
+  g_clear_pointer (&priv->stored_prints_cache, g_ptr_array_unref);
+
   G_OBJECT_CLASS (fp_device_parent_class)->finalize (object);
 }
 
@@ -265,6 +274,10 @@ fp_device_get_property (GObject    *object,
       g_value_set_enum (value, priv->temp_current);
       break;
 
+    case PROP_TRANSFER_STATS:
+      g_value_take_variant (value, fp_device_get_transfer_stats (self));
+      break;
+
     case PROP_DRIVER:
       g_value_set_static_string (value, FP_DEVICE_GET_CLASS (self)->id);
       break;
@@ -461,6 +474,20 @@ fp_device_class_init (FpDeviceClass *klass)
                        FP_TYPE_TEMPERATURE, FP_TEMPERATURE_COLD,
                        G_PARAM_STATIC_STRINGS | G_PARAM_READABLE);
 
+  /**
+   * FpDevice:transfer-stats:
+   *
+   * A snapshot of the transfer statistics, see fp_device_get_transfer_stats().
+   * No change notification is emitted for this property.
+   */
+  properties[PROP_TRANSFER_STATS] =
+    g_param_spec_variant ("transfer-stats",
+                          "TransferStats",
+                          "Statistics about the USB and SPI transfers of the device",
+                          G_VARIANT_TYPE ("aa{sv}"),
+                          NULL,
+                          G_PARAM_STATIC_STRINGS | G_PARAM_READABLE);
+
   properties[PROP_DRIVER] =
     g_param_spec_string ("driver",
                          "Driver",
@@ -599,6 +626,10 @@ fp_device_class_init (FpDeviceClass *klass)
 static void
 fp_device_init (FpDevice *self)
 {
+  FpDevicePrivate *priv = fp_device_get_instance_private (self);
+
+  g_mutex_init (&priv->transfer_stats_mutex);
+  priv->transfer_stats = g_new0 (FpTransferStats, TRANSFER_STATS_SLOTS);
 }
 
 /**
@@ -738,6 +769,107 @@ fp_device_get_temperature (FpDevice *device)
   return priv->temp_current;
 }
 
+/**
+ * fp_device_get_transfer_stats:
+ * @device: A #FpDevice
+ *
+ * Retrieves statistics about the USB and SPI transfers done by the driver
+ * since the device object was created. The result contains one dictionary
+ * for every endpoint that was used, with the keys:
+ *
+ * - "bus" (s): Either "usb" or "spi"
+ * - "endpoint" (y): The USB endpoint address, only for USB
+ * - "transfers" (t): Number of completed transfers
+ * - "bytes" (t): Number of transferred bytes
+ * - "errors" (t): Number of failed transfers, excluding timeouts and
+ *   cancellations
+ * - "timeouts" (t): Number of transfers that timed out
+ * - "cancelled" (t): Number of cancelled transfers
+ * - "latency-total" (t): Sum of all transfer latencies in microseconds
+ * - "latency-max" (t): Maximum transfer latency in microseconds
+ * - "latency-histogram" (at): Number of transfers by latency, with the
+ *   first bucket counting latencies below 1ms and each further bucket
+ *   doubling the limit, the last bucket counts everything else.
+ * - "bytes-histogram" (at): Number of transfers by transferred bytes, with
+ *   the first bucket counting transfers without data and bucket n counting
+ *   sizes from 2^(n-1) to 2^n - 1 bytes, the last bucket counts everything
+ *   else.
+ *
+ * Note that the latency of interrupt transfers usually includes the time
+ * spent waiting for the device to report an event.
+ *
+ * Returns: (transfer full): A #GVariant of type "aa{sv}"
+ */
+GVariant *
+fp_device_get_transfer_stats (FpDevice *device)
+{
+  FpDevicePrivate *priv = fp_device_get_instance_private (device);
+  g_autofree FpTransferStats *snapshot = NULL;
+  GVariantBuilder builder;
+  guint slot;
+
+  g_return_val_if_fail (FP_IS_DEVICE (device), NULL);
+
+  g_mutex_lock (&priv->transfer_stats_mutex);
+  snapshot = g_memdup (priv->transfer_stats,
+                       TRANSFER_STATS_SLOTS * sizeof (FpTransferStats));
+  g_mutex_unlock (&priv->transfer_stats_mutex);
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("aa{sv}"));
+
+  for (slot = 0; slot < TRANSFER_STATS_SLOTS; slot++)
+    {
+      FpTransferStats *stats = &snapshot[slot];
+
+      if (stats->transfers == 0)
+        continue;
+
+      g_variant_builder_open (&builder, G_VARIANT_TYPE ("a{sv}"));
+
+      if (slot == TRANSFER_STATS_SPI_SLOT)
+        {
+          g_variant_builder_add (&builder, "{sv}", "bus",
+                                 g_variant_new_string ("spi"));
+        }
+      else
+        {
+          g_variant_builder_add (&builder, "{sv}", "bus",
+                                 g_variant_new_string ("usb"));
+          g_variant_builder_add (&builder, "{sv}", "endpoint",
+                                 g_variant_new_byte ((slot & 0x0f) | (slot & 0x10 ? 0x80 : 0)));
+        }
+
+      g_variant_builder_add (&builder, "{sv}", "transfers",
+                             g_variant_new_uint64 (stats->transfers));
+      g_variant_builder_add (&builder, "{sv}", "bytes",
+                             g_variant_new_uint64 (stats->bytes));
+      g_variant_builder_add (&builder, "{sv}", "errors",
+                             g_variant_new_uint64 (stats->errors));
+      g_variant_builder_add (&builder, "{sv}", "timeouts",
+                             g_variant_new_uint64 (stats->timeouts));
+      g_variant_builder_add (&builder, "{sv}", "cancelled",
+                             g_variant_new_uint64 (stats->cancelled));
+      g_variant_builder_add (&builder, "{sv}", "latency-total",
+                             g_variant_new_uint64 (stats->latency_total));
+      g_variant_builder_add (&builder, "{sv}", "latency-max",
+                             g_variant_new_uint64 (stats->latency_max));
+      g_variant_builder_add (&builder, "{sv}", "latency-histogram",
+                             g_variant_new_fixed_array (G_VARIANT_TYPE_UINT64,
+                                                        stats->latency_histogram,
+                                                        TRANSFER_STATS_LATENCY_BUCKETS,
+                                                        sizeof (guint64)));
+      g_variant_builder_add (&builder, "{sv}", "bytes-histogram",
+                             g_variant_new_fixed_array (G_VARIANT_TYPE_UINT64,
+                                                        stats->bytes_histogram,
+                                                        TRANSFER_STATS_BYTES_BUCKETS,
+                                                        sizeof (guint64)));
+
+      g_variant_builder_close (&builder);
+    }
+
+  return g_variant_ref_sink (g_variant_builder_end (&builder));
+}
+
 /**
  * fp_device_supports_identify:
  * @device: A #FpDevice
@@ -1015,7 +1147,11 @@ fp_device_suspend (FpDevice           *device,
   switch (priv->current_action)
     {
     case FPI_DEVICE_ACTION_NONE:
-      fpi_device_suspend_complete (device, NULL);
+      /* Image devices may still be active after the last action */
+      if (FP_IS_IMAGE_DEVICE (device))
+        fpi_image_device_suspend_idle (FP_IMAGE_DEVICE (device));
+      else
+        fpi_device_suspend_complete (device, NULL);
       break;
 
     case FPI_DEVICE_ACTION_ENROLL:
@@ -1728,6 +1864,9 @@ fp_device_delete_print_finish (FpDevice     *device,
  * Start an asynchronous operation to list all prints stored on the device.
  * This only makes sense on devices that store prints on-chip.
  *
+ * Some drivers keep the listing until the storage is modified, in which
+ * case the operation completes without querying the device.
+ *
  * Retrieve the result with fp_device_list_prints_finish().
  */
 void
@@ -1739,6 +1878,7 @@ fp_device_list_prints (FpDevice           *device,
   g_autoptr(GTask) task = NULL;
   FpDevicePrivate *priv = fp_device_get_instance_private (device);
   FpDeviceClass *cls = FP_DEVICE_GET_CLASS (device);
+  GPtrArray *cached;
 
   task = g_task_new (device, cancellable, callback, user_data);
   if (g_task_return_error_if_cancelled (task))
@@ -1766,6 +1906,14 @@ fp_device_list_prints (FpDevice           *device,
       return;
     }
 
+  cached = fpi_device_get_cached_stored_prints (device);
+  if (cached)
+    {
+      g_debug ("Returning %u cached prints", cached->len);
+      g_task_return_pointer (task, cached, (GDestroyNotify) g_ptr_array_unref);
+      return;
+    }
+
   priv->current_action = FPI_DEVICE_ACTION_LIST;
   priv->current_task = g_steal_pointer (&task);
   setup_task_cancellable (device);
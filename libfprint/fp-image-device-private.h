@@ -37,9 +37,20 @@ typedef struct
   FpImage            *capture_image;
 
   gint                bz3_threshold;
+
+  /* Keeping the device active between actions */
+  guint               keep_active_timeout;
+  GSource            *keep_active_source;
+  gboolean            kept_active;
+  gboolean            releasing;
+  gboolean            activate_pending;
+  gboolean            close_pending;
+  gboolean            suspend_pending;
 } FpImageDevicePrivate;
 
 
 void fpi_image_device_activate (FpImageDevice *image_device);
 void fpi_image_device_deactivate (FpImageDevice *image_device,
                                   gboolean       cancelling);
+void fpi_image_device_release (FpImageDevice *image_device);
+void fpi_image_device_suspend_idle (FpImageDevice *image_device);
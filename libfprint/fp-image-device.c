@@ -30,12 +30,18 @@
  * @short_description: Image device subclass
  *
  * This is a helper class for the commonly found image based devices.
+ *
+ * Image devices are activated for every action and deactivated again
+ * once the action has completed. Applications that run many actions in a
+ * row can use fp_image_device_set_keep_active_timeout() to skip the
+ * deactivation and the next activation.
  */
 
 G_DEFINE_ABSTRACT_TYPE_WITH_PRIVATE (FpImageDevice, fp_image_device, FP_TYPE_DEVICE)
 
 enum {
   PROP_0,
+  PROP_KEEP_ACTIVE_TIMEOUT,
   PROP_FPI_STATE,
   N_PROPS
 };
@@ -74,7 +80,15 @@ fp_image_device_close (FpDevice *device)
   FpImageDeviceClass *cls = FP_IMAGE_DEVICE_GET_CLASS (self);
   FpImageDevicePrivate *priv = fp_image_device_get_instance_private (self);
 
-  g_assert (priv->active == FALSE);
+  if (priv->active)
+    {
+      /* Kept active after the last action, close once deactivated */
+      g_assert (priv->kept_active || priv->releasing);
+      priv->close_pending = TRUE;
+      fpi_image_device_release (self);
+      return;
+    }
+
   cls->img_close (self);
 }
 
@@ -140,13 +154,26 @@ fp_image_device_start_capture_action (FpDevice *device)
 
 /*********************************************************/
 
+static void
+fp_image_device_dispose (GObject *object)
+{
+  FpImageDevice *self = (FpImageDevice *) object;
+  FpImageDevicePrivate *priv = fp_image_device_get_instance_private (self);
+
+  /* The device cannot be deactivated anymore, FpDevice warns about
+   * destroying an open device. */
+  g_clear_pointer (&priv->keep_active_source, g_source_destroy);
+
+  G_OBJECT_CLASS (fp_image_device_parent_class)->dispose (object);
+}
+
 static void
 fp_image_device_finalize (GObject *object)
 {
   FpImageDevice *self = (FpImageDevice *) object;
   FpImageDevicePrivate *priv = fp_image_device_get_instance_private (self);
 
-  g_assert (priv->active == FALSE);
+  g_assert (priv->active == FALSE || priv->kept_active);
 
   G_OBJECT_CLASS (fp_image_device_parent_class)->finalize (object);
 }
@@ -174,6 +201,10 @@ fp_image_device_get_property (GObject    *object,
 
   switch (prop_id)
     {
+    case PROP_KEEP_ACTIVE_TIMEOUT:
+      g_value_set_uint (value, priv->keep_active_timeout);
+      break;
+
     case PROP_FPI_STATE:
       g_value_set_enum (value, priv->state);
       break;
@@ -183,6 +214,35 @@ fp_image_device_get_property (GObject    *object,
     }
 }
 
+static void
+fp_image_device_set_property (GObject      *object,
+                              guint         prop_id,
+                              const GValue *value,
+                              GParamSpec   *pspec)
+{
+  FpImageDevice *self = FP_IMAGE_DEVICE (object);
+
+  switch (prop_id)
+    {
+    case PROP_KEEP_ACTIVE_TIMEOUT:
+      fp_image_device_set_keep_active_timeout (self, g_value_get_uint (value));
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+static void
+fp_image_device_temperature_changed (FpImageDevice *self,
+                                     GParamSpec    *pspec,
+                                     gpointer       user_data)
+{
+  /* Only stay active while the device is cold */
+  if (fp_device_get_temperature (FP_DEVICE (self)) != FP_TEMPERATURE_COLD)
+    fpi_image_device_release (self);
+}
+
 static void
 fp_image_device_constructed (GObject *obj)
 {
@@ -195,6 +255,9 @@ fp_image_device_constructed (GObject *obj)
   if (cls->bz3_threshold > 0)
     priv->bz3_threshold = cls->bz3_threshold;
 
+  g_signal_connect (self, "notify::temperature",
+                    G_CALLBACK (fp_image_device_temperature_changed), NULL);
+
   G_OBJECT_CLASS (fp_image_device_parent_class)->constructed (obj);
 }
 
@@ -204,8 +267,10 @@ fp_image_device_class_init (FpImageDeviceClass *klass)
   GObjectClass *object_class = G_OBJECT_CLASS (klass);
   FpDeviceClass *fp_device_class = FP_DEVICE_CLASS (klass);
 
+  object_class->dispose = fp_image_device_dispose;
   object_class->finalize = fp_image_device_finalize;
   object_class->get_property = fp_image_device_get_property;
+  object_class->set_property = fp_image_device_set_property;
   object_class->constructed = fp_image_device_constructed;
 
   /* Set default enroll stage count. */
@@ -226,6 +291,19 @@ fp_image_device_class_init (FpImageDeviceClass *klass)
   klass->activate = fp_image_device_default_activate;
   klass->deactivate = fp_image_device_default_deactivate;
 
+  /**
+   * FpImageDevice:keep-active-timeout:
+   *
+   * The time in milliseconds that the device stays active after an action,
+   * see fp_image_device_set_keep_active_timeout().
+   */
+  properties[PROP_KEEP_ACTIVE_TIMEOUT] =
+    g_param_spec_uint ("keep-active-timeout",
+                       "Keep active timeout",
+                       "Time in milliseconds the device stays active after an action",
+                       0, G_MAXUINT, 0,
+                       G_PARAM_STATIC_STRINGS | G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY);
+
   /**
    * FpImageDevice::fpi-image-device-state: (skip)
    *
@@ -265,3 +343,60 @@ static void
 fp_image_device_init (FpImageDevice *self)
 {
 }
+
+/*********************************************************/
+/* Public API */
+
+/**
+ * fp_image_device_set_keep_active_timeout:
+ * @self: a #FpImageDevice
+ * @timeout_ms: time in milliseconds, or 0 to deactivate after every action
+ *
+ * Keep the sensor active for @timeout_ms after an enroll, verify, identify
+ * or capture action completed successfully, so that an action started
+ * within that time does not need to activate the device again. This is
+ * useful if e.g. a verification is run again right after the previous one.
+ *
+ * The device is only kept active while its temperature is
+ * %FP_TEMPERATURE_COLD, and the time counts towards heating it up. Drivers
+ * that keep scanning for as long as they are active do not support this
+ * and always deactivate.
+ *
+ * A new timeout applies after the next action, setting it to 0 deactivates
+ * a device that is currently kept active. Suspending the device with
+ * fp_device_suspend() deactivates it as well.
+ */
+void
+fp_image_device_set_keep_active_timeout (FpImageDevice *self,
+                                         guint          timeout_ms)
+{
+  FpImageDevicePrivate *priv = fp_image_device_get_instance_private (self);
+
+  g_return_if_fail (FP_IS_IMAGE_DEVICE (self));
+
+  if (priv->keep_active_timeout == timeout_ms)
+    return;
+
+  priv->keep_active_timeout = timeout_ms;
+  if (timeout_ms == 0)
+    fpi_image_device_release (self);
+
+  g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_KEEP_ACTIVE_TIMEOUT]);
+}
+
+/**
+ * fp_image_device_get_keep_active_timeout:
+ * @self: a #FpImageDevice
+ *
+ * Returns: The time in milliseconds the device stays active after an
+ *   action, see fp_image_device_set_keep_active_timeout()
+ */
+guint
+fp_image_device_get_keep_active_timeout (FpImageDevice *self)
+{
+  FpImageDevicePrivate *priv = fp_image_device_get_instance_private (self);
+
+  g_return_val_if_fail (FP_IS_IMAGE_DEVICE (self), 0);
+
+  return priv->keep_active_timeout;
+}
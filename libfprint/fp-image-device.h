@@ -26,4 +26,8 @@ G_BEGIN_DECLS
 #define FP_TYPE_IMAGE_DEVICE (fp_image_device_get_type ())
 G_DECLARE_DERIVABLE_TYPE (FpImageDevice, fp_image_device, FP, IMAGE_DEVICE, FpDevice)
 
+void  fp_image_device_set_keep_active_timeout (FpImageDevice *self,
+                                               guint          timeout_ms);
+guint fp_image_device_get_keep_active_timeout (FpImageDevice *self);
+
 G_END_DECLS
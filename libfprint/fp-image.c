@@ -61,6 +61,7 @@ fp_image_finalize (GObject *object)
 
   g_clear_pointer (&self->data, g_free);
   g_clear_pointer (&self->binarized, g_free);
+  g_clear_pointer (&self->binarized_packed, g_free);
   g_clear_pointer (&self->minutiae, g_ptr_array_unref);
 
   G_OBJECT_CLASS (fp_image_parent_class)->finalize (object);
@@ -154,6 +155,7 @@ fp_image_class_init (FpImageClass *klass)
 static void
 fp_image_init (FpImage *self)
 {
+  self->minutiae_features = FPI_MINUTIAE_FEATURE_ALL;
 }
 
 typedef struct
@@ -161,42 +163,91 @@ typedef struct
   GAsyncReadyCallback user_cb;
   struct fp_minutiae *minutiae;
   gint                width, height;
+  guint               w_upscale, h_upscale;
   gdouble             ppmm;
   FpiImageFlags       flags;
+  FpiMinutiaeFeature  features;
   guchar             *image;
-  guchar             *binarized;
+  guint64            *binarized;
+  GError             *error;
 } DetectMinutiaeData;
 
+typedef struct
+{
+  GAsyncReadyCallback user_cb;
+  GPtrArray          *images;
+  GPtrArray          *data;
+  guint               max_threads;
+  GCancellable       *cancellable;
+  /* LFSTABLES not in use by a worker, reused across images */
+  GAsyncQueue        *tables;
+} DetectMinutiaeBatchData;
+
+static DetectMinutiaeData *
+fp_image_detect_minutiae_data_new (FpImage *self)
+{
+  DetectMinutiaeData *data = g_new0 (DetectMinutiaeData, 1);
+
+  data->image = g_malloc (self->width * self->height);
+  memcpy (data->image, self->data, self->width * self->height);
+  data->flags = self->flags;
+  data->width = self->width;
+  data->height = self->height;
+  data->w_upscale = self->w_upscale;
+  data->h_upscale = self->h_upscale;
+  data->ppmm = self->ppmm;
+  data->features = self->minutiae_features;
+
+  return data;
+}
+
 static void
 fp_image_detect_minutiae_free (DetectMinutiaeData *data)
 {
   g_clear_pointer (&data->image, g_free);
   g_clear_pointer (&data->minutiae, free_minutiae);
   g_clear_pointer (&data->binarized, g_free);
+  g_clear_error (&data->error);
   g_free (data);
 }
 
 static void
-fp_image_detect_minutiae_cb (GObject      *source_object,
-                             GAsyncResult *res,
-                             gpointer      user_data)
+fp_image_detect_minutiae_batch_free (DetectMinutiaeBatchData *batch)
 {
-  GTask *task = G_TASK (res);
-  FpImage *image;
-  DetectMinutiaeData *data = g_task_get_task_data (task);
+  g_clear_pointer (&batch->images, g_ptr_array_unref);
+  g_clear_pointer (&batch->data, g_ptr_array_unref);
+  g_clear_pointer (&batch->tables, g_async_queue_unref);
+  g_free (batch);
+}
 
-  if (!g_task_had_error (task))
+static void
+fp_image_apply_detected_minutiae (FpImage            *image,
+                                  DetectMinutiaeData *data,
+                                  gboolean            success)
+{
+  /* An image enlarged by the thread replaces the original even if detection
+   * failed, so that its dimensions do not depend on the outcome. */
+  if (success ||
+      data->width != image->width || data->height != image->height)
     {
-      gint i;
-      image = FP_IMAGE (source_object);
-
       image->flags = data->flags;
+      image->width = data->width;
+      image->height = data->height;
+      image->w_upscale = 0;
+      image->h_upscale = 0;
 
       g_clear_pointer (&image->data, g_free);
       image->data = g_steal_pointer (&data->image);
+    }
 
+  if (success)
+    {
+      gint i;
+
+      /* Only the packed form is kept, see fp_image_get_binarized() */
       g_clear_pointer (&image->binarized, g_free);
-      image->binarized = g_steal_pointer (&data->binarized);
+      g_clear_pointer (&image->binarized_packed, g_free);
+      image->binarized_packed = g_steal_pointer (&data->binarized);
 
       g_clear_pointer (&image->minutiae, g_ptr_array_unref);
       image->minutiae = g_ptr_array_new_full (data->minutiae->num,
@@ -209,6 +260,18 @@ fp_image_detect_minutiae_cb (GObject      *source_object,
       /* Don't let it delete anything. */
       data->minutiae->num = 0;
     }
+}
+
+static void
+fp_image_detect_minutiae_cb (GObject      *source_object,
+                             GAsyncResult *res,
+                             gpointer      user_data)
+{
+  GTask *task = G_TASK (res);
+  DetectMinutiaeData *data = g_task_get_task_data (task);
+
+  fp_image_apply_detected_minutiae (FP_IMAGE (source_object), data,
+                                    !g_task_had_error (task));
 
   if (data->user_cb)
     data->user_cb (source_object, res, user_data);
@@ -263,14 +326,12 @@ invert_colors (guint8 *data, gint width, gint height)
     data[i] = 0xff - data[i];
 }
 
-static void
-fp_image_detect_minutiae_thread_func (GTask        *task,
-                                      gpointer      source_object,
-                                      gpointer      task_data,
-                                      GCancellable *cancellable)
+static gboolean
+fp_image_detect_minutiae_run (DetectMinutiaeData *data,
+                              LFSTABLES          *tables,
+                              GError            **error)
 {
   g_autoptr(GTimer) timer = NULL;
-  DetectMinutiaeData *data = task_data;
   struct fp_minutiae *minutiae = NULL;
   g_autofree gint *direction_map = NULL;
   g_autofree gint *low_contrast_map = NULL;
@@ -283,6 +344,21 @@ fp_image_detect_minutiae_thread_func (GTask        *task,
   gint r;
   g_autofree LFSPARMS *lfsparms = NULL;
 
+#if HAVE_PIXMAN
+  if (data->w_upscale > 1 || data->h_upscale > 1)
+    {
+      guint8 *scaled = fpi_image_resize_data (data->image,
+                                              data->width, data->height,
+                                              MAX (data->w_upscale, 1),
+                                              MAX (data->h_upscale, 1));
+
+      g_free (data->image);
+      data->image = scaled;
+      data->width *= MAX (data->w_upscale, 1);
+      data->height *= MAX (data->h_upscale, 1);
+    }
+#endif
+
   /* Normalize the image first */
   if (data->flags & FPI_IMAGE_H_FLIPPED)
     hflip (data->image, data->width, data->height);
@@ -297,39 +373,140 @@ fp_image_detect_minutiae_thread_func (GTask        *task,
 
   lfsparms = g_memdup (&g_lfsparms_V2, sizeof (LFSPARMS));
   lfsparms->remove_perimeter_pts = data->flags & FPI_IMAGE_PARTIAL ? TRUE : FALSE;
+  lfsparms->outputs = 0;
+  if (data->features & FPI_MINUTIAE_FEATURE_RIDGE_COUNTS)
+    lfsparms->outputs |= LFS_OUTPUT_RIDGE_COUNTS;
+  if (data->features & FPI_MINUTIAE_FEATURE_QUALITY)
+    lfsparms->outputs |= LFS_OUTPUT_QUALITY;
 
   timer = g_timer_new ();
   r = get_minutiae (&minutiae, &quality_map, &direction_map,
                     &low_contrast_map, &low_flow_map, &high_curve_map,
                     &map_w, &map_h, &bdata, &bw, &bh, &bd,
                     data->image, data->width, data->height, 8,
-                    data->ppmm, lfsparms);
+                    data->ppmm, lfsparms, tables);
   g_timer_stop (timer);
   fp_dbg ("Minutiae scan completed in %f secs", g_timer_elapsed (timer, NULL));
 
-  data->binarized = g_steal_pointer (&bdata);
+  if (bdata)
+    {
+      data->binarized = g_new (guint64, PACKED_ROW_WORDS (bw) * bh);
+      pack_binary_image (data->binarized, bdata, bw, bh);
+    }
   data->minutiae = minutiae;
 
   if (r)
     {
       fp_err ("get minutiae failed, code %d", r);
-      g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_FAILED, "Minutiae scan failed with code %d", r);
-      g_object_unref (task);
-      return;
+      g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED, "Minutiae scan failed with code %d", r);
+      return FALSE;
     }
 
   if (!data->minutiae || data->minutiae->num == 0)
     {
-      g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_FAILED,
-                               "No minutiae found");
+      g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+                   "No minutiae found");
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+static void
+fp_image_detect_minutiae_thread_func (GTask        *task,
+                                      gpointer      source_object,
+                                      gpointer      task_data,
+                                      GCancellable *cancellable)
+{
+  DetectMinutiaeData *data = task_data;
+  GError *error = NULL;
+
+  if (fp_image_detect_minutiae_run (data, NULL, &error))
+    g_task_return_boolean (task, TRUE);
+  else
+    g_task_return_error (task, error);
+
+  g_object_unref (task);
+}
+
+static void
+fp_image_detect_minutiae_batch_worker (gpointer item,
+                                       gpointer user_data)
+{
+  DetectMinutiaeData *data = item;
+  DetectMinutiaeBatchData *batch = user_data;
+  LFSTABLES *tables;
+
+  if (g_cancellable_set_error_if_cancelled (batch->cancellable, &data->error))
+    return;
+
+  /* Each worker takes a set of tables, so that the mindtct lookup tables
+   * and the padded image buffer are only built once per thread. */
+  tables = g_async_queue_try_pop (batch->tables);
+  if (!tables)
+    alloc_lfstables (&tables);
+
+  fp_image_detect_minutiae_run (data, tables, &data->error);
+
+  g_async_queue_push (batch->tables, tables);
+}
+
+static void
+fp_image_detect_minutiae_batch_thread_func (GTask        *task,
+                                            gpointer      source_object,
+                                            gpointer      task_data,
+                                            GCancellable *cancellable)
+{
+  DetectMinutiaeBatchData *batch = task_data;
+  GThreadPool *pool;
+  GError *error = NULL;
+  guint i;
+
+  batch->cancellable = cancellable;
+  pool = g_thread_pool_new (fp_image_detect_minutiae_batch_worker,
+                            batch, batch->max_threads, FALSE, &error);
+  if (!pool)
+    {
+      g_task_return_error (task, error);
       g_object_unref (task);
       return;
     }
 
-  g_task_return_boolean (task, TRUE);
+  for (i = 0; i < batch->data->len; i++)
+    g_thread_pool_push (pool, g_ptr_array_index (batch->data, i), NULL);
+
+  /* Wait for all queued images to be processed */
+  g_thread_pool_free (pool, FALSE, TRUE);
+
+  if (!g_task_return_error_if_cancelled (task))
+    g_task_return_boolean (task, TRUE);
   g_object_unref (task);
 }
 
+static void
+fp_image_detect_minutiae_batch_cb (GObject      *source_object,
+                                   GAsyncResult *res,
+                                   gpointer      user_data)
+{
+  GTask *task = G_TASK (res);
+  DetectMinutiaeBatchData *batch = g_task_get_task_data (task);
+  guint i;
+
+  for (i = 0; i < batch->images->len; i++)
+    {
+      DetectMinutiaeData *data = g_ptr_array_index (batch->data, i);
+
+      if (data->error && !g_error_matches (data->error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        fp_dbg ("Minutiae detection failed for image %u: %s", i, data->error->message);
+
+      fp_image_apply_detected_minutiae (g_ptr_array_index (batch->images, i),
+                                        data, data->error == NULL);
+    }
+
+  if (batch->user_cb)
+    batch->user_cb (source_object, res, user_data);
+}
+
 /**
  * fp_image_get_height:
  * @self: A #FpImage
@@ -406,6 +583,14 @@ fp_image_get_data (FpImage *self, gsize *len)
 const guchar *
 fp_image_get_binarized (FpImage *self, gsize *len)
 {
+  /* Stored with one bit per pixel, expand on first use */
+  if (!self->binarized && self->binarized_packed)
+    {
+      self->binarized = g_malloc (self->width * self->height);
+      unpack_binary_image (self->binarized, self->binarized_packed,
+                           self->width, self->height);
+    }
+
   if (len && self->binarized)
     *len = self->width * self->height;
 
@@ -444,16 +629,10 @@ fp_image_detect_minutiae (FpImage            *self,
                           gpointer            user_data)
 {
   GTask *task;
-  DetectMinutiaeData *data = g_new0 (DetectMinutiaeData, 1);
+  DetectMinutiaeData *data = fp_image_detect_minutiae_data_new (self);
 
   task = g_task_new (self, cancellable, fp_image_detect_minutiae_cb, user_data);
 
-  data->image = g_malloc (self->width * self->height);
-  memcpy (data->image, self->data, self->width * self->height);
-  data->flags = self->flags;
-  data->width = self->width;
-  data->height = self->height;
-  data->ppmm = self->ppmm;
   data->user_cb = callback;
 
   g_task_set_task_data (task, data, (GDestroyNotify) fp_image_detect_minutiae_free);
@@ -478,6 +657,78 @@ fp_image_detect_minutiae_finish (FpImage      *self,
   return g_task_propagate_boolean (G_TASK (result), error);
 }
 
+/**
+ * fp_image_detect_minutiae_batch:
+ * @images: (element-type FpImage): The images to process
+ * @max_threads: Maximum number of worker threads, or 0 to use one per CPU
+ * @cancellable: a #GCancellable, or %NULL
+ * @callback: the function to call on completion
+ * @user_data: the data to pass to @callback
+ *
+ * Detects the minutiae of many images at once, spreading the work over a
+ * pool of threads. This is useful to process existing image archives, e.g.
+ * to re-create prints offline. Each thread reuses its lookup tables and
+ * scratch memory for all images of the same width.
+ *
+ * A copy of every image is held until the operation completes, so very
+ * large sets should be passed in chunks. Once finished, the minutiae of
+ * each image can be retrieved with fp_image_get_minutiae(). Images in which
+ * detection failed are left untouched.
+ */
+void
+fp_image_detect_minutiae_batch (GPtrArray          *images,
+                                guint               max_threads,
+                                GCancellable       *cancellable,
+                                GAsyncReadyCallback callback,
+                                gpointer            user_data)
+{
+  GTask *task;
+  DetectMinutiaeBatchData *batch;
+  guint i;
+
+  g_return_if_fail (images != NULL);
+
+  batch = g_new0 (DetectMinutiaeBatchData, 1);
+  batch->user_cb = callback;
+  batch->max_threads = max_threads > 0 ? max_threads : g_get_num_processors ();
+  batch->tables = g_async_queue_new_full ((GDestroyNotify) free_lfstables);
+  batch->images = g_ptr_array_new_full (images->len, g_object_unref);
+  batch->data = g_ptr_array_new_full (images->len,
+                                      (GDestroyNotify) fp_image_detect_minutiae_free);
+
+  for (i = 0; i < images->len; i++)
+    {
+      FpImage *image = g_ptr_array_index (images, i);
+
+      g_ptr_array_add (batch->images, g_object_ref (image));
+      g_ptr_array_add (batch->data, fp_image_detect_minutiae_data_new (image));
+    }
+
+  task = g_task_new (NULL, cancellable, fp_image_detect_minutiae_batch_cb, user_data);
+  g_task_set_source_tag (task, fp_image_detect_minutiae_batch);
+  g_task_set_task_data (task, batch, (GDestroyNotify) fp_image_detect_minutiae_batch_free);
+  g_task_run_in_thread (task, fp_image_detect_minutiae_batch_thread_func);
+}
+
+/**
+ * fp_image_detect_minutiae_batch_finish:
+ * @result: A #GAsyncResult
+ * @error: Return location for errors, or %NULL to ignore
+ *
+ * Finish minutiae detection in a set of images. Note that a successful
+ * return does not mean that minutiae were found in every image.
+ *
+ * Returns: %TRUE if all images were processed
+ */
+gboolean
+fp_image_detect_minutiae_batch_finish (GAsyncResult *result,
+                                       GError      **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, NULL), FALSE);
+
+  return g_task_propagate_boolean (G_TASK (result), error);
+}
+
 /**
  * fp_minutia_get_coords:
  * @min: A #FpMinutia
@@ -47,6 +47,14 @@ gboolean      fp_image_detect_minutiae_finish (FpImage      *self,
                                                GAsyncResult *result,
                                                GError      **error);
 
+void          fp_image_detect_minutiae_batch (GPtrArray          *images,
+                                              guint               max_threads,
+                                              GCancellable       *cancellable,
+                                              GAsyncReadyCallback callback,
+                                              gpointer            user_data);
+gboolean      fp_image_detect_minutiae_batch_finish (GAsyncResult *result,
+                                                     GError      **error);
+
 const guchar * fp_image_get_data (FpImage *self,
                                   gsize   *len);
 const guchar * fp_image_get_binarized (FpImage *self,
@@ -0,0 +1,218 @@
+/*
+ * Persistent storage of sensor calibration data
+ * Copyright (C) 2026 libfprint contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#define FP_COMPONENT "calibration"
+
+#include <errno.h>
+#include <glib/gstdio.h>
+
+#include "fpi-calibration-cache.h"
+#include "fpi-log.h"
+
+/**
+ * SECTION:fpi-calibration-cache
+ * @title: Calibration cache
+ * @short_description: Persistent storage of sensor calibration data
+ *
+ * Some sensors need a lengthy calibration every time they are activated.
+ * Drivers can store the result of such a calibration and restore it the
+ * next time, skipping most of the work as long as the result still
+ * matches what the sensor reports.
+ *
+ * The cache is opt-in, it is only used if FP_CALIBRATION_CACHE is set to
+ * the directory the data should be stored in. Entries are stored per
+ * driver and device ID, and are only returned for the same version string
+ * that they were stored with. Drivers should include anything in the
+ * version that invalidates a calibration, e.g. the firmware version.
+ *
+ * The cached data is opaque to this module. Drivers must validate it
+ * against the sensor before relying on it, and call
+ * fpi_calibration_cache_discard() if it turned out to be stale.
+ */
+
+#define CALIBRATION_CACHE_FORMAT 1
+#define CALIBRATION_CACHE_TYPE "(ussay)"
+
+static const gchar *
+get_directory (void)
+{
+  static gchar *directory = NULL;
+
+  if (g_once_init_enter (&directory))
+    {
+      const gchar *value = g_getenv ("FP_CALIBRATION_CACHE");
+
+      g_once_init_leave (&directory, g_strdup (value && *value ? value : ""));
+    }
+
+  return *directory ? directory : NULL;
+}
+
+static gchar *
+get_path (FpDevice *device)
+{
+  g_autofree gchar *basename = NULL;
+
+  basename = g_strdup_printf ("%s-%s.calibration",
+                              fp_device_get_driver (device),
+                              fp_device_get_device_id (device));
+  g_strcanon (basename, G_CSET_a_2_z G_CSET_A_2_Z G_CSET_DIGITS "-_.", '_');
+
+  return g_build_filename (get_directory (), basename, NULL);
+}
+
+/**
+ * fpi_calibration_cache_enabled:
+ *
+ * Whether calibration data is cached, i.e. FP_CALIBRATION_CACHE is set.
+ *
+ * Returns: %TRUE if the cache is enabled
+ */
+gboolean
+fpi_calibration_cache_enabled (void)
+{
+  return get_directory () != NULL;
+}
+
+/**
+ * fpi_calibration_cache_load:
+ * @device: The #FpDevice
+ * @version: The version the data has to be stored with
+ *
+ * Load the calibration data that was previously stored for @device.
+ *
+ * Returns: (transfer full) (nullable): The stored data, or %NULL if the
+ *   cache is disabled or no matching data was stored
+ */
+GBytes *
+fpi_calibration_cache_load (FpDevice *device, const gchar *version)
+{
+  g_autoptr(GVariant) variant = NULL;
+  g_autoptr(GVariant) data = NULL;
+  g_autoptr(GError) error = NULL;
+  g_autofree gchar *path = NULL;
+  g_autofree gchar *contents = NULL;
+  const gchar *stored_id, *stored_version;
+  guint32 format;
+  gsize len;
+
+  g_return_val_if_fail (FP_IS_DEVICE (device), NULL);
+  g_return_val_if_fail (version != NULL, NULL);
+
+  if (!fpi_calibration_cache_enabled ())
+    return NULL;
+
+  path = get_path (device);
+  if (!g_file_get_contents (path, &contents, &len, &error))
+    {
+      if (!g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+        fp_warn ("Could not read calibration cache %s: %s", path, error->message);
+      return NULL;
+    }
+
+  variant = g_variant_new_from_data (G_VARIANT_TYPE (CALIBRATION_CACHE_TYPE),
+                                     g_steal_pointer (&contents), len,
+                                     FALSE, g_free, NULL);
+  g_variant_ref_sink (variant);
+  if (!g_variant_is_normal_form (variant))
+    {
+      fp_warn ("Ignoring corrupt calibration cache %s", path);
+      return NULL;
+    }
+
+  g_variant_get (variant, "(u&s&s@ay)", &format, &stored_id, &stored_version, &data);
+  if (format != CALIBRATION_CACHE_FORMAT ||
+      g_strcmp0 (stored_id, fp_device_get_device_id (device)) != 0 ||
+      g_strcmp0 (stored_version, version) != 0)
+    {
+      fp_dbg ("Calibration cache %s does not match version %s", path, version);
+      return NULL;
+    }
+
+  fp_dbg ("Loaded calibration from %s", path);
+
+  return g_variant_get_data_as_bytes (data);
+}
+
+/**
+ * fpi_calibration_cache_store:
+ * @device: The #FpDevice
+ * @version: The version to store the data with
+ * @data: The calibration data
+ *
+ * Store the calibration data of @device, replacing any data stored
+ * previously. Does nothing if the cache is disabled.
+ */
+void
+fpi_calibration_cache_store (FpDevice *device, const gchar *version, GBytes *data)
+{
+  g_autoptr(GVariant) variant = NULL;
+  g_autoptr(GError) error = NULL;
+  g_autofree gchar *path = NULL;
+
+  g_return_if_fail (FP_IS_DEVICE (device));
+  g_return_if_fail (version != NULL);
+  g_return_if_fail (data != NULL);
+
+  if (!fpi_calibration_cache_enabled ())
+    return;
+
+  if (g_mkdir_with_parents (get_directory (), 0700) != 0)
+    {
+      fp_warn ("Could not create calibration cache directory %s: %s",
+               get_directory (), g_strerror (errno));
+      return;
+    }
+
+  variant = g_variant_new ("(uss@ay)",
+                           CALIBRATION_CACHE_FORMAT,
+                           fp_device_get_device_id (device),
+                           version,
+                           g_variant_new_from_bytes (G_VARIANT_TYPE_BYTESTRING, data, TRUE));
+  g_variant_ref_sink (variant);
+
+  path = get_path (device);
+  if (!g_file_set_contents (path, g_variant_get_data (variant),
+                            g_variant_get_size (variant), &error))
+    fp_warn ("Could not write calibration cache %s: %s", path, error->message);
+  else
+    fp_dbg ("Stored calibration in %s", path);
+}
+
+/**
+ * fpi_calibration_cache_discard:
+ * @device: The #FpDevice
+ *
+ * Remove the calibration data that was stored for @device, e.g. because
+ * the sensor did not accept it anymore.
+ */
+void
+fpi_calibration_cache_discard (FpDevice *device)
+{
+  g_autofree gchar *path = NULL;
+
+  g_return_if_fail (FP_IS_DEVICE (device));
+
+  if (!fpi_calibration_cache_enabled ())
+    return;
+
+  path = get_path (device);
+  if (g_unlink (path) != 0 && errno != ENOENT)
+    fp_warn ("Could not remove calibration cache %s: %s", path, g_strerror (errno));
+}
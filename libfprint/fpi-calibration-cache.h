@@ -0,0 +1,37 @@
+/*
+ * Persistent storage of sensor calibration data
+ * Copyright (C) 2026 libfprint contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#pragma once
+
+#include "fpi-device.h"
+
+G_BEGIN_DECLS
+
+gboolean fpi_calibration_cache_enabled (void);
+
+GBytes  *fpi_calibration_cache_load (FpDevice    *device,
+                                     const gchar *version);
+
+void     fpi_calibration_cache_store (FpDevice    *device,
+                                      const gchar *version,
+                                      GBytes      *data);
+
+void     fpi_calibration_cache_discard (FpDevice *device);
+
+G_END_DECLS
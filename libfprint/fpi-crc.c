@@ -0,0 +1,167 @@
+/*
+ * Checksum helpers for driver protocols
+ * Copyright (C) 2026 libfprint contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <string.h>
+
+#include "fpi-crc.h"
+
+/**
+ * SECTION:fpi-crc
+ * @title: Checksum helpers
+ * @short_description: CRC routines shared by driver protocols
+ *
+ * Table driven CRC implementations for the checksums used by device
+ * protocols. All functions take the CRC of the preceding data as first
+ * argument, so that a checksum can be computed over several buffers.
+ */
+
+#define CRC32_POLY 0xedb88320     /* reflected 0x04c11db7 */
+#define CRC16_CCITT_POLY 0x1021
+#define CRC8_POLY 0x07
+
+static guint32 crc32_table[8][256];
+static guint16 crc16_ccitt_table[256];
+static guint8 crc8_table[256];
+
+static void
+fpi_crc_init_tables (void)
+{
+  static gsize initialized = 0;
+  guint i, j;
+
+  if (!g_once_init_enter (&initialized))
+    return;
+
+  for (i = 0; i < 256; i++)
+    {
+      guint32 crc32 = i;
+      guint16 crc16 = i << 8;
+      guint8 crc8 = i;
+
+      for (j = 0; j < 8; j++)
+        {
+          crc32 = (crc32 >> 1) ^ (crc32 & 1 ? CRC32_POLY : 0);
+          crc16 = (crc16 << 1) ^ (crc16 & 0x8000 ? CRC16_CCITT_POLY : 0);
+          crc8 = (crc8 << 1) ^ (crc8 & 0x80 ? CRC8_POLY : 0);
+        }
+
+      crc32_table[0][i] = crc32;
+      crc16_ccitt_table[i] = crc16;
+      crc8_table[i] = crc8;
+    }
+
+  /* Tables to process 8 bytes per step ("slicing-by-8") */
+  for (i = 0; i < 256; i++)
+    for (j = 1; j < 8; j++)
+      crc32_table[j][i] = (crc32_table[j - 1][i] >> 8) ^
+                          crc32_table[0][crc32_table[j - 1][i] & 0xff];
+
+  g_once_init_leave (&initialized, 1);
+}
+
+/**
+ * fpi_crc32:
+ * @crc: CRC of the preceding data, or 0
+ * @data: the data to checksum
+ * @len: length of @data
+ *
+ * Computes the common CRC-32 (IEEE 802.3, as used by zlib and Ethernet)
+ * of @data.
+ *
+ * Returns: The CRC-32 value
+ */
+guint32
+fpi_crc32 (guint32 crc, const guint8 *data, gsize len)
+{
+  fpi_crc_init_tables ();
+
+  crc = ~crc;
+
+  while (len >= 8)
+    {
+      guint32 one, two;
+
+      memcpy (&one, data, sizeof (one));
+      memcpy (&two, data + 4, sizeof (two));
+      one = GUINT32_FROM_LE (one) ^ crc;
+      two = GUINT32_FROM_LE (two);
+
+      crc = crc32_table[7][one & 0xff] ^
+            crc32_table[6][(one >> 8) & 0xff] ^
+            crc32_table[5][(one >> 16) & 0xff] ^
+            crc32_table[4][one >> 24] ^
+            crc32_table[3][two & 0xff] ^
+            crc32_table[2][(two >> 8) & 0xff] ^
+            crc32_table[1][(two >> 16) & 0xff] ^
+            crc32_table[0][two >> 24];
+
+      data += 8;
+      len -= 8;
+    }
+
+  while (len--)
+    crc = crc32_table[0][(crc ^ *data++) & 0xff] ^ (crc >> 8);
+
+  return ~crc;
+}
+
+/**
+ * fpi_crc16_ccitt:
+ * @crc: CRC of the preceding data, or the initial value
+ * @data: the data to checksum
+ * @len: length of @data
+ *
+ * Computes the non-reflected CRC-16 with the CCITT polynomial 0x1021.
+ * With an initial value of 0 this is known as CRC-16/XMODEM, with 0xffff
+ * as CRC-16/CCITT-FALSE.
+ *
+ * Returns: The CRC-16 value
+ */
+guint16
+fpi_crc16_ccitt (guint16 crc, const guint8 *data, gsize len)
+{
+  fpi_crc_init_tables ();
+
+  while (len--)
+    crc = (crc << 8) ^ crc16_ccitt_table[((crc >> 8) ^ *data++) & 0xff];
+
+  return crc;
+}
+
+/**
+ * fpi_crc8:
+ * @crc: CRC of the preceding data, or the initial value
+ * @data: the data to checksum
+ * @len: length of @data
+ *
+ * Computes the non-reflected CRC-8 with the polynomial 0x07, as used for
+ * e.g. the SMBus packet error code.
+ *
+ * Returns: The CRC-8 value
+ */
+guint8
+fpi_crc8 (guint8 crc, const guint8 *data, gsize len)
+{
+  fpi_crc_init_tables ();
+
+  while (len--)
+    crc = crc8_table[crc ^ *data++];
+
+  return crc;
+}
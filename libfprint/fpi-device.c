@@ -21,10 +21,12 @@
 #define FP_COMPONENT "device"
 #include <math.h>
 #include <fcntl.h>
+#include <errno.h>
 
 #include "fpi-log.h"
 
 #include "fp-device-private.h"
+#include "fpi-usb-transfer.h"
 
 /**
  * SECTION: fpi-device
@@ -310,6 +312,65 @@ fpi_device_update_features (FpDevice       *device,
   priv->features = (priv->features & ~update) | (value & update);
 }
 
+/**
+ * fpi_device_invalidate_stored_prints:
+ * @device: The #FpDevice
+ *
+ * Drops the cached result of the last list operation, see the
+ * #FpDeviceClass.cache_stored_prints flag. Drivers need to call this if
+ * they detect that the storage was modified by other means than the enroll,
+ * delete and clear_storage operations.
+ */
+void
+fpi_device_invalidate_stored_prints (FpDevice *device)
+{
+  FpDevicePrivate *priv = fp_device_get_instance_private (device);
+
+  g_return_if_fail (FP_IS_DEVICE (device));
+
+  g_clear_pointer (&priv->stored_prints_cache, g_ptr_array_unref);
+}
+
+/* Deep copies, so that modifying a returned print does not modify the cache */
+static GPtrArray *
+copy_prints (GPtrArray *prints)
+{
+  g_autoptr(GPtrArray) res = g_ptr_array_new_full (prints->len, g_object_unref);
+  g_autoptr(GError) error = NULL;
+  guint i;
+
+  for (i = 0; i < prints->len; i++)
+    {
+      g_autofree guchar *data = NULL;
+      gsize length;
+      FpPrint *print;
+
+      if (!fp_print_serialize (g_ptr_array_index (prints, i), &data, &length, &error) ||
+          !(print = fp_print_deserialize (data, length, &error)))
+        {
+          g_warning ("Not caching stored prints: %s", error->message);
+          return NULL;
+        }
+
+      g_ptr_array_add (res, print);
+    }
+
+  return g_steal_pointer (&res);
+}
+
+/* Returns a new array with copies of the cached prints, or NULL if there is
+ * no cache */
+GPtrArray *
+fpi_device_get_cached_stored_prints (FpDevice *device)
+{
+  FpDevicePrivate *priv = fp_device_get_instance_private (device);
+
+  if (!priv->stored_prints_cache)
+    return NULL;
+
+  return copy_prints (priv->stored_prints_cache);
+}
+
 typedef struct
 {
   GSource   source;
@@ -982,7 +1043,7 @@ fp_device_task_return_in_idle_cb (gpointer user_data)
   g_clear_object (&priv->current_cancellable);
   cancellation_reason = g_steal_pointer (&priv->current_cancellation_reason);
 
-  fpi_device_update_temp (data->device, FALSE);
+  fpi_device_update_temp (data->device, priv->temp_kept_active);
 
   if (action == FPI_DEVICE_ACTION_OPEN &&
       data->type != FP_DEVICE_TASK_RETURN_ERROR)
@@ -1180,6 +1241,7 @@ fpi_device_open_complete (FpDevice *device, GError *error)
   g_debug ("Device reported open completion");
 
   clear_device_cancel_action (device);
+  fpi_device_invalidate_stored_prints (device);
   fpi_device_report_finger_status (device, FP_FINGER_STATUS_NONE);
 
   if (!error)
@@ -1208,8 +1270,12 @@ fpi_device_close_complete (FpDevice *device, GError *error)
   g_debug ("Device reported close completion");
 
   clear_device_cancel_action (device);
+  fpi_device_invalidate_stored_prints (device);
   fpi_device_report_finger_status (device, FP_FINGER_STATUS_NONE);
 
+  if (fpi_transfer_trace_get_flags () & FPI_TRANSFER_TRACE_RECORD)
+    fpi_transfer_trace_save (device);
+
   switch (priv->type)
     {
     case FP_DEVICE_TYPE_USB:
@@ -1260,6 +1326,7 @@ fpi_device_enroll_complete (FpDevice *device, FpPrint *print, GError *error)
   g_debug ("Device reported enroll completion");
 
   clear_device_cancel_action (device);
+  fpi_device_invalidate_stored_prints (device);
   fpi_device_report_finger_status (device, FP_FINGER_STATUS_NONE);
 
   if (!error)
@@ -1495,6 +1562,7 @@ fpi_device_delete_complete (FpDevice *device,
   g_debug ("Device reported deletion completion");
 
   clear_device_cancel_action (device);
+  fpi_device_invalidate_stored_prints (device);
   fpi_device_report_finger_status (device, FP_FINGER_STATUS_NONE);
 
   if (!error)
@@ -1516,6 +1584,10 @@ fpi_device_delete_complete (FpDevice *device,
  * g_ptr_array_unref() and the elements are destroyed automatically.
  * As such, you must use g_ptr_array_new_with_free_func() with
  * g_object_unref() as free func to create the array.
+ *
+ * If #FpDeviceClass.cache_stored_prints is set, copies of the prints are
+ * also kept and returned for further list operations without calling the
+ * driver.
  */
 void
 fpi_device_list_complete (FpDevice  *device,
@@ -1544,6 +1616,12 @@ fpi_device_list_complete (FpDevice  *device,
                                         "Driver failed to provide a list of prints");
     }
 
+  if (!error && FP_DEVICE_GET_CLASS (device)->cache_stored_prints)
+    {
+      g_clear_pointer (&priv->stored_prints_cache, g_ptr_array_unref);
+      priv->stored_prints_cache = copy_prints (prints);
+    }
+
   if (!error)
     fpi_device_return_task_in_idle (device, FP_DEVICE_TASK_RETURN_PTR_ARRAY, prints);
   else
@@ -1746,6 +1824,7 @@ fpi_device_clear_storage_complete (FpDevice *device,
   g_debug ("Device reported deletion completion");
 
   clear_device_cancel_action (device);
+  fpi_device_invalidate_stored_prints (device);
   fpi_device_report_finger_status (device, FP_FINGER_STATUS_NONE);
 
   if (!error)
@@ -2133,3 +2212,86 @@ fpi_device_update_temp (FpDevice *device, gboolean is_active)
                                                update_temp_timeout,
                                                NULL, NULL);
 }
+
+/**
+ * fpi_device_set_kept_active:
+ * @device: The #FpDevice
+ * @kept_active: Whether the device stays active without an action
+ *
+ * Purely internal function to mark that the sensor stays powered once the
+ * current action has completed, so that the time is accounted as active in
+ * the temperature model.
+ */
+void
+fpi_device_set_kept_active (FpDevice *device, gboolean kept_active)
+{
+  FpDevicePrivate *priv = fp_device_get_instance_private (device);
+
+  priv->temp_kept_active = kept_active;
+
+  /* Otherwise the model is updated when the current action completes */
+  if (priv->current_action == FPI_DEVICE_ACTION_NONE)
+    fpi_device_update_temp (device, kept_active);
+}
+
+void
+fpi_device_update_transfer_stats (FpDevice           *device,
+                                  FpiTransferTraceBus bus,
+                                  guint8              endpoint,
+                                  gssize              length,
+                                  gint64              latency,
+                                  const GError       *error)
+{
+  FpDevicePrivate *priv = fp_device_get_instance_private (device);
+  FpTransferStats *stats;
+  guint64 latency_ms;
+  guint slot;
+
+  if (bus == FPI_TRANSFER_TRACE_BUS_SPI)
+    slot = TRANSFER_STATS_SPI_SLOT;
+  else
+    slot = (endpoint & 0x0f) | ((endpoint & FPI_USB_ENDPOINT_IN) ? 0x10 : 0);
+
+  g_mutex_lock (&priv->transfer_stats_mutex);
+
+  stats = &priv->transfer_stats[slot];
+  stats->transfers += 1;
+  if (length > 0)
+    stats->bytes += length;
+
+  if (length <= 0)
+    stats->bytes_histogram[0] += 1;
+  else
+    stats->bytes_histogram[MIN (g_bit_storage (length),
+                                TRANSFER_STATS_BYTES_BUCKETS - 1)] += 1;
+
+  switch (fpi_transfer_trace_status_from_error (error))
+    {
+    case 0:
+      break;
+
+    case -ETIMEDOUT:
+      stats->timeouts += 1;
+      break;
+
+    case -ENOENT:
+      stats->cancelled += 1;
+      break;
+
+    default:
+      stats->errors += 1;
+    }
+
+  latency = MAX (latency, 0);
+  stats->latency_total += latency;
+  stats->latency_max = MAX (stats->latency_max, (guint64) latency);
+
+  latency_ms = latency / 1000;
+  if (latency_ms == 0)
+    stats->latency_histogram[0] += 1;
+  else
+    stats->latency_histogram[MIN (g_bit_storage (latency_ms),
+                                  TRANSFER_STATS_LATENCY_BUCKETS - 1)] += 1;
+
+  g_mutex_unlock (&priv->transfer_stats_mutex);
+}
@@ -84,6 +84,10 @@ struct _FpIdEntry
  *   after being mostly cold. Set to -1 if the device can be always-on.
  * @temp_cold_seconds: Assumed time in seconds for the device to be mostly cold
  *   after having been too hot to operate.
+ * @cache_stored_prints: Keep the result of @list until the storage is
+ *   modified through @enroll, @delete or @clear_storage, or the device is
+ *   closed. Use fpi_device_invalidate_stored_prints() if the driver detects
+ *   other changes.
  * @usb_discover: Class method to check whether a USB device is supported by
  *  the driver. Should return 0 if the device is unsupported and a positive
  *  score otherwise. The default score is 50 and the driver with the highest
@@ -155,6 +159,8 @@ struct _FpDeviceClass
   gint32 temp_hot_seconds;
   gint32 temp_cold_seconds;
 
+  gboolean cache_stored_prints;
+
   /* Callbacks */
   gint (*usb_discover) (GUsbDevice *usb_device);
   void (*probe)    (FpDevice *device);
@@ -268,6 +274,8 @@ void fpi_device_update_features (FpDevice       *device,
                                  FpDeviceFeature update,
                                  FpDeviceFeature value);
 
+void fpi_device_invalidate_stored_prints (FpDevice *device);
+
 void fpi_device_action_error (FpDevice *device,
                               GError   *error);
 
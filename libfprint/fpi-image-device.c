@@ -20,6 +20,7 @@
 #define FP_COMPONENT "image_device"
 #include "fpi-log.h"
 
+#include "fp-device-private.h"
 #include "fp-image-device-private.h"
 #include "fp-image-device.h"
 
@@ -43,6 +44,8 @@ fp_image_device_get_instance_private (FpImageDevice *self)
 
 static void fp_image_device_change_state (FpImageDevice      *self,
                                           FpiImageDeviceState state);
+static void fp_image_device_maybe_complete_action (FpImageDevice *self,
+                                                   GError        *error);
 
 /* Private shared functions */
 
@@ -52,6 +55,25 @@ fpi_image_device_activate (FpImageDevice *self)
   FpImageDevicePrivate *priv = fp_image_device_get_instance_private (self);
   FpImageDeviceClass *cls = FP_IMAGE_DEVICE_GET_CLASS (self);
 
+  if (priv->kept_active)
+    {
+      g_assert (priv->state == FPI_IMAGE_DEVICE_STATE_IDLE);
+
+      fp_dbg ("Image device is still active, resuming");
+      g_clear_pointer (&priv->keep_active_source, g_source_destroy);
+      priv->kept_active = FALSE;
+      fpi_device_set_kept_active (FP_DEVICE (self), FALSE);
+      fp_image_device_change_state (self, FPI_IMAGE_DEVICE_STATE_AWAIT_FINGER_ON);
+      return;
+    }
+
+  if (priv->releasing)
+    {
+      /* Activate again once the deactivation has finished */
+      priv->activate_pending = TRUE;
+      return;
+    }
+
   g_assert (!priv->active);
 
   fp_dbg ("Activating image device");
@@ -59,6 +81,36 @@ fpi_image_device_activate (FpImageDevice *self)
   cls->activate (self);
 }
 
+static void
+fp_image_device_keep_active_timeout (FpDevice *device, gpointer user_data)
+{
+  FpImageDevice *self = FP_IMAGE_DEVICE (device);
+  FpImageDevicePrivate *priv = fp_image_device_get_instance_private (self);
+
+  priv->keep_active_source = NULL;
+
+  fp_dbg ("Image device was not used again in time");
+  fpi_image_device_release (self);
+}
+
+static gboolean
+fp_image_device_can_keep_active (FpImageDevice *self)
+{
+  FpImageDevicePrivate *priv = fp_image_device_get_instance_private (self);
+  FpImageDeviceClass *cls = FP_IMAGE_DEVICE_GET_CLASS (self);
+
+  /* Drivers without a change_state handler usually keep scanning for as
+   * long as they are active, which is not possible without an action. */
+  if (priv->keep_active_timeout == 0 || !cls->change_state)
+    return FALSE;
+
+  if (priv->state != FPI_IMAGE_DEVICE_STATE_IDLE || priv->action_error)
+    return FALSE;
+
+  /* Let the device cool down instead */
+  return fp_device_get_temperature (FP_DEVICE (self)) == FP_TEMPERATURE_COLD;
+}
+
 void
 fpi_image_device_deactivate (FpImageDevice *self, gboolean cancelling)
 {
@@ -73,14 +125,69 @@ fpi_image_device_deactivate (FpImageDevice *self, gboolean cancelling)
       fp_dbg ("Already deactivated, ignoring request.");
       return;
     }
+  if (priv->kept_active)
+    {
+      /* The action has completed already, see fpi_image_device_release() */
+      fp_dbg ("Image device is kept active, ignoring request.");
+      return;
+    }
   if (!cancelling && priv->state != FPI_IMAGE_DEVICE_STATE_IDLE)
     g_warning ("Deactivating image device while it is not idle, this should not happen.");
 
+  if (!cancelling && fp_image_device_can_keep_active (self))
+    {
+      fp_dbg ("Keeping image device active for %u ms", priv->keep_active_timeout);
+      priv->kept_active = TRUE;
+      priv->keep_active_source = fpi_device_add_timeout (device,
+                                                         priv->keep_active_timeout,
+                                                         fp_image_device_keep_active_timeout,
+                                                         NULL, NULL);
+      fpi_device_set_kept_active (device, TRUE);
+      fp_image_device_maybe_complete_action (self, NULL);
+      return;
+    }
+
   fp_dbg ("Deactivating image device");
   fp_image_device_change_state (self, FPI_IMAGE_DEVICE_STATE_DEACTIVATING);
   cls->deactivate (self);
 }
 
+/* Deactivates the device if it was kept active after the last action, see
+ * fp_image_device_set_keep_active_timeout(). */
+void
+fpi_image_device_release (FpImageDevice *self)
+{
+  FpImageDevicePrivate *priv = fp_image_device_get_instance_private (self);
+
+  if (!priv->kept_active)
+    return;
+
+  g_clear_pointer (&priv->keep_active_source, g_source_destroy);
+  priv->kept_active = FALSE;
+  priv->releasing = TRUE;
+  fpi_device_set_kept_active (FP_DEVICE (self), FALSE);
+
+  fpi_image_device_deactivate (self, TRUE);
+}
+
+/* Suspends a device without a current action, once it is deactivated if it
+ * was kept active after the last action. */
+void
+fpi_image_device_suspend_idle (FpImageDevice *self)
+{
+  FpImageDevicePrivate *priv = fp_image_device_get_instance_private (self);
+
+  if (!priv->kept_active && !priv->releasing)
+    {
+      fpi_device_suspend_complete (FP_DEVICE (self), NULL);
+      return;
+    }
+
+  fp_dbg ("Releasing image device before suspending");
+  priv->suspend_pending = TRUE;
+  fpi_image_device_release (self);
+}
+
 /* Static helper functions */
 
 /* This should not be called directly to activate/deactivate the device! */
@@ -191,7 +298,7 @@ fp_image_device_maybe_complete_action (FpImageDevice *self, GError *error)
     }
 
   /* Do not complete if the device is still active or a minutiae scan is pending. */
-  if (priv->active || priv->minutiae_scan_active)
+  if ((priv->active && !priv->kept_active) || priv->minutiae_scan_active)
     return;
 
   if (!priv->action_error)
@@ -239,6 +346,7 @@ fpi_image_device_minutiae_detected (GObject *source_object, GAsyncResult *res, g
   g_autoptr(FpPrint) print = NULL;
   GError *error = NULL;
   FpImageDevice *self = FP_IMAGE_DEVICE (user_data);
+  FpImageDeviceClass *cls = FP_IMAGE_DEVICE_GET_CLASS (self);
   FpDevice *device = FP_DEVICE (self);
   FpImageDevicePrivate *priv;
   FpiDeviceAction action;
@@ -277,7 +385,7 @@ fpi_image_device_minutiae_detected (GObject *source_object, GAsyncResult *res, g
     {
       print = fp_print_new (device);
       fpi_print_set_type (print, FPI_PRINT_NBIS);
-      if (!fpi_print_add_from_image (print, image, &error))
+      if (!fpi_print_add_from_image (print, image, cls->max_minutiae, &error))
         {
           g_clear_object (&print);
 
@@ -421,7 +529,7 @@ fpi_image_device_report_finger_status (FpImageDevice *self,
                                                FP_FINGER_STATUS_PRESENT);
     }
 
-  if (priv->state == FPI_IMAGE_DEVICE_STATE_INACTIVE)
+  if (priv->state == FPI_IMAGE_DEVICE_STATE_INACTIVE || priv->kept_active)
     {
       /* Do we really want to always ignore such reports? We could
        * also track the state in case the user had the finger on
@@ -479,6 +587,7 @@ void
 fpi_image_device_image_captured (FpImageDevice *self, FpImage *image)
 {
   FpImageDevicePrivate *priv = fp_image_device_get_instance_private (self);
+  FpImageDeviceClass *cls = FP_IMAGE_DEVICE_GET_CLASS (self);
   FpiDeviceAction action;
 
   action = fpi_device_get_current_action (FP_DEVICE (self));
@@ -494,6 +603,14 @@ fpi_image_device_image_captured (FpImageDevice *self, FpImage *image)
 
   priv->minutiae_scan_active = TRUE;
 
+  /* Prints only need position and direction of the minutiae, and the
+   * quality if some of them will be pruned */
+  if (action != FPI_DEVICE_ACTION_CAPTURE)
+    fpi_image_set_minutiae_features (image,
+                                     cls->max_minutiae > 0 ?
+                                     FPI_MINUTIAE_FEATURE_QUALITY :
+                                     FPI_MINUTIAE_FEATURE_NONE);
+
   /* XXX: We also detect minutiae in capture mode, we solely do this
    *      to normalize the image which will happen as a by-product. */
   fp_image_detect_minutiae (image,
@@ -585,6 +702,14 @@ fpi_image_device_session_error (FpImageDevice *self, GError *error)
       error = g_error_new (FP_DEVICE_ERROR, FP_DEVICE_ERROR_GENERAL, "Driver reported session error without an error");
     }
 
+  if (priv->kept_active || priv->releasing)
+    {
+      g_warning ("Driver reported session error without an action: %s", error->message);
+      g_clear_error (&error);
+      fpi_image_device_release (self);
+      return;
+    }
+
   if (!priv->active)
     {
       FpiDeviceAction action = fpi_device_get_current_action (FP_DEVICE (self));
@@ -684,6 +809,37 @@ fpi_image_device_deactivate_complete (FpImageDevice *self, GError *error)
 
   fp_image_device_change_state (self, FPI_IMAGE_DEVICE_STATE_INACTIVE);
 
+  if (priv->releasing)
+    {
+      FpImageDeviceClass *cls = FP_IMAGE_DEVICE_GET_CLASS (self);
+
+      /* Not part of an action, only continue whatever waited for it. */
+      priv->releasing = FALSE;
+      if (error)
+        g_debug ("Ignoring deactivation error: %s", error->message);
+      g_clear_error (&error);
+
+      if (priv->suspend_pending)
+        {
+          priv->suspend_pending = FALSE;
+          fpi_device_suspend_complete (FP_DEVICE (self), NULL);
+        }
+      else if (priv->close_pending)
+        {
+          priv->close_pending = FALSE;
+          cls->img_close (self);
+        }
+      else if (priv->activate_pending)
+        {
+          priv->activate_pending = FALSE;
+          if (fpi_device_action_is_cancelled (FP_DEVICE (self)))
+            fp_image_device_maybe_complete_action (self, NULL);
+          else
+            fpi_image_device_activate (self);
+        }
+      return;
+    }
+
   fp_image_device_maybe_complete_action (self, error);
 }
 
@@ -75,6 +75,9 @@ typedef enum {
  * @bz3_threshold: Threshold to consider bozorth3 score a match, default: 40
  * @img_width: Width of the image, only provide if constant
  * @img_height: Height of the image, only provide if constant
+ * @max_minutiae: Maximum number of minutiae stored in a print, the ones with
+ *   the highest quality are kept. Small sensors may want to reduce this to
+ *   speed up matching. Default: 0 (no limit besides the bozorth3 maximum)
  * @img_open: Open the device and do basic initialization
  *   (use this instead of the #FpDeviceClass open vfunc)
  * @img_close: Close the device
@@ -107,6 +110,7 @@ struct _FpImageDeviceClass
   gint          bz3_threshold;
   gint          img_width;
   gint          img_height;
+  gint          max_minutiae;
 
   void          (*img_open)     (FpImageDevice *dev);
   void          (*img_close)    (FpImageDevice *dev);
@@ -107,19 +107,39 @@ fpi_mean_sq_diff_norm (const guint8 *buf1,
   return res / size;
 }
 
+/**
+ * fpi_image_set_minutiae_features:
+ * @image: A #FpImage
+ * @features: The #FpiMinutiaeFeature results to compute
+ *
+ * Selects the optional results that fp_image_detect_minutiae() computes
+ * for @image. Prints only use the position and direction of minutiae, so
+ * callers that just create prints can skip the other stages to save time.
+ */
+void
+fpi_image_set_minutiae_features (FpImage           *image,
+                                 FpiMinutiaeFeature features)
+{
+  g_return_if_fail (FP_IS_IMAGE (image));
+
+  image->minutiae_features = features;
+}
+
 #if HAVE_PIXMAN
-FpImage *
-fpi_image_resize (FpImage *orig_img,
-                  guint    w_factor,
-                  guint    h_factor)
+guint8 *
+fpi_image_resize_data (const guint8 *data,
+                       guint         width,
+                       guint         height,
+                       guint         w_factor,
+                       guint         h_factor)
 {
-  int new_width = orig_img->width * w_factor;
-  int new_height = orig_img->height * h_factor;
+  int new_width = width * w_factor;
+  int new_height = height * h_factor;
   pixman_image_t *orig, *resized;
   pixman_transform_t transform;
-  FpImage *newimg;
+  guint8 *new_data;
 
-  orig = pixman_image_create_bits (PIXMAN_a8, orig_img->width, orig_img->height, (uint32_t *) orig_img->data, orig_img->width);
+  orig = pixman_image_create_bits (PIXMAN_a8, width, height, (uint32_t *) data, width);
   resized = pixman_image_create_bits (PIXMAN_a8, new_width, new_height, NULL, new_width);
 
   pixman_transform_init_identity (&transform);
@@ -136,14 +156,57 @@ fpi_image_resize (FpImage *orig_img,
                             new_width, new_height /* width height */
                            );
 
-  newimg = fp_image_new (new_width, new_height);
-  newimg->flags = orig_img->flags;
-
-  memcpy (newimg->data, pixman_image_get_data (resized), new_width * new_height);
+  new_data = g_memdup (pixman_image_get_data (resized), new_width * new_height);
 
   pixman_image_unref (orig);
   pixman_image_unref (resized);
 
+  return new_data;
+}
+
+FpImage *
+fpi_image_resize (FpImage *orig_img,
+                  guint    w_factor,
+                  guint    h_factor)
+{
+  FpImage *newimg;
+
+  newimg = fp_image_new (orig_img->width * w_factor, orig_img->height * h_factor);
+  newimg->flags = orig_img->flags;
+
+  g_free (newimg->data);
+  newimg->data = fpi_image_resize_data (orig_img->data,
+                                        orig_img->width, orig_img->height,
+                                        w_factor, h_factor);
+
   return newimg;
 }
+
+/**
+ * fpi_image_set_upscale:
+ * @image: A #FpImage
+ * @w_factor: horizontal enlargement factor
+ * @h_factor: vertical enlargement factor
+ *
+ * Requests the image to be enlarged in the same way as fpi_image_resize()
+ * does, but defers the work to the minutiae detection thread. Drivers can
+ * use this to hand over the image at the native sensor resolution, the
+ * width, height and data of @image are updated to the enlarged image once
+ * fp_image_detect_minutiae() has finished.
+ *
+ * Detection itself still runs on the enlarged image. The enlargement is
+ * cheap compared to detection, but the NBIS parameters assume about 500 ppi
+ * and minutiae found at the native resolution do not match prints that
+ * were enrolled from enlarged images.
+ */
+void
+fpi_image_set_upscale (FpImage *image,
+                       guint    w_factor,
+                       guint    h_factor)
+{
+  g_return_if_fail (w_factor > 0 && h_factor > 0);
+
+  image->w_upscale = w_factor;
+  image->h_upscale = h_factor;
+}
 #endif
@@ -40,6 +40,25 @@ typedef enum {
   FPI_IMAGE_PARTIAL         = 1 << 3,
 } FpiImageFlags;
 
+/**
+ * FpiMinutiaeFeature:
+ * @FPI_MINUTIAE_FEATURE_NONE: Only detect position and direction
+ * @FPI_MINUTIAE_FEATURE_RIDGE_COUNTS: Count the ridges to neighbouring minutiae
+ * @FPI_MINUTIAE_FEATURE_QUALITY: Derive the minutiae reliability from the
+ *   NBIS quality map
+ * @FPI_MINUTIAE_FEATURE_ALL: All of the above, the default
+ *
+ * Optional results of the minutiae detection, see
+ * fpi_image_set_minutiae_features().
+ */
+typedef enum {
+  FPI_MINUTIAE_FEATURE_NONE         = 0,
+  FPI_MINUTIAE_FEATURE_RIDGE_COUNTS = 1 << 0,
+  FPI_MINUTIAE_FEATURE_QUALITY      = 1 << 1,
+  FPI_MINUTIAE_FEATURE_ALL          = FPI_MINUTIAE_FEATURE_RIDGE_COUNTS |
+                                      FPI_MINUTIAE_FEATURE_QUALITY,
+} FpiMinutiaeFeature;
+
 /**
  * FpImage:
  * @width: Width of the image
@@ -66,6 +85,12 @@ struct _FpImage
   /*< private >*/
   guint8    *data;
   guint8    *binarized;
+  guint64   *binarized_packed;
+
+  guint      w_upscale;
+  guint      h_upscale;
+
+  FpiMinutiaeFeature minutiae_features;
 
   GPtrArray *minutiae;
   guint      ref_count;
@@ -77,8 +102,19 @@ gint fpi_mean_sq_diff_norm (const guint8 *buf1,
                             const guint8 *buf2,
                             gint          size);
 
+void fpi_image_set_minutiae_features (FpImage           *image,
+                                      FpiMinutiaeFeature features);
+
 #if HAVE_PIXMAN
+guint8 *fpi_image_resize_data (const guint8 *data,
+                               guint         width,
+                               guint         height,
+                               guint         w_factor,
+                               guint         h_factor);
 FpImage *fpi_image_resize (FpImage *orig,
                            guint    w_factor,
                            guint    h_factor);
+void fpi_image_set_upscale (FpImage *image,
+                            guint    w_factor,
+                            guint    h_factor);
 #endif
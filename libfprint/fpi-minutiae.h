@@ -36,10 +36,14 @@ struct fp_minutia
   int    num_nbrs;
 };
 
+struct fp_minutiae_grid;
+
 /* fp_minutiae structure definition */
 struct fp_minutiae
 {
-  int                 alloc;
-  int                 num;
-  struct fp_minutia **list;
+  int                      alloc;
+  int                      num;
+  struct fp_minutia      **list;
+  /* Optional spatial index, only attached during minutiae detection */
+  struct fp_minutiae_grid *grid;
 };
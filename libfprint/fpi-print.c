@@ -97,11 +97,27 @@ fpi_print_set_device_stored (FpPrint *print,
   g_object_notify (G_OBJECT (print), "device-stored");
 }
 
-/* XXX: This is the old version, but wouldn't it be smarter to instead
- * use the highest quality mintutiae? Possibly just using bz_prune from
- * upstream? */
+static int
+sort_quality_decreasing (gconstpointer a, gconstpointer b, gpointer user_data)
+{
+  struct fp_minutiae *minutiae = user_data;
+  int ia = *(const int *) a;
+  int ib = *(const int *) b;
+  double qa = minutiae->list[ia]->reliability;
+  double qb = minutiae->list[ib]->reliability;
+
+  if (qa != qb)
+    return qa < qb ? 1 : -1;
+
+  /* Keep detection order for minutiae of the same quality */
+  return ia - ib;
+}
+
+/* Like bz_prune from upstream, only the max_minutiae minutiae with the
+ * highest quality are kept if there are more and a limit is set. */
 static void
 minutiae_to_xyt (struct fp_minutiae *minutiae,
+                 int                 max_minutiae,
                  int                 bwidth,
                  int                 bheight,
                  struct xyt_struct  *xyt)
@@ -109,13 +125,27 @@ minutiae_to_xyt (struct fp_minutiae *minutiae,
   int i;
   struct fp_minutia *minutia;
   struct minutiae_struct c[MAX_FILE_MINUTIAE];
+  g_autofree int *order = NULL;
 
   /* struct xyt_struct uses arrays of MAX_BOZORTH_MINUTIAE (200) */
   int nmin = min (minutiae->num, MAX_BOZORTH_MINUTIAE);
 
+  order = g_new (int, minutiae->num);
+  for (i = 0; i < minutiae->num; i++)
+    order[i] = i;
+
+  /* Without a limit the first minutiae are kept in detection order, so
+   * that prints stay the same as with older versions. */
+  if (max_minutiae > 0 && minutiae->num > min (max_minutiae, MAX_BOZORTH_MINUTIAE))
+    {
+      g_qsort_with_data (order, minutiae->num, sizeof (int),
+                         sort_quality_decreasing, minutiae);
+      nmin = min (max_minutiae, MAX_BOZORTH_MINUTIAE);
+    }
+
   for (i = 0; i < nmin; i++)
     {
-      minutia = minutiae->list[i];
+      minutia = minutiae->list[order[i]];
 
       lfs2nist_minutia_XYT (&c[i].col[0], &c[i].col[1], &c[i].col[2],
                             minutia, bwidth, bheight);
@@ -141,11 +171,19 @@ minutiae_to_xyt (struct fp_minutiae *minutiae,
  * fpi_print_add_from_image:
  * @print: A #FpPrint
  * @image: A #FpImage
+ * @max_minutiae: Maximum number of minutiae to store, or 0 for the default
  * @error: Return location for error
  *
  * Extracts the minutiae from the given image and adds it to @print of
  * type #FPI_PRINT_NBIS.
  *
+ * If the image contains more than @max_minutiae minutiae, then only the
+ * ones with the highest reliability are stored. This requires the image to
+ * be scanned with %FPI_MINUTIAE_FEATURE_QUALITY to be effective. Storing
+ * fewer minutiae makes prints smaller and matching faster. The number is
+ * always limited to the 200 minutiae that bozorth3 can handle, by default
+ * the first 200 in detection order are stored.
+ *
  * The @image will be kept so that API users can get retrieve it e.g.
  * for debugging purposes.
  *
@@ -154,10 +192,11 @@ minutiae_to_xyt (struct fp_minutiae *minutiae,
 gboolean
 fpi_print_add_from_image (FpPrint *print,
                           FpImage *image,
+                          gint     max_minutiae,
                           GError **error)
 {
   GPtrArray *minutiae;
-  struct fp_minutiae _minutiae;
+  struct fp_minutiae _minutiae = { 0 };
   struct xyt_struct *xyt;
 
   if (print->type != FPI_PRINT_NBIS || !image)
@@ -184,7 +223,7 @@ fpi_print_add_from_image (FpPrint *print,
   _minutiae.alloc = minutiae->len;
 
   xyt = g_new0 (struct xyt_struct, 1);
-  minutiae_to_xyt (&_minutiae, image->width, image->height, xyt);
+  minutiae_to_xyt (&_minutiae, max_minutiae, image->width, image->height, xyt);
   g_ptr_array_add (print->prints, xyt);
 
   g_clear_object (&print->image);
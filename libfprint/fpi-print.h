@@ -40,6 +40,7 @@ void     fpi_print_set_device_stored (FpPrint *print,
 
 gboolean fpi_print_add_from_image (FpPrint *print,
                                    FpImage *image,
+                                   gint     max_minutiae,
                                    GError **error);
 
 FpiMatchResult fpi_print_bz3_match (FpPrint * template,
@@ -0,0 +1,358 @@
+/*
+ * Normalization of raw capacitive sensor frames
+ * Copyright (C) 2026 libfprint contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <string.h>
+
+#include "fpi-sensor-normalize.h"
+
+/**
+ * SECTION:fpi-sensor-normalize
+ * @title: Sensor frame normalization
+ * @short_description: Turning raw 16 bit sensor frames into 8 bit images
+ *
+ * Capacitive sensors report frames with a higher ADC resolution than the
+ * 8 bit images used by libfprint. Drivers subtract a background frame that
+ * was captured without a finger, optionally rotate the frame into the
+ * orientation of the device, and then map the remaining value range onto
+ * 8 bit using intensity levels taken from the frame itself (e.g. its
+ * minimum, maximum or percentiles).
+ *
+ * These routines are called for every polled frame and are therefore
+ * written to work in a small number of linear passes over the data.
+ */
+
+#define SENSOR_MAX_LEVELS 16
+
+/* Division by a segment width of less than 2^16 is replaced with a
+ * multiplication, see fpi_sensor_map_levels() */
+#define SENSOR_RECIPROCAL_SHIFT 40
+
+#if defined(__GNUC__) && (__GNUC__ >= 9 || defined(__clang__))
+#define SENSOR_LANES 8
+typedef guint16 sensor_v8hu __attribute__ ((vector_size (16)));
+#endif
+
+/**
+ * fpi_sensor_subtract_background:
+ * @out: (out): output frame, may be the same as @frame
+ * @frame: the raw frame
+ * @background: the background frame
+ * @len: number of pixels in each frame
+ * @max: (out) (optional): the highest pixel value after subtraction
+ *
+ * Subtracts @background from @frame. Pixels that are darker than the
+ * background are set to 0.
+ *
+ * Returns: The number of pixels that were darker than the background
+ */
+gsize
+fpi_sensor_subtract_background (guint16       *out,
+                                const guint16 *frame,
+                                const guint16 *background,
+                                gsize          len,
+                                guint16       *max)
+{
+  guint16 frame_max = 0;
+  gsize count = 0;
+  gsize i = 0;
+
+#ifdef SENSOR_LANES
+  while (len - i >= SENSOR_LANES)
+    {
+      sensor_v8hu vmax = { 0 };
+      sensor_v8hu vcount = { 0 };
+      gsize end;
+      guint j;
+
+      /* Flush the per lane counters before they can overflow */
+      end = i + MIN ((len - i) / SENSOR_LANES, G_MAXUINT16) * SENSOR_LANES;
+
+      for (; i < end; i += SENSOR_LANES)
+        {
+          sensor_v8hu v, bg, darker, larger;
+
+          memcpy (&v, frame + i, sizeof (v));
+          memcpy (&bg, background + i, sizeof (bg));
+
+          darker = (sensor_v8hu) (v < bg);
+          v = (v - bg) & ~darker;
+          larger = (sensor_v8hu) (v > vmax);
+          vmax = (v & larger) | (vmax & ~larger);
+          vcount -= darker;
+
+          memcpy (out + i, &v, sizeof (v));
+        }
+
+      for (j = 0; j < SENSOR_LANES; j++)
+        {
+          frame_max = MAX (frame_max, vmax[j]);
+          count += vcount[j];
+        }
+    }
+#endif
+
+  for (; i < len; i++)
+    {
+      if (frame[i] < background[i])
+        {
+          out[i] = 0;
+          count++;
+        }
+      else
+        {
+          out[i] = frame[i] - background[i];
+          frame_max = MAX (frame_max, out[i]);
+        }
+    }
+
+  if (max)
+    *max = frame_max;
+
+  return count;
+}
+
+/**
+ * fpi_sensor_select_ranks:
+ * @frame: the frame
+ * @len: number of pixels in @frame
+ * @ranks: (array length=n_ranks): zero based ranks, each smaller than @len
+ * @values: (out) (array length=n_ranks): the selected pixel values
+ * @n_ranks: number of ranks to select
+ *
+ * Stores the value that the pixel at each position in @ranks would have if
+ * @frame was sorted in ascending order, i.e. rank 0 selects the minimum
+ * and rank @len - 1 the maximum. This is used to find percentiles without
+ * sorting the frame.
+ */
+void
+fpi_sensor_select_ranks (const guint16 *frame,
+                         gsize          len,
+                         const gsize   *ranks,
+                         guint16       *values,
+                         guint          n_ranks)
+{
+  g_autofree gsize *low_hist = NULL;
+  gsize high_hist[256] = { 0 };
+  gint8 slot[256];
+  guint8 bucket[SENSOR_MAX_LEVELS];
+  gsize residual[SENSOR_MAX_LEVELS];
+  guint16 min = G_MAXUINT16, max = 0;
+  guint n_slots = 0;
+  gsize i;
+  guint j;
+
+  g_return_if_fail (len > 0);
+  g_return_if_fail (n_ranks <= SENSOR_MAX_LEVELS);
+
+  /* First pass, histogram of the high byte */
+  for (i = 0; i < len; i++)
+    {
+      high_hist[frame[i] >> 8]++;
+      min = MIN (min, frame[i]);
+      max = MAX (max, frame[i]);
+    }
+
+  memset (slot, -1, sizeof (slot));
+
+  for (j = 0; j < n_ranks; j++)
+    {
+      gsize below = 0;
+      guint b = 0;
+
+      g_return_if_fail (ranks[j] < len);
+
+      if (ranks[j] == 0)
+        {
+          values[j] = min;
+          continue;
+        }
+      if (ranks[j] == len - 1)
+        {
+          values[j] = max;
+          continue;
+        }
+
+      while (below + high_hist[b] <= ranks[j])
+        below += high_hist[b++];
+
+      bucket[j] = b;
+      residual[j] = ranks[j] - below;
+      if (slot[b] < 0)
+        slot[b] = n_slots++;
+    }
+
+  if (n_slots == 0)
+    return;
+
+  /* Second pass, histogram of the low byte within the selected buckets */
+  low_hist = g_new0 (gsize, n_slots * 256);
+  for (i = 0; i < len; i++)
+    {
+      gint s = slot[frame[i] >> 8];
+
+      if (s >= 0)
+        low_hist[s * 256 + (frame[i] & 0xff)]++;
+    }
+
+  for (j = 0; j < n_ranks; j++)
+    {
+      const gsize *hist;
+      gsize below = 0;
+      guint l = 0;
+
+      if (ranks[j] == 0 || ranks[j] == len - 1)
+        continue;
+
+      hist = low_hist + slot[bucket[j]] * 256;
+      while (below + hist[l] <= residual[j])
+        below += hist[l++];
+
+      values[j] = (bucket[j] << 8) | l;
+    }
+}
+
+/**
+ * fpi_sensor_rotate:
+ * @out: (out): the rotated frame of @out_width by @out_height pixels
+ * @out_width: width of @out
+ * @out_height: height of @out
+ * @in: the frame as read from the sensor
+ * @in_width: width of @in
+ * @in_height: height of @in
+ * @rotation: the #FpiSensorRotation of the sensor
+ *
+ * Copies the area of @in that is visible in the orientation of the device
+ * into @out. The output may be smaller than the sensor, in which case
+ * pixels are taken starting from the corner that becomes the top left
+ * one after rotation.
+ */
+void
+fpi_sensor_rotate (guint16          *out,
+                   guint             out_width,
+                   guint             out_height,
+                   const guint16    *in,
+                   guint             in_width,
+                   guint             in_height,
+                   FpiSensorRotation rotation)
+{
+  const guint16 *row;
+  gssize dx, dy;
+  guint x, y;
+
+  switch (rotation)
+    {
+    case FPI_SENSOR_ROTATE_NONE:
+      for (y = 0; y < out_height; y++)
+        memcpy (out + y * out_width, in + y * in_width, out_width * sizeof (guint16));
+      return;
+
+    case FPI_SENSOR_ROTATE_90_LEFT:
+      row = in + (gsize) (in_width - 1) * in_width;
+      dx = -(gssize) in_width;
+      dy = 1;
+      break;
+
+    case FPI_SENSOR_ROTATE_180:
+      row = in + (gsize) (in_height - 1) * in_width + in_width - 1;
+      dx = -1;
+      dy = -(gssize) in_width;
+      break;
+
+    case FPI_SENSOR_ROTATE_90_RIGHT:
+      row = in + in_height - 1;
+      dx = in_width;
+      dy = -1;
+      break;
+
+    default:
+      g_return_if_reached ();
+    }
+
+  for (y = 0; y < out_height; y++, row += dy)
+    {
+      const guint16 *px = row;
+
+      for (x = 0; x < out_width; x++, px += dx)
+        *out++ = *px;
+    }
+}
+
+/**
+ * fpi_sensor_map_levels:
+ * @out: (out): the 8 bit output frame
+ * @in: the input frame
+ * @len: number of pixels in each frame
+ * @levels: (array length=n_levels): ascending input levels
+ * @values: (array length=n_levels): ascending output values for each level
+ * @n_levels: number of levels, at least 2
+ *
+ * Maps each pixel piecewise linearly, a pixel between levels[i] and
+ * levels[i + 1] is mapped to values[i] plus its relative position in that
+ * segment times the difference between values[i + 1] and values[i],
+ * rounded down. Pixels outside of the levels are clamped to the first or
+ * last value.
+ */
+void
+fpi_sensor_map_levels (guint8        *out,
+                       const guint16 *in,
+                       gsize          len,
+                       const guint16 *levels,
+                       const guint8  *values,
+                       guint          n_levels)
+{
+  guint64 reciprocal[SENSOR_MAX_LEVELS];
+  guint last = n_levels - 1;
+  gsize i;
+  guint s;
+
+  g_return_if_fail (n_levels >= 2 && n_levels <= SENSOR_MAX_LEVELS);
+
+  /* With (px - levels[s]) * (values[s + 1] - values[s]) < width * 2^8 and
+   * width < 2^16, the rounding error of this reciprocal is too small to
+   * change the quotient, so the result is the same as with a division. */
+  for (s = 0; s < last; s++)
+    {
+      guint width = levels[s + 1] - levels[s];
+
+      reciprocal[s] = width ? (G_GUINT64_CONSTANT (1) << SENSOR_RECIPROCAL_SHIFT) / width + 1 : 0;
+    }
+
+  for (i = 0; i < len; i++)
+    {
+      guint16 px = in[i];
+
+      if (px < levels[0])
+        {
+          out[i] = values[0];
+          continue;
+        }
+      if (px >= levels[last])
+        {
+          out[i] = values[last];
+          continue;
+        }
+
+      for (s = last - 1; s > 0 && px < levels[s]; s--)
+        ;
+
+      out[i] = values[s] +
+               (((guint64) (px - levels[s]) * (values[s + 1] - values[s]) *
+                 reciprocal[s]) >> SENSOR_RECIPROCAL_SHIFT);
+    }
+}
@@ -0,0 +1,71 @@
+/*
+ * Normalization of raw capacitive sensor frames
+ * Copyright (C) 2026 libfprint contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/**
+ * FpiSensorRotation:
+ * @FPI_SENSOR_ROTATE_NONE: The sensor is mounted upright
+ * @FPI_SENSOR_ROTATE_90_LEFT: The sensor is mounted rotated by 90 degrees
+ *   to the left, frames are rotated clockwise to compensate
+ * @FPI_SENSOR_ROTATE_180: The sensor is mounted upside down
+ * @FPI_SENSOR_ROTATE_90_RIGHT: The sensor is mounted rotated by 90 degrees
+ *   to the right, frames are rotated counterclockwise to compensate
+ *
+ * The orientation of a sensor, see fpi_sensor_rotate().
+ */
+typedef enum {
+  FPI_SENSOR_ROTATE_NONE,
+  FPI_SENSOR_ROTATE_90_LEFT,
+  FPI_SENSOR_ROTATE_180,
+  FPI_SENSOR_ROTATE_90_RIGHT,
+} FpiSensorRotation;
+
+gsize fpi_sensor_subtract_background (guint16       *out,
+                                      const guint16 *frame,
+                                      const guint16 *background,
+                                      gsize          len,
+                                      guint16       *max);
+
+void  fpi_sensor_select_ranks (const guint16 *frame,
+                               gsize          len,
+                               const gsize   *ranks,
+                               guint16       *values,
+                               guint          n_ranks);
+
+void  fpi_sensor_rotate (guint16           *out,
+                         guint              out_width,
+                         guint              out_height,
+                         const guint16     *in,
+                         guint              in_width,
+                         guint              in_height,
+                         FpiSensorRotation  rotation);
+
+void  fpi_sensor_map_levels (guint8        *out,
+                             const guint16 *in,
+                             gsize          len,
+                             const guint16 *levels,
+                             const guint8  *values,
+                             guint          n_levels);
+
+G_END_DECLS
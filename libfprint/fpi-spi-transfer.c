@@ -18,6 +18,8 @@
  */
 
 #include "fpi-spi-transfer.h"
+#include "fpi-transfer-trace.h"
+#include "fp-device-private.h"
 #include <sys/ioctl.h>
 #include <linux/spi/spidev.h>
 #include <errno.h>
@@ -27,6 +29,19 @@
 #define SPIDEV_BLOCK_SIZE_FALLBACK 4096
 static gsize block_size = 0;
 
+/* Maximum number of queued transfers that are sent in one ioctl */
+#define SPI_BATCH_MAX_TRANSFERS 16
+
+struct _FpiSpiWorker
+{
+  GThread     *thread;
+  /* Submitted GTasks, the worker itself is queued to stop the thread */
+  GAsyncQueue *queue;
+  /* Serializes access to the bus with synchronous transfers */
+  GMutex       io_mutex;
+  gboolean     free_on_exit;
+};
+
 /**
  * SECTION:fpi-spi-transfer
  * @title: SPI transfer helpers
@@ -38,41 +53,55 @@ static gsize block_size = 0;
  *
  * Currently only transfers with a write and subsequent read are supported.
  *
+ * Asynchronous transfers are executed in submission order by a worker
+ * thread of the device. Consecutive small transfers that are queued at the
+ * same time are sent using a single ioctl, with the chip select being
+ * toggled between them.
+ *
  * Drivers should always use this API rather than calling read/write/ioctl on
  * the spidev device.
  *
  * Setting G_MESSAGES_DEBUG and FP_DEBUG_TRANSFER will result in the message
- * content to be dumped.
+ * content to be dumped. See fpi_transfer_trace_get_flags() for recording
+ * the transfers instead.
  */
 
 
 G_DEFINE_BOXED_TYPE (FpiSpiTransfer, fpi_spi_transfer, fpi_spi_transfer_ref, fpi_spi_transfer_unref)
 
 static void
-dump_buffer (guchar *buf, gssize dump_len)
+log_transfer (FpiSpiTransfer *transfer, gboolean submit, GError *error)
 {
-  g_autoptr(GString) line = NULL;
+  FpiTransferTraceFlags flags = fpi_transfer_trace_get_flags ();
+
+  if (submit)
+    transfer->submit_time = g_get_monotonic_time ();
+  else
+    fpi_device_update_transfer_stats (transfer->device,
+                                      FPI_TRANSFER_TRACE_BUS_SPI,
+                                      0,
+                                      error ? 0 : transfer->length_wr + transfer->length_rd,
+                                      g_get_monotonic_time () - transfer->submit_time,
+                                      error);
 
-  line = g_string_new ("");
-  /* Dump the buffer. */
-  for (gssize i = 0; i < dump_len; i++)
+  if (G_LIKELY (flags == FPI_TRANSFER_TRACE_NONE))
+    return;
+
+  if (flags & FPI_TRANSFER_TRACE_RECORD)
     {
-      g_string_append_printf (line, "%02x ", buf[i]);
-      if ((i + 1) % 16 == 0)
-        {
-          g_debug ("%s", line->str);
-          g_string_set_size (line, 0);
-        }
-    }
+      FpiTransferTraceRecord record = { 0 };
 
-  if (line->len)
-    g_debug ("%s", line->str);
-}
+      record.id = GPOINTER_TO_SIZE (transfer);
+      record.bus = FPI_TRANSFER_TRACE_BUS_SPI;
+      record.submit = submit;
+      record.status = fpi_transfer_trace_status_from_error (error);
+      record.length = submit ? transfer->length_wr : transfer->length_rd;
 
-static void
-log_transfer (FpiSpiTransfer *transfer, gboolean submit, GError *error)
-{
-  if (g_getenv ("FP_DEBUG_TRANSFER"))
+      fpi_transfer_trace_record (transfer->device, &record,
+                                 submit ? transfer->buffer_wr : transfer->buffer_rd);
+    }
+
+  if (flags & FPI_TRANSFER_TRACE_LOG)
     {
       if (submit)
         {
@@ -82,7 +111,7 @@ log_transfer (FpiSpiTransfer *transfer, gboolean submit, GError *error)
                    transfer->length_rd);
 
           if (transfer->buffer_wr)
-            dump_buffer (transfer->buffer_wr, transfer->length_wr);
+            fpi_transfer_trace_log_buffer (transfer->buffer_wr, transfer->length_wr);
         }
       else
         {
@@ -98,7 +127,7 @@ log_transfer (FpiSpiTransfer *transfer, gboolean submit, GError *error)
                    transfer->length_wr,
                    transfer->length_rd);
           if (transfer->buffer_rd)
-            dump_buffer (transfer->buffer_rd, transfer->length_rd);
+            fpi_transfer_trace_log_buffer (transfer->buffer_rd, transfer->length_rd);
         }
     }
 }
@@ -382,24 +411,20 @@ transfer_chunk (FpiSpiTransfer *transfer, gsize full_length, gsize *transferred)
   return status;
 }
 
-static void
-transfer_thread_func (GTask        *task,
-                      gpointer      source_object,
-                      gpointer      task_data,
-                      GCancellable *cancellable)
+static gboolean
+transfer_run (FpiSpiTransfer *transfer, GError **error)
 {
-  FpiSpiTransfer *transfer = (FpiSpiTransfer *) task_data;
   gsize full_length;
   gsize transferred = 0;
   int status = 0;
 
   if (transfer->buffer_wr == NULL && transfer->buffer_rd == NULL)
     {
-      g_task_return_new_error (task,
-                               G_IO_ERROR,
-                               G_IO_ERROR_INVALID_ARGUMENT,
-                               "Transfer with neither write or read!");
-      return;
+      g_set_error_literal (error,
+                           G_IO_ERROR,
+                           G_IO_ERROR_INVALID_ARGUMENT,
+                           "Transfer with neither write or read!");
+      return FALSE;
     }
 
   full_length = 0;
@@ -413,16 +438,205 @@ transfer_thread_func (GTask        *task,
 
   if (status < 0)
     {
-      g_task_return_new_error (task,
-                               G_IO_ERROR,
-                               g_io_error_from_errno (errno),
-                               "Error invoking ioctl for SPI transfer (%d)",
-                               errno);
+      g_set_error (error,
+                   G_IO_ERROR,
+                   g_io_error_from_errno (errno),
+                   "Error invoking ioctl for SPI transfer (%d)",
+                   errno);
+      return FALSE;
     }
-  else
+
+  return TRUE;
+}
+
+/* Whether the transfer fits into a single block and can be combined with
+ * others, returns its full length.
+ */
+static gsize
+transfer_batch_length (FpiSpiTransfer *transfer)
+{
+  gsize length = 0;
+
+  if (transfer->buffer_wr)
+    length += transfer->length_wr;
+  if (transfer->buffer_rd)
+    length += transfer->length_rd;
+
+  if (length == 0 || length > block_size)
+    return 0;
+
+  return length;
+}
+
+static void
+transfer_run_batch (GTask **tasks, guint n_tasks)
+{
+  struct spi_ioc_transfer xfer[SPI_BATCH_MAX_TRANSFERS * 2] = { 0 };
+  g_autoptr(GError) error = NULL;
+  int n_xfer = 0;
+  int spidev_fd = -1;
+  guint i;
+
+  for (i = 0; i < n_tasks; i++)
+    {
+      FpiSpiTransfer *transfer = g_task_get_task_data (tasks[i]);
+
+      spidev_fd = transfer->spidev_fd;
+
+      if (transfer->buffer_wr)
+        {
+          xfer[n_xfer].tx_buf = (gsize) transfer->buffer_wr;
+          xfer[n_xfer].len = transfer->length_wr;
+          n_xfer += 1;
+        }
+
+      if (transfer->buffer_rd)
+        {
+          xfer[n_xfer].rx_buf = (gsize) transfer->buffer_rd;
+          xfer[n_xfer].len = transfer->length_rd;
+          n_xfer += 1;
+        }
+
+      /* Deselect the chip between the transfers, like separate ioctls do */
+      if (i + 1 < n_tasks)
+        xfer[n_xfer - 1].cs_change = TRUE;
+    }
+
+  if (ioctl (spidev_fd, SPI_IOC_MESSAGE (n_xfer), xfer) < 0)
+    error = g_error_new (G_IO_ERROR,
+                         g_io_error_from_errno (errno),
+                         "Error invoking ioctl for SPI transfer (%d)",
+                         errno);
+
+  for (i = 0; i < n_tasks; i++)
+    {
+      if (error)
+        g_task_return_error (tasks[i], g_error_copy (error));
+      else
+        g_task_return_boolean (tasks[i], TRUE);
+    }
+}
+
+static gpointer
+spi_worker_thread (gpointer user_data)
+{
+  FpiSpiWorker *worker = user_data;
+  GTask *tasks[SPI_BATCH_MAX_TRANSFERS];
+  gpointer next = NULL;
+
+  while (TRUE)
     {
-      g_task_return_boolean (task, TRUE);
+      FpiSpiTransfer *transfer;
+      guint n_tasks = 0;
+      gsize batch_length;
+      guint i;
+
+      if (!next)
+        next = g_async_queue_pop (worker->queue);
+      if (next == worker)
+        break;
+
+      tasks[n_tasks++] = g_steal_pointer (&next);
+      transfer = g_task_get_task_data (tasks[0]);
+      batch_length = transfer_batch_length (transfer);
+
+      /* Collect further transfers that are already waiting */
+      while (batch_length > 0 &&
+             n_tasks < SPI_BATCH_MAX_TRANSFERS &&
+             (next = g_async_queue_try_pop (worker->queue)))
+        {
+          FpiSpiTransfer *other;
+          gsize length;
+
+          if (next == worker)
+            break;
+
+          other = g_task_get_task_data (next);
+          length = transfer_batch_length (other);
+          if (length == 0 ||
+              other->spidev_fd != transfer->spidev_fd ||
+              batch_length + length > block_size)
+            break;
+
+          tasks[n_tasks++] = g_steal_pointer (&next);
+          batch_length += length;
+        }
+
+      g_mutex_lock (&worker->io_mutex);
+
+      if (n_tasks > 1)
+        {
+          transfer_run_batch (tasks, n_tasks);
+        }
+      else
+        {
+          GError *error = NULL;
+
+          if (transfer_run (transfer, &error))
+            g_task_return_boolean (tasks[0], TRUE);
+          else
+            g_task_return_error (tasks[0], error);
+        }
+
+      g_mutex_unlock (&worker->io_mutex);
+
+      /* May drop the last device reference, see fpi_spi_worker_free() */
+      for (i = 0; i < n_tasks; i++)
+        g_object_unref (tasks[i]);
+    }
+
+  if (worker->free_on_exit)
+    {
+      g_async_queue_unref (worker->queue);
+      g_mutex_clear (&worker->io_mutex);
+      g_free (worker);
     }
+
+  return NULL;
+}
+
+static FpiSpiWorker *
+spi_worker_get (FpDevice *device)
+{
+  FpDevicePrivate *priv = fpi_device_get_private (device);
+  FpiSpiWorker *worker;
+
+  worker = g_atomic_pointer_get (&priv->spi_worker);
+  if (G_LIKELY (worker))
+    return worker;
+
+  worker = g_new0 (FpiSpiWorker, 1);
+  worker->queue = g_async_queue_new ();
+  g_mutex_init (&worker->io_mutex);
+  worker->thread = g_thread_new ("fpi-spi-worker", spi_worker_thread, worker);
+
+  /* Synchronous transfers may be submitted from a thread */
+  if (!g_atomic_pointer_compare_and_exchange (&priv->spi_worker, NULL, worker))
+    fpi_spi_worker_free (worker);
+
+  return g_atomic_pointer_get (&priv->spi_worker);
+}
+
+/* Called when the device is finalized, at which point no transfer can be
+ * queued anymore as each holds a reference to the device.
+ */
+void
+fpi_spi_worker_free (FpiSpiWorker *worker)
+{
+  g_async_queue_push (worker->queue, worker);
+
+  /* The worker dropped the last reference, it cleans up when returning */
+  if (g_thread_self () == worker->thread)
+    {
+      worker->free_on_exit = TRUE;
+      g_thread_unref (worker->thread);
+      return;
+    }
+
+  g_thread_join (worker->thread);
+  g_async_queue_unref (worker->queue);
+  g_mutex_clear (&worker->io_mutex);
+  g_free (worker);
 }
 
 /**
@@ -437,6 +651,10 @@ transfer_thread_func (GTask        *task,
  * The underlying transfer cannot be cancelled. The current implementation
  * will only call @callback after the transfer has been completed.
  *
+ * Transfers are executed in the order in which they were submitted, so a
+ * driver may queue up several transfers (e.g. a register table) at once
+ * and only wait for the last callback.
+ *
  * Note that #FpiSpiTransfer will be stolen when this function is called.
  * So that all associated data will be free'ed automatically, after the
  * callback ran unless fpi_usb_transfer_ref() is explicitly called.
@@ -448,6 +666,7 @@ fpi_spi_transfer_submit (FpiSpiTransfer        *transfer,
                          gpointer               user_data)
 {
   g_autoptr(GTask) task = NULL;
+  FpiSpiWorker *worker;
 
   g_return_if_fail (transfer);
   g_return_if_fail (callback);
@@ -460,6 +679,7 @@ fpi_spi_transfer_submit (FpiSpiTransfer        *transfer,
 
   log_transfer (transfer, TRUE, NULL);
 
+  worker = spi_worker_get (transfer->device);
   task = g_task_new (transfer->device,
                      cancellable,
                      transfer_finish_cb,
@@ -468,7 +688,7 @@ fpi_spi_transfer_submit (FpiSpiTransfer        *transfer,
                         g_steal_pointer (&transfer),
                         (GDestroyNotify) fpi_spi_transfer_unref);
 
-  g_task_run_in_thread (task, transfer_thread_func);
+  g_async_queue_push (worker->queue, g_steal_pointer (&task));
 }
 
 /**
@@ -488,7 +708,7 @@ gboolean
 fpi_spi_transfer_submit_sync (FpiSpiTransfer *transfer,
                               GError        **error)
 {
-  g_autoptr(GTask) task = NULL;
+  FpiSpiWorker *worker;
   GError *err = NULL;
   gboolean res;
 
@@ -499,17 +719,11 @@ fpi_spi_transfer_submit_sync (FpiSpiTransfer *transfer,
 
   log_transfer (transfer, TRUE, NULL);
 
-  task = g_task_new (transfer->device,
-                     NULL,
-                     NULL,
-                     NULL);
-  g_task_set_task_data (task,
-                        fpi_spi_transfer_ref (transfer),
-                        (GDestroyNotify) fpi_spi_transfer_unref);
-
-  g_task_run_in_thread_sync (task, transfer_thread_func);
+  worker = spi_worker_get (transfer->device);
 
-  res = g_task_propagate_boolean (task, &err);
+  g_mutex_lock (&worker->io_mutex);
+  res = transfer_run (transfer, &err);
+  g_mutex_unlock (&worker->io_mutex);
 
   log_transfer (transfer, FALSE, err);
 
@@ -66,6 +66,9 @@ struct _FpiSpiTransfer
 
   int   spidev_fd;
 
+  /* Monotonic time of the submission, for the transfer statistics */
+  gint64 submit_time;
+
   /* Callbacks */
   gpointer               user_data;
   FpiSpiTransferCallback callback;
@@ -68,6 +68,12 @@
  * communication with the device (such as a USB transfer), and the
  * callback function iterates the machine to the next state
  * upon success (or fails).
+ *
+ * Drivers that need to poll the sensor while waiting for a finger can use
+ * an #FpiSsmPoller together with fpi_ssm_jump_to_state_polled(). The delay
+ * between polls backs off while nothing happens, and is reset to the
+ * shortest delay by fpi_ssm_poller_activity() whenever the driver sees
+ * a hint that a finger is about to be placed.
  */
 
 struct _FpiSsm
@@ -590,6 +596,115 @@ fpi_ssm_jump_to_state_delayed (FpiSsm *machine,
   g_source_set_name (machine->timeout, source_name);
 }
 
+/**
+ * fpi_ssm_poller_init:
+ * @poller: an #FpiSsmPoller
+ * @min_delay: delay between polls in milliseconds while a finger is likely
+ * @max_delay: delay between polls in milliseconds after backing off
+ * @backoff_after: time in milliseconds without activity before backing off
+ *
+ * Sets up @poller, it starts out polling with @min_delay.
+ */
+void
+fpi_ssm_poller_init (FpiSsmPoller *poller,
+                     guint         min_delay,
+                     guint         max_delay,
+                     guint         backoff_after)
+{
+  g_return_if_fail (poller != NULL);
+  g_return_if_fail (min_delay <= max_delay && max_delay > 0);
+
+  *poller = (FpiSsmPoller) {
+    .min_delay = min_delay,
+    .max_delay = max_delay,
+    .backoff_after = backoff_after,
+  };
+  fpi_ssm_poller_activity (poller);
+}
+
+/**
+ * fpi_ssm_poller_activity:
+ * @poller: an #FpiSsmPoller
+ *
+ * Reports that a finger is likely to be placed soon, e.g. because the
+ * sensor reading changed or the user was just asked for a finger. Polling
+ * continues with the shortest delay, and the polling rate is measured anew
+ * so that it does not include the time since an earlier wait.
+ */
+void
+fpi_ssm_poller_activity (FpiSsmPoller *poller)
+{
+  g_return_if_fail (poller != NULL);
+
+  poller->delay = poller->min_delay;
+  poller->last_activity = g_get_monotonic_time ();
+  poller->window_start = poller->last_activity;
+  poller->window_polls = 0;
+}
+
+/**
+ * fpi_ssm_poller_get_wakeups_per_second:
+ * @poller: an #FpiSsmPoller
+ *
+ * Returns: the polling rate measured over the last full second of polling,
+ *   or 0 if polling did not run for a second yet
+ */
+gdouble
+fpi_ssm_poller_get_wakeups_per_second (FpiSsmPoller *poller)
+{
+  g_return_val_if_fail (poller != NULL, 0);
+
+  return poller->wakeups_per_second;
+}
+
+/**
+ * fpi_ssm_jump_to_state_polled:
+ * @machine: an #FpiSsm state machine
+ * @state: the state to jump to
+ * @poller: the #FpiSsmPoller of the polling loop
+ *
+ * Jump to the @state state after the current delay of @poller, or right
+ * away while it is zero. Once there was no activity for
+ * #FpiSsmPoller.backoff_after milliseconds, the delay is doubled on every
+ * poll until it reaches #FpiSsmPoller.max_delay.
+ */
+void
+fpi_ssm_jump_to_state_polled (FpiSsm       *machine,
+                              int           state,
+                              FpiSsmPoller *poller)
+{
+  gint64 now = g_get_monotonic_time ();
+  guint delay;
+
+  g_return_if_fail (machine != NULL);
+  g_return_if_fail (poller != NULL);
+
+  if (now - poller->window_start >= G_USEC_PER_SEC)
+    {
+      if (poller->window_polls > 0)
+        poller->wakeups_per_second = poller->window_polls * (gdouble) G_USEC_PER_SEC /
+                                     (now - poller->window_start);
+      poller->window_start = now;
+      poller->window_polls = 0;
+    }
+  poller->window_polls++;
+
+  delay = poller->delay;
+  if (now - poller->last_activity >= (gint64) poller->backoff_after * 1000 &&
+      poller->delay < poller->max_delay)
+    {
+      poller->delay = CLAMP (poller->delay * 2, 1, poller->max_delay);
+      fp_dbg ("[%s] %s backing off polling to %u ms, was %.1f wakeups per second",
+              fp_device_get_driver (machine->dev), machine->name,
+              poller->delay, fpi_ssm_poller_get_wakeups_per_second (poller));
+    }
+
+  if (delay == 0)
+    fpi_ssm_jump_to_state (machine, state);
+  else
+    fpi_ssm_jump_to_state_delayed (machine, state, delay);
+}
+
 /**
  * fpi_ssm_get_cur_state:
  * @machine: an #FpiSsm state machine
@@ -58,6 +58,30 @@ typedef void (*FpiSsmCompletedCallback)(FpiSsm   *ssm,
 typedef void (*FpiSsmHandlerCallback)(FpiSsm   *ssm,
                                       FpDevice *dev);
 
+/**
+ * FpiSsmPoller:
+ * @min_delay: Delay between polls in milliseconds while a finger is likely
+ * @max_delay: Delay between polls in milliseconds after backing off
+ * @backoff_after: Time in milliseconds without activity before backing off
+ *
+ * Adaptive delay for drivers that poll the sensor while waiting for a
+ * finger, see fpi_ssm_jump_to_state_polled(). Drivers embed it in their
+ * device structure and set it up using fpi_ssm_poller_init().
+ */
+typedef struct
+{
+  guint min_delay;
+  guint max_delay;
+  guint backoff_after;
+
+  /*< private >*/
+  guint   delay;
+  gint64  last_activity;
+  gint64  window_start;
+  guint   window_polls;
+  gdouble wakeups_per_second;
+} FpiSsmPoller;
+
 /* for library and drivers */
 #define fpi_ssm_new(dev, handler, nr_states) \
   fpi_ssm_new_full (dev, handler, nr_states, nr_states, #nr_states)
@@ -81,6 +105,9 @@ void fpi_ssm_next_state_delayed (FpiSsm *machine,
 void fpi_ssm_jump_to_state_delayed (FpiSsm *machine,
                                     int     state,
                                     int     delay);
+void fpi_ssm_jump_to_state_polled (FpiSsm       *machine,
+                                   int           state,
+                                   FpiSsmPoller *poller);
 void fpi_ssm_cancel_delayed_state_change (FpiSsm *machine);
 void fpi_ssm_mark_completed (FpiSsm *machine);
 void fpi_ssm_mark_completed_delayed (FpiSsm *machine,
@@ -96,6 +123,13 @@ GError * fpi_ssm_get_error (FpiSsm *machine);
 GError * fpi_ssm_dup_error (FpiSsm *machine);
 int fpi_ssm_get_cur_state (FpiSsm *machine);
 
+void fpi_ssm_poller_init (FpiSsmPoller *poller,
+                          guint         min_delay,
+                          guint         max_delay,
+                          guint         backoff_after);
+void fpi_ssm_poller_activity (FpiSsmPoller *poller);
+gdouble fpi_ssm_poller_get_wakeups_per_second (FpiSsmPoller *poller);
+
 /* Callbacks to be used by the driver instead of implementing their own
  * logic.
  */
@@ -0,0 +1,660 @@
+/*
+ * Recording of USB and SPI transfers
+ * Copyright (C) 2026 libfprint contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include "fpi-transfer-trace.h"
+#include "fpi-byte-writer.h"
+#include "fpi-usb-transfer.h"
+#include "fp-device-private.h"
+
+/**
+ * SECTION:fpi-transfer-trace
+ * @title: Transfer tracing
+ * @short_description: Recording of USB and SPI transfers
+ *
+ * The USB and SPI transfer helpers report every submission and completion
+ * to this module. The environment is only inspected once:
+ *
+ * - FP_DEBUG_TRANSFER: Log all transfers and their content as debug
+ *   messages (requires G_MESSAGES_DEBUG to be set).
+ * - FP_TRACE_TRANSFER: Record the transfers of each device into a ring
+ *   buffer that holds the last 1024 events. The recording is written to the
+ *   given directory when the device is closed.
+ * - FP_TRACE_TRANSFER_FORMAT: Either "pcapng" (the default) or "json".
+ * - FP_TRACE_TRANSFER_SNAPLEN: Number of data bytes stored for each event,
+ *   defaults to 4096. It needs to be large enough for the longest transfer
+ *   if the recording is used to replay a device with umockdev.
+ *
+ * Recording does not take any locks, the ring buffer slots are guarded
+ * by a sequence number instead, so that a dump can be taken while the
+ * device is in use.
+ *
+ * USB transfers are stored in the pcapng file using the usbmon format
+ * (LINKTYPE_USB_LINUX_MMAPPED) as recorded by the kernel. SPI transfers
+ * use LINKTYPE_USER0 with a 20 byte little endian header consisting of
+ * the 64 bit ID, the event ('S' or 'C') followed by three padding bytes,
+ * the 32 bit status and the 32 bit length.
+ */
+
+#define TRACE_RECORDS 1024 /* must be a power of two */
+#define TRACE_DEFAULT_SNAPLEN 4096
+
+#define PCAPNG_SECTION_HEADER_BLOCK 0x0a0d0d0a
+#define PCAPNG_INTERFACE_DESCRIPTION_BLOCK 0x00000001
+#define PCAPNG_ENHANCED_PACKET_BLOCK 0x00000006
+#define PCAPNG_BYTE_ORDER_MAGIC 0x1a2b3c4d
+#define LINKTYPE_USER0 147
+#define LINKTYPE_USB_LINUX_MMAPPED 220
+#define USBMON_HEADER_SIZE 64
+#define USBMON_TYPE_INTERRUPT 1
+#define USBMON_TYPE_CONTROL 2
+#define USBMON_TYPE_BULK 3
+#define SPI_HEADER_SIZE 20
+
+typedef struct
+{
+  FpiTransferTraceFlags flags;
+  gchar                *directory;
+  gboolean              json;
+  gsize                 snaplen;
+} TraceConfig;
+
+typedef struct
+{
+  /* Index of the stored event plus one, zero while it is being written */
+  gint                   seq;
+  FpiTransferTraceRecord record;
+  guint8                 data[];
+} TraceSlot;
+
+struct _FpiTransferTrace
+{
+  gint   head;
+  gsize  slot_size;
+  guint8 slots[];
+};
+
+typedef void (*TraceForeachFunc) (const FpiTransferTraceRecord *record,
+                                  const guint8                 *data,
+                                  gpointer                      user_data);
+
+static const TraceConfig *
+get_config (void)
+{
+  static TraceConfig *config = NULL;
+
+  if (g_once_init_enter (&config))
+    {
+      TraceConfig *new_config = g_new0 (TraceConfig, 1);
+      const gchar *value;
+
+      if (g_getenv ("FP_DEBUG_TRANSFER"))
+        new_config->flags |= FPI_TRANSFER_TRACE_LOG;
+
+      value = g_getenv ("FP_TRACE_TRANSFER");
+      if (value && *value)
+        {
+          new_config->flags |= FPI_TRANSFER_TRACE_RECORD;
+          new_config->directory = g_strdup (value);
+        }
+
+      value = g_getenv ("FP_TRACE_TRANSFER_FORMAT");
+      new_config->json = g_strcmp0 (value, "json") == 0;
+
+      value = g_getenv ("FP_TRACE_TRANSFER_SNAPLEN");
+      new_config->snaplen = TRACE_DEFAULT_SNAPLEN;
+      if (value)
+        {
+          guint64 snaplen;
+
+          if (g_ascii_string_to_unsigned (value, 10, 0, G_MAXINT32, &snaplen, NULL))
+            new_config->snaplen = snaplen;
+          else
+            g_warning ("Ignoring invalid FP_TRACE_TRANSFER_SNAPLEN value \"%s\"", value);
+        }
+
+      g_once_init_leave (&config, new_config);
+    }
+
+  return config;
+}
+
+/**
+ * fpi_transfer_trace_get_flags:
+ *
+ * Get the enabled transfer tracing facilities. The environment is only
+ * read on the first call, so this is cheap enough to be called for every
+ * transfer.
+ *
+ * Returns: The #FpiTransferTraceFlags
+ */
+FpiTransferTraceFlags
+fpi_transfer_trace_get_flags (void)
+{
+  return get_config ()->flags;
+}
+
+/**
+ * fpi_transfer_trace_log_buffer:
+ * @buffer: The data to log
+ * @length: The length of @buffer
+ *
+ * Log @buffer as hex dump with 16 bytes per debug message.
+ */
+void
+fpi_transfer_trace_log_buffer (const guint8 *buffer, gsize length)
+{
+  static const gchar hex[] = "0123456789abcdef";
+  gchar line[16 * 3 + 1];
+  gsize i, j;
+
+  for (i = 0; i < length; i += 16)
+    {
+      gsize n = MIN (length - i, 16);
+
+      for (j = 0; j < n; j++)
+        {
+          line[j * 3] = hex[buffer[i + j] >> 4];
+          line[j * 3 + 1] = hex[buffer[i + j] & 0xf];
+          line[j * 3 + 2] = ' ';
+        }
+      line[n * 3] = '\0';
+
+      g_debug ("%s", line);
+    }
+}
+
+/**
+ * fpi_transfer_trace_status_from_error:
+ * @error: (nullable): The #GError the transfer completed with
+ *
+ * Translate a transfer error into the errno based status used in traces.
+ *
+ * Returns: 0 if @error is %NULL, otherwise a negative errno value
+ */
+gint32
+fpi_transfer_trace_status_from_error (const GError *error)
+{
+  if (!error)
+    return 0;
+
+  if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED) ||
+      g_error_matches (error, G_USB_DEVICE_ERROR, G_USB_DEVICE_ERROR_CANCELLED))
+    return -ENOENT;
+
+  if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_TIMED_OUT) ||
+      g_error_matches (error, G_USB_DEVICE_ERROR, G_USB_DEVICE_ERROR_TIMED_OUT))
+    return -ETIMEDOUT;
+
+  if (g_error_matches (error, G_USB_DEVICE_ERROR, G_USB_DEVICE_ERROR_NO_DEVICE))
+    return -ENODEV;
+
+  return -EIO;
+}
+
+static inline TraceSlot *
+trace_get_slot (FpiTransferTrace *trace, guint idx)
+{
+  return (TraceSlot *) (trace->slots + (idx & (TRACE_RECORDS - 1)) * trace->slot_size);
+}
+
+static FpiTransferTrace *
+trace_get (FpDevice *device, gboolean create)
+{
+  FpDevicePrivate *priv = fpi_device_get_private (device);
+  FpiTransferTrace *trace;
+  gsize slot_size;
+
+  trace = g_atomic_pointer_get (&priv->transfer_trace);
+  if (G_LIKELY (trace || !create))
+    return trace;
+
+  slot_size = (sizeof (TraceSlot) + get_config ()->snaplen + 7) & ~((gsize) 7);
+  trace = g_malloc0 (sizeof (FpiTransferTrace) + TRACE_RECORDS * slot_size);
+  trace->slot_size = slot_size;
+
+  /* Transfers may be completed from a worker thread (SPI) */
+  if (!g_atomic_pointer_compare_and_exchange (&priv->transfer_trace, NULL, trace))
+    fpi_transfer_trace_free (trace);
+
+  return g_atomic_pointer_get (&priv->transfer_trace);
+}
+
+/**
+ * fpi_transfer_trace_record:
+ * @device: The #FpDevice the transfer belongs to
+ * @record: The event to record, the timestamp and captured fields are
+ *   filled in by this function
+ * @data: (nullable): The data of the transfer, @record->length bytes
+ *
+ * Store a transfer event in the trace buffer of @device. Must only be
+ * called if %FPI_TRANSFER_TRACE_RECORD is enabled.
+ */
+void
+fpi_transfer_trace_record (FpDevice               *device,
+                           FpiTransferTraceRecord *record,
+                           const guint8           *data)
+{
+  const TraceConfig *config = get_config ();
+  FpiTransferTrace *trace;
+  TraceSlot *slot;
+  guint idx;
+
+  g_return_if_fail (config->flags & FPI_TRANSFER_TRACE_RECORD);
+
+  trace = trace_get (device, TRUE);
+
+  record->timestamp = g_get_real_time ();
+  record->captured = data ? MIN (record->length, config->snaplen) : 0;
+
+  idx = (guint) g_atomic_int_add (&trace->head, 1);
+  slot = trace_get_slot (trace, idx);
+
+  g_atomic_int_set (&slot->seq, 0);
+  slot->record = *record;
+  if (record->captured)
+    memcpy (slot->data, data, record->captured);
+  g_atomic_int_set (&slot->seq, (gint) (idx + 1));
+}
+
+static void
+trace_foreach (FpDevice *device, TraceForeachFunc func, gpointer user_data)
+{
+  FpiTransferTrace *trace = trace_get (device, FALSE);
+  g_autofree TraceSlot *copy = NULL;
+  guint head, idx;
+
+  if (!trace)
+    return;
+
+  copy = g_malloc (trace->slot_size);
+  head = (guint) g_atomic_int_get (&trace->head);
+
+  for (idx = head - MIN (head, TRACE_RECORDS); idx != head; idx++)
+    {
+      TraceSlot *slot = trace_get_slot (trace, idx);
+
+      /* Skip events that are overwritten while we read them */
+      if (g_atomic_int_get (&slot->seq) != (gint) (idx + 1))
+        continue;
+      memcpy (copy, slot, trace->slot_size);
+      if (g_atomic_int_get (&slot->seq) != (gint) (idx + 1))
+        continue;
+
+      func (&copy->record, copy->data, user_data);
+    }
+}
+
+static void
+pcapng_begin_block (FpiByteWriter *writer, guint32 type)
+{
+  fpi_byte_writer_put_uint32_le (writer, type);
+  /* Length, filled in by pcapng_end_block() */
+  fpi_byte_writer_put_uint32_le (writer, 0);
+}
+
+static void
+pcapng_end_block (FpiByteWriter *writer, guint start)
+{
+  guint end;
+
+  fpi_byte_writer_fill (writer, 0, (4 - fpi_byte_writer_get_pos (writer) % 4) % 4);
+  end = fpi_byte_writer_get_pos (writer) + 4;
+  fpi_byte_writer_put_uint32_le (writer, end - start);
+
+  fpi_byte_writer_set_pos (writer, start + 4);
+  fpi_byte_writer_put_uint32_le (writer, end - start);
+  fpi_byte_writer_set_pos (writer, end);
+}
+
+static void
+pcapng_put_interface (FpiByteWriter *writer, guint16 linktype, guint32 snaplen)
+{
+  guint start = fpi_byte_writer_get_pos (writer);
+
+  pcapng_begin_block (writer, PCAPNG_INTERFACE_DESCRIPTION_BLOCK);
+  fpi_byte_writer_put_uint16_le (writer, linktype);
+  fpi_byte_writer_put_uint16_le (writer, 0);
+  fpi_byte_writer_put_uint32_le (writer, snaplen);
+  pcapng_end_block (writer, start);
+}
+
+typedef struct
+{
+  FpiByteWriter writer;
+  guint16       busnum;
+  guint8        devnum;
+} PcapngData;
+
+static void
+pcapng_put_record (const FpiTransferTraceRecord *record,
+                   const guint8                 *data,
+                   gpointer                      user_data)
+{
+  PcapngData *pcapng = user_data;
+  FpiByteWriter *writer = &pcapng->writer;
+  guint start = fpi_byte_writer_get_pos (writer);
+  guint32 header_size;
+
+  if (record->bus == FPI_TRANSFER_TRACE_BUS_USB)
+    header_size = USBMON_HEADER_SIZE;
+  else
+    header_size = SPI_HEADER_SIZE;
+
+  pcapng_begin_block (writer, PCAPNG_ENHANCED_PACKET_BLOCK);
+  fpi_byte_writer_put_uint32_le (writer, record->bus == FPI_TRANSFER_TRACE_BUS_USB ? 0 : 1);
+  fpi_byte_writer_put_uint32_le (writer, (guint64) record->timestamp >> 32);
+  fpi_byte_writer_put_uint32_le (writer, (guint64) record->timestamp & 0xffffffff);
+  fpi_byte_writer_put_uint32_le (writer, header_size + record->captured);
+  fpi_byte_writer_put_uint32_le (writer, header_size + record->captured);
+
+  if (record->bus == FPI_TRANSFER_TRACE_BUS_USB)
+    {
+      gboolean has_setup = record->submit && record->type == FP_TRANSFER_CONTROL;
+      guint8 flag_data = 0;
+      guint8 type;
+
+      switch (record->type)
+        {
+        case FP_TRANSFER_CONTROL:
+          type = USBMON_TYPE_CONTROL;
+          break;
+
+        case FP_TRANSFER_INTERRUPT:
+          type = USBMON_TYPE_INTERRUPT;
+          break;
+
+        default:
+          type = USBMON_TYPE_BULK;
+        }
+
+      if (!record->captured)
+        flag_data = record->submit ? '<' : '>';
+
+      /* struct usbmon_packet */
+      fpi_byte_writer_put_uint64_le (writer, record->id);
+      fpi_byte_writer_put_uint8 (writer, record->submit ? 'S' : 'C');
+      fpi_byte_writer_put_uint8 (writer, type);
+      fpi_byte_writer_put_uint8 (writer, record->endpoint);
+      fpi_byte_writer_put_uint8 (writer, pcapng->devnum);
+      fpi_byte_writer_put_uint16_le (writer, pcapng->busnum);
+      fpi_byte_writer_put_uint8 (writer, has_setup ? 0 : '-');
+      fpi_byte_writer_put_uint8 (writer, flag_data);
+      fpi_byte_writer_put_int64_le (writer, record->timestamp / G_USEC_PER_SEC);
+      fpi_byte_writer_put_int32_le (writer, record->timestamp % G_USEC_PER_SEC);
+      fpi_byte_writer_put_int32_le (writer, record->submit ? -EINPROGRESS : record->status);
+      fpi_byte_writer_put_uint32_le (writer, record->length);
+      fpi_byte_writer_put_uint32_le (writer, record->captured);
+      if (has_setup)
+        fpi_byte_writer_put_data (writer, record->setup, sizeof (record->setup));
+      else
+        fpi_byte_writer_fill (writer, 0, sizeof (record->setup));
+      /* interval, start_frame, xfer_flags, ndesc */
+      fpi_byte_writer_fill (writer, 0, 16);
+    }
+  else
+    {
+      fpi_byte_writer_put_uint64_le (writer, record->id);
+      fpi_byte_writer_put_uint8 (writer, record->submit ? 'S' : 'C');
+      fpi_byte_writer_fill (writer, 0, 3);
+      fpi_byte_writer_put_int32_le (writer, record->status);
+      fpi_byte_writer_put_uint32_le (writer, record->length);
+    }
+
+  if (record->captured)
+    fpi_byte_writer_put_data (writer, data, record->captured);
+  pcapng_end_block (writer, start);
+}
+
+static gboolean
+write_and_free_data (GOutputStream *stream,
+                     guint8        *data,
+                     gsize          length,
+                     GCancellable  *cancellable,
+                     GError       **error)
+{
+  g_autofree guint8 *owned_data = data;
+
+  return g_output_stream_write_all (stream, owned_data, length, NULL,
+                                    cancellable, error);
+}
+
+/**
+ * fpi_transfer_trace_write_pcapng:
+ * @device: The #FpDevice
+ * @stream: The #GOutputStream to write to
+ * @cancellable: (nullable): A #GCancellable
+ * @error: Return location for errors
+ *
+ * Write the transfers recorded for @device as pcapng file. The first
+ * interface in the file contains the USB and the second the SPI
+ * transfers.
+ *
+ * Returns: %TRUE on success
+ */
+gboolean
+fpi_transfer_trace_write_pcapng (FpDevice      *device,
+                                 GOutputStream *stream,
+                                 GCancellable  *cancellable,
+                                 GError       **error)
+{
+  FpDevicePrivate *priv = fpi_device_get_private (device);
+  PcapngData pcapng = { 0 };
+  guint32 snaplen = get_config ()->snaplen;
+  gsize size;
+
+  g_return_val_if_fail (FP_IS_DEVICE (device), FALSE);
+
+  if (priv->usb_device)
+    {
+      pcapng.busnum = g_usb_device_get_bus (priv->usb_device);
+      pcapng.devnum = g_usb_device_get_address (priv->usb_device);
+    }
+
+  fpi_byte_writer_init (&pcapng.writer);
+
+  pcapng_begin_block (&pcapng.writer, PCAPNG_SECTION_HEADER_BLOCK);
+  fpi_byte_writer_put_uint32_le (&pcapng.writer, PCAPNG_BYTE_ORDER_MAGIC);
+  fpi_byte_writer_put_uint16_le (&pcapng.writer, 1);
+  fpi_byte_writer_put_uint16_le (&pcapng.writer, 0);
+  /* Section length is not specified */
+  fpi_byte_writer_put_int64_le (&pcapng.writer, -1);
+  pcapng_end_block (&pcapng.writer, 0);
+
+  pcapng_put_interface (&pcapng.writer, LINKTYPE_USB_LINUX_MMAPPED,
+                        USBMON_HEADER_SIZE + snaplen);
+  pcapng_put_interface (&pcapng.writer, LINKTYPE_USER0,
+                        SPI_HEADER_SIZE + snaplen);
+
+  trace_foreach (device, pcapng_put_record, &pcapng);
+
+  size = fpi_byte_writer_get_size (&pcapng.writer);
+  return write_and_free_data (stream,
+                              fpi_byte_writer_reset_and_get_data (&pcapng.writer),
+                              size, cancellable, error);
+}
+
+static void
+json_append_hex (GString *json, const guint8 *data, gsize length)
+{
+  static const gchar hex[] = "0123456789abcdef";
+  gsize i;
+
+  g_string_append_c (json, '"');
+  for (i = 0; i < length; i++)
+    {
+      g_string_append_c (json, hex[data[i] >> 4]);
+      g_string_append_c (json, hex[data[i] & 0xf]);
+    }
+  g_string_append_c (json, '"');
+}
+
+static void
+json_put_record (const FpiTransferTraceRecord *record,
+                 const guint8                 *data,
+                 gpointer                      user_data)
+{
+  GString *json = user_data;
+
+  if (json->len > 2)
+    g_string_append (json, ",\n");
+
+  g_string_append_printf (json,
+                          "  { \"timestamp\": %" G_GINT64_FORMAT ", "
+                          "\"id\": %" G_GUINT64_FORMAT ", "
+                          "\"bus\": \"%s\", \"event\": \"%s\", ",
+                          record->timestamp,
+                          record->id,
+                          record->bus == FPI_TRANSFER_TRACE_BUS_USB ? "usb" : "spi",
+                          record->submit ? "submit" : "complete");
+
+  if (record->bus == FPI_TRANSFER_TRACE_BUS_USB)
+    {
+      const gchar *type;
+
+      switch (record->type)
+        {
+        case FP_TRANSFER_CONTROL:
+          type = "control";
+          break;
+
+        case FP_TRANSFER_INTERRUPT:
+          type = "interrupt";
+          break;
+
+        default:
+          type = "bulk";
+        }
+
+      g_string_append_printf (json, "\"type\": \"%s\", \"endpoint\": %u, ",
+                              type, record->endpoint);
+      if (record->submit && record->type == FP_TRANSFER_CONTROL)
+        {
+          g_string_append (json, "\"setup\": ");
+          json_append_hex (json, record->setup, sizeof (record->setup));
+          g_string_append (json, ", ");
+        }
+    }
+
+  g_string_append_printf (json, "\"status\": %d, \"length\": %u, \"data\": ",
+                          record->status, record->length);
+  json_append_hex (json, data, record->captured);
+  g_string_append (json, " }");
+}
+
+/**
+ * fpi_transfer_trace_write_json:
+ * @device: The #FpDevice
+ * @stream: The #GOutputStream to write to
+ * @cancellable: (nullable): A #GCancellable
+ * @error: Return location for errors
+ *
+ * Write the transfers recorded for @device as JSON array with one object
+ * per event. The data is stored as hex string.
+ *
+ * Returns: %TRUE on success
+ */
+gboolean
+fpi_transfer_trace_write_json (FpDevice      *device,
+                               GOutputStream *stream,
+                               GCancellable  *cancellable,
+                               GError       **error)
+{
+  GString *json;
+  gsize size;
+
+  g_return_val_if_fail (FP_IS_DEVICE (device), FALSE);
+
+  json = g_string_new ("[\n");
+  trace_foreach (device, json_put_record, json);
+  g_string_append (json, "\n]\n");
+
+  size = json->len;
+  return write_and_free_data (stream, (guint8 *) g_string_free (json, FALSE),
+                              size, cancellable, error);
+}
+
+/**
+ * fpi_transfer_trace_save:
+ * @device: The #FpDevice
+ *
+ * Write the recorded transfers of @device into the directory given by
+ * FP_TRACE_TRANSFER and discard them. This is done automatically when
+ * the device is closed.
+ */
+void
+fpi_transfer_trace_save (FpDevice *device)
+{
+  FpDevicePrivate *priv = fpi_device_get_private (device);
+  const TraceConfig *config = get_config ();
+  g_autoptr(GFileOutputStream) stream = NULL;
+  g_autoptr(GError) error = NULL;
+  g_autoptr(GFile) file = NULL;
+  g_autofree gchar *basename = NULL;
+  g_autofree gchar *path = NULL;
+  gboolean res;
+
+  if (!trace_get (device, FALSE))
+    return;
+
+  basename = g_strdup_printf ("%s-%" G_GINT64_FORMAT ".%s",
+                              fp_device_get_driver (device),
+                              g_get_real_time (),
+                              config->json ? "json" : "pcapng");
+  path = g_build_filename (config->directory, basename, NULL);
+  file = g_file_new_for_path (path);
+
+  stream = g_file_replace (file, NULL, FALSE, G_FILE_CREATE_NONE, NULL, &error);
+  if (stream)
+    {
+      if (config->json)
+        res = fpi_transfer_trace_write_json (device, G_OUTPUT_STREAM (stream), NULL, &error);
+      else
+        res = fpi_transfer_trace_write_pcapng (device, G_OUTPUT_STREAM (stream), NULL, &error);
+
+      if (res)
+        res = g_output_stream_close (G_OUTPUT_STREAM (stream), NULL, &error);
+    }
+  else
+    {
+      res = FALSE;
+    }
+
+  if (res)
+    g_debug ("Saved transfer trace to %s", path);
+  else
+    g_warning ("Could not save transfer trace to %s: %s", path, error->message);
+
+  /* Nothing is in flight once the device is closed */
+  g_clear_pointer (&priv->transfer_trace, fpi_transfer_trace_free);
+}
+
+/**
+ * fpi_transfer_trace_free:
+ * @trace: The #FpiTransferTrace
+ *
+ * Free the trace buffer of a device.
+ */
+void
+fpi_transfer_trace_free (FpiTransferTrace *trace)
+{
+  g_free (trace);
+}
@@ -0,0 +1,112 @@
+/*
+ * Recording of USB and SPI transfers
+ * Copyright (C) 2026 libfprint contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+#include "fpi-device.h"
+
+G_BEGIN_DECLS
+
+/**
+ * FpiTransferTraceFlags:
+ * @FPI_TRANSFER_TRACE_NONE: Tracing is disabled
+ * @FPI_TRANSFER_TRACE_LOG: Log transfers and their content as debug
+ *   messages (FP_DEBUG_TRANSFER)
+ * @FPI_TRANSFER_TRACE_RECORD: Record transfers into the per device
+ *   trace buffer (FP_TRACE_TRANSFER)
+ *
+ * The enabled tracing facilities, see fpi_transfer_trace_get_flags().
+ */
+typedef enum {
+  FPI_TRANSFER_TRACE_NONE = 0,
+  FPI_TRANSFER_TRACE_LOG = 1 << 0,
+  FPI_TRANSFER_TRACE_RECORD = 1 << 1,
+} FpiTransferTraceFlags;
+
+/**
+ * FpiTransferTraceBus:
+ * @FPI_TRANSFER_TRACE_BUS_USB: A USB transfer
+ * @FPI_TRANSFER_TRACE_BUS_SPI: An SPI transfer
+ *
+ * The bus a recorded transfer happened on.
+ */
+typedef enum {
+  FPI_TRANSFER_TRACE_BUS_USB,
+  FPI_TRANSFER_TRACE_BUS_SPI,
+} FpiTransferTraceBus;
+
+/**
+ * FpiTransferTraceRecord:
+ * @timestamp: Wall clock time of the event in microseconds
+ * @id: Identifier that is the same for the submission and completion
+ * @bus: The #FpiTransferTraceBus
+ * @submit: %TRUE for the submission, %FALSE for the completion
+ * @type: The #FpiTransferType of a USB transfer, unused for SPI
+ * @endpoint: USB endpoint address including the direction bit
+ * @setup: The USB setup packet of a control transfer submission
+ * @status: 0 on success, otherwise a negative errno value
+ * @length: The length of the transfer (submission) or the transferred
+ *   data (completion). For SPI, the write and read length respectively.
+ * @captured: Number of bytes of data that were recorded
+ *
+ * A single recorded event, the data itself is stored right after it.
+ */
+typedef struct
+{
+  gint64  timestamp;
+  guint64 id;
+  guint8  bus;
+  guint8  submit;
+  gint8   type;
+  guint8  endpoint;
+  guint8  setup[8];
+  gint32  status;
+  guint32 length;
+  guint32 captured;
+} FpiTransferTraceRecord;
+
+typedef struct _FpiTransferTrace FpiTransferTrace;
+
+FpiTransferTraceFlags fpi_transfer_trace_get_flags (void);
+
+void                  fpi_transfer_trace_log_buffer (const guint8 *buffer,
+                                                     gsize         length);
+
+gint32                fpi_transfer_trace_status_from_error (const GError *error);
+
+void                  fpi_transfer_trace_record (FpDevice               *device,
+                                                 FpiTransferTraceRecord *record,
+                                                 const guint8           *data);
+
+gboolean              fpi_transfer_trace_write_pcapng (FpDevice      *device,
+                                                       GOutputStream *stream,
+                                                       GCancellable  *cancellable,
+                                                       GError       **error);
+
+gboolean              fpi_transfer_trace_write_json (FpDevice      *device,
+                                                     GOutputStream *stream,
+                                                     GCancellable  *cancellable,
+                                                     GError       **error);
+
+void                  fpi_transfer_trace_save (FpDevice *device);
+
+void                  fpi_transfer_trace_free (FpiTransferTrace *trace);
+
+G_END_DECLS
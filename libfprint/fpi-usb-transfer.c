@@ -17,7 +17,12 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include <string.h>
+
 #include "fpi-usb-transfer.h"
+#include "fpi-byte-utils.h"
+#include "fpi-transfer-trace.h"
+#include "fp-device-private.h"
 
 /**
  * SECTION:fpi-usb-transfer
@@ -30,15 +35,285 @@
  *
  * Drivers should use this API only rather than accessing the GUsbDevice
  * directly in most cases.
+ *
+ * Transfers and the buffers allocated by the fill functions are recycled
+ * through a small per device pool. Drivers that prepare buffers themselves
+ * can allocate them from the same pool using fpi_usb_buffer_new().
  */
 
 
 G_DEFINE_BOXED_TYPE (FpiUsbTransfer, fpi_usb_transfer, fpi_usb_transfer_ref, fpi_usb_transfer_unref)
 
+/* Buffers are recycled in power of two size classes from 64 bytes up to
+ * 64 KiB, larger ones are allocated on demand.
+ */
+#define POOL_MIN_SHIFT 6
+#define POOL_BUFFER_CLASSES 11
+#define POOL_MAX_FREE_BUFFERS 4
+#define POOL_MAX_FREE_TRANSFERS 8
+
+struct _FpiUsbTransferPool
+{
+  gint            ref_count;
+  GMutex          mutex;
+  /* Set once the device is gone, nothing is cached anymore */
+  gboolean        released;
+
+  guint           n_transfers;
+  FpiUsbTransfer *transfers[POOL_MAX_FREE_TRANSFERS];
+
+  guint           n_buffers[POOL_BUFFER_CLASSES];
+  gpointer        buffers[POOL_BUFFER_CLASSES][POOL_MAX_FREE_BUFFERS];
+};
+
+/* Stored in front of every buffer from fpi_usb_buffer_new() */
+typedef union
+{
+  struct
+  {
+    FpiUsbTransferPool *pool;
+    guint               size_class;
+  } h;
+  /* Keep the data aligned like a g_malloc() result */
+  gint64 align[2];
+} PoolBufferHeader;
+
+static FpiUsbTransferPool *
+pool_ref (FpiUsbTransferPool *pool)
+{
+  g_atomic_int_inc (&pool->ref_count);
+
+  return pool;
+}
+
+static void
+pool_unref (FpiUsbTransferPool *pool)
+{
+  if (!g_atomic_int_dec_and_test (&pool->ref_count))
+    return;
+
+  g_assert (pool->released);
+  g_mutex_clear (&pool->mutex);
+  g_free (pool);
+}
+
+static FpiUsbTransferPool *
+pool_get (FpDevice *device)
+{
+  FpDevicePrivate *priv = fpi_device_get_private (device);
+  FpiUsbTransferPool *pool;
+
+  pool = g_atomic_pointer_get (&priv->usb_transfer_pool);
+  if (G_LIKELY (pool))
+    return pool;
+
+  pool = g_new0 (FpiUsbTransferPool, 1);
+  pool->ref_count = 1;
+  g_mutex_init (&pool->mutex);
+
+  /* Synchronous transfers may be created from a thread */
+  if (!g_atomic_pointer_compare_and_exchange (&priv->usb_transfer_pool, NULL, pool))
+    {
+      pool->released = TRUE;
+      pool_unref (pool);
+    }
+
+  return g_atomic_pointer_get (&priv->usb_transfer_pool);
+}
+
+/* Called when the device is finalized. Frees all cached transfers and
+ * buffers, the ones that are still in use are freed when they are
+ * returned.
+ */
+void
+fpi_usb_transfer_pool_release (FpiUsbTransferPool *pool)
+{
+  guint i;
+
+  g_mutex_lock (&pool->mutex);
+
+  pool->released = TRUE;
+
+  for (i = 0; i < pool->n_transfers; i++)
+    g_slice_free (FpiUsbTransfer, pool->transfers[i]);
+  pool->n_transfers = 0;
+
+  for (i = 0; i < POOL_BUFFER_CLASSES; i++)
+    {
+      while (pool->n_buffers[i] > 0)
+        g_free (pool->buffers[i][--pool->n_buffers[i]]);
+    }
+
+  g_mutex_unlock (&pool->mutex);
+
+  pool_unref (pool);
+}
+
+static guint8 *
+pool_alloc_buffer (FpiUsbTransferPool *pool, gsize length)
+{
+  PoolBufferHeader *header = NULL;
+  guint size_class = 0;
+
+  while (size_class < POOL_BUFFER_CLASSES &&
+         ((gsize) 1 << (POOL_MIN_SHIFT + size_class)) < length)
+    size_class++;
+
+  if (size_class < POOL_BUFFER_CLASSES)
+    {
+      g_mutex_lock (&pool->mutex);
+      if (pool->n_buffers[size_class] > 0)
+        header = pool->buffers[size_class][--pool->n_buffers[size_class]];
+      g_mutex_unlock (&pool->mutex);
+
+      if (!header)
+        header = g_malloc (sizeof (PoolBufferHeader) +
+                           ((gsize) 1 << (POOL_MIN_SHIFT + size_class)));
+
+      header->h.pool = pool_ref (pool);
+      header->h.size_class = size_class;
+    }
+  else
+    {
+      header = g_malloc (sizeof (PoolBufferHeader) + length);
+      header->h.pool = NULL;
+    }
+
+  memset (header + 1, 0, length);
+
+  return (guint8 *) (header + 1);
+}
+
+/**
+ * fpi_usb_buffer_new:
+ * @device: The #FpDevice the buffer is for
+ * @length: The size of the buffer
+ *
+ * Allocates a zero initialized buffer from the transfer pool of @device.
+ * Use this for buffers that are passed to fpi_usb_transfer_fill_bulk_full()
+ * or fpi_usb_transfer_fill_interrupt_full() together with
+ * fpi_usb_buffer_free() as destroy notify.
+ *
+ * Returns: (transfer full): A new buffer, free with fpi_usb_buffer_free()
+ */
+guint8 *
+fpi_usb_buffer_new (FpDevice *device, gsize length)
+{
+  g_return_val_if_fail (FP_IS_DEVICE (device), NULL);
+
+  return pool_alloc_buffer (pool_get (device), length);
+}
+
+/**
+ * fpi_usb_buffer_free:
+ * @buffer: (nullable): A buffer allocated with fpi_usb_buffer_new()
+ *
+ * Returns the buffer to the pool it was allocated from. The buffer must not
+ * be freed using g_free().
+ */
+void
+fpi_usb_buffer_free (gpointer buffer)
+{
+  PoolBufferHeader *header;
+  FpiUsbTransferPool *pool;
+
+  if (!buffer)
+    return;
+
+  header = ((PoolBufferHeader *) buffer) - 1;
+  pool = header->h.pool;
+
+  if (pool)
+    {
+      guint size_class = header->h.size_class;
+
+      g_mutex_lock (&pool->mutex);
+      if (!pool->released && pool->n_buffers[size_class] < POOL_MAX_FREE_BUFFERS)
+        {
+          pool->buffers[size_class][pool->n_buffers[size_class]++] = header;
+          header = NULL;
+        }
+      g_mutex_unlock (&pool->mutex);
+
+      pool_unref (pool);
+    }
+
+  g_free (header);
+}
+
+static guint8
+transfer_get_endpoint (FpiUsbTransfer *transfer)
+{
+  if (transfer->type != FP_TRANSFER_CONTROL)
+    return transfer->endpoint;
+
+  if (transfer->direction == G_USB_DEVICE_DIRECTION_DEVICE_TO_HOST)
+    return FPI_USB_ENDPOINT_IN;
+  else
+    return FPI_USB_ENDPOINT_OUT;
+}
+
+static void
+record_transfer (FpiUsbTransfer *transfer, gboolean submit, GError *error)
+{
+  FpiTransferTraceRecord record = { 0 };
+  gboolean is_in;
+
+  record.id = GPOINTER_TO_SIZE (transfer);
+  record.bus = FPI_TRANSFER_TRACE_BUS_USB;
+  record.submit = submit;
+  record.type = transfer->type;
+  record.endpoint = transfer_get_endpoint (transfer);
+  is_in = (record.endpoint & FPI_USB_ENDPOINT_IN) != 0;
+
+  if (transfer->type == FP_TRANSFER_CONTROL)
+    {
+      record.setup[0] = record.endpoint |
+                        (transfer->request_type << 5) |
+                        transfer->recipient;
+      record.setup[1] = transfer->request;
+      FP_WRITE_UINT16_LE (&record.setup[2], transfer->value);
+      FP_WRITE_UINT16_LE (&record.setup[4], transfer->idx);
+      FP_WRITE_UINT16_LE (&record.setup[6], transfer->length);
+    }
+
+  if (submit)
+    {
+      record.length = transfer->length;
+      fpi_transfer_trace_record (transfer->device, &record,
+                                 is_in ? NULL : transfer->buffer);
+    }
+  else
+    {
+      record.status = fpi_transfer_trace_status_from_error (error);
+      record.length = MAX (transfer->actual_length, 0);
+      fpi_transfer_trace_record (transfer->device, &record,
+                                 is_in ? transfer->buffer : NULL);
+    }
+}
+
 static void
 log_transfer (FpiUsbTransfer *transfer, gboolean submit, GError *error)
 {
-  if (g_getenv ("FP_DEBUG_TRANSFER"))
+  FpiTransferTraceFlags flags = fpi_transfer_trace_get_flags ();
+
+  if (submit)
+    transfer->submit_time = g_get_monotonic_time ();
+  else
+    fpi_device_update_transfer_stats (transfer->device,
+                                      FPI_TRANSFER_TRACE_BUS_USB,
+                                      transfer_get_endpoint (transfer),
+                                      transfer->actual_length,
+                                      g_get_monotonic_time () - transfer->submit_time,
+                                      error);
+
+  if (G_LIKELY (flags == FPI_TRANSFER_TRACE_NONE))
+    return;
+
+  if (flags & FPI_TRANSFER_TRACE_RECORD)
+    record_transfer (transfer, submit, error);
+
+  if (flags & FPI_TRANSFER_TRACE_LOG)
     {
       if (!submit)
         {
@@ -65,25 +340,11 @@ log_transfer (FpiUsbTransfer *transfer, gboolean submit, GError *error)
 
       if (!submit == !!(transfer->endpoint & FPI_USB_ENDPOINT_IN))
         {
-          g_autoptr(GString) line = NULL;
           gssize dump_len;
 
           dump_len = (transfer->endpoint & FPI_USB_ENDPOINT_IN) ? transfer->actual_length : transfer->length;
-
-          line = g_string_new ("");
-          /* Dump the buffer. */
-          for (gint i = 0; i < dump_len; i++)
-            {
-              g_string_append_printf (line, "%02x ", transfer->buffer[i]);
-              if ((i + 1) % 16 == 0)
-                {
-                  g_debug ("%s", line->str);
-                  g_string_set_size (line, 0);
-                }
-            }
-
-          if (line->len)
-            g_debug ("%s", line->str);
+          if (dump_len > 0)
+            fpi_transfer_trace_log_buffer (transfer->buffer, dump_len);
         }
     }
 }
@@ -99,15 +360,28 @@ log_transfer (FpiUsbTransfer *transfer, gboolean submit, GError *error)
 FpiUsbTransfer *
 fpi_usb_transfer_new (FpDevice * device)
 {
-  FpiUsbTransfer *self;
+  FpiUsbTransferPool *pool;
+  FpiUsbTransfer *self = NULL;
 
   g_assert (device != NULL);
 
-  self = g_slice_new0 (FpiUsbTransfer);
+  pool = pool_get (device);
+
+  g_mutex_lock (&pool->mutex);
+  if (pool->n_transfers > 0)
+    self = pool->transfers[--pool->n_transfers];
+  g_mutex_unlock (&pool->mutex);
+
+  if (self)
+    memset (self, 0, sizeof (FpiUsbTransfer));
+  else
+    self = g_slice_new0 (FpiUsbTransfer);
+
   self->ref_count = 1;
   self->type = FP_TRANSFER_NONE;
 
   self->device = device;
+  self->pool = pool_ref (pool);
 
   return self;
 }
@@ -115,6 +389,8 @@ fpi_usb_transfer_new (FpDevice * device)
 static void
 fpi_usb_transfer_free (FpiUsbTransfer *self)
 {
+  FpiUsbTransferPool *pool;
+
   g_assert (self);
   g_assert_cmpint (self->ref_count, ==, 0);
 
@@ -122,7 +398,20 @@ fpi_usb_transfer_free (FpiUsbTransfer *self)
     self->free_buffer (self->buffer);
   self->buffer = NULL;
 
-  g_slice_free (FpiUsbTransfer, self);
+  pool = g_steal_pointer (&self->pool);
+
+  g_mutex_lock (&pool->mutex);
+  if (!pool->released && pool->n_transfers < POOL_MAX_FREE_TRANSFERS)
+    {
+      pool->transfers[pool->n_transfers++] = self;
+      self = NULL;
+    }
+  g_mutex_unlock (&pool->mutex);
+
+  pool_unref (pool);
+
+  if (self)
+    g_slice_free (FpiUsbTransfer, self);
 }
 
 /**
@@ -169,7 +458,8 @@ fpi_usb_transfer_unref (FpiUsbTransfer *self)
  *
  * Prepare a bulk transfer. A buffer will be created for you, use
  * fpi_usb_transfer_fill_bulk_full() if you want to send a static buffer
- * or receive a pre-defined buffer.
+ * or receive a pre-defined buffer. The buffer is taken from the device
+ * pool and must not be freed using g_free().
  */
 void
 fpi_usb_transfer_fill_bulk (FpiUsbTransfer *transfer,
@@ -178,9 +468,9 @@ fpi_usb_transfer_fill_bulk (FpiUsbTransfer *transfer,
 {
   fpi_usb_transfer_fill_bulk_full (transfer,
                                    endpoint,
-                                   g_malloc0 (length),
+                                   pool_alloc_buffer (transfer->pool, length),
                                    length,
-                                   g_free);
+                                   fpi_usb_buffer_free);
 }
 
 /**
@@ -246,8 +536,8 @@ fpi_usb_transfer_fill_control (FpiUsbTransfer       *transfer,
   transfer->idx = idx;
 
   transfer->length = length;
-  transfer->buffer = g_malloc0 (length);
-  transfer->free_buffer = g_free;
+  transfer->buffer = pool_alloc_buffer (transfer->pool, length);
+  transfer->free_buffer = fpi_usb_buffer_free;
 }
 
 /**
@@ -266,9 +556,9 @@ fpi_usb_transfer_fill_interrupt (FpiUsbTransfer *transfer,
 {
   fpi_usb_transfer_fill_interrupt_full (transfer,
                                         endpoint,
-                                        g_malloc0 (length),
+                                        pool_alloc_buffer (transfer->pool, length),
                                         length,
-                                        g_free);
+                                        fpi_usb_buffer_free);
 }
 
 /**
@@ -539,12 +829,422 @@ fpi_usb_transfer_submit_sync (FpiUsbTransfer *transfer,
       g_return_val_if_reached (FALSE);
     }
 
-  log_transfer (transfer, FALSE, *error);
-
   if (!res)
     transfer->actual_length = -1;
   else
     transfer->actual_length = actual_length;
 
+  log_transfer (transfer, FALSE, error ? *error : NULL);
+
   return res;
 }
+
+typedef struct
+{
+  FpiUsbTransferBatchCallback callback;
+  gpointer                    user_data;
+  guint                       pending;
+  GError                     *error;
+
+  /* Cancelled on the first error, so that the rest is not sent */
+  GCancellable               *cancellable;
+  GCancellable               *external_cancellable;
+  gulong                      external_cancellable_id;
+} UsbTransferBatch;
+
+static void
+batch_external_cancelled_cb (GCancellable *cancellable, UsbTransferBatch *batch)
+{
+  g_cancellable_cancel (batch->cancellable);
+}
+
+static void
+batch_transfer_cb (FpiUsbTransfer *transfer, FpDevice *device,
+                   gpointer user_data, GError *error)
+{
+  UsbTransferBatch *batch = user_data;
+
+  if (error && !batch->error)
+    {
+      batch->error = error;
+      g_cancellable_cancel (batch->cancellable);
+    }
+  else
+    {
+      g_clear_error (&error);
+    }
+
+  batch->pending -= 1;
+  if (batch->pending > 0)
+    return;
+
+  if (batch->external_cancellable)
+    g_cancellable_disconnect (batch->external_cancellable,
+                              batch->external_cancellable_id);
+  g_clear_object (&batch->external_cancellable);
+  g_clear_object (&batch->cancellable);
+
+  batch->callback (device, batch->user_data, g_steal_pointer (&batch->error));
+  g_free (batch);
+}
+
+/**
+ * fpi_usb_transfer_submit_batch:
+ * @transfers: (array length=n_transfers) (transfer full): The filled
+ *   transfers to submit
+ * @n_transfers: Number of transfers in @transfers
+ * @timeout_ms: Timeout for each transfer in ms
+ * @cancellable: (nullable): Cancellable to use, e.g. fpi_device_get_cancellable()
+ * @callback: Callback once all transfers have completed
+ * @user_data: Data to pass to callback
+ *
+ * Submit a sequence of transfers at once rather than waiting for each of
+ * them to complete before submitting the next one. Transfers to the same
+ * endpoint are executed in order, this is useful to e.g. write register
+ * tables without a round trip for every write.
+ *
+ * If a transfer fails, the remaining ones are cancelled and @callback is
+ * called with the first error once all transfers have returned. Short
+ * transfers are only an error if fpi_usb_transfer_set_short_error() was
+ * used.
+ */
+void
+fpi_usb_transfer_submit_batch (FpiUsbTransfer            **transfers,
+                               guint                       n_transfers,
+                               guint                       timeout_ms,
+                               GCancellable               *cancellable,
+                               FpiUsbTransferBatchCallback callback,
+                               gpointer                    user_data)
+{
+  UsbTransferBatch *batch;
+  guint i;
+
+  g_return_if_fail (transfers);
+  g_return_if_fail (n_transfers > 0);
+  g_return_if_fail (callback);
+
+  batch = g_new0 (UsbTransferBatch, 1);
+  batch->callback = callback;
+  batch->user_data = user_data;
+  batch->pending = n_transfers;
+  batch->cancellable = g_cancellable_new ();
+
+  if (cancellable)
+    {
+      batch->external_cancellable = g_object_ref (cancellable);
+      batch->external_cancellable_id =
+        g_cancellable_connect (cancellable,
+                               G_CALLBACK (batch_external_cancelled_cb),
+                               batch, NULL);
+    }
+
+  for (i = 0; i < n_transfers; i++)
+    fpi_usb_transfer_submit (transfers[i], timeout_ms, batch->cancellable,
+                             batch_transfer_cb, batch);
+}
+
+/**
+ * FpiUsbStream:
+ *
+ * A set of bulk transfers on one endpoint that are kept in flight, see
+ * fpi_usb_stream_new().
+ */
+struct _FpiUsbStream
+{
+  FpDevice                   *device;
+  guint                       n_transfers;
+  FpiUsbTransfer            **transfers;
+  GError                    **errors;
+  gboolean                   *completed;
+
+  guint                       timeout_ms;
+  GCancellable               *cancellable;
+  GCancellable               *external_cancellable;
+  gulong                      external_cancellable_id;
+  FpiUsbStreamCallback        callback;
+  FpiUsbStreamStoppedCallback stopped_callback;
+  gpointer                    user_data;
+
+  /* Index of the transfer that is delivered next */
+  guint                       next;
+  guint                       in_flight;
+  gboolean                    running;
+  gboolean                    stopping;
+  gboolean                    freed;
+  GError                     *stop_error;
+};
+
+static void stream_transfer_cb (FpiUsbTransfer *transfer,
+                                FpDevice       *device,
+                                gpointer        user_data,
+                                GError         *error);
+
+/**
+ * fpi_usb_stream_new:
+ * @device: The #FpDevice the stream is for
+ * @endpoint: The bulk IN endpoint to read from
+ * @transfer_length: The length of each transfer
+ * @n_transfers: Number of transfers to keep in flight
+ *
+ * Creates a stream that keeps @n_transfers bulk transfers queued on
+ * @endpoint, so that the host controller does not need to wait for the
+ * driver before polling the device again. This is useful for sensors that
+ * stream image data without flow control. The transfers and their buffers
+ * are allocated once and reused for every submission.
+ *
+ * Returns: (transfer full): A newly created #FpiUsbStream
+ */
+FpiUsbStream *
+fpi_usb_stream_new (FpDevice *device,
+                    guint8    endpoint,
+                    gsize     transfer_length,
+                    guint     n_transfers)
+{
+  FpiUsbStream *stream;
+  guint i;
+
+  g_return_val_if_fail (FP_IS_DEVICE (device), NULL);
+  g_return_val_if_fail (endpoint & FPI_USB_ENDPOINT_IN, NULL);
+  g_return_val_if_fail (n_transfers > 0, NULL);
+
+  stream = g_new0 (FpiUsbStream, 1);
+  stream->device = device;
+  stream->n_transfers = n_transfers;
+  stream->transfers = g_new0 (FpiUsbTransfer *, n_transfers);
+  stream->errors = g_new0 (GError *, n_transfers);
+  stream->completed = g_new0 (gboolean, n_transfers);
+
+  for (i = 0; i < n_transfers; i++)
+    {
+      stream->transfers[i] = fpi_usb_transfer_new (device);
+      fpi_usb_transfer_fill_bulk (stream->transfers[i], endpoint, transfer_length);
+    }
+
+  return stream;
+}
+
+/**
+ * fpi_usb_stream_free:
+ * @stream: The #FpiUsbStream
+ *
+ * Frees the stream and its transfers. A running stream is stopped first
+ * and only freed once all of its transfers have returned, no callbacks are
+ * called for it anymore in that case.
+ */
+void
+fpi_usb_stream_free (FpiUsbStream *stream)
+{
+  guint i;
+
+  if (!stream)
+    return;
+
+  if (stream->running)
+    {
+      stream->freed = TRUE;
+      stream->stopped_callback = NULL;
+      fpi_usb_stream_stop (stream);
+      return;
+    }
+
+  for (i = 0; i < stream->n_transfers; i++)
+    fpi_usb_transfer_unref (stream->transfers[i]);
+
+  g_free (stream->transfers);
+  g_free (stream->errors);
+  g_free (stream->completed);
+  g_free (stream);
+}
+
+static void
+stream_submit (FpiUsbStream *stream, guint idx)
+{
+  stream->in_flight++;
+  fpi_usb_transfer_submit (fpi_usb_transfer_ref (stream->transfers[idx]),
+                           stream->timeout_ms,
+                           stream->cancellable,
+                           stream_transfer_cb,
+                           stream);
+}
+
+static void
+stream_external_cancelled_cb (GCancellable *cancellable, FpiUsbStream *stream)
+{
+  g_cancellable_cancel (stream->cancellable);
+}
+
+static void
+stream_finish (FpiUsbStream *stream)
+{
+  GError *error = g_steal_pointer (&stream->stop_error);
+  guint i;
+
+  g_assert (stream->in_flight == 0);
+
+  for (i = 0; i < stream->n_transfers; i++)
+    {
+      g_clear_error (&stream->errors[i]);
+      stream->completed[i] = FALSE;
+    }
+
+  if (stream->external_cancellable)
+    g_cancellable_disconnect (stream->external_cancellable,
+                              stream->external_cancellable_id);
+  g_clear_object (&stream->external_cancellable);
+  g_clear_object (&stream->cancellable);
+
+  stream->running = FALSE;
+  stream->stopping = FALSE;
+
+  if (stream->stopped_callback)
+    stream->stopped_callback (stream, stream->device, stream->user_data, error);
+  else
+    g_clear_error (&error);
+
+  if (stream->freed)
+    fpi_usb_stream_free (stream);
+}
+
+static void
+stream_finish_timeout_cb (FpDevice *device, gpointer user_data)
+{
+  stream_finish (user_data);
+}
+
+static void
+stream_transfer_cb (FpiUsbTransfer *transfer, FpDevice *device,
+                    gpointer user_data, GError *error)
+{
+  FpiUsbStream *stream = user_data;
+  guint idx;
+
+  stream->in_flight--;
+
+  if (!stream->stopping &&
+      g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    {
+      /* The cancellable passed to fpi_usb_stream_start() was cancelled */
+      stream->stop_error = g_steal_pointer (&error);
+      stream->stopping = TRUE;
+      g_cancellable_cancel (stream->cancellable);
+    }
+
+  if (stream->stopping)
+    {
+      g_clear_error (&error);
+      if (stream->in_flight == 0)
+        stream_finish (stream);
+      return;
+    }
+
+  for (idx = 0; stream->transfers[idx] != transfer; idx++)
+    ;
+
+  stream->errors[idx] = error;
+  stream->completed[idx] = TRUE;
+
+  /* Deliver in submission order and queue the transfers up again */
+  while (stream->completed[stream->next])
+    {
+      idx = stream->next;
+      stream->next = (stream->next + 1) % stream->n_transfers;
+      stream->completed[idx] = FALSE;
+
+      stream->callback (stream, stream->transfers[idx], stream->device,
+                        stream->user_data, g_steal_pointer (&stream->errors[idx]));
+
+      /* fpi_usb_stream_stop() takes care of finishing */
+      if (stream->stopping)
+        return;
+
+      stream_submit (stream, idx);
+    }
+}
+
+/**
+ * fpi_usb_stream_start:
+ * @stream: The #FpiUsbStream
+ * @timeout_ms: Timeout for each transfer in ms, 0 for no timeout
+ * @cancellable: (nullable): Cancellable to use, e.g. fpi_device_get_cancellable()
+ * @callback: Callback for each completed transfer
+ * @stopped_callback: (nullable): Callback once the stream has stopped
+ * @user_data: User data to pass to the callbacks
+ *
+ * Submit all transfers of the stream. Each transfer is submitted again
+ * after @callback has been called for it, until fpi_usb_stream_stop() is
+ * called or @cancellable is cancelled.
+ */
+void
+fpi_usb_stream_start (FpiUsbStream               *stream,
+                      guint                       timeout_ms,
+                      GCancellable               *cancellable,
+                      FpiUsbStreamCallback        callback,
+                      FpiUsbStreamStoppedCallback stopped_callback,
+                      gpointer                    user_data)
+{
+  guint i;
+
+  g_return_if_fail (stream);
+  g_return_if_fail (callback);
+  g_return_if_fail (!stream->running);
+
+  stream->timeout_ms = timeout_ms;
+  stream->callback = callback;
+  stream->stopped_callback = stopped_callback;
+  stream->user_data = user_data;
+  stream->next = 0;
+  stream->running = TRUE;
+
+  stream->cancellable = g_cancellable_new ();
+  if (cancellable)
+    {
+      stream->external_cancellable = g_object_ref (cancellable);
+      stream->external_cancellable_id =
+        g_cancellable_connect (cancellable,
+                               G_CALLBACK (stream_external_cancelled_cb),
+                               stream, NULL);
+    }
+
+  for (i = 0; i < stream->n_transfers; i++)
+    stream_submit (stream, i);
+}
+
+/**
+ * fpi_usb_stream_stop:
+ * @stream: The #FpiUsbStream
+ *
+ * Stop the stream by cancelling all transfers that are in flight. No
+ * further data will be delivered, the stopped callback is called once all
+ * transfers have returned. Calling this on a stream that is not running
+ * or already stopping does nothing.
+ */
+void
+fpi_usb_stream_stop (FpiUsbStream *stream)
+{
+  g_return_if_fail (stream);
+
+  if (!stream->running || stream->stopping)
+    return;
+
+  stream->stopping = TRUE;
+  g_cancellable_cancel (stream->cancellable);
+
+  /* Called from the stream callback with nothing else in flight */
+  if (stream->in_flight == 0)
+    fpi_device_add_timeout (stream->device, 0, stream_finish_timeout_cb,
+                            stream, NULL);
+}
+
+/**
+ * fpi_usb_stream_is_running:
+ * @stream: The #FpiUsbStream
+ *
+ * Returns: %TRUE if the stream was started and has not stopped yet
+ */
+gboolean
+fpi_usb_stream_is_running (FpiUsbStream *stream)
+{
+  g_return_val_if_fail (stream, FALSE);
+
+  return stream->running;
+}
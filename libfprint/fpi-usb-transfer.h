@@ -31,6 +31,7 @@ G_BEGIN_DECLS
 #define FPI_USB_ENDPOINT_OUT 0x00
 
 typedef struct _FpiUsbTransfer FpiUsbTransfer;
+typedef struct _FpiUsbStream   FpiUsbStream;
 typedef struct _FpiSsm         FpiSsm;
 
 typedef void (*FpiUsbTransferCallback)(FpiUsbTransfer *transfer,
@@ -38,6 +39,52 @@ typedef void (*FpiUsbTransferCallback)(FpiUsbTransfer *transfer,
                                        gpointer        user_data,
                                        GError         *error);
 
+/**
+ * FpiUsbTransferBatchCallback:
+ * @dev: The #FpDevice the transfers belong to
+ * @user_data: User data passed to fpi_usb_transfer_submit_batch()
+ * @error: (transfer full): The first #GError that occurred or %NULL
+ *
+ * Called once all transfers of a batch have completed.
+ */
+typedef void (*FpiUsbTransferBatchCallback)(FpDevice *dev,
+                                            gpointer  user_data,
+                                            GError   *error);
+
+/**
+ * FpiUsbStreamCallback:
+ * @stream: The #FpiUsbStream
+ * @transfer: The completed #FpiUsbTransfer
+ * @dev: The #FpDevice the stream belongs to
+ * @user_data: User data passed to fpi_usb_stream_start()
+ * @error: (transfer full): The #GError of the transfer or %NULL
+ *
+ * Called for every completed transfer of the stream, in the order in
+ * which the transfers were submitted. The data of @transfer is only valid
+ * until the callback returns, afterwards the transfer is submitted again.
+ * Call fpi_usb_stream_stop() to stop the stream, e.g. on error.
+ */
+typedef void (*FpiUsbStreamCallback)(FpiUsbStream   *stream,
+                                     FpiUsbTransfer *transfer,
+                                     FpDevice       *dev,
+                                     gpointer        user_data,
+                                     GError         *error);
+
+/**
+ * FpiUsbStreamStoppedCallback:
+ * @stream: The #FpiUsbStream
+ * @dev: The #FpDevice the stream belongs to
+ * @user_data: User data passed to fpi_usb_stream_start()
+ * @error: (transfer full): The cancellation #GError if the cancellable
+ *   passed to fpi_usb_stream_start() was cancelled, otherwise %NULL
+ *
+ * Called once no transfer of a stopped stream is in flight anymore.
+ */
+typedef void (*FpiUsbStreamStoppedCallback)(FpiUsbStream *stream,
+                                            FpDevice     *dev,
+                                            gpointer      user_data,
+                                            GError       *error);
+
 /**
  * FpiTransferType:
  * @FP_TRANSFER_NONE: Type not set
@@ -96,12 +143,18 @@ struct _FpiUsbTransfer
   /* Flags */
   gboolean short_is_error;
 
+  /* Monotonic time of the submission, for the transfer statistics */
+  gint64 submit_time;
+
   /* Callbacks */
   gpointer               user_data;
   FpiUsbTransferCallback callback;
 
   /* Data free function */
   GDestroyNotify free_buffer;
+
+  /* The per device pool the transfer is returned to */
+  struct _FpiUsbTransferPool *pool;
 };
 
 GType              fpi_usb_transfer_get_type (void) G_GNUC_CONST;
@@ -109,6 +162,10 @@ FpiUsbTransfer     *fpi_usb_transfer_new (FpDevice *device);
 FpiUsbTransfer     *fpi_usb_transfer_ref (FpiUsbTransfer *self);
 void               fpi_usb_transfer_unref (FpiUsbTransfer *self);
 
+guint8            *fpi_usb_buffer_new (FpDevice *device,
+                                        gsize     length);
+void               fpi_usb_buffer_free (gpointer buffer);
+
 void               fpi_usb_transfer_set_short_error (FpiUsbTransfer *transfer,
                                                      gboolean        short_is_error);
 
@@ -153,7 +210,29 @@ gboolean           fpi_usb_transfer_submit_sync (FpiUsbTransfer *transfer,
                                                  guint           timeout_ms,
                                                  GError        **error);
 
+void               fpi_usb_transfer_submit_batch (FpiUsbTransfer            **transfers,
+                                                  guint                       n_transfers,
+                                                  guint                       timeout_ms,
+                                                  GCancellable               *cancellable,
+                                                  FpiUsbTransferBatchCallback callback,
+                                                  gpointer                    user_data);
+
+FpiUsbStream       *fpi_usb_stream_new (FpDevice *device,
+                                        guint8    endpoint,
+                                        gsize     transfer_length,
+                                        guint     n_transfers);
+void               fpi_usb_stream_free (FpiUsbStream *stream);
+
+void               fpi_usb_stream_start (FpiUsbStream               *stream,
+                                         guint                       timeout_ms,
+                                         GCancellable               *cancellable,
+                                         FpiUsbStreamCallback        callback,
+                                         FpiUsbStreamStoppedCallback stopped_callback,
+                                         gpointer                    user_data);
+void               fpi_usb_stream_stop (FpiUsbStream *stream);
+gboolean           fpi_usb_stream_is_running (FpiUsbStream *stream);
 
 G_DEFINE_AUTOPTR_CLEANUP_FUNC (FpiUsbTransfer, fpi_usb_transfer_unref)
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (FpiUsbStream, fpi_usb_stream_free)
 
 G_END_DECLS
@@ -0,0 +1,257 @@
+/*
+ * Offline extraction of NBIS prints from stored images
+ * Copyright (C) 2026 libfprint contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <config.h>
+
+#include <errno.h>
+#include <string.h>
+
+#include "fpi-image.h"
+#include "fpi-print.h"
+
+/* Number of images that are held in memory at the same time */
+#define EXTRACT_CHUNK_SIZE 256
+
+static gchar *driver = NULL;
+static gchar *device_id = NULL;
+static gchar *output_dir = NULL;
+static gint max_threads = 0;
+static gint max_minutiae = 0;
+static gchar **filenames = NULL;
+
+static const GOptionEntry entries[] = {
+  { "driver", 'd', 0, G_OPTION_ARG_STRING, &driver, "Driver the prints are created for", "DRIVER" },
+  { "device-id", 'i', 0, G_OPTION_ARG_STRING, &device_id, "Device ID the prints are created for", "ID" },
+  { "output-dir", 'o', 0, G_OPTION_ARG_FILENAME, &output_dir, "Directory to write the prints to", "DIR" },
+  { "max-minutiae", 'm', 0, G_OPTION_ARG_INT, &max_minutiae, "Only store the N minutiae with the highest quality", "N" },
+  { "threads", 'j', 0, G_OPTION_ARG_INT, &max_threads, "Number of worker threads (default: one per CPU)", "N" },
+  { G_OPTION_REMAINING, 0, 0, G_OPTION_ARG_FILENAME_ARRAY, &filenames, NULL, "IMAGE.pgm..." },
+  { NULL }
+};
+
+static const gchar *
+pgm_next_token (const gchar **pos, const gchar *end)
+{
+  const gchar *p = *pos;
+  const gchar *token;
+
+  while (p < end && (g_ascii_isspace (*p) || *p == '#'))
+    {
+      if (*p == '#')
+        while (p < end && *p != '\n')
+          p++;
+      else
+        p++;
+    }
+
+  token = p;
+  while (p < end && !g_ascii_isspace (*p))
+    p++;
+
+  *pos = p;
+  return token < end ? token : NULL;
+}
+
+static FpImage *
+load_pgm (const gchar *filename, GError **error)
+{
+  g_autofree gchar *contents = NULL;
+  const gchar *pos, *end, *token;
+  guint64 values[3];
+  FpImage *image;
+  gsize len;
+  gint i;
+
+  if (!g_file_get_contents (filename, &contents, &len, error))
+    return NULL;
+
+  pos = contents;
+  end = contents + len;
+
+  token = pgm_next_token (&pos, end);
+  if (!token || pos - token != 2 || strncmp (token, "P5", 2) != 0)
+    goto invalid;
+
+  for (i = 0; i < 3; i++)
+    {
+      g_autofree gchar *str = NULL;
+
+      token = pgm_next_token (&pos, end);
+      if (!token)
+        goto invalid;
+
+      str = g_strndup (token, pos - token);
+      if (!g_ascii_string_to_unsigned (str, 10, 1, G_MAXUINT16, &values[i], NULL))
+        goto invalid;
+    }
+
+  /* Only 8 bit greyscale, a single whitespace separates header and data */
+  if (values[2] != 255 || end - pos < 1 ||
+      (gsize) (end - pos - 1) < values[0] * values[1])
+    goto invalid;
+  pos++;
+
+  image = fp_image_new (values[0], values[1]);
+  memcpy (image->data, pos, values[0] * values[1]);
+
+  return image;
+
+invalid:
+  g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+               "%s is not an 8 bit binary PGM image", filename);
+  return NULL;
+}
+
+typedef struct
+{
+  GMainLoop *loop;
+  GError    *error;
+} ExtractData;
+
+static void
+on_minutiae_detected (GObject *source_object, GAsyncResult *res, gpointer user_data)
+{
+  ExtractData *extract_data = user_data;
+
+  fp_image_detect_minutiae_batch_finish (res, &extract_data->error);
+  g_main_loop_quit (extract_data->loop);
+}
+
+static gboolean
+save_print (FpImage *image, const gchar *filename, GError **error)
+{
+  g_autoptr(FpPrint) print = NULL;
+  g_autofree gchar *basename = NULL;
+  g_autofree gchar *print_name = NULL;
+  g_autofree gchar *print_path = NULL;
+  g_autofree guchar *data = NULL;
+  gsize len;
+
+  print = g_object_new (FP_TYPE_PRINT,
+                        "driver", driver,
+                        "device-id", device_id,
+                        NULL);
+  fpi_print_set_type (print, FPI_PRINT_NBIS);
+
+  if (!fpi_print_add_from_image (print, image, max_minutiae, error))
+    return FALSE;
+
+  if (!fp_print_serialize (print, &data, &len, error))
+    return FALSE;
+
+  basename = g_path_get_basename (filename);
+  if (g_str_has_suffix (basename, ".pgm"))
+    basename[strlen (basename) - 4] = '\0';
+  print_name = g_strconcat (basename, ".print", NULL);
+  print_path = g_build_filename (output_dir, print_name, NULL);
+
+  return g_file_set_contents (print_path, (gchar *) data, len, error);
+}
+
+int
+main (int argc, char **argv)
+{
+  g_autoptr(GOptionContext) context = NULL;
+  g_autoptr(GMainLoop) loop = NULL;
+  g_autoptr(GError) error = NULL;
+  guint n_files, n_failed = 0;
+  guint i, chunk;
+
+  context = g_option_context_new ("- create NBIS prints from stored images");
+  g_option_context_add_main_entries (context, entries, NULL);
+
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      return 1;
+    }
+
+  if (!driver || !device_id || !output_dir || !filenames || max_threads < 0 ||
+      max_minutiae < 0)
+    {
+      g_autofree gchar *help = g_option_context_get_help (context, TRUE, NULL);
+
+      g_printerr ("%s", help);
+      return 1;
+    }
+
+  if (g_mkdir_with_parents (output_dir, 0700) != 0)
+    {
+      g_printerr ("Could not create %s: %s\n", output_dir, g_strerror (errno));
+      return 1;
+    }
+
+  loop = g_main_loop_new (NULL, FALSE);
+  n_files = g_strv_length (filenames);
+
+  for (chunk = 0; chunk < n_files; chunk += EXTRACT_CHUNK_SIZE)
+    {
+      g_autoptr(GPtrArray) images = g_ptr_array_new_with_free_func (g_object_unref);
+      g_autoptr(GPtrArray) names = g_ptr_array_new ();
+      ExtractData extract_data = { loop, NULL };
+
+      for (i = chunk; i < MIN (chunk + EXTRACT_CHUNK_SIZE, n_files); i++)
+        {
+          g_autoptr(GError) load_error = NULL;
+          FpImage *image = load_pgm (filenames[i], &load_error);
+
+          if (!image)
+            {
+              g_printerr ("%s\n", load_error->message);
+              n_failed++;
+              continue;
+            }
+
+          fpi_image_set_minutiae_features (image,
+                                           max_minutiae > 0 ?
+                                           FPI_MINUTIAE_FEATURE_QUALITY :
+                                           FPI_MINUTIAE_FEATURE_NONE);
+          g_ptr_array_add (images, image);
+          g_ptr_array_add (names, filenames[i]);
+        }
+
+      fp_image_detect_minutiae_batch (images, max_threads, NULL,
+                                      on_minutiae_detected, &extract_data);
+      g_main_loop_run (loop);
+
+      if (extract_data.error)
+        {
+          g_printerr ("Extraction failed: %s\n", extract_data.error->message);
+          g_error_free (extract_data.error);
+          return 1;
+        }
+
+      for (i = 0; i < images->len; i++)
+        {
+          g_autoptr(GError) save_error = NULL;
+
+          if (!save_print (g_ptr_array_index (images, i),
+                           g_ptr_array_index (names, i), &save_error))
+            {
+              g_printerr ("%s: %s\n", (gchar *) g_ptr_array_index (names, i),
+                          save_error->message);
+              n_failed++;
+            }
+        }
+    }
+
+  g_print ("Created %u of %u prints\n", n_files - n_failed, n_files);
+
+  return n_failed > 0 ? 2 : 0;
+}
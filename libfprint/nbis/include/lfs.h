@@ -66,6 +66,7 @@ of the software.
 
 #include <math.h>
 #include <stdio.h>
+#include <stdint.h>
 #include <nbis-helpers.h>
 #include <fpi-minutiae.h>
 
@@ -107,6 +108,17 @@ of the software.
 /*        STRUCTURE DEFINITIONS                                          */
 /*************************************************************************/
 
+/* Floating point type of the DFT wave forms and power statistics used  */
+/* to derive block directions.  Building with LFS_DFT_FLOAT32 defined   */
+/* halves their memory footprint and doubles the number of values per  */
+/* SIMD register, at the cost of maps that may differ from NIST's       */
+/* double precision reference in blocks where two directions are close. */
+#ifdef LFS_DFT_FLOAT32
+typedef float dft_real;
+#else
+typedef double dft_real;
+#endif
+
 /* Lookup tables for converting from integer directions */
 /* to angles in radians.                                */
 typedef struct dir2rad{
@@ -118,8 +130,8 @@ typedef struct dir2rad{
 /* DFT wave form structure containing both cosine and   */
 /* sine components for a specific frequency.            */
 typedef struct dftwave{
-   double *cos;
-   double *sin;
+   dft_real *cos;
+   dft_real *sin;
 } DFTWAVE;
 
 /* DFT wave forms structure containing all wave forms  */
@@ -145,6 +157,27 @@ typedef struct rotgrids{
    int **grids;
 } ROTGRIDS;
 
+/* Lookup tables and the padded image buffer used by               */
+/* lfs_detect_minutiae_V2().  The same structure can be passed for */
+/* many images in turn; the tables are only rebuilt if the image   */
+/* width or the parameters they depend on change.                  */
+typedef struct lfstables{
+   int iw;
+   int maxpad;
+   int num_directions;
+   double start_dir_angle;
+   int num_dft_waves;
+   int windowsize;
+   int dirbin_grid_w;
+   int dirbin_grid_h;
+   DIR2RAD *dir2rad;
+   DFTWAVES *dftwaves;
+   ROTGRIDS *dftgrids;
+   ROTGRIDS *dirbingrids;
+   unsigned char *pdata;
+   int pdata_size;
+} LFSTABLES;
+
 /*************************************************************************/
 /* 10, 2X3 pixel pair feature patterns used to define ridge endings      */
 /* and bifurcations.                                                     */
@@ -158,6 +191,23 @@ typedef struct rotgrids{
 typedef struct fp_minutia MINUTIA;
 typedef struct fp_minutiae MINUTIAE;
 
+/* Bucket grid over minutia locations, so that neighbor queries do not */
+/* have to walk the whole minutiae list.  Each cell keeps its minutiae */
+/* in list order along with an insertion sequence number.             */
+typedef struct fp_minutiae_grid{
+   int cell_size;
+   int gw, gh;
+   int next_seq;
+   int *cell_num;
+   int *cell_alloc;
+   MINUTIA ***cell_list;
+   int **cell_seq;
+   /* Scratch buffers returned by get_minutiae_grid_nbrs(). */
+   int nbrs_alloc;
+   MINUTIA **nbrs;
+   int *nbr_seqs;
+} MINUTIAE_GRID;
+
 typedef struct feature_pattern{
    int type;
    int appearing;
@@ -266,6 +316,9 @@ typedef struct g_lfsparms{
    /* Ridge Counting Controls */
    int    max_nbrs;
    int    max_ridge_steps;
+
+   /* Optional Outputs */
+   int    outputs;
 } LFSPARMS;
 
 /*************************************************************************/
@@ -288,6 +341,9 @@ typedef struct g_lfsparms{
 #define WHITE_PIXEL            255
 #define BLACK_PIXEL              0
 
+/* Number of 64-bit words in a row of a bit-packed binary image. */
+#define PACKED_ROW_WORDS(iw)   (((iw) + 63) >> 6)
+
 /* Definitions for controlling join_miutia(). */
 /* Draw without opposite perimeter pixels.  */
 #define NO_BOUNDARY              0
@@ -624,6 +680,16 @@ typedef struct g_lfsparms{
 /* Maximum number of contour steps taken to validate a ridge crossing. */
 #define MAX_RIDGE_STEPS         10
 
+/***** OPTIONAL OUTPUT CONSTANTS *****/
+
+/* Results that are not needed to locate the minutiae.  Leaving a flag */
+/* out of lfsparms->outputs skips the corresponding stage: minutiae    */
+/* then have no neighbors, respectively keep the coarse reliability    */
+/* assigned during detection and no quality map is returned.          */
+#define LFS_OUTPUT_RIDGE_COUNTS  1
+#define LFS_OUTPUT_QUALITY       2
+#define LFS_OUTPUT_ALL           (LFS_OUTPUT_RIDGE_COUNTS | LFS_OUTPUT_QUALITY)
+
 /*************************************************************************/
 /*         QUALITY/RELIABILITY DEFINITIONS                               */
 /*************************************************************************/
@@ -730,6 +796,8 @@ extern int binarize_image_V2(unsigned char **, int *, int *,
                      const int *, const int, const int,
                      const int, const ROTGRIDS *);
 extern int dirbinarize(const unsigned char *, const int, const ROTGRIDS *);
+extern void dirbinarize_run(unsigned char *, const unsigned char *,
+                     const int, const int, const ROTGRIDS *);
 extern int isobinarize(unsigned char *, const int, const int, const int);
 
 /* block.c */
@@ -785,32 +853,35 @@ extern int lfs_detect_minutiae_V2(MINUTIAE **,
                      int **, int **, int **, int **, int *, int *,
                      unsigned char **, int *, int *,
                      unsigned char *, const int, const int,
-                     const LFSPARMS *);
+                     const LFSPARMS *, LFSTABLES *);
 
 /* dft.c */
-extern int dft_dir_powers(double **, unsigned char *, const int,
+extern int dft_dir_powers(dft_real **, unsigned char *, const int,
                      const int, const int, const DFTWAVES *,
                      const ROTGRIDS *);
 extern void sum_rot_block_rows(int *, const unsigned char *, const int *,
                      const int);
-extern void dft_power(double *, const int *, const DFTWAVE *, const int);
-extern int dft_power_stats(int *, double *, int *, double *, double **,
+extern void dft_power(dft_real *, const int *, const DFTWAVE *, const int);
+extern int dft_power_stats(int *, dft_real *, int *, dft_real *, dft_real **,
                      const int, const int, const int);
-extern void get_max_norm(double *, int *, double *, const double *, const int);
-extern int sort_dft_waves(int *, const double *, const double *, const int);
+extern void get_max_norm(dft_real *, int *, dft_real *, const dft_real *,
+                     const int);
+extern int sort_dft_waves(int *, const dft_real *, const dft_real *,
+                     const int);
 
 /* free.c */
 extern void free_dir2rad(DIR2RAD *);
 extern void free_dftwaves(DFTWAVES *);
 extern void free_rotgrids(ROTGRIDS *);
-extern void free_dir_powers(double **, const int);
+extern void free_lfstables(LFSTABLES *);
+extern void free_dir_powers(dft_real **, const int);
 
 /* getmin.c */
 extern int get_minutiae(MINUTIAE **, int **, int **, int **,
                  int **, int **, int *, int *,
                  unsigned char **, int *, int *, int *,
                  unsigned char *, const int, const int,
-                 const int, const double, const LFSPARMS *);
+                 const int, const double, const LFSPARMS *, LFSTABLES *);
 
 /* imgutil.c */
 extern void bits_6to8(unsigned char *, const int, const int);
@@ -820,7 +891,16 @@ extern void gray2bin(const int, const int, const int,
 extern int pad_uchar_image(unsigned char **, int *, int *,
                      unsigned char *, const int, const int, const int,
                      const int);
+extern void fill_padded_uchar_image(unsigned char *, unsigned char *,
+                     const int, const int, const int, const int);
 extern void fill_holes(unsigned char *, const int, const int);
+extern void pack_binary_image(uint64_t *, const unsigned char *,
+                     const int, const int);
+extern void pack_binary_columns(uint64_t *, const unsigned char *,
+                     const int, const int);
+extern void unpack_binary_image(unsigned char *, const uint64_t *,
+                     const int, const int);
+extern void fill_holes_packed(uint64_t *, const int, const int);
 extern int free_path(const int, const int, const int, const int,
                      unsigned char *, const int, const int, const LFSPARMS *);
 extern int search_in_direction(int *, int *, int *, int *, const int,
@@ -834,8 +914,12 @@ extern int get_max_padding(const int, const int, const int, const int);
 extern int get_max_padding_V2(const int, const int, const int, const int);
 extern int init_rotgrids(ROTGRIDS **, const int, const int, const int,
                      const double, const int, const int, const int, const int);
-extern int alloc_dir_powers(double ***, const int, const int);
-extern int alloc_power_stats(int **, double **, int **, double **, const int);
+extern int alloc_dir_powers(dft_real ***, const int, const int);
+extern int alloc_power_stats(int **, dft_real **, int **, dft_real **,
+                     const int);
+extern int alloc_lfstables(LFSTABLES **);
+extern int init_lfstables(LFSTABLES *, const int, const int,
+                     const LFSPARMS *);
 
 /* isempty.c */
 extern int is_image_empty(int *, const int, const int);
@@ -874,6 +958,7 @@ extern int on_loop(const MINUTIA *, const int, unsigned char *, const int,
 extern int on_island_lake(int **, int **, int **, int **, int *,
                      const MINUTIA *, const MINUTIA *, const int,
                      unsigned char *, const int, const int);
+extern int label_components(int **, unsigned char *, const int, const int);
 extern int on_hook(const MINUTIA *, const MINUTIA *, const int,
                      unsigned char *, const int, const int);
 extern int is_loop_clockwise(const int *, const int *, const int, const int);
@@ -920,11 +1005,11 @@ extern int gen_imap(int **, int *, int *,
 extern int gen_initial_imap(int **, int *, const int, const int,
                      unsigned char *, const int, const int,
                      const DFTWAVES *, const ROTGRIDS *, const LFSPARMS *);
-extern int primary_dir_test(double **, const int *, const double *,
-                     const int *, const double *, const int,
+extern int primary_dir_test(dft_real **, const int *, const dft_real *,
+                     const int *, const dft_real *, const int,
                      const LFSPARMS *);
-extern int secondary_fork_test(double **, const int *, const double *,
-                     const int *, const double *, const int,
+extern int secondary_fork_test(dft_real **, const int *, const dft_real *,
+                     const int *, const dft_real *, const int,
                      const LFSPARMS *);
 extern void remove_incon_dirs(int *, const int, const int,
                      const DIR2RAD *, const LFSPARMS *);
@@ -991,6 +1076,14 @@ extern int create_minutia(MINUTIA **, const int, const int,
 extern void free_minutiae(MINUTIAE *);
 extern void free_minutia(MINUTIA *);
 extern int remove_minutia(const int, MINUTIAE *);
+extern int remove_flagged_minutiae(MINUTIAE *, const int *);
+extern int alloc_minutiae_grid(MINUTIAE_GRID **, const MINUTIAE *,
+                     const int, const int, const int);
+extern void free_minutiae_grid(MINUTIAE_GRID *);
+extern void add_minutia_to_grid(MINUTIAE_GRID *, MINUTIA *);
+extern void remove_minutia_from_grid(MINUTIAE_GRID *, const MINUTIA *);
+extern int get_minutiae_grid_nbrs(MINUTIA ***, int **, int *, MINUTIAE_GRID *,
+                     const int, const int, const int);
 extern int join_minutia(const MINUTIA *, const MINUTIA *, unsigned char *,
                      const int, const int, const int, const int);
 extern int minutia_type(const int);
@@ -1189,7 +1282,7 @@ extern void sort_row_on_x(ROW *);
 /* sort.c */
 extern int sort_indices_int_inc(int **, int *, const int);
 extern int sort_indices_double_inc(int **, double *, const int);
-extern void bubble_sort_int_inc_2(int *, int *, const int);
+extern void merge_sort_int_inc_2(int *, int *, const int);
 extern void bubble_sort_double_inc_2(double *, int *, const int);
 extern void bubble_sort_double_dec_2(double *, int *,  const int);
 extern void bubble_sort_int_inc(int *, const int);
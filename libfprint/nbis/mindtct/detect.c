@@ -111,6 +111,7 @@ of the software.
       iw        - width (in pixels) of the image
       ih        - height (in pixels) of the image
       lfsparms  - parameters and thresholds for controlling LFS
+      tables    - lookup tables to reuse from previous images, or NULL
 
    Output:
       ominutiae - resulting list of minutiae
@@ -137,14 +138,11 @@ int lfs_detect_minutiae_V2(MINUTIAE **ominutiae,
                         int *omw, int *omh,
                         unsigned char **obdata, int *obw, int *obh,
                         unsigned char *idata, const int iw, const int ih,
-                        const LFSPARMS *lfsparms)
+                        const LFSPARMS *lfsparms, LFSTABLES *tables)
 {
    unsigned char *pdata, *bdata;
    int pw, ph, bw, bh;
-   DIR2RAD *dir2rad;
-   DFTWAVES *dftwaves;
-   ROTGRIDS *dftgrids;
-   ROTGRIDS *dirbingrids;
+   LFSTABLES *local_tables = (LFSTABLES *)NULL;
    int *direction_map, *low_contrast_map, *low_flow_map, *high_curve_map;
    int mw, mh;
    int ret, maxpad;
@@ -161,57 +159,27 @@ int lfs_detect_minutiae_V2(MINUTIAE **ominutiae,
       /* If system error, exit with error code. */
       return(ret);
 
-   /* Determine the maximum amount of image padding required to support */
-   /* LFS processes.                                                    */
-   maxpad = get_max_padding_V2(lfsparms->windowsize, lfsparms->windowoffset,
-                          lfsparms->dirbin_grid_w, lfsparms->dirbin_grid_h);
-
-   /* Initialize lookup table for converting integer directions */
-   /* to angles in radians.                                     */
-   if((ret = init_dir2rad(&dir2rad, lfsparms->num_directions))){
-      /* Free memory allocated to this point. */
-      return(ret);
-   }
-
-   /* Initialize wave form lookup tables for DFT analyses. */
-   /* used for direction binarization.                             */
-   if((ret = init_dftwaves(&dftwaves, g_dft_coefs, lfsparms->num_dft_waves,
-                        lfsparms->windowsize))){
-      /* Free memory allocated to this point. */
-      free_dir2rad(dir2rad);
-      return(ret);
+   /* Without tables from the caller, build them for this image only. */
+   if(tables == (LFSTABLES *)NULL){
+      if((ret = alloc_lfstables(&local_tables)))
+         return(ret);
+      tables = local_tables;
    }
 
-   /* Initialize lookup table for pixel offsets to rotated grids */
-   /* used for DFT analyses.                                     */
-   if((ret = init_rotgrids(&dftgrids, iw, ih, maxpad,
-                        lfsparms->start_dir_angle, lfsparms->num_directions,
-                        lfsparms->windowsize, lfsparms->windowsize,
-                        RELATIVE2ORIGIN))){
+   /* Initialize the lookup tables for the directions, the DFT wave */
+   /* forms and the rotated grids, unless they can be reused.       */
+   if((ret = init_lfstables(tables, iw, ih, lfsparms))){
       /* Free memory allocated to this point. */
-      free_dir2rad(dir2rad);
-      free_dftwaves(dftwaves);
+      free_lfstables(local_tables);
       return(ret);
    }
 
    /* Pad input image based on max padding. */
-   if(maxpad > 0){   /* May not need to pad at all */
-      if((ret = pad_uchar_image(&pdata, &pw, &ph, idata, iw, ih,
-                             maxpad, lfsparms->pad_value))){
-         /* Free memory allocated to this point. */
-         free_dir2rad(dir2rad);
-         free_dftwaves(dftwaves);
-         free_rotgrids(dftgrids);
-         return(ret);
-      }
-   }
-   else{
-      /* If padding is unnecessary, then copy the input image. */
-      pdata = (unsigned char *)g_malloc(iw * ih);
-      memcpy(pdata, idata, iw*ih);
-      pw = iw;
-      ph = ih;
-   }
+   maxpad = tables->maxpad;
+   pdata = tables->pdata;
+   pw = iw + (maxpad<<1);
+   ph = ih + (maxpad<<1);
+   fill_padded_uchar_image(pdata, idata, iw, ih, maxpad, lfsparms->pad_value);
 
    /* Scale input image to 6 bits [0..63] */
    /* !!! Would like to remove this dependency eventualy !!!     */
@@ -231,18 +199,12 @@ int lfs_detect_minutiae_V2(MINUTIAE **ominutiae,
    /* Generate block maps from the input image. */
    if((ret = gen_image_maps(&direction_map, &low_contrast_map,
                     &low_flow_map, &high_curve_map, &mw, &mh,
-                    pdata, pw, ph, dir2rad, dftwaves, dftgrids, lfsparms))){
+                    pdata, pw, ph, tables->dir2rad, tables->dftwaves,
+                    tables->dftgrids, lfsparms))){
       /* Free memory allocated to this point. */
-      free_dir2rad(dir2rad);
-      free_dftwaves(dftwaves);
-      free_rotgrids(dftgrids);
-      g_free(pdata);
+      free_lfstables(local_tables);
       return(ret);
    }
-   /* Deallocate working memories. */
-   free_dir2rad(dir2rad);
-   free_dftwaves(dftwaves);
-   free_rotgrids(dftgrids);
 
    print2log("\nMAPS DONE\n");
 
@@ -253,43 +215,24 @@ int lfs_detect_minutiae_V2(MINUTIAE **ominutiae,
    /******************/
    set_timer(bin_timer);
 
-   /* Initialize lookup table for pixel offsets to rotated grids */
-   /* used for directional binarization.                         */
-   if((ret = init_rotgrids(&dirbingrids, iw, ih, maxpad,
-                        lfsparms->start_dir_angle, lfsparms->num_directions,
-                        lfsparms->dirbin_grid_w, lfsparms->dirbin_grid_h,
-                        RELATIVE2CENTER))){
-      /* Free memory allocated to this point. */
-      g_free(pdata);
-      g_free(direction_map);
-      g_free(low_contrast_map);
-      g_free(low_flow_map);
-      g_free(high_curve_map);
-      return(ret);
-   }
-
    /* Binarize input image based on NMAP information. */
    if((ret = binarize_V2(&bdata, &bw, &bh,
                       pdata, pw, ph, direction_map, mw, mh,
-                      dirbingrids, lfsparms))){
+                      tables->dirbingrids, lfsparms))){
       /* Free memory allocated to this point. */
-      g_free(pdata);
+      free_lfstables(local_tables);
       g_free(direction_map);
       g_free(low_contrast_map);
       g_free(low_flow_map);
       g_free(high_curve_map);
-      free_rotgrids(dirbingrids);
       return(ret);
    }
 
-   /* Deallocate working memory. */
-   free_rotgrids(dirbingrids);
-
    /* Check dimension of binary image.  If they are different from */
    /* the input image, then ERROR.                                 */
    if((iw != bw) || (ih != bh)){
       /* Free memory allocated to this point. */
-      g_free(pdata);
+      free_lfstables(local_tables);
       g_free(direction_map);
       g_free(low_contrast_map);
       g_free(low_flow_map);
@@ -324,7 +267,7 @@ int lfs_detect_minutiae_V2(MINUTIAE **ominutiae,
                              direction_map, low_flow_map, high_curve_map,
                              mw, mh, lfsparms))){
       /* Free memory allocated to this point. */
-      g_free(pdata);
+      free_lfstables(local_tables);
       g_free(direction_map);
       g_free(low_contrast_map);
       g_free(low_flow_map);
@@ -341,7 +284,7 @@ int lfs_detect_minutiae_V2(MINUTIAE **ominutiae,
                        direction_map, low_flow_map, high_curve_map, mw, mh,
                        lfsparms))){
       /* Free memory allocated to this point. */
-      g_free(pdata);
+      free_lfstables(local_tables);
       g_free(direction_map);
       g_free(low_contrast_map);
       g_free(low_flow_map);
@@ -360,9 +303,16 @@ int lfs_detect_minutiae_V2(MINUTIAE **ominutiae,
    /******************/
    set_timer(ridge_count_timer);
 
-   if((ret = count_minutiae_ridges(minutiae, bdata, iw, ih, lfsparms))){
+   if(lfsparms->outputs & LFS_OUTPUT_RIDGE_COUNTS)
+      ret = count_minutiae_ridges(minutiae, bdata, iw, ih, lfsparms);
+   /* Without ridge counts, still sort and remove duplicates the same */
+   /* way count_minutiae_ridges() does.                               */
+   else if((ret = sort_minutiae_x_y(minutiae, iw, ih)) == 0)
+      ret = rm_dup_minutiae(minutiae);
+
+   if(ret){
       /* Free memory allocated to this point. */
-      g_free(pdata);
+      free_lfstables(local_tables);
       g_free(direction_map);
       g_free(low_contrast_map);
       g_free(low_flow_map);
@@ -385,7 +335,7 @@ int lfs_detect_minutiae_V2(MINUTIAE **ominutiae,
    gray2bin(1, 255, 0, bdata, iw, ih);
 
    /* Deallocate working memory. */
-   g_free(pdata);
+   free_lfstables(local_tables);
 
    /* Assign results to output pointers. */
    *odmap = direction_map;
@@ -99,7 +99,7 @@ of the software.
       Zero     - successful completion
       Negative - system error
 **************************************************************************/
-int dft_dir_powers(double **powers, unsigned char *pdata,
+int dft_dir_powers(dft_real **powers, unsigned char *pdata,
                const int blkoffset, const int pw, const int ph,
                const DFTWAVES *dftwaves, const ROTGRIDS *dftgrids)
 {
@@ -192,11 +192,11 @@ void sum_rot_block_rows(int *rowsums, const unsigned char *blkptr,
       power   - the computed DFT power for the given wave form at the
                 given orientation within the image block
 **************************************************************************/
-void dft_power(double *power, const int *rowsums,
+void dft_power(dft_real *power, const int *rowsums,
                const DFTWAVE *wave, const int wavelen)
 {
    int i;
-   double cospart, sinpart;
+   dft_real cospart, sinpart;
 
    /* Initialize accumulators */
    cospart = 0.0;
@@ -251,8 +251,8 @@ void dft_power(double *power, const int *rowsums,
       Zero     - successful completion
       Negative - system error
 **************************************************************************/
-int dft_power_stats(int *wis, double *powmaxs, int *powmax_dirs,
-                     double *pownorms, double **powers,
+int dft_power_stats(int *wis, dft_real *powmaxs, int *powmax_dirs,
+                     dft_real *pownorms, dft_real **powers,
                      const int fw, const int tw, const int ndirs)
 {
    int w, i;
@@ -291,13 +291,13 @@ int dft_power_stats(int *wis, double *powmaxs, int *powmax_dirs,
       powmax_dir - the direciton at which the maximum power value occured
       pownorm    - the normalized power corresponding to the maximum power
 **************************************************************************/
-void get_max_norm(double *powmax, int *powmax_dir,
-               double *pownorm, const double *power_vector, const int ndirs)
+void get_max_norm(dft_real *powmax, int *powmax_dir,
+               dft_real *pownorm, const dft_real *power_vector, const int ndirs)
 {
    int dir;
-   double max_v, powsum;
+   dft_real max_v, powsum;
    int max_i;
-   double powmean;
+   dft_real powmean;
 
    /* Find max power value and store corresponding direction */
    max_v = power_vector[0];
@@ -320,7 +320,7 @@ void get_max_norm(double *powmax, int *powmax_dir,
 
    /* Powmean is used as denominator for pownorm, so setting  */
    /* a non-zero minimum avoids possible division by zero.    */
-   powmean = max(powsum, MIN_POWER_SUM)/(double)ndirs;
+   powmean = max(powsum, MIN_POWER_SUM)/(dft_real)ndirs;
 
    *pownorm = *powmax / powmean;
 }
@@ -344,7 +344,7 @@ void get_max_norm(double *powmax, int *powmax_dir,
       Zero     - successful completion
       Negative - system error
 **************************************************************************/
-int sort_dft_waves(int *wis, const double *powmaxs, const double *pownorms,
+int sort_dft_waves(int *wis, const dft_real *powmaxs, const dft_real *pownorms,
                    const int nstats)
 {
    int i;
@@ -58,6 +58,7 @@ of the software.
                         free_dftwaves()
                         free_rotgrids()
                         free_dir_powers()
+                        free_lfstables()
 ***********************************************************************/
 
 #include <stdio.h>
@@ -116,6 +117,31 @@ void free_rotgrids(ROTGRIDS *rotgrids)
    g_free(rotgrids);
 }
 
+/*************************************************************************
+**************************************************************************
+#cat: free_lfstables - Deallocates the memory associated with a LFSTABLES
+#cat:                 structure, including the tables it holds
+
+   Input:
+      tables - pointer to memory to be freed, may be NULL
+**************************************************************************/
+void free_lfstables(LFSTABLES *tables)
+{
+   if(tables == (LFSTABLES *)NULL)
+      return;
+
+   if(tables->dir2rad != (DIR2RAD *)NULL)
+      free_dir2rad(tables->dir2rad);
+   if(tables->dftwaves != (DFTWAVES *)NULL)
+      free_dftwaves(tables->dftwaves);
+   if(tables->dftgrids != (ROTGRIDS *)NULL)
+      free_rotgrids(tables->dftgrids);
+   if(tables->dirbingrids != (ROTGRIDS *)NULL)
+      free_rotgrids(tables->dirbingrids);
+   g_free(tables->pdata);
+   g_free(tables);
+}
+
 /*************************************************************************
 **************************************************************************
 #cat: free_dir_powers - Deallocate memory associated with DFT power vectors
@@ -124,7 +150,7 @@ void free_rotgrids(ROTGRIDS *rotgrids)
       powers - vectors of DFT power values (N Waves X M Directions)
       nwaves - number of DFT wave forms used
 **************************************************************************/
-void free_dir_powers(double **powers, const int nwaves)
+void free_dir_powers(dft_real **powers, const int nwaves)
 {
    int w;
 
@@ -78,6 +78,7 @@ of the software.
       id       - pixel depth (in bits) of the grayscale image
       ppmm     - the scan resolution (in pixels/mm) of the grayscale image
       lfsparms - parameters and thresholds for controlling LFS
+      tables   - lookup tables to reuse from previous images, or NULL
    Output:
       ominutiae         - points to a structure containing the
                           detected minutiae
@@ -102,7 +103,8 @@ int get_minutiae(MINUTIAE **ominutiae, int **oquality_map,
                  int *omap_w, int *omap_h,
                  unsigned char **obdata, int *obw, int *obh, int *obd,
                  unsigned char *idata, const int iw, const int ih,
-                 const int id, const double ppmm, const LFSPARMS *lfsparms)
+                 const int id, const double ppmm, const LFSPARMS *lfsparms,
+                 LFSTABLES *tables)
 {
    int ret;
    MINUTIAE *minutiae;
@@ -125,12 +127,16 @@ int get_minutiae(MINUTIAE **ominutiae, int **oquality_map,
                                    &low_flow_map, &high_curve_map,
                                    &map_w, &map_h,
                                    &bdata, &bw, &bh,
-                                   idata, iw, ih, lfsparms))){
+                                   idata, iw, ih, lfsparms, tables))){
       return(ret);
    }
 
+   /* Quality is optional, leave the detected reliabilities otherwise. */
+   if(!(lfsparms->outputs & LFS_OUTPUT_QUALITY)){
+      quality_map = (int *)NULL;
+   }
    /* Build integrated quality map. */
-   if((ret = gen_quality_map(&quality_map,
+   else if((ret = gen_quality_map(&quality_map,
                             direction_map, low_contrast_map,
                             low_flow_map, high_curve_map, map_w, map_h))){
       free_minutiae(minutiae);
@@ -143,7 +149,8 @@ int get_minutiae(MINUTIAE **ominutiae, int **oquality_map,
    }
 
    /* Assign reliability from quality map. */
-   if((ret = combined_minutia_quality(minutiae, quality_map, map_w, map_h,
+   if(quality_map &&
+      (ret = combined_minutia_quality(minutiae, quality_map, map_w, map_h,
                                      lfsparms->blocksize,
                                      idata, iw, ih, id, ppmm))){
       free_minutiae(minutiae);
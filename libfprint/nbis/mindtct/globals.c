@@ -155,7 +155,10 @@ LFSPARMS g_lfsparms = {
 
    /* Ridge Counting Controls */
    MAX_NBRS,
-   MAX_RIDGE_STEPS
+   MAX_RIDGE_STEPS,
+
+   /* Optional Outputs */
+   LFS_OUTPUT_ALL
 };
 
 
@@ -241,7 +244,10 @@ LFSPARMS g_lfsparms_V2 = {
 
    /* Ridge Counting Controls */
    MAX_NBRS,
-   MAX_RIDGE_STEPS
+   MAX_RIDGE_STEPS,
+
+   /* Optional Outputs */
+   LFS_OUTPUT_ALL
 };
 
 /* Variables for conducting 8-connected neighbor analyses. */
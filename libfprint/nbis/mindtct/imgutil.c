@@ -59,7 +59,12 @@ of the software.
                         bits_8to6()
                         gray2bin()
                         pad_uchar_image()
+                        fill_padded_uchar_image()
                         fill_holes()
+                        pack_binary_image()
+                        pack_binary_columns()
+                        unpack_binary_image()
+                        fill_holes_packed()
                         free_path()
                         search_in_direction()
 
@@ -178,8 +183,8 @@ int pad_uchar_image(unsigned char **optr, int *ow, int *oh,
                     unsigned char *idata, const int iw, const int ih,
                     const int pad, const int pad_value)
 {
-   unsigned char *pdata, *pptr, *iptr;
-   int i, pw, ph;
+   unsigned char *pdata;
+   int pw, ph;
    int pad2, psize;
 
    /* Account for pad on both sides of image */
@@ -193,8 +198,41 @@ int pad_uchar_image(unsigned char **optr, int *ow, int *oh,
    /* Allocate padded image */
    pdata = (unsigned char *)g_malloc(psize * sizeof(unsigned char));
 
+   fill_padded_uchar_image(pdata, idata, iw, ih, pad, pad_value);
+
+   *optr = pdata;
+   *ow = pw;
+   *oh = ph;
+   return(0);
+}
+
+/*************************************************************************
+**************************************************************************
+#cat: fill_padded_uchar_image - Same as pad_uchar_image(), but writes the
+#cat:                   padded image into a buffer provided by the caller,
+#cat:                   which must hold (iw+(2*pad)) X (ih+(2*pad)) pixels.
+
+   Input:
+      idata     - input 8-bit grayscale image
+      iw        - width (in pixels) of the input image
+      ih        - height (in pixels) of the input image
+      pad       - size of padding (in pixels) to be added
+      pad_value - intensity of the padded area
+   Output:
+      pdata     - the padded image
+**************************************************************************/
+void fill_padded_uchar_image(unsigned char *pdata, unsigned char *idata,
+                    const int iw, const int ih,
+                    const int pad, const int pad_value)
+{
+   unsigned char *pptr, *iptr;
+   int i, pw, ph;
+
+   pw = iw + (pad<<1);
+   ph = ih + (pad<<1);
+
    /* Initialize values to a constant PAD value */
-   memset(pdata, pad_value, psize);
+   memset(pdata, pad_value, pw * ph);
 
    /* Copy input image into padded image one scanline at a time */
    iptr = idata;
@@ -204,11 +242,6 @@ int pad_uchar_image(unsigned char **optr, int *ow, int *oh,
       iptr += iw;
       pptr += pw;
    }
-
-   *optr = pdata;
-   *ow = pw;
-   *oh = ph;
-   return(0);
 }
 
 /*************************************************************************
@@ -301,6 +334,166 @@ void fill_holes(unsigned char *bdata, const int iw, const int ih)
    }
 }
 
+/*************************************************************************
+**************************************************************************
+#cat: pack_binary_image - Packs a binary image into rows of 64-bit words
+#cat:              holding one pixel per bit.  Pixel x of a row is stored
+#cat:              in bit (x % 64) of word (x / 64) and is set if the pixel
+#cat:              is non-zero.  Unused bits at the end of a row are zero.
+
+   Input:
+      bdata - binary image data to be packed
+      iw    - width (in pixels) of the binary input image
+      ih    - height (in pixels) of the binary input image
+   Output:
+      packed - PACKED_ROW_WORDS(iw) * ih words of packed image data
+**************************************************************************/
+void pack_binary_image(uint64_t *packed, const unsigned char *bdata,
+                       const int iw, const int ih)
+{
+   int ix, iy, pw;
+   uint64_t *pptr;
+
+   pw = PACKED_ROW_WORDS(iw);
+   memset(packed, 0, pw * ih * sizeof(uint64_t));
+
+   for(iy = 0; iy < ih; iy++){
+      pptr = packed + (iy * pw);
+      for(ix = 0; ix < iw; ix++)
+         pptr[ix >> 6] |= (uint64_t)(bdata[ix] != 0) << (ix & 63);
+      bdata += iw;
+   }
+}
+
+/*************************************************************************
+**************************************************************************
+#cat: pack_binary_columns - Same as pack_binary_image(), but packs the
+#cat:              columns of the image, so that pixel y of column x is
+#cat:              stored in bit (y % 64) of word
+#cat:              (x * PACKED_ROW_WORDS(ih) + y / 64).
+
+   Input:
+      bdata - binary image data to be packed
+      iw    - width (in pixels) of the binary input image
+      ih    - height (in pixels) of the binary input image
+   Output:
+      packed - PACKED_ROW_WORDS(ih) * iw words of packed image data
+**************************************************************************/
+void pack_binary_columns(uint64_t *packed, const unsigned char *bdata,
+                         const int iw, const int ih)
+{
+   int ix, iy, ph;
+   uint64_t *pptr;
+
+   ph = PACKED_ROW_WORDS(ih);
+   memset(packed, 0, ph * iw * sizeof(uint64_t));
+
+   for(iy = 0; iy < ih; iy++){
+      pptr = packed + (iy >> 6);
+      for(ix = 0; ix < iw; ix++)
+         pptr[ix * ph] |= (uint64_t)(bdata[ix] != 0) << (iy & 63);
+      bdata += iw;
+   }
+}
+
+/*************************************************************************
+**************************************************************************
+#cat: unpack_binary_image - Expands a bit-packed binary image created by
+#cat:              pack_binary_image() into one byte per pixel, using
+#cat:              WHITE_PIXEL for set and BLACK_PIXEL for unset bits.
+
+   Input:
+      packed - bit-packed binary image data
+      iw     - width (in pixels) of the binary image
+      ih     - height (in pixels) of the binary image
+   Output:
+      bdata  - iw * ih bytes of binary image data
+**************************************************************************/
+void unpack_binary_image(unsigned char *bdata, const uint64_t *packed,
+                         const int iw, const int ih)
+{
+   int ix, iy, pw;
+   const uint64_t *pptr;
+
+   pw = PACKED_ROW_WORDS(iw);
+
+   for(iy = 0; iy < ih; iy++){
+      pptr = packed + (iy * pw);
+      for(ix = 0; ix < iw; ix++)
+         bdata[ix] = (pptr[ix >> 6] >> (ix & 63)) & 1 ? WHITE_PIXEL : BLACK_PIXEL;
+      bdata += iw;
+   }
+}
+
+/*************************************************************************
+**************************************************************************
+#cat: fill_holes_packed - Same as fill_holes(), but operates on an image
+#cat:              packed by pack_binary_image(), handling 64 pixels at
+#cat:              once.  The results are identical to fill_holes().
+
+   Input:
+      packed - bit-packed binary image data to be processed
+      iw     - width (in pixels) of the binary input image
+      ih     - height (in pixels) of the binary input image
+   Output:
+      packed - points to the results
+**************************************************************************/
+void fill_holes_packed(uint64_t *packed, const int iw, const int ih)
+{
+   int i, iy, pw, last;
+   uint64_t *row, *tptr, *mptr, *bptr;
+   uint64_t lft, rgt, valid, holes, fill, prev;
+
+   pw = PACKED_ROW_WORDS(iw);
+   last = (iw - 1) >> 6;
+
+   /* 1. Fill 1-pixel wide holes in horizontal runs first ... */
+   for(iy = 0; iy < ih; iy++){
+      row = packed + (iy * pw);
+      for(i = 0; i < pw; i++){
+         /* Left and right neighbors of each pixel in the word.  The */
+         /* left neighbor of the first bit has already been filled.  */
+         lft = row[i] << 1;
+         if(i > 0)
+            lft |= row[i-1] >> 63;
+         rgt = row[i] >> 1;
+         if(i < pw - 1)
+            rgt |= row[i+1] << 63;
+
+         /* The far left and right pixels are never holes. */
+         valid = ~(uint64_t)0;
+         if(i == 0)
+            valid &= ~(uint64_t)1;
+         if(i == last)
+            valid &= ((uint64_t)1 << ((iw - 1) & 63)) - 1;
+
+         holes = (lft ^ row[i]) & ~(lft ^ rgt) & valid;
+
+         /* A pixel right of a filled hole is not a hole anymore, so   */
+         /* in a run of holes only every other one is filled, starting */
+         /* from the left.  Iterate until the run lengths are resolved.*/
+         fill = holes;
+         do{
+            prev = fill;
+            fill = holes & ~(fill << 1);
+         }while(fill != prev);
+
+         row[i] ^= fill;
+      }
+   }
+
+   /* 2. Now, fill 1-pixel wide holes in vertical runs ... */
+   /* As the row above has been processed already, a pixel below */
+   /* a filled hole cannot be a hole itself.                     */
+   for(iy = 1; iy < ih - 1; iy++){
+      tptr = packed + ((iy - 1) * pw);
+      mptr = tptr + pw;
+      bptr = mptr + pw;
+      for(i = 0; i < pw; i++)
+         mptr[i] ^= (tptr[i] ^ mptr[i]) & ~(tptr[i] ^ bptr[i]);
+   }
+}
+
 /*************************************************************************
 **************************************************************************
 #cat: free_path - Traverses a straight line between 2 pixel points in an
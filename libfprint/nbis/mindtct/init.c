@@ -63,6 +63,8 @@ of the software.
                         init_rotgrids()
                         alloc_dir_powers()
                         alloc_power_stats()
+                        alloc_lfstables()
+                        init_lfstables()
 ***********************************************************************/
 
 #include <stdio.h>
@@ -146,7 +148,7 @@ int init_dftwaves(DFTWAVES **optr, const double *dft_coefs,
    DFTWAVES *dftwaves;
    int i, j;
    double pi_factor, freq, x;
-   double *cptr, *sptr;
+   dft_real *cptr, *sptr;
 
    /* Allocate structure */
    dftwaves = (DFTWAVES *)g_malloc(sizeof(DFTWAVES));
@@ -175,9 +177,9 @@ int init_dftwaves(DFTWAVES **optr, const double *dft_coefs,
       /* Allocate wave structure */
       dftwaves->waves[i] = (DFTWAVE *)g_malloc(sizeof(DFTWAVE));
       /* Allocate cosine vector */
-      dftwaves->waves[i]->cos = (double *)g_malloc(blocksize * sizeof(double));
+      dftwaves->waves[i]->cos = (dft_real *)g_malloc(blocksize * sizeof(dft_real));
       /* Allocate sine vector */
-      dftwaves->waves[i]->sin = (double *)g_malloc(blocksize * sizeof(double));
+      dftwaves->waves[i]->sin = (dft_real *)g_malloc(blocksize * sizeof(dft_real));
 
       /* Assign pointer nicknames */
       cptr = dftwaves->waves[i]->cos;
@@ -546,17 +548,17 @@ int init_rotgrids(ROTGRIDS **optr, const int iw, const int ih, const int ipad,
       Zero     - successful completion
       Negative - system error
 **************************************************************************/
-int alloc_dir_powers(double ***opowers, const int nwaves, const int ndirs)
+int alloc_dir_powers(dft_real ***opowers, const int nwaves, const int ndirs)
 {
    int w;
-   double **powers;
+   dft_real **powers;
 
    /* Allocate list of double pointers to hold power vectors */
-   powers = (double **)g_malloc(nwaves * sizeof(double *));
+   powers = (dft_real **)g_malloc(nwaves * sizeof(dft_real *));
    /* Foreach DFT wave ... */
    for(w = 0; w < nwaves; w++){
       /* Allocate power vector for all directions */
-      powers[w] = (double *)g_malloc(ndirs * sizeof(double));
+      powers[w] = (dft_real *)g_malloc(ndirs * sizeof(dft_real));
    }
 
    *opowers = powers;
@@ -591,11 +593,11 @@ int alloc_dir_powers(double ***opowers, const int nwaves, const int ndirs)
       Zero     - successful completion
       Negative - system error
 **************************************************************************/
-int alloc_power_stats(int **owis, double **opowmaxs, int **opowmax_dirs,
-                      double **opownorms, const int nstats)
+int alloc_power_stats(int **owis, dft_real **opowmaxs, int **opowmax_dirs,
+                      dft_real **opownorms, const int nstats)
 {
    int *wis, *powmax_dirs;
-   double *powmaxs, *pownorms;
+   dft_real *powmaxs, *pownorms;
 
    ASSERT_SIZE_MUL(nstats, sizeof(int));
    ASSERT_SIZE_MUL(nstats, sizeof(double));
@@ -604,13 +606,13 @@ int alloc_power_stats(int **owis, double **opowmaxs, int **opowmax_dirs,
    wis = (int *)g_malloc(nstats * sizeof(int));
 
    /* Allocate max power vector */
-   powmaxs = (double *)g_malloc(nstats * sizeof(double));
+   powmaxs = (dft_real *)g_malloc(nstats * sizeof(dft_real));
 
    /* Allocate max power direction vector */
    powmax_dirs = (int *)g_malloc(nstats * sizeof(int));
 
    /* Allocate normalized power vector */
-   pownorms = (double *)g_malloc(nstats * sizeof(double));
+   pownorms = (dft_real *)g_malloc(nstats * sizeof(dft_real));
 
    *owis = wis;
    *opowmaxs = powmaxs;
@@ -619,5 +621,131 @@ int alloc_power_stats(int **owis, double **opowmaxs, int **opowmax_dirs,
    return(0);
 }
 
+/*************************************************************************
+**************************************************************************
+#cat: alloc_lfstables - Allocates an empty LFSTABLES structure.  The tables
+#cat:                are built by init_lfstables() on first use.
+
+   Output:
+      otables - points to the allocated structure
+   Return Code:
+      Zero     - successful completion
+**************************************************************************/
+int alloc_lfstables(LFSTABLES **otables)
+{
+   *otables = (LFSTABLES *)g_malloc0(sizeof(LFSTABLES));
+   return(0);
+}
 
+/*************************************************************************
+**************************************************************************
+#cat: init_lfstables - Prepares the lookup tables and the padded image
+#cat:                buffer needed to detect minutiae in an image of the
+#cat:                given dimensions.  Tables left from a previous image
+#cat:                are kept if they were built for the same image width
+#cat:                and parameters; the buffer only grows.
 
+   Input:
+      tables   - structure to be prepared
+      iw       - width (in pixels) of the input image
+      ih       - height (in pixels) of the input image
+      lfsparms - parameters and thresholds for controlling LFS
+   Output:
+      tables   - the tables and buffer ready for use
+   Return Code:
+      Zero     - successful completion
+      Negative - system error
+**************************************************************************/
+int init_lfstables(LFSTABLES *tables, const int iw, const int ih,
+                   const LFSPARMS *lfsparms)
+{
+   int ret, maxpad, psize;
+
+   maxpad = get_max_padding_V2(lfsparms->windowsize, lfsparms->windowoffset,
+                          lfsparms->dirbin_grid_w, lfsparms->dirbin_grid_h);
+
+   if((tables->dir2rad == (DIR2RAD *)NULL) ||
+      (tables->iw != iw) || (tables->maxpad != maxpad) ||
+      (tables->num_directions != lfsparms->num_directions) ||
+      (tables->start_dir_angle != lfsparms->start_dir_angle) ||
+      (tables->num_dft_waves != lfsparms->num_dft_waves) ||
+      (tables->windowsize != lfsparms->windowsize) ||
+      (tables->dirbin_grid_w != lfsparms->dirbin_grid_w) ||
+      (tables->dirbin_grid_h != lfsparms->dirbin_grid_h)){
+      /* Drop the tables of the previous image. */
+      if(tables->dir2rad != (DIR2RAD *)NULL)
+         free_dir2rad(tables->dir2rad);
+      if(tables->dftwaves != (DFTWAVES *)NULL)
+         free_dftwaves(tables->dftwaves);
+      if(tables->dftgrids != (ROTGRIDS *)NULL)
+         free_rotgrids(tables->dftgrids);
+      if(tables->dirbingrids != (ROTGRIDS *)NULL)
+         free_rotgrids(tables->dirbingrids);
+      tables->dir2rad = (DIR2RAD *)NULL;
+      tables->dftwaves = (DFTWAVES *)NULL;
+      tables->dftgrids = (ROTGRIDS *)NULL;
+      tables->dirbingrids = (ROTGRIDS *)NULL;
+
+      /* Initialize lookup table for converting integer directions */
+      /* to angles in radians.                                     */
+      if((ret = init_dir2rad(&(tables->dir2rad), lfsparms->num_directions)))
+         return(ret);
+
+      /* Initialize wave form lookup tables for DFT analyses. */
+      /* used for direction binarization.                     */
+      if((ret = init_dftwaves(&(tables->dftwaves), g_dft_coefs,
+                              lfsparms->num_dft_waves,
+                              lfsparms->windowsize))){
+         free_dir2rad(tables->dir2rad);
+         tables->dir2rad = (DIR2RAD *)NULL;
+         return(ret);
+      }
+
+      /* Initialize lookup table for pixel offsets to rotated grids */
+      /* used for DFT analyses.                                     */
+      if((ret = init_rotgrids(&(tables->dftgrids), iw, ih, maxpad,
+                        lfsparms->start_dir_angle, lfsparms->num_directions,
+                        lfsparms->windowsize, lfsparms->windowsize,
+                        RELATIVE2ORIGIN))){
+         free_dir2rad(tables->dir2rad);
+         free_dftwaves(tables->dftwaves);
+         tables->dir2rad = (DIR2RAD *)NULL;
+         tables->dftwaves = (DFTWAVES *)NULL;
+         return(ret);
+      }
+
+      /* Initialize lookup table for pixel offsets to rotated grids */
+      /* used for directional binarization.                         */
+      if((ret = init_rotgrids(&(tables->dirbingrids), iw, ih, maxpad,
+                        lfsparms->start_dir_angle, lfsparms->num_directions,
+                        lfsparms->dirbin_grid_w, lfsparms->dirbin_grid_h,
+                        RELATIVE2CENTER))){
+         free_dir2rad(tables->dir2rad);
+         free_dftwaves(tables->dftwaves);
+         free_rotgrids(tables->dftgrids);
+         tables->dir2rad = (DIR2RAD *)NULL;
+         tables->dftwaves = (DFTWAVES *)NULL;
+         tables->dftgrids = (ROTGRIDS *)NULL;
+         return(ret);
+      }
+
+      tables->iw = iw;
+      tables->maxpad = maxpad;
+      tables->num_directions = lfsparms->num_directions;
+      tables->start_dir_angle = lfsparms->start_dir_angle;
+      tables->num_dft_waves = lfsparms->num_dft_waves;
+      tables->windowsize = lfsparms->windowsize;
+      tables->dirbin_grid_w = lfsparms->dirbin_grid_w;
+      tables->dirbin_grid_h = lfsparms->dirbin_grid_h;
+   }
+
+   /* Grow the padded image buffer if needed. */
+   psize = (iw + (maxpad<<1)) * (ih + (maxpad<<1));
+   if(psize > tables->pdata_size){
+      g_free(tables->pdata);
+      tables->pdata = (unsigned char *)g_malloc(psize);
+      tables->pdata_size = psize;
+   }
+
+   return(0);
+}
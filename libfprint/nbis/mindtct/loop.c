@@ -60,6 +60,7 @@ of the software.
                         get_loop_list()
                         on_loop()
                         on_island_lake()
+                        label_components()
                         on_hook()
                         is_loop_clockwise()
                         process_loop()
@@ -305,6 +306,103 @@ int on_island_lake(int **ocontour_x, int **ocontour_y,
    return(ret);
 }
 
+/* Union-find helpers for label_components(). */
+static int find_component(int *parent, int label)
+{
+   while(parent[label] != label){
+      /* Halve the path on the way up. */
+      parent[label] = parent[parent[label]];
+      label = parent[label];
+   }
+   return(label);
+}
+
+static int union_components(int *parent, int label1, int label2)
+{
+   label1 = find_component(parent, label1);
+   label2 = find_component(parent, label2);
+
+   /* Always keep the smaller label as root. */
+   if(label1 < label2){
+      parent[label2] = label1;
+      return(label1);
+   }
+   parent[label1] = label2;
+   return(label2);
+}
+
+/*************************************************************************
+**************************************************************************
+#cat: label_components - Labels the 8-connected components of equally
+#cat:                valued pixels in a binary image in a single pass
+#cat:                (plus relabelling), using a union-find structure.
+#cat:                Contour tracing only steps between 8-connected pixels
+#cat:                of the same value, so two pixels with different labels
+#cat:                can never be reached from each other by a trace.
+
+   Input:
+      bdata     - binary image data (0==while & 1==black)
+      iw        - width (in pixels) of image
+      ih        - height (in pixels) of image
+   Output:
+      olabels   - component label of each pixel
+   Return Code:
+      Zero      - successful completion
+      Negative  - system error
+**************************************************************************/
+int label_components(int **olabels, unsigned char *bdata,
+                     const int iw, const int ih)
+{
+   int *labels, *parent;
+   int x, y, i, label, nlabels;
+   unsigned char pix;
+
+   ASSERT_INT_MUL(iw, ih);
+   ASSERT_INT_MUL(iw * ih, sizeof(int));
+   labels = (int *)g_malloc(iw * ih * sizeof(int));
+   parent = (int *)g_malloc(iw * ih * sizeof(int));
+
+   nlabels = 0;
+   for(y = 0, i = 0; y < ih; y++){
+      for(x = 0; x < iw; x++, i++){
+         pix = bdata[i];
+         label = -1;
+
+         /* Join with the already labelled neighbors to the left */
+         /* and in the row above that have the same value.       */
+         if((x > 0) && (bdata[i-1] == pix))
+            label = labels[i-1];
+         if(y > 0){
+            if((x > 0) && (bdata[i-iw-1] == pix))
+               label = (label < 0) ? labels[i-iw-1] :
+                       union_components(parent, label, labels[i-iw-1]);
+            if(bdata[i-iw] == pix)
+               label = (label < 0) ? labels[i-iw] :
+                       union_components(parent, label, labels[i-iw]);
+            if((x < iw-1) && (bdata[i-iw+1] == pix))
+               label = (label < 0) ? labels[i-iw+1] :
+                       union_components(parent, label, labels[i-iw+1]);
+         }
+
+         /* Otherwise, start a new component. */
+         if(label < 0){
+            label = nlabels++;
+            parent[label] = label;
+         }
+         labels[i] = label;
+      }
+   }
+
+   /* Resolve all labels to the root of their component. */
+   for(i = 0; i < iw * ih; i++)
+      labels[i] = find_component(parent, labels[i]);
+
+   g_free(parent);
+
+   *olabels = labels;
+   return(0);
+}
+
 /*************************************************************************
 **************************************************************************
 #cat: on_hook - Determines if two minutia points lie on a hook on the side
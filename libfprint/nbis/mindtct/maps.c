@@ -262,7 +262,7 @@ int gen_initial_maps(int **odmap, int **olcmap, int **olfmap,
    int *direction_map, *low_contrast_map, *low_flow_map;
    int bi, bsize, blkdir;
    int *wis, *powmax_dirs;
-   double **powers, *powmaxs, *pownorms;
+   dft_real **powers, *powmaxs, *pownorms;
    int nstats;
    int ret; /* return code */
    int dft_offset;
@@ -1000,9 +1000,9 @@ int gen_high_curve_map(int **ohcmap, int *direction_map,
       Zero or Positive - The selected IMAP integer direction
       INVALID_DIR - IMAP Integer direction could not be determined
 **************************************************************************/
-int primary_dir_test(double **powers, const int *wis,
-            const double *powmaxs, const int *powmax_dirs,
-            const double *pownorms, const int nstats,
+int primary_dir_test(dft_real **powers, const int *wis,
+            const dft_real *powmaxs, const int *powmax_dirs,
+            const dft_real *pownorms, const int nstats,
             const LFSPARMS *lfsparms)
 {
    int w;
@@ -1084,9 +1084,9 @@ int primary_dir_test(double **powers, const int *wis,
       Zero or Positive - The selected IMAP integer direction
       INVALID_DIR - IMAP Integer direction could not be determined
 **************************************************************************/
-int secondary_fork_test(double **powers, const int *wis,
-            const double *powmaxs, const int *powmax_dirs,
-            const double *pownorms, const int nstats,
+int secondary_fork_test(dft_real **powers, const int *wis,
+            const dft_real *powmaxs, const int *powmax_dirs,
+            const dft_real *pownorms, const int nstats,
             const LFSPARMS *lfsparms)
 {
    int ldir, rdir;
@@ -72,6 +72,12 @@ of the software.
                         free_minutiae()
                         free_minutia()
                         remove_minutia()
+                        remove_flagged_minutiae()
+                        alloc_minutiae_grid()
+                        free_minutiae_grid()
+                        add_minutia_to_grid()
+                        remove_minutia_from_grid()
+                        get_minutiae_grid_nbrs()
                         join_minutia()
                         minutia_type()
                         is_minutia_appearing()
@@ -123,6 +129,7 @@ int alloc_minutiae(MINUTIAE **ominutiae, const int DEFAULT_BOZORTH_MINUTIAE)
 
    minutiae->alloc = DEFAULT_BOZORTH_MINUTIAE;
    minutiae->num = 0;
+   minutiae->grid = (MINUTIAE_GRID *)NULL;
 
    *ominutiae = minutiae;
    return(0);
@@ -226,11 +233,23 @@ int detect_minutiae_V2(MINUTIAE *minutiae,
       return(ret);
    }
 
+   /* Index detected minutiae spatially while scanning, so that each */
+   /* new candidate is only compared to its close neighbors.          */
+   if((ret = alloc_minutiae_grid(&(minutiae->grid), minutiae, iw, ih,
+                                 lfsparms->max_minutia_delta))){
+      g_free(pdirection_map);
+      g_free(plow_flow_map);
+      g_free(phigh_curve_map);
+      return(ret);
+   }
+
    if((ret = scan4minutiae_horizontally_V2(minutiae, bdata, iw, ih,
                  pdirection_map, plow_flow_map, phigh_curve_map, lfsparms))){
       g_free(pdirection_map);
       g_free(plow_flow_map);
       g_free(phigh_curve_map);
+      free_minutiae_grid(minutiae->grid);
+      minutiae->grid = (MINUTIAE_GRID *)NULL;
       return(ret);
    }
 
@@ -239,6 +258,8 @@ int detect_minutiae_V2(MINUTIAE *minutiae,
       g_free(pdirection_map);
       g_free(plow_flow_map);
       g_free(phigh_curve_map);
+      free_minutiae_grid(minutiae->grid);
+      minutiae->grid = (MINUTIAE_GRID *)NULL;
       return(ret);
    }
 
@@ -246,6 +267,8 @@ int detect_minutiae_V2(MINUTIAE *minutiae,
    g_free(pdirection_map);
    g_free(plow_flow_map);
    g_free(phigh_curve_map);
+   free_minutiae_grid(minutiae->grid);
+   minutiae->grid = (MINUTIAE_GRID *)NULL;
 
    /* Return normally. */
    return(0);
@@ -276,6 +299,8 @@ int update_minutiae(MINUTIAE *minutiae, MINUTIA *minutia,
 {
    int i, ret, dy, dx, delta_dir;
    int qtr_ndirs, full_ndirs;
+   MINUTIA **nbrs;
+   int *nbr_seqs, nnbrs;
 
    /* Check to see if minutiae list is full ... if so, then extend */
    /* the length of the allocated list of minutia points.          */
@@ -293,24 +318,37 @@ int update_minutiae(MINUTIAE *minutiae, MINUTIA *minutia,
    /* Compute number of directions in full circle. */
    full_ndirs = lfsparms->num_directions<<1;
 
+   /* Only minutiae within "max_minutia_delta" are of interest, so if */
+   /* a spatial index is attached, just visit those nearby.            */
+   if(minutiae->grid != (MINUTIAE_GRID *)NULL){
+      if((ret = get_minutiae_grid_nbrs(&nbrs, &nbr_seqs, &nnbrs,
+                               minutiae->grid, minutia->x, minutia->y,
+                               lfsparms->max_minutia_delta-1)))
+         return(ret);
+   }
+   else{
+      nbrs = minutiae->list;
+      nnbrs = minutiae->num;
+   }
+
    /* Is the minutiae list empty? */
-   if(minutiae->num > 0){
+   if(nnbrs > 0){
       /* Foreach minutia stored in the list... */
-      for(i = 0; i < minutiae->num; i++){
+      for(i = 0; i < nnbrs; i++){
          /* If x distance between new minutia and current list minutia */
          /* are sufficiently close...                                 */
-         dx = abs(minutiae->list[i]->x - minutia->x);
+         dx = abs(nbrs[i]->x - minutia->x);
          if(dx < lfsparms->max_minutia_delta){
             /* If y distance between new minutia and current list minutia */
             /* are sufficiently close...                                 */
-            dy = abs(minutiae->list[i]->y - minutia->y);
+            dy = abs(nbrs[i]->y - minutia->y);
             if(dy < lfsparms->max_minutia_delta){
                /* If new minutia and current list minutia are same type... */
-               if(minutiae->list[i]->type == minutia->type){
+               if(nbrs[i]->type == minutia->type){
                   /* Test to see if minutiae have similar directions. */
                   /* Take minimum of computed inner and outer        */
                   /* direction differences.                          */
-                  delta_dir = abs(minutiae->list[i]->direction -
+                  delta_dir = abs(nbrs[i]->direction -
                                   minutia->direction);
                   delta_dir = min(delta_dir, full_ndirs-delta_dir);
                   /* If directional difference is <= 45 degrees... */
@@ -328,8 +366,8 @@ int update_minutiae(MINUTIAE *minutiae, MINUTIA *minutia,
                      /* If new minutia point found on contour...        */
                      if(search_contour(minutia->x, minutia->y,
                                lfsparms->max_minutia_delta,
-                               minutiae->list[i]->x, minutiae->list[i]->y,
-                               minutiae->list[i]->ex, minutiae->list[i]->ey,
+                               nbrs[i]->x, nbrs[i]->y,
+                               nbrs[i]->ex, nbrs[i]->ey,
                                SCAN_CLOCKWISE, bdata, iw, ih)){
                         /* Consider the new minutia to be the same as the */
                         /* current list minutia, so don't add the new one */
@@ -341,8 +379,8 @@ int update_minutiae(MINUTIAE *minutiae, MINUTIA *minutia,
                      /* If new minutia point found on contour...       */
                      if(search_contour(minutia->x, minutia->y,
                                lfsparms->max_minutia_delta,
-                               minutiae->list[i]->x, minutiae->list[i]->y,
-                               minutiae->list[i]->ex, minutiae->list[i]->ey,
+                               nbrs[i]->x, nbrs[i]->y,
+                               nbrs[i]->ex, nbrs[i]->ey,
                                SCAN_COUNTER_CLOCKWISE, bdata, iw, ih)){
                         /* Consider the new minutia to be the same as the */
                         /* current list minutia, so don't add the new one */
@@ -365,6 +403,8 @@ int update_minutiae(MINUTIAE *minutiae, MINUTIA *minutia,
    /* Otherwise, assume new minutia is not in the list, so add it. */
    minutiae->list[minutiae->num] = minutia;
    (minutiae->num)++;
+   if(minutiae->grid != (MINUTIAE_GRID *)NULL)
+      add_minutia_to_grid(minutiae->grid, minutia);
 
    /* New minutia was successfully added to the list. */
    /* Return normally. */
@@ -398,9 +438,11 @@ int update_minutiae_V2(MINUTIAE *minutiae, MINUTIA *minutia,
                    unsigned char *bdata, const int iw, const int ih,
                    const LFSPARMS *lfsparms)
 {
-   int i, ret, dy, dx, delta_dir;
+   int i, j, ret, dy, dx, delta_dir;
    int qtr_ndirs, full_ndirs;
    int map_scan_dir;
+   MINUTIA **nbrs;
+   int *nbr_seqs, nnbrs;
 
    /* Check to see if minutiae list is full ... if so, then extend */
    /* the length of the allocated list of minutia points.          */
@@ -418,24 +460,37 @@ int update_minutiae_V2(MINUTIAE *minutiae, MINUTIA *minutia,
    /* Compute number of directions in full circle. */
    full_ndirs = lfsparms->num_directions<<1;
 
+   /* Only minutiae within "max_minutia_delta" are of interest, so if */
+   /* a spatial index is attached, just visit those nearby.            */
+   if(minutiae->grid != (MINUTIAE_GRID *)NULL){
+      if((ret = get_minutiae_grid_nbrs(&nbrs, &nbr_seqs, &nnbrs,
+                               minutiae->grid, minutia->x, minutia->y,
+                               lfsparms->max_minutia_delta-1)))
+         return(ret);
+   }
+   else{
+      nbrs = minutiae->list;
+      nnbrs = minutiae->num;
+   }
+
    /* Is the minutiae list empty? */
-   if(minutiae->num > 0){
+   if(nnbrs > 0){
       /* Foreach minutia stored in the list (in reverse order) ... */
-      for(i = minutiae->num-1; i >= 0; i--){
+      for(i = nnbrs-1; i >= 0; i--){
          /* If x distance between new minutia and current list minutia */
          /* are sufficiently close...                                 */
-         dx = abs(minutiae->list[i]->x - minutia->x);
+         dx = abs(nbrs[i]->x - minutia->x);
          if(dx < lfsparms->max_minutia_delta){
             /* If y distance between new minutia and current list minutia */
             /* are sufficiently close...                                 */
-            dy = abs(minutiae->list[i]->y - minutia->y);
+            dy = abs(nbrs[i]->y - minutia->y);
             if(dy < lfsparms->max_minutia_delta){
                /* If new minutia and current list minutia are same type... */
-               if(minutiae->list[i]->type == minutia->type){
+               if(nbrs[i]->type == minutia->type){
                   /* Test to see if minutiae have similar directions. */
                   /* Take minimum of computed inner and outer        */
                   /* direction differences.                          */
-                  delta_dir = abs(minutiae->list[i]->direction -
+                  delta_dir = abs(nbrs[i]->direction -
                                   minutia->direction);
                   delta_dir = min(delta_dir, full_ndirs-delta_dir);
                   /* If directional difference is <= 45 degrees... */
@@ -453,13 +508,13 @@ int update_minutiae_V2(MINUTIAE *minutiae, MINUTIA *minutia,
                      /* If new minutia point found on contour...        */
                      if(search_contour(minutia->x, minutia->y,
                                lfsparms->max_minutia_delta,
-                               minutiae->list[i]->x, minutiae->list[i]->y,
-                               minutiae->list[i]->ex, minutiae->list[i]->ey,
+                               nbrs[i]->x, nbrs[i]->y,
+                               nbrs[i]->ex, nbrs[i]->ey,
                                SCAN_CLOCKWISE, bdata, iw, ih) ||
                         search_contour(minutia->x, minutia->y,
                                lfsparms->max_minutia_delta,
-                               minutiae->list[i]->x, minutiae->list[i]->y,
-                               minutiae->list[i]->ex, minutiae->list[i]->ey,
+                               nbrs[i]->x, nbrs[i]->y,
+                               nbrs[i]->ex, nbrs[i]->ey,
                                SCAN_COUNTER_CLOCKWISE, bdata, iw, ih)){
                         /* If new minutia has VALID block direction ... */
                         if(dmapval >= 0){
@@ -472,7 +527,14 @@ int update_minutiae_V2(MINUTIAE *minutiae, MINUTIA *minutia,
                            if(map_scan_dir == scan_dir){
                               /* Then choose the new minutia over the one */
                               /* currently in the list.                   */
-                              if((ret = remove_minutia(i, minutiae))){
+                              /* Locate the list minutia by position.  The */
+                              /* list is in the same order as "nbrs", so   */
+                              /* it cannot be past index "nbr_seqs[i]".    */
+                              j = (nbrs == minutiae->list) ? i :
+                                  min(nbr_seqs[i], minutiae->num-1);
+                              while(minutiae->list[j] != nbrs[i])
+                                 j--;
+                              if((ret = remove_minutia(j, minutiae))){
                                  return(ret);
                               }
                               /* Continue on ... */
@@ -509,6 +571,8 @@ int update_minutiae_V2(MINUTIAE *minutiae, MINUTIA *minutia,
    /* were close neighbors were selectively removed, so add it.       */
    minutiae->list[minutiae->num] = minutia;
    (minutiae->num)++;
+   if(minutiae->grid != (MINUTIAE_GRID *)NULL)
+      add_minutia_to_grid(minutiae->grid, minutia);
 
    /* New minutia was successfully added to the list. */
    /* Return normally. */
@@ -771,6 +835,9 @@ void free_minutiae(MINUTIAE *minutiae)
       free_minutia(minutiae->list[i]);
    /* Deallocate list of minutia pointers. */
    g_free(minutiae->list);
+   /* Deallocate spatial index if one is still attached. */
+   if(minutiae->grid != (MINUTIAE_GRID *)NULL)
+      free_minutiae_grid(minutiae->grid);
 
    /* Deallocate the list structure. */
    g_free(minutiae);
@@ -820,6 +887,10 @@ int remove_minutia(const int index, MINUTIAE *minutiae)
       return(-380);
    }
 
+   /* Keep the spatial index (if any) in sync with the list. */
+   if(minutiae->grid != (MINUTIAE_GRID *)NULL)
+      remove_minutia_from_grid(minutiae->grid, minutiae->list[index]);
+
    /* Deallocate the minutia structure to be removed. */
    free_minutia(minutiae->list[index]);
 
@@ -835,6 +906,276 @@ int remove_minutia(const int index, MINUTIAE *minutiae)
    return(0);
 }
 
+/*************************************************************************
+**************************************************************************
+#cat: remove_flagged_minutiae - Removes all minutia points flagged in the
+#cat:                  given list from the input list of minutiae.  The
+#cat:                  list is compacted in a single pass, rather than
+#cat:                  sliding the remainder of the list once per removal.
+
+   Input:
+      minutiae   - input list of minutiae
+      to_remove  - list of flags, one per minutia, TRUE if to be removed
+   Output:
+      minutiae   - list with flagged minutiae removed
+   Return Code:
+      Zero      - successful completion
+      Negative  - system error
+**************************************************************************/
+int remove_flagged_minutiae(MINUTIAE *minutiae, const int *to_remove)
+{
+   int fr, to;
+
+   for(to = 0, fr = 0; fr < minutiae->num; fr++){
+      /* If the current minutia is flagged for removal ... */
+      if(to_remove[fr]){
+         if(minutiae->grid != (MINUTIAE_GRID *)NULL)
+            remove_minutia_from_grid(minutiae->grid, minutiae->list[fr]);
+         /* Deallocate the minutia structure. */
+         free_minutia(minutiae->list[fr]);
+      }
+      /* Otherwise, slide the minutia into its compacted position. */
+      else
+         minutiae->list[to++] = minutiae->list[fr];
+   }
+
+   /* Set the number of minutiae remaining in the list. */
+   minutiae->num = to;
+
+   /* Return normally. */
+   return(0);
+}
+
+/*************************************************************************
+**************************************************************************
+#cat: alloc_minutiae_grid - Allocates a grid of square buckets covering
+#cat:                  the image and adds all minutiae of the given list to
+#cat:                  it.  A query for the neighbors of a point then only
+#cat:                  has to visit the buckets around it.
+
+   Input:
+      minutiae   - list of minutiae to be indexed
+      iw         - width (in pixels) of image
+      ih         - height (in pixels) of image
+      cell_size  - width and height (in pixels) of each bucket
+   Output:
+      ogrid      - points to the allocated grid
+   Return Code:
+      Zero      - successful completion
+      Negative  - system error
+**************************************************************************/
+int alloc_minutiae_grid(MINUTIAE_GRID **ogrid, const MINUTIAE *minutiae,
+                        const int iw, const int ih, const int cell_size)
+{
+   MINUTIAE_GRID *grid;
+   int i, ncells;
+
+   if(cell_size <= 0){
+      fprintf(stderr, "ERROR : alloc_minutiae_grid : invalid cell size\n");
+      return(-381);
+   }
+
+   grid = (MINUTIAE_GRID *)g_malloc(sizeof(MINUTIAE_GRID));
+   grid->cell_size = cell_size;
+   grid->gw = max(1, (iw + cell_size - 1) / cell_size);
+   grid->gh = max(1, (ih + cell_size - 1) / cell_size);
+   grid->next_seq = 0;
+
+   ncells = grid->gw * grid->gh;
+   grid->cell_num = (int *)g_malloc0(ncells * sizeof(int));
+   grid->cell_alloc = (int *)g_malloc0(ncells * sizeof(int));
+   grid->cell_list = (MINUTIA ***)g_malloc0(ncells * sizeof(MINUTIA **));
+   grid->cell_seq = (int **)g_malloc0(ncells * sizeof(int *));
+
+   grid->nbrs_alloc = 0;
+   grid->nbrs = (MINUTIA **)NULL;
+   grid->nbr_seqs = (int *)NULL;
+
+   /* Add minutiae in list order, so sequence numbers match indices. */
+   for(i = 0; i < minutiae->num; i++)
+      add_minutia_to_grid(grid, minutiae->list[i]);
+
+   *ogrid = grid;
+   return(0);
+}
+
+/*************************************************************************
+**************************************************************************
+#cat: free_minutiae_grid - Deallocates a grid allocated by
+#cat:                  alloc_minutiae_grid().  The minutiae themselves are
+#cat:                  not touched.
+
+   Input:
+      grid       - pointer to allocated grid
+**************************************************************************/
+void free_minutiae_grid(MINUTIAE_GRID *grid)
+{
+   int i;
+
+   for(i = 0; i < grid->gw * grid->gh; i++){
+      g_free(grid->cell_list[i]);
+      g_free(grid->cell_seq[i]);
+   }
+   g_free(grid->cell_num);
+   g_free(grid->cell_alloc);
+   g_free(grid->cell_list);
+   g_free(grid->cell_seq);
+   g_free(grid->nbrs);
+   g_free(grid->nbr_seqs);
+   g_free(grid);
+}
+
+/*************************************************************************
+**************************************************************************
+#cat: minutia_grid_cell - Returns the index of the bucket a pixel
+#cat:                  location falls into, clipped to the grid.
+**************************************************************************/
+static int minutia_grid_cell(const MINUTIAE_GRID *grid, const int x,
+                             const int y)
+{
+   int cx, cy;
+
+   cx = max(0, min(grid->gw - 1, x / grid->cell_size));
+   cy = max(0, min(grid->gh - 1, y / grid->cell_size));
+
+   return((cy * grid->gw) + cx);
+}
+
+/*************************************************************************
+**************************************************************************
+#cat: add_minutia_to_grid - Adds a minutia to the bucket of its location.
+#cat:                  Minutiae must be added in the same order as they are
+#cat:                  appended to their minutiae list.
+
+   Input:
+      grid       - grid to be updated
+      minutia    - minutia to be added
+**************************************************************************/
+void add_minutia_to_grid(MINUTIAE_GRID *grid, MINUTIA *minutia)
+{
+   int cell, n;
+
+   cell = minutia_grid_cell(grid, minutia->x, minutia->y);
+   n = grid->cell_num[cell];
+
+   if(n >= grid->cell_alloc[cell]){
+      grid->cell_alloc[cell] += 8;
+      grid->cell_list[cell] = (MINUTIA **)g_realloc(grid->cell_list[cell],
+                                grid->cell_alloc[cell] * sizeof(MINUTIA *));
+      grid->cell_seq[cell] = (int *)g_realloc(grid->cell_seq[cell],
+                                grid->cell_alloc[cell] * sizeof(int));
+   }
+
+   grid->cell_list[cell][n] = minutia;
+   grid->cell_seq[cell][n] = grid->next_seq++;
+   grid->cell_num[cell]++;
+}
+
+/*************************************************************************
+**************************************************************************
+#cat: remove_minutia_from_grid - Removes a minutia from its bucket,
+#cat:                  preserving the order of the remaining ones.  The
+#cat:                  minutia must still be at the location it was added.
+
+   Input:
+      grid       - grid to be updated
+      minutia    - minutia to be removed
+**************************************************************************/
+void remove_minutia_from_grid(MINUTIAE_GRID *grid, const MINUTIA *minutia)
+{
+   int cell, i;
+
+   cell = minutia_grid_cell(grid, minutia->x, minutia->y);
+
+   for(i = 0; i < grid->cell_num[cell]; i++){
+      if(grid->cell_list[cell][i] == minutia)
+         break;
+   }
+   /* Not in the grid, so nothing to do. */
+   if(i == grid->cell_num[cell])
+      return;
+
+   grid->cell_num[cell]--;
+   for(; i < grid->cell_num[cell]; i++){
+      grid->cell_list[cell][i] = grid->cell_list[cell][i+1];
+      grid->cell_seq[cell][i] = grid->cell_seq[cell][i+1];
+   }
+}
+
+/*************************************************************************
+**************************************************************************
+#cat: get_minutiae_grid_nbrs - Returns all minutiae in the buckets
+#cat:                  overlapping a square window around a point.  The
+#cat:                  result is a superset of the minutiae within the
+#cat:                  window, returned in increasing sequence (list) order.
+
+   Input:
+      grid       - grid to be searched
+      x          - x-pixel coord of window center
+      y          - y-pixel coord of window center
+      radius     - half width (in pixels) of the window
+   Output:
+      onbrs      - points to list of candidate minutiae (owned by grid,
+                   valid until the next query)
+      oseqs      - points to list of their sequence numbers (owned by grid)
+      onnbrs     - number of candidates returned
+   Return Code:
+      Zero      - successful completion
+      Negative  - system error
+**************************************************************************/
+int get_minutiae_grid_nbrs(MINUTIA ***onbrs, int **oseqs, int *onnbrs,
+                           MINUTIAE_GRID *grid,
+                           const int x, const int y, const int radius)
+{
+   int sx, ex, sy, ey, cx, cy, cell;
+   int i, j, n, nnbrs, seq;
+   MINUTIA *minutia;
+
+   sx = max(0, (x - radius) / grid->cell_size);
+   ex = min(grid->gw - 1, (x + radius) / grid->cell_size);
+   sy = max(0, (y - radius) / grid->cell_size);
+   ey = min(grid->gh - 1, (y + radius) / grid->cell_size);
+
+   /* Count candidates so the scratch buffers can be sized. */
+   nnbrs = 0;
+   for(cy = sy; cy <= ey; cy++)
+      for(cx = sx; cx <= ex; cx++)
+         nnbrs += grid->cell_num[(cy * grid->gw) + cx];
+
+   if(nnbrs > grid->nbrs_alloc){
+      grid->nbrs_alloc = nnbrs + 32;
+      grid->nbrs = (MINUTIA **)g_realloc(grid->nbrs,
+                                 grid->nbrs_alloc * sizeof(MINUTIA *));
+      grid->nbr_seqs = (int *)g_realloc(grid->nbr_seqs,
+                                 grid->nbrs_alloc * sizeof(int));
+   }
+
+   /* Merge the buckets by insertion on sequence number.  Only a */
+   /* handful of minutiae are expected per window.               */
+   n = 0;
+   for(cy = sy; cy <= ey; cy++){
+      for(cx = sx; cx <= ex; cx++){
+         cell = (cy * grid->gw) + cx;
+         for(i = 0; i < grid->cell_num[cell]; i++){
+            minutia = grid->cell_list[cell][i];
+            seq = grid->cell_seq[cell][i];
+            for(j = n; (j > 0) && (grid->nbr_seqs[j-1] > seq); j--){
+               grid->nbrs[j] = grid->nbrs[j-1];
+               grid->nbr_seqs[j] = grid->nbr_seqs[j-1];
+            }
+            grid->nbrs[j] = minutia;
+            grid->nbr_seqs[j] = seq;
+            n++;
+         }
+      }
+   }
+
+   *onbrs = grid->nbrs;
+   *oseqs = grid->nbr_seqs;
+   *onnbrs = n;
+   return(0);
+}
+
 /*************************************************************************
 **************************************************************************
 #cat: join_minutia - Takes 2 minutia points and connectes their features in
@@ -1025,6 +1366,44 @@ int choose_scan_direction(const int imapval, const int ndirs)
       Negative  - system error
 **************************************************************************/
 
+/*************************************************************************
+**************************************************************************
+#cat: scan_pair_candidates - Finds the pixel pairs of two packed scan lines
+#cat:                that can be the second pair of a feature pattern.  The
+#cat:                second pair of every pattern consists of different
+#cat:                pixels and differs from its first pair.  All other
+#cat:                positions are skipped by the scan state machine anyway.
+
+   Input:
+      l1ptr     - first scan line, packed by pack_binary_image()
+      l2ptr     - adjacent scan line, packed the same way
+      i         - index of the word to be tested
+   Return Code:
+      Mask of candidate pixel pairs within word i
+**************************************************************************/
+static uint64_t scan_pair_candidates(const uint64_t *l1ptr,
+                const uint64_t *l2ptr, const int i)
+{
+   uint64_t c1, c2, cands;
+
+   /* Pixels that differ from the pixel before them ... */
+   c1 = l1ptr[i] ^ (l1ptr[i] << 1);
+   c2 = l2ptr[i] ^ (l2ptr[i] << 1);
+   if(i > 0){
+      c1 ^= l1ptr[i-1] >> 63;
+      c2 ^= l2ptr[i-1] >> 63;
+   }
+
+   /* ... in pairs of different pixels. */
+   cands = (l1ptr[i] ^ l2ptr[i]) & (c1 | c2);
+
+   /* The first pair in a scan line has no first pair before it. */
+   if(i == 0)
+      cands &= ~(uint64_t)1;
+
+   return(cands);
+}
+
 /*************************************************************************
 **************************************************************************
 #cat: scan4minutiae_horizontally_V2 - Scans an entire binary image
@@ -1051,97 +1430,68 @@ int scan4minutiae_horizontally_V2(MINUTIAE *minutiae,
                 int *pdirection_map, int *plow_flow_map, int *phigh_curve_map,
                 const LFSPARMS *lfsparms)
 {
-   int sx, sy, ex, ey, cx, cy, x2;
+   int cx, cy, x2, i, pw;
+   uint64_t *packed, *r1ptr, *r2ptr, cands;
    unsigned char *p1ptr, *p2ptr;
    int possible[NFEATURES], nposs;
    int ret;
 
-   /* Set scan region to entire image. */
-   sx = 0;
-   ex = iw;
-   sy = 0;
-   ey = ih;
-
-   /* Start at first row in region. */
-   cy = sy;
-   /* While second scan row not outside the bottom of the scan region... */
-   while(cy+1 < ey){
-      /* Start at beginning of new scan row in region. */
-      cx = sx;
-      /* While not at end of region's current scan row. */
-      while(cx < ex){
-         /* Get pixel pair from current x position in current and next */
-         /* scan rows. */
-         p1ptr = bdata+(cy*iw)+cx;
-         p2ptr = bdata+((cy+1)*iw)+cx;
-         /* If scan pixel pair matches first pixel pair of */
-         /* 1 or more features... */
-         if(match_1st_pair(*p1ptr, *p2ptr, possible, &nposs)){
-            /* Bump forward to next scan pixel pair. */
-            cx++;
+   /* Pack the rows, so that candidates for 64 pixel pairs are found */
+   /* at once.                                                         */
+   pw = PACKED_ROW_WORDS(iw);
+   ASSERT_INT_MUL(pw * ih, sizeof(uint64_t));
+   packed = (uint64_t *)g_malloc(pw * ih * sizeof(uint64_t));
+   pack_binary_image(packed, bdata, iw, ih);
+
+   /* Foreach pair of adjacent scan rows ... */
+   for(cy = 0; cy+1 < ih; cy++){
+      r1ptr = packed + (cy * pw);
+      r2ptr = r1ptr + pw;
+      for(i = 0; i < pw; i++){
+         cands = scan_pair_candidates(r1ptr, r2ptr, i);
+         /* Foreach candidate 2nd pixel pair from left to right ... */
+         while(cands){
+            x2 = (i << 6) + __builtin_ctzll(cands);
+            cands &= cands - 1;
+
+            /* Test the pixel pair left of it as first pair. */
+            p1ptr = bdata+(cy*iw)+x2-1;
+            p2ptr = p1ptr+iw;
+            if(!match_1st_pair(*p1ptr, *p2ptr, possible, &nposs))
+               continue;
+            if(!match_2nd_pair(*(p1ptr+1), *(p2ptr+1), possible, &nposs))
+               continue;
+
+            /* Skip repeated pixel pairs. */
+            cx = x2;
             p1ptr++;
             p2ptr++;
-            /* If not at end of region's current scan row... */
-            if(cx < ex){
-               /* If scan pixel pair matches second pixel pair of */
-               /* 1 or more features... */
-               if(match_2nd_pair(*p1ptr, *p2ptr, possible, &nposs)){
-                  /* Store current x location. */
-                  x2 = cx;
-                  /* Skip repeated pixel pairs. */
-                  skip_repeated_horizontal_pair(&cx, ex, &p1ptr, &p2ptr,
-                                                    iw, ih);
-                  /* If not at end of region's current scan row... */
-                  if(cx < ex){
-                     /* If scan pixel pair matches third pixel pair of */
-                     /* a single feature... */
-                     if(match_3rd_pair(*p1ptr, *p2ptr, possible, &nposs)){
-                        /* Process detected minutia point. */
-                        if((ret = process_horizontal_scan_minutia_V2(minutiae,
-                                         cx, cy, x2, possible[0],
-                                         bdata, iw, ih, pdirection_map,
-                                         plow_flow_map, phigh_curve_map,
-                                         lfsparms))){
-                           /* Return code may be:                       */
-                           /* 1.  ret< 0 (implying system error)        */
-                           /* 2. ret==IGNORE (ignore current feature)   */
-                           if(ret < 0)
-                              return(ret);
-                           /* Otherwise, IGNORE and continue. */
-                        }
-                     }
-
-                     /* Set up to resume scan. */
-                     /* Test to see if 3rd pair can slide into 2nd pair. */
-                     /* The values of the 2nd pair MUST be different.    */
-                     /* If 3rd pair values are different ... */
-                     if(*p1ptr != *p2ptr){
-                        /* Set next first pair to last of repeated */
-                        /* 2nd pairs, ie. back up one pair.        */
-                        cx--;
-                     }
-
-                     /* Otherwise, 3rd pair can't be a 2nd pair, so  */
-                     /* keep pointing to 3rd pair so that it is used */
-                     /* in the next first pair test.                 */
-
-                  } /* Else, at end of current scan row. */
+            skip_repeated_horizontal_pair(&cx, iw, &p1ptr, &p2ptr, iw, ih);
+
+            /* If scan pixel pair matches third pixel pair of */
+            /* a single feature...                              */
+            if((cx < iw) && match_3rd_pair(*p1ptr, *p2ptr, possible, &nposs)){
+               /* Process detected minutia point. */
+               if((ret = process_horizontal_scan_minutia_V2(minutiae,
+                                cx, cy, x2, possible[0],
+                                bdata, iw, ih, pdirection_map,
+                                plow_flow_map, phigh_curve_map,
+                                lfsparms))){
+                  /* Return code may be:                       */
+                  /* 1.  ret< 0 (implying system error)        */
+                  /* 2. ret==IGNORE (ignore current feature)   */
+                  if(ret < 0){
+                     g_free(packed);
+                     return(ret);
+                  }
+                  /* Otherwise, IGNORE and continue. */
                }
-
-               /* Otherwise, 2nd pair failed, so keep pointing to it */
-               /* so that it is used in the next first pair test.    */
-
-            } /* Else, at end of current scan row. */
-         }
-         /* Otherwise, 1st pair failed... */
-         else{
-            /* Bump forward to next pixel pair. */
-            cx++;
+            }
          }
-      } /* While not at end of current scan row. */
-      /* Bump forward to next scan row. */
-      cy++;
-   } /* While not out of scan rows. */
+      }
+   }
+
+   g_free(packed);
 
    /* Return normally. */
    return(0);
@@ -1202,97 +1552,68 @@ int scan4minutiae_vertically_V2(MINUTIAE *minutiae,
                 int *pdirection_map, int *plow_flow_map, int *phigh_curve_map,
                 const LFSPARMS *lfsparms)
 {
-   int sx, sy, ex, ey, cx, cy, y2;
+   int cx, cy, y2, i, ph;
+   uint64_t *packed, *c1ptr, *c2ptr, cands;
    unsigned char *p1ptr, *p2ptr;
    int possible[NFEATURES], nposs;
    int ret;
 
-   /* Set scan region to entire image. */
-   sx = 0;
-   ex = iw;
-   sy = 0;
-   ey = ih;
-
-   /* Start at first column in region. */
-   cx = sx;
-   /* While second scan column not outside the right of the region ... */
-   while(cx+1 < ex){
-      /* Start at beginning of new scan column in region. */
-      cy = sy;
-      /* While not at end of region's current scan column. */
-      while(cy < ey){
-         /* Get pixel pair from current y position in current and next */
-         /* scan columns. */
-         p1ptr = bdata+(cy*iw)+cx;
-         p2ptr = p1ptr+1;
-         /* If scan pixel pair matches first pixel pair of */
-         /* 1 or more features... */
-         if(match_1st_pair(*p1ptr, *p2ptr, possible, &nposs)){
-            /* Bump forward to next scan pixel pair. */
-            cy++;
+   /* Pack the columns, so that candidates for 64 pixel pairs are */
+   /* found at once.                                                */
+   ph = PACKED_ROW_WORDS(ih);
+   ASSERT_INT_MUL(ph * iw, sizeof(uint64_t));
+   packed = (uint64_t *)g_malloc(ph * iw * sizeof(uint64_t));
+   pack_binary_columns(packed, bdata, iw, ih);
+
+   /* Foreach pair of adjacent scan columns ... */
+   for(cx = 0; cx+1 < iw; cx++){
+      c1ptr = packed + (cx * ph);
+      c2ptr = c1ptr + ph;
+      for(i = 0; i < ph; i++){
+         cands = scan_pair_candidates(c1ptr, c2ptr, i);
+         /* Foreach candidate 2nd pixel pair from top to bottom ... */
+         while(cands){
+            y2 = (i << 6) + __builtin_ctzll(cands);
+            cands &= cands - 1;
+
+            /* Test the pixel pair above it as first pair. */
+            p1ptr = bdata+((y2-1)*iw)+cx;
+            p2ptr = p1ptr+1;
+            if(!match_1st_pair(*p1ptr, *p2ptr, possible, &nposs))
+               continue;
+            if(!match_2nd_pair(*(p1ptr+iw), *(p2ptr+iw), possible, &nposs))
+               continue;
+
+            /* Skip repeated pixel pairs. */
+            cy = y2;
             p1ptr+=iw;
             p2ptr+=iw;
-            /* If not at end of region's current scan column... */
-            if(cy < ey){
-               /* If scan pixel pair matches second pixel pair of */
-               /* 1 or more features... */
-               if(match_2nd_pair(*p1ptr, *p2ptr, possible, &nposs)){
-                  /* Store current y location. */
-                  y2 = cy;
-                  /* Skip repeated pixel pairs. */
-                  skip_repeated_vertical_pair(&cy, ey, &p1ptr, &p2ptr,
-                                                  iw, ih);
-                  /* If not at end of region's current scan column... */
-                  if(cy < ey){
-                     /* If scan pixel pair matches third pixel pair of */
-                     /* a single feature... */
-                     if(match_3rd_pair(*p1ptr, *p2ptr, possible, &nposs)){
-                        /* Process detected minutia point. */
-                        if((ret = process_vertical_scan_minutia_V2(minutiae,
-                                         cx, cy, y2, possible[0],
-                                         bdata, iw, ih, pdirection_map,
-                                         plow_flow_map, phigh_curve_map,
-                                         lfsparms))){
-                           /* Return code may be:                       */
-                           /* 1.  ret< 0 (implying system error)        */
-                           /* 2. ret==IGNORE (ignore current feature)   */
-                           if(ret < 0)
-                              return(ret);
-                           /* Otherwise, IGNORE and continue. */
-                        }
-                     }
-
-                     /* Set up to resume scan. */
-                     /* Test to see if 3rd pair can slide into 2nd pair. */
-                     /* The values of the 2nd pair MUST be different.    */
-                     /* If 3rd pair values are different ... */
-                     if(*p1ptr != *p2ptr){
-                        /* Set next first pair to last of repeated */
-                        /* 2nd pairs, ie. back up one pair.        */
-                        cy--;
-                     }
-
-                     /* Otherwise, 3rd pair can't be a 2nd pair, so  */
-                     /* keep pointing to 3rd pair so that it is used */
-                     /* in the next first pair test.                 */
-
-                  } /* Else, at end of current scan row. */
+            skip_repeated_vertical_pair(&cy, ih, &p1ptr, &p2ptr, iw, ih);
+
+            /* If scan pixel pair matches third pixel pair of */
+            /* a single feature...                              */
+            if((cy < ih) && match_3rd_pair(*p1ptr, *p2ptr, possible, &nposs)){
+               /* Process detected minutia point. */
+               if((ret = process_vertical_scan_minutia_V2(minutiae,
+                                cx, cy, y2, possible[0],
+                                bdata, iw, ih, pdirection_map,
+                                plow_flow_map, phigh_curve_map,
+                                lfsparms))){
+                  /* Return code may be:                       */
+                  /* 1.  ret< 0 (implying system error)        */
+                  /* 2. ret==IGNORE (ignore current feature)   */
+                  if(ret < 0){
+                     g_free(packed);
+                     return(ret);
+                  }
+                  /* Otherwise, IGNORE and continue. */
                }
-
-               /* Otherwise, 2nd pair failed, so keep pointing to it */
-               /* so that it is used in the next first pair test.    */
-
-            } /* Else, at end of current scan column. */
-         }
-         /* Otherwise, 1st pair failed... */
-         else{
-            /* Bump forward to next pixel pair. */
-            cy++;
+            }
          }
-      } /* While not at end of current scan column. */
-      /* Bump forward to next scan column. */
-      cx++;
-   } /* While not out of scan columns. */
+      }
+   }
+
+   g_free(packed);
 
    /* Return normally. */
    return(0);
@@ -223,14 +223,18 @@ int remove_holes(MINUTIAE *minutiae,
                  unsigned char *bdata, const int iw, const int ih,
                  const LFSPARMS *lfsparms)
 {
+   int *to_remove;
    int i, ret;
    MINUTIA *minutia;
 
    print2log("\nREMOVING HOLES:\n");
 
-   i = 0;
-   /* Foreach minutia remaining in list ... */
-   while(i < minutiae->num){
+   /* Each minutia is tested on its own, so flag the ones to be removed */
+   /* and compact the list once at the end.                             */
+   to_remove = (int *)g_malloc0(minutiae->num * sizeof(int));
+
+   /* Foreach minutia in list ... */
+   for(i = 0; i < minutiae->num; i++){
       /* Assign a temporary pointer. */
       minutia = minutiae->list[i];
       /* If current minutia is a bifurcation ... */
@@ -242,34 +246,25 @@ int remove_holes(MINUTIAE *minutiae,
 
             print2log("%d,%d RM\n", minutia->x, minutia->y);
 
-            /* Then remove the minutia from list. */
-            if((ret = remove_minutia(i, minutiae))){
-               /* Return error code. */
-               return(ret);
-            }
-            /* No need to advance because next minutia has "slid" */
-            /* into position pointed to by 'i'.                   */
+            /* Then flag the minutia for removal from the list. */
+            to_remove[i] = TRUE;
          }
-         /* If the minutia is NOT on a loop... */
-         else if (ret == FALSE){
-            /* Simply advance to next minutia in the list. */
-            i++;
-         }
-         /* Otherwise, an ERROR occurred while looking for loop. */
-         else{
+         /* Otherwise, if an ERROR occurred while looking for loop. */
+         else if (ret != FALSE){
             /* Return error code. */
+            g_free(to_remove);
             return(ret);
          }
       }
       /* Otherwise, the current minutia is a ridge-ending... */
-      else{
-         /* Advance to next minutia in the list. */
-         i++;
-      }
    }
 
+   /* Remove all flagged minutiae from the list. */
+   ret = remove_flagged_minutiae(minutiae, to_remove);
+   g_free(to_remove);
+
    /* Return normally. */
-   return(0);
+   return(ret);
 }
 
 /*************************************************************************
@@ -295,7 +290,7 @@ int remove_hooks(MINUTIAE *minutiae,
                  const LFSPARMS *lfsparms)
 {
    int *to_remove;
-   int i, f, s, ret;
+   int f, s, ret;
    int delta_y, full_ndirs, qtr_ndirs, deltadir, min_deltadir;
    MINUTIA *minutia1, *minutia2;
    double dist;
@@ -471,18 +466,11 @@ int remove_hooks(MINUTIAE *minutiae,
       f++;
    }/* End primary minutiae loop. */
 
-   /* Now remove all minutiae in list that have been flagged for removal. */
-   /* NOTE: Need to remove the minutia from their lists in reverse       */
-   /*       order, otherwise, indices will be off.                       */
-   for(i = minutiae->num-1; i >= 0; i--){
-      /* If the current minutia index is flagged for removal ... */
-      if(to_remove[i]){
-         /* Remove the minutia from the minutiae list. */
-         if((ret = remove_minutia(i, minutiae))){
-            g_free(to_remove);
-            return(ret);
-         }
-      }
+   /* Now remove all minutiae in list that have been flagged for removal */
+   /* in a single compacting pass over the list.                         */
+   if((ret = remove_flagged_minutiae(minutiae, to_remove))){
+      g_free(to_remove);
+      return(ret);
    }
 
    /* Deallocate flag list. */
@@ -541,9 +529,11 @@ int remove_islands_and_lakes(MINUTIAE *minutiae,
                       const LFSPARMS *lfsparms)
 {
    int *to_remove;
-   int i, f, s, ret;
+   int f, s, ret;
    int delta_y, full_ndirs, qtr_ndirs, deltadir, min_deltadir;
    int *loop_x, *loop_y, *loop_ex, *loop_ey, nloop;
+   int *labels = (int *)NULL;
+   int stale[2] = { FALSE, FALSE };
    MINUTIA *minutia1, *minutia2;
    double dist;
    int dist_thresh, half_loop;
@@ -646,6 +636,7 @@ int remove_islands_and_lakes(MINUTIAE *minutiae,
                         if((deltadir = closest_dir_dist(minutia1->direction,
                                        minutia2->direction, full_ndirs)) ==
                                        INVALID_DIR){
+                           g_free(labels);
                            g_free(to_remove);
                            fprintf(stderr,
                      "ERROR : remove_islands_and_lakes : INVALID direction\n");
@@ -662,9 +653,38 @@ int remove_islands_and_lakes(MINUTIAE *minutiae,
                            /* Pair is the same type, so test to see */
                            /* if both are on an island or lake.     */
 
-                           /* Check to see if pair on a loop of specified */
-                           /* half length (ex. 30 pixels) ...             */
-                           ret = on_island_lake(&loop_x, &loop_y,
+                           /* Label the connected components of the binary */
+                           /* image, again if filled loops may have joined */
+                           /* components of the pair's pixel value.        */
+                           if(stale[minutia1->type]){
+                              g_free(labels);
+                              labels = (int *)NULL;
+                           }
+                           if(labels == (int *)NULL){
+                              if((ret = label_components(&labels,
+                                                         bdata, iw, ih))){
+                                 g_free(to_remove);
+                                 return(ret);
+                              }
+                              stale[0] = stale[1] = FALSE;
+                           }
+
+                           /* If the pair is in different components,   */
+                           /* tracing from the first minutia can never  */
+                           /* reach the second one, so the result only  */
+                           /* depends on whether the trace can start.   */
+                           if(labels[(minutia1->y*iw)+minutia1->x] !=
+                              labels[(minutia2->y*iw)+minutia2->x]){
+                              if(*(bdata+(minutia1->y*iw)+minutia1->x) ==
+                                 *(bdata+(minutia1->ey*iw)+minutia1->ex))
+                                 ret = IGNORE;
+                              else
+                                 ret = FALSE;
+                           }
+                           /* Otherwise, check to see if pair on a loop */
+                           /* of specified half length (ex. 30 pixels). */
+                           else
+                              ret = on_island_lake(&loop_x, &loop_y,
                                            &loop_ex, &loop_ey, &nloop,
                                            minutia1, minutia2,
                                            half_loop, bdata, iw, ih);
@@ -678,9 +698,15 @@ int remove_islands_and_lakes(MINUTIAE *minutiae,
                                                  bdata, iw, ih))){
                                  free_contour(loop_x, loop_y,
                                               loop_ex, loop_ey);
+                                 g_free(labels);
                                  g_free(to_remove);
                                  return(ret);
                               }
+                              /* Filling can only split the components of */
+                              /* the loop's pixel value, so their labels  */
+                              /* stay usable.  Components of the opposite */
+                              /* value may have been joined though.       */
+                              stale[minutia1->type ? 0 : 1] = TRUE;
                               /* Set to remove first minutia. */
                               to_remove[f] = TRUE;
                               /* Set to remove second minutia. */
@@ -701,6 +727,7 @@ int remove_islands_and_lakes(MINUTIAE *minutiae,
                            }
                            /* If ERROR while looking for island/lake ... */
                            else if (ret < 0){
+                              g_free(labels);
                               g_free(to_remove);
                               return(ret);
                            }
@@ -738,18 +765,13 @@ int remove_islands_and_lakes(MINUTIAE *minutiae,
       f++;
    }/* End primary minutiae loop. */
 
-   /* Now remove all minutiae in list that have been flagged for removal. */
-   /* NOTE: Need to remove the minutia from their lists in reverse       */
-   /*       order, otherwise, indices will be off.                       */
-   for(i = minutiae->num-1; i >= 0; i--){
-      /* If the current minutia index is flagged for removal ... */
-      if(to_remove[i]){
-         /* Remove the minutia from the minutiae list. */
-         if((ret = remove_minutia(i, minutiae))){
-            g_free(to_remove);
-            return(ret);
-         }
-      }
+   g_free(labels);
+
+   /* Now remove all minutiae in list that have been flagged for removal */
+   /* in a single compacting pass over the list.                         */
+   if((ret = remove_flagged_minutiae(minutiae, to_remove))){
+      g_free(to_remove);
+      return(ret);
    }
 
    /* Deallocate flag list. */
@@ -795,6 +817,7 @@ int remove_malformations(MINUTIAE *minutiae,
                          int *low_flow_map, const int mw, const int mh,
                          const LFSPARMS *lfsparms)
 {
+   int *to_remove;
    int i, j, ret;
    MINUTIA *minutia;
    int *contour_x, *contour_y, *contour_ex, *contour_ey, ncontour;
@@ -807,6 +830,10 @@ int remove_malformations(MINUTIAE *minutiae,
 
    print2log("\nREMOVING MALFORMATIONS:\n");
 
+   /* Each minutia is tested on its own, so flag the ones to be removed */
+   /* and compact the list once at the end.                             */
+   to_remove = (int *)g_malloc0(minutiae->num * sizeof(int));
+
    for(i = minutiae->num-1; i >= 0; i--){
       minutia = minutiae->list[i];
       ret = trace_contour(&contour_x, &contour_y,
@@ -819,6 +846,7 @@ int remove_malformations(MINUTIAE *minutiae,
       /* If system error occurred during trace ... */
       if(ret < 0){
          /* Return error code. */
+         g_free(to_remove);
          return(ret);
       }
 
@@ -836,9 +864,7 @@ int remove_malformations(MINUTIAE *minutiae,
          print2log("%d,%d RMA\n", minutia->x, minutia->y);
 
          /* Then remove the minutia. */
-         if((ret = remove_minutia(i, minutiae)))
-            /* If system error, return error code. */
-            return(ret);
+         to_remove[i] = TRUE;
       }
       /* Otherwise, traced contour is complete. */
       else{
@@ -863,6 +889,7 @@ int remove_malformations(MINUTIAE *minutiae,
          /* If system error occurred during trace ... */
          if(ret < 0){
             /* Return error code. */
+            g_free(to_remove);
             return(ret);
          }
 
@@ -880,9 +907,7 @@ int remove_malformations(MINUTIAE *minutiae,
             print2log("%d,%d RMB\n", minutia->x, minutia->y);
 
             /* Then remove the minutia. */
-            if((ret = remove_minutia(i, minutiae)))
-               /* If system error, return error code. */
-               return(ret);
+            to_remove[i] = TRUE;
          }
          /* Otherwise, traced contour is complete. */
          else{
@@ -911,9 +936,7 @@ int remove_malformations(MINUTIAE *minutiae,
             if((a_dist == 0.0) || (b_dist == 0.0)){
                /* Remove the malformation minutia. */
                print2log("%d,%d RMMAL1\n", minutia->x, minutia->y);
-               if((ret = remove_minutia(i, minutiae)))
-                  /* If system error, return error code. */
-                  return(ret);
+               to_remove[i] = TRUE;
                removed = TRUE;
             }
 
@@ -926,9 +949,7 @@ int remove_malformations(MINUTIAE *minutiae,
                   if(b_dist > lfsparms->max_malformation_dist){
                      /* Remove the malformation minutia. */
                      print2log("%d,%d RMMAL2\n", minutia->x, minutia->y);
-                     if((ret = remove_minutia(i, minutiae)))
-                        /* If system error, return error code. */
-                        return(ret);
+                     to_remove[i] = TRUE;
                      removed = TRUE;
                   }
                }
@@ -937,8 +958,10 @@ int remove_malformations(MINUTIAE *minutiae,
             if(!removed){
                /* Compute points on line between the points A & B. */
                if((ret = line_points(&x_list, &y_list, &num,
-                                     bx1, by1, bx2, by2)))
+                                     bx1, by1, bx2, by2))){
+                  g_free(to_remove);
                   return(ret);
+               }
                /* Foreach remaining point along line segment ... */
                for(j = 0; j < num; j++){
                   /* If B path contains pixel opposite minutia type ... */
@@ -954,12 +977,7 @@ int remove_malformations(MINUTIAE *minutiae,
                         /* Then remove the minutia. */
                         print2log("%d,%d RMMAL3 (%f)\n",
                                   minutia->x, minutia->y, ratio);
-                        if((ret = remove_minutia(i, minutiae))){
-                           g_free(x_list);
-                           g_free(y_list);
-                           /* If system error, return error code. */
-                           return(ret);
-                        }
+                        to_remove[i] = TRUE;
                         /* Break out of FOR loop. */
                         break;
                      }
@@ -974,7 +992,11 @@ int remove_malformations(MINUTIAE *minutiae,
       }
    }
 
-   return(0);
+   /* Remove all flagged minutiae from the list. */
+   ret = remove_flagged_minutiae(minutiae, to_remove);
+   g_free(to_remove);
+
+   return(ret);
 }
 
 /*************************************************************************
@@ -1018,11 +1040,11 @@ int remove_malformations(MINUTIAE *minutiae,
 int remove_near_invblock_V2(MINUTIAE *minutiae, int *direction_map,
                 const int mw, const int mh, const LFSPARMS *lfsparms)
 {
+   int *to_remove;
    int i, ret;
    int ni, nbx, nby, nvalid;
    int ix, iy, sbi, ebi;
    int bx, by, px, py;
-   int removed;
    MINUTIA *minutia;
    int lo_margin, hi_margin;
 
@@ -1101,9 +1123,12 @@ int remove_near_invblock_V2(MINUTIAE *minutiae, int *direction_map,
    lo_margin = lfsparms->inv_block_margin;
    hi_margin = lfsparms->blocksize - lfsparms->inv_block_margin - 1;
 
-   i = 0;
-   /* Foreach minutia remaining in the list ... */
-   while(i < minutiae->num){
+   /* Each minutia is tested on its own, so flag the ones to be removed */
+   /* and compact the list once at the end.                             */
+   to_remove = (int *)g_malloc0(minutiae->num * sizeof(int));
+
+   /* Foreach minutia in the list ... */
+   for(i = 0; i < minutiae->num; i++){
       /* Assign temporary minutia pointer. */
       minutia = minutiae->list[i];
 
@@ -1144,9 +1169,6 @@ int remove_near_invblock_V2(MINUTIAE *minutiae, int *direction_map,
       else
          iy = 1;
 
-      /* Set remove flag to FALSE. */
-      removed = FALSE;
-
       /* If one of the minutia's pixel offsets is in a margin ... */
       if((ix != 1) || (iy != 1)){
 
@@ -1175,12 +1197,7 @@ int remove_near_invblock_V2(MINUTIAE *minutiae, int *direction_map,
                /* an even multiple, then some minutia may not be detected */
                /* as being in the margin of "the image" (not the block).  */
                /* In practice, I don't think this will impact performance.*/
-               if((ret = remove_minutia(i, minutiae)))
-                  /* If system error occurred while removing minutia, */
-                  /* then return error code.                          */
-                  return(ret);
-               /* Set remove flag to TURE. */
-               removed = TRUE;
+               to_remove[i] = TRUE;
                /* Break out of neighboring block loop. */
                break;
             }
@@ -1195,13 +1212,8 @@ int remove_near_invblock_V2(MINUTIAE *minutiae, int *direction_map,
 
                   print2log("%d,%d RM2\n", minutia->x, minutia->y);
 
-                  /* Then remove the current minutia from the list. */
-                  if((ret = remove_minutia(i, minutiae)))
-                     /* If system error occurred while removing minutia, */
-                     /* then return error code.                          */
-                     return(ret);
-                  /* Set remove flag to TURE. */
-                  removed = TRUE;
+                  /* Then flag the current minutia for removal. */
+                  to_remove[i] = TRUE;
                   /* Break out of neighboring block loop. */
                   break;
                }
@@ -1213,17 +1225,14 @@ int remove_near_invblock_V2(MINUTIAE *minutiae, int *direction_map,
          }
 
       } /* Otherwise not in margin, so skip to next minutia in list. */
-
-      /* If current minutia not removed ... */
-      if(!removed)
-         /* Advance to the next minutia in the list. */
-         i++;
-      /* Otherwise the next minutia has slid into the spot where current */
-      /* minutia was removed, so don't bump minutia index.               */
    } /* End minutia loop */
 
+   /* Remove all flagged minutiae from the list. */
+   ret = remove_flagged_minutiae(minutiae, to_remove);
+   g_free(to_remove);
+
    /* Return normally. */
-   return(0);
+   return(ret);
 }
 
 /*************************************************************************
@@ -1268,6 +1277,7 @@ int remove_pointing_invblock_V2(MINUTIAE *minutiae,
                              int *direction_map, const int mw, const int mh,
                              const LFSPARMS *lfsparms)
 {
+   int *to_remove;
    int i, ret;
    int delta_x, delta_y, dmapval;
    int nx, ny, bx, by;
@@ -1280,9 +1290,12 @@ int remove_pointing_invblock_V2(MINUTIAE *minutiae,
    /* Compute factor for converting integer directions to radians. */
    pi_factor = M_PI / (double)lfsparms->num_directions;
 
-   i = 0;
-   /* Foreach minutia remaining in list ... */
-   while(i < minutiae->num){
+   /* Each minutia is tested on its own, so flag the ones to be removed */
+   /* and compact the list once at the end.                             */
+   to_remove = (int *)g_malloc0(minutiae->num * sizeof(int));
+
+   /* Foreach minutia in list ... */
+   for(i = 0; i < minutiae->num; i++){
       /* Set temporary minutia pointer. */
       minutia = minutiae->list[i];
       /* Convert minutia's direction to radians. */
@@ -1318,33 +1331,36 @@ int remove_pointing_invblock_V2(MINUTIAE *minutiae,
 
          print2log("%d,%d RM\n", minutia->x, minutia->y);
 
-         /* Remove the minutia from the minutiae list. */
-         if((ret = remove_minutia(i, minutiae))){
-            return(ret);
-         }
-         /* No need to advance because next minutia has slid into slot. */
-      }
-      else{
-         /* Advance to next minutia in list. */
-         i++;
+         /* Flag the minutia for removal from the minutiae list. */
+         to_remove[i] = TRUE;
       }
    }
 
+   /* Remove all flagged minutiae from the list. */
+   ret = remove_flagged_minutiae(minutiae, to_remove);
+   g_free(to_remove);
+
    /* Return normally. */
-   return(0);
+   return(ret);
 }
 
-static void mark_minutiae_in_range(MINUTIAE *minutiae, int *to_remove, int x, int y,
+static void mark_minutiae_in_range(MINUTIAE_GRID *grid, int *to_remove, int x, int y,
                                    const LFSPARMS *lfsparms)
 {
+    MINUTIA **nbrs;
+    int *seqs, nnbrs;
     int i, dist;
-    for (i = 0; i < minutiae->num; i++) {
-        if (to_remove[i])
+
+    /* The grid was built from the list, so sequence numbers are indices */
+    get_minutiae_grid_nbrs(&nbrs, &seqs, &nnbrs, grid, x, y,
+                           lfsparms->min_pp_distance);
+    for (i = 0; i < nnbrs; i++) {
+        if (to_remove[seqs[i]])
             continue;
-        dist = (int)sqrt((x - minutiae->list[i]->x) * (x - minutiae->list[i]->x) +
-                         (y - minutiae->list[i]->y) * (y - minutiae->list[i]->y));
+        dist = (int)sqrt((x - nbrs[i]->x) * (x - nbrs[i]->x) +
+                         (y - nbrs[i]->y) * (y - nbrs[i]->y));
         if (dist < lfsparms->min_pp_distance) {
-            to_remove[i] = 1;
+            to_remove[seqs[i]] = 1;
         }
     }
 }
@@ -1374,8 +1390,8 @@ int remove_perimeter_pts(MINUTIAE *minutiae,
     int i, j, ret, *to_remove;
     int *left, *left_up, *left_down;
     int *right, *right_up, *right_down;
-    int removed = 0;
     int left_min, right_max;
+    MINUTIAE_GRID *grid;
 
     if (!lfsparms->remove_perimeter_pts)
         return(0);
@@ -1459,27 +1475,31 @@ int remove_perimeter_pts(MINUTIAE *minutiae,
     free(right_up);
     free(right_down);
 
+    /* Index the minutiae so each edge point only visits nearby ones */
+    if ((ret = alloc_minutiae_grid(&grid, minutiae, iw, ih,
+                                   max(1, lfsparms->min_pp_distance)))) {
+        free(to_remove);
+        free(left);
+        free(right);
+        return(ret);
+    }
+
     /* Mark minitiae close to the edge */
     for (i = 0; i < ih; i++) {
         if (left[i] != -1)
-            mark_minutiae_in_range(minutiae, to_remove, left[i], i, lfsparms);
+            mark_minutiae_in_range(grid, to_remove, left[i], i, lfsparms);
         if (right[i] != -1)
-            mark_minutiae_in_range(minutiae, to_remove, right[i], i, lfsparms);
+            mark_minutiae_in_range(grid, to_remove, right[i], i, lfsparms);
     }
 
+    free_minutiae_grid(grid);
     free(left);
     free(right);
 
-    for (i = minutiae->num - 1; i >= 0; i--) {
-        /* If the current minutia index is flagged for removal ... */
-        if (to_remove[i]){
-            removed ++;
-            /* Remove the minutia from the minutiae list. */
-            if((ret = remove_minutia(i, minutiae))){
-                free(to_remove);
-                return(ret);
-            }
-        }
+    /* Remove the flagged minutiae from the minutiae list. */
+    if ((ret = remove_flagged_minutiae(minutiae, to_remove))) {
+        free(to_remove);
+        return(ret);
     }
 
     free(to_remove);
@@ -1512,7 +1532,7 @@ int remove_overlaps(MINUTIAE *minutiae,
                     const LFSPARMS *lfsparms)
 {
    int *to_remove;
-   int i, f, s, ret;
+   int f, s, ret;
    int delta_y, full_ndirs, qtr_ndirs, deltadir, min_deltadir;
    MINUTIA *minutia1, *minutia2;
    double dist;
@@ -1696,18 +1716,11 @@ int remove_overlaps(MINUTIAE *minutiae,
       f++;
    }/* End primary minutiae loop. */
 
-   /* Now remove all minutiae in list that have been flagged for removal. */
-   /* NOTE: Need to remove the minutia from their lists in reverse       */
-   /*       order, otherwise, indices will be off.                       */
-   for(i = minutiae->num-1; i >= 0; i--){
-      /* If the current minutia index is flagged for removal ... */
-      if(to_remove[i]){
-         /* Remove the minutia from the minutiae list. */
-         if((ret = remove_minutia(i, minutiae))){
-            g_free(to_remove);
-            return(ret);
-         }
-      }
+   /* Now remove all minutiae in list that have been flagged for removal */
+   /* in a single compacting pass over the list.                         */
+   if((ret = remove_flagged_minutiae(minutiae, to_remove))){
+      g_free(to_remove);
+      return(ret);
    }
 
    /* Deallocate flag list. */
@@ -1769,8 +1782,9 @@ int remove_pores_V2(MINUTIAE *minutiae,
                     int *high_curve_map, const int mw, const int mh,
                     const LFSPARMS *lfsparms)
 {
+   int *to_remove;
    int i, ret;
-   int removed, blk_x, blk_y;
+   int blk_x, blk_y;
    int rx, ry;
    int px, py, pex, pey, bx, by, dx, dy;
    int qx, qy, qex, qey, ax, ay, cx, cy;
@@ -1816,16 +1830,15 @@ int remove_pores_V2(MINUTIAE *minutiae,
    /* Factor for converting integer directions into radians. */
    pi_factor = M_PI/(double)lfsparms->num_directions;
 
-   /* Initialize to the beginning of the minutia list. */
-   i = 0;
-   /* Foreach minutia remaining in the list ... */
-   while(i < minutiae->num){
+   /* Each minutia is tested on its own, so flag the ones to be removed */
+   /* and compact the list once at the end.                             */
+   to_remove = (int *)g_malloc0(minutiae->num * sizeof(int));
+
+   /* Foreach minutia in the list ... */
+   for(i = 0; i < minutiae->num; i++){
       /* Set temporary minutia pointer. */
       minutia = minutiae->list[i];
 
-      /* Initialize remove flag to FALSE. */
-      removed = FALSE;
-
       /* Compute block coords from minutia point. */
       blk_x = minutia->x / lfsparms->blocksize;
       blk_y = minutia->y / lfsparms->blocksize;
@@ -1877,6 +1890,7 @@ int remove_pores_V2(MINUTIAE *minutiae,
                /* If system error occurred during trace ... */
                if(ret < 0){
                   /* Return error code. */
+                  g_free(to_remove);
                   return(ret);
                }
 
@@ -1895,11 +1909,7 @@ int remove_pores_V2(MINUTIAE *minutiae,
                   print2log("%d,%d RMB\n", minutia->x, minutia->y);
 
                   /* Then remove the minutia. */
-                  if((ret = remove_minutia(i, minutiae)))
-                     /* If system error, return error code. */
-                     return(ret);
-                  /* Set remove flag to TRUE. */
-                  removed = TRUE;
+                  to_remove[i] = TRUE;
                }
                /* Otherwise, traced contour is complete. */
                else{
@@ -1921,6 +1931,7 @@ int remove_pores_V2(MINUTIAE *minutiae,
                   /* If system error occurred during trace ... */
                   if(ret < 0){
                      /* Return error code. */
+                     g_free(to_remove);
                      return(ret);
                   }
 
@@ -1939,11 +1950,7 @@ int remove_pores_V2(MINUTIAE *minutiae,
                      print2log("%d,%d RMD\n", minutia->x, minutia->y);
 
                      /* Then remove the minutia. */
-                     if((ret = remove_minutia(i, minutiae)))
-                        /* If system error, return error code. */
-                        return(ret);
-                     /* Set remove flag to TRUE. */
-                     removed = TRUE;
+                     to_remove[i] = TRUE;
                   }
                   /* Otherwise, traced contour is complete. */
                   else{
@@ -1976,6 +1983,7 @@ int remove_pores_V2(MINUTIAE *minutiae,
                         /* If system error occurred during trace ... */
                         if(ret < 0){
                            /* Return error code. */
+                           g_free(to_remove);
                            return(ret);
                         }
 
@@ -1994,11 +2002,7 @@ int remove_pores_V2(MINUTIAE *minutiae,
                            print2log("%d,%d RMA\n", minutia->x, minutia->y);
 
                            /* Then remove the minutia. */
-                           if((ret = remove_minutia(i, minutiae)))
-                              /* If system error, return error code. */
-                              return(ret);
-                           /* Set remove flag to TRUE. */
-                           removed = TRUE;
+                           to_remove[i] = TRUE;
                         }
                         /* Otherwise, traced contour is complete. */
                         else{
@@ -2021,6 +2025,7 @@ int remove_pores_V2(MINUTIAE *minutiae,
                            /* If system error occurred during scan ... */
                            if(ret < 0){
                               /* Return error code. */
+                              g_free(to_remove);
                               return(ret);
                            }
 
@@ -2040,11 +2045,7 @@ int remove_pores_V2(MINUTIAE *minutiae,
                                         minutia->x, minutia->y);
 
                               /* Then remove the minutia. */
-                              if((ret = remove_minutia(i, minutiae)))
-                                 /* If system error, return error code. */
-                                 return(ret);
-                              /* Set remove flag to TRUE. */
-                              removed = TRUE;
+                              to_remove[i] = TRUE;
                            }
                            /* Otherwise, traced contour is complete. */
                            else{
@@ -2077,11 +2078,7 @@ int remove_pores_V2(MINUTIAE *minutiae,
                                     print2log("RMRATIO %f\n", ratio);
 
                                     /* Then assume pore & remove minutia. */
-                                    if((ret = remove_minutia(i, minutiae)))
-                                       /* If system error, return code. */
-                                       return(ret);
-                                    /* Set remove flag to TRUE. */
-                                    removed = TRUE;
+                                    to_remove[i] = TRUE;
                                  }
                                  /* Otherwise, ratio to big, so assume */
                                  /* legitimate minutia.                */
@@ -2095,11 +2092,7 @@ int remove_pores_V2(MINUTIAE *minutiae,
                         print2log("%d,%d RMQ\n", minutia->x, minutia->y);
 
                         /* Then remove the minutia. */
-                        if((ret = remove_minutia(i, minutiae)))
-                           /* If system error, return error code. */
-                           return(ret);
-                        /* Set remove flag to TRUE. */
-                        removed = TRUE;
+                        to_remove[i] = TRUE;
                      } /* Done with Q. */
                   } /* Done with D. */
                } /* Done with B. */
@@ -2110,26 +2103,19 @@ int remove_pores_V2(MINUTIAE *minutiae,
                print2log("%d,%d RMP\n", minutia->x, minutia->y);
 
                /* Then remove the minutia. */
-               if((ret = remove_minutia(i, minutiae)))
-                  /* If system error, return error code. */
-                  return(ret);
-               /* Set remove flag to TRUE. */
-               removed = TRUE;
+               to_remove[i] = TRUE;
             }
          } /* Else, R is on pixel the same color as type, so do not */
            /* remove minutia point and skip to next one.            */
       } /* Else block is unreliable or has INVALID direction. */
+   } /* End For minutia in list. */
 
-      /* If current minutia not removed ... */
-      if(!removed)
-         /* Bump to next minutia in list. */
-         i++;
-      /* Otherwise, next minutia has slid into slot of current removed one. */
-
-   } /* End While minutia remaining in list. */
+   /* Remove all flagged minutiae from the list. */
+   ret = remove_flagged_minutiae(minutiae, to_remove);
+   g_free(to_remove);
 
    /* Return normally. */
-   return(0);
+   return(ret);
 }
 
 /*************************************************************************
@@ -57,13 +57,14 @@ of the software.
                ROUTINES:
                         sort_indices_int_inc()
                         sort_indices_double_inc()
-                        bubble_sort_int_inc_2()
+                        merge_sort_int_inc_2()
                         bubble_sort_double_inc_2()
                         bubble_sort_double_dec_2()
                         bubble_sort_int_inc()
 ***********************************************************************/
 
 #include <stdio.h>
+#include <string.h>
 #include <lfs.h>
 
 /*************************************************************************
@@ -95,7 +96,7 @@ int sort_indices_int_inc(int **optr, int *ranks, const int num)
       order[i] = i;
 
    /* Sort the indecies into rank order. */
-   bubble_sort_int_inc_2(ranks, order, num);
+   merge_sort_int_inc_2(ranks, order, num);
 
    /* Set output pointer to the resulting order of sorted indices. */
    *optr = order;
@@ -123,10 +124,12 @@ int sort_indices_int_inc(int **optr, int *ranks, const int num)
 
 /*************************************************************************
 **************************************************************************
-#cat: bubble_sort_int_inc_2 - Takes a list of integer ranks and a corresponding
-#cat:                         list of integer attributes, and sorts the ranks
-#cat:                         into increasing order moving the attributes
-#cat:                         correspondingly.
+#cat: merge_sort_int_inc_2 - Takes a list of integer ranks and a corresponding
+#cat:                        list of integer attributes, and sorts the ranks
+#cat:                        into increasing order moving the attributes
+#cat:                        correspondingly.  The sort is stable, so equal
+#cat:                        ranks keep their relative order, exactly as with
+#cat:                        a bubble sort, but in O(N log N) time.
 
    Input:
       ranks     - list of integers to be sort on
@@ -136,40 +139,47 @@ int sort_indices_int_inc(int **optr, int *ranks, const int num)
       ranks     - list of integers sorted in increasing order
       items     - list of attributes in corresponding sorted order
 **************************************************************************/
-void bubble_sort_int_inc_2(int *ranks, int *items, const int len)
+void merge_sort_int_inc_2(int *ranks, int *items, const int len)
 {
-   int done = 0;
-   int i, p, n, trank, titem;
-
-   /* Set counter to the length of the list being sorted. */
-   n = len;
-
-   /* While swaps in order continue to occur from the */
-   /* previous iteration...                           */
-   while(!done){
-      /* Reset the done flag to TRUE. */
-      done = TRUE;
-      /* Foreach rank in list up to current end index...               */
-      /* ("p" points to current rank and "i" points to the next rank.) */
-      for (i=1, p = 0; i<n; i++, p++){
-         /* If previous rank is < current rank ... */
-         if(ranks[p] > ranks[i]){
-            /* Swap ranks. */
-            trank = ranks[i];
-            ranks[i] = ranks[p];
-            ranks[p] = trank;
-            /* Swap items. */
-            titem = items[i];
-            items[i] = items[p];
-            items[p] = titem;
-            /* Changes were made, so set done flag to FALSE. */
-            done = FALSE;
+   int *tranks, *titems;
+   int width, lo, mid, hi, i, l, r;
+
+   if(len < 2)
+      return;
+
+   tranks = (int *)g_malloc(len * sizeof(int));
+   titems = (int *)g_malloc(len * sizeof(int));
+
+   /* Bottom-up merge of runs of doubling width. */
+   for(width = 1; width < len; width <<= 1){
+      for(lo = 0; lo < len - width; lo += (width<<1)){
+         mid = lo + width;
+         hi = min(lo + (width<<1), len);
+
+         /* Runs already in order, nothing to merge. */
+         if(ranks[mid-1] <= ranks[mid])
+            continue;
+
+         l = lo;
+         r = mid;
+         for(i = lo; i < hi; i++){
+            /* Take from the left run on ties to keep the sort stable. */
+            if((r >= hi) || ((l < mid) && (ranks[l] <= ranks[r]))){
+               tranks[i] = ranks[l];
+               titems[i] = items[l++];
+            }
+            else{
+               tranks[i] = ranks[r];
+               titems[i] = items[r++];
+            }
          }
-         /* Otherwise, rank pair is in order, so continue. */
+         memcpy(ranks+lo, tranks+lo, (hi-lo) * sizeof(int));
+         memcpy(items+lo, titems+lo, (hi-lo) * sizeof(int));
       }
-      /* Decrement the ending index. */
-      n--;
    }
+
+   g_free(tranks);
+   g_free(titems);
 }
 
 /*************************************************************************
@@ -198,3 +198,27 @@ patch -p0 < fix-scan-build-reports.patch
 
 # Add pass to remove perimeter points
 patch -p0 < remove-perimeter-pts.patch
+
+# Index minutiae spatially and compact lists once when removing
+patch -p0 < spatial-minutiae-removal.patch
+
+# Binarize runs of pixels sharing a direction using vector types
+patch -p0 < vectorize-dirbinarize.patch
+
+# Allow building the DFT direction analysis with single precision floats
+patch -p0 < dft-real-type.patch
+
+# Allow skipping ridge counting and the quality map
+patch -p0 < optional-outputs.patch
+
+# Fill holes on a bit-packed copy of the binarized image
+patch -p0 < bitpacked-fill-holes.patch
+
+# Find minutia scan candidates on bit-packed scan lines
+patch -p0 < bitparallel-minutiae-scan.patch
+
+# Skip island/lake contour traces between unconnected pixels
+patch -p0 < island-lake-components.patch
+
+# Allow reusing lookup tables and the padded image across images
+patch -p0 < reusable-lfs-tables.patch
@@ -0,0 +1,171 @@
+/*
+ * Unit tests for the FpImage minutiae detection
+ * Copyright (C) 2026 libfprint contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <math.h>
+#include <string.h>
+#include <nbis.h>
+
+#include "fpi-image.h"
+
+/* Parallel ridges with a few dislocations, each of which creates a minutia */
+static FpImage *
+synthetic_image (int width, int height, double shift)
+{
+  const double centers[][2] = { { 0.3, 0.3 }, { 0.7, 0.4 }, { 0.4, 0.7 } };
+  FpImage *image = fp_image_new (width, height);
+
+  for (int y = 0; y < height; y++)
+    for (int x = 0; x < width; x++)
+      {
+        double phase = 2 * G_PI * (x + 0.3 * y + shift) / 9.0;
+
+        for (guint i = 0; i < G_N_ELEMENTS (centers); i++)
+          phase += atan2 (y - centers[i][1] * height, x - centers[i][0] * width);
+
+        image->data[y * width + x] = 128 + 100 * sin (phase);
+      }
+
+  return image;
+}
+
+static FpImage *
+copy_image (FpImage *image)
+{
+  FpImage *copy = fp_image_new (image->width, image->height);
+
+  memcpy (copy->data, image->data, image->width * image->height);
+  copy->flags = image->flags;
+
+  return copy;
+}
+
+static void
+on_detected (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+  g_autoptr(GError) error = NULL;
+  guint *pending = user_data;
+
+  /* Blank images fail, like they do in the batch */
+  if (!fp_image_detect_minutiae_finish (FP_IMAGE (source), res, &error))
+    g_assert_error (error, G_IO_ERROR, G_IO_ERROR_FAILED);
+
+  *pending -= 1;
+}
+
+static void
+on_batch_detected (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+  g_autoptr(GError) error = NULL;
+  guint *pending = user_data;
+
+  g_assert_true (fp_image_detect_minutiae_batch_finish (res, &error));
+  g_assert_no_error (error);
+
+  *pending -= 1;
+}
+
+static void
+assert_same_detection (FpImage *a, FpImage *b)
+{
+  GPtrArray *ma = fp_image_get_minutiae (a);
+  GPtrArray *mb = fp_image_get_minutiae (b);
+  const guchar *ba, *bb;
+  gsize la = 0, lb = 0;
+
+  g_assert_cmpint (a->width, ==, b->width);
+  g_assert_cmpint (a->height, ==, b->height);
+
+  if (!ma)
+    {
+      g_assert_null (mb);
+      return;
+    }
+
+  g_assert_nonnull (mb);
+  g_assert_cmpuint (ma->len, ==, mb->len);
+  for (guint i = 0; i < ma->len; i++)
+    {
+      struct fp_minutia *pa = g_ptr_array_index (ma, i);
+      struct fp_minutia *pb = g_ptr_array_index (mb, i);
+
+      g_assert_cmpint (pa->x, ==, pb->x);
+      g_assert_cmpint (pa->y, ==, pb->y);
+      g_assert_cmpint (pa->direction, ==, pb->direction);
+      g_assert_cmpint (pa->type, ==, pb->type);
+      g_assert_cmpfloat (pa->reliability, ==, pb->reliability);
+      g_assert_cmpint (pa->num_nbrs, ==, pb->num_nbrs);
+    }
+
+  ba = fp_image_get_binarized (a, &la);
+  bb = fp_image_get_binarized (b, &lb);
+  g_assert_cmpmem (ba, la, bb, lb);
+}
+
+static void
+test_detect_minutiae_batch (void)
+{
+  g_autoptr(GPtrArray) single = g_ptr_array_new_with_free_func (g_object_unref);
+  g_autoptr(GPtrArray) batch = g_ptr_array_new_with_free_func (g_object_unref);
+  FpImage *blank;
+  guint pending;
+  guint i;
+
+  /* Changing widths force the reused tables to be rebuilt in between */
+  g_ptr_array_add (single, synthetic_image (160, 160, 0));
+  g_ptr_array_add (single, synthetic_image (200, 120, 2));
+  g_ptr_array_add (single, synthetic_image (160, 160, 4));
+  g_ptr_array_add (single, synthetic_image (120, 200, 6));
+  g_ptr_array_add (single, synthetic_image (160, 160, 8));
+  blank = fp_image_new (100, 100);
+  memset (blank->data, 0x80, 100 * 100);
+  g_ptr_array_add (single, blank);
+
+  for (i = 0; i < single->len; i++)
+    g_ptr_array_add (batch, copy_image (g_ptr_array_index (single, i)));
+
+  pending = single->len;
+  for (i = 0; i < single->len; i++)
+    fp_image_detect_minutiae (g_ptr_array_index (single, i), NULL,
+                              on_detected, &pending);
+  while (pending > 0)
+    g_main_context_iteration (NULL, TRUE);
+
+  pending = 1;
+  fp_image_detect_minutiae_batch (batch, 2, NULL, on_batch_detected, &pending);
+  while (pending > 0)
+    g_main_context_iteration (NULL, TRUE);
+
+  for (i = 0; i < single->len; i++)
+    assert_same_detection (g_ptr_array_index (single, i),
+                           g_ptr_array_index (batch, i));
+
+  /* The synthetic prints must actually have been detected */
+  g_assert_nonnull (fp_image_get_minutiae (g_ptr_array_index (batch, 0)));
+  g_assert_null (fp_image_get_minutiae (blank));
+}
+
+int
+main (int argc, char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/image/detect-minutiae-batch", test_detect_minutiae_batch);
+
+  return g_test_run ();
+}
@@ -0,0 +1,103 @@
+/*
+ * Unit tests for the calibration cache
+ * Copyright (C) 2026 libfprint contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <glib/gstdio.h>
+#include <libfprint/fprint.h>
+
+#include "fpi-calibration-cache.h"
+#include "test-device-fake.h"
+
+static gchar *cache_dir = NULL;
+
+static gchar *
+get_cache_file (void)
+{
+  g_autoptr(GDir) dir = g_dir_open (cache_dir, 0, NULL);
+  const gchar *name = g_dir_read_name (dir);
+
+  g_assert_nonnull (name);
+  g_assert_true (g_str_has_suffix (name, ".calibration"));
+  g_assert_null (g_dir_read_name (dir));
+
+  return g_build_filename (cache_dir, name, NULL);
+}
+
+static void
+test_calibration_cache_roundtrip (void)
+{
+  g_autoptr(FpDevice) device = g_object_new (FPI_TYPE_DEVICE_FAKE, NULL);
+  g_autoptr(GBytes) data = g_bytes_new_static ("\x01\x02\x03", 3);
+  g_autoptr(GBytes) loaded = NULL;
+
+  g_assert_true (fpi_calibration_cache_enabled ());
+  g_assert_null (fpi_calibration_cache_load (device, "v1"));
+
+  fpi_calibration_cache_store (device, "v1", data);
+  loaded = fpi_calibration_cache_load (device, "v1");
+  g_assert_nonnull (loaded);
+  g_assert_true (g_bytes_equal (loaded, data));
+
+  /* Stored data is only returned for the same version */
+  g_assert_null (fpi_calibration_cache_load (device, "v2"));
+
+  fpi_calibration_cache_discard (device);
+  g_assert_null (fpi_calibration_cache_load (device, "v1"));
+}
+
+static void
+test_calibration_cache_corrupt (void)
+{
+  g_autoptr(FpDevice) device = g_object_new (FPI_TYPE_DEVICE_FAKE, NULL);
+  g_autoptr(GBytes) data = g_bytes_new_static ("\x01\x02\x03", 3);
+  g_autofree gchar *path = NULL;
+
+  fpi_calibration_cache_store (device, "v1", data);
+  path = get_cache_file ();
+  g_assert_true (g_file_set_contents (path, "\xff\xff\xff", 3, NULL));
+
+  g_test_expect_message ("libfprint-calibration", G_LOG_LEVEL_WARNING,
+                         "Ignoring corrupt calibration cache*");
+  g_assert_null (fpi_calibration_cache_load (device, "v1"));
+  g_test_assert_expected_messages ();
+
+  fpi_calibration_cache_discard (device);
+  g_assert_false (g_file_test (path, G_FILE_TEST_EXISTS));
+}
+
+int
+main (int argc, char *argv[])
+{
+  int ret;
+
+  g_test_init (&argc, &argv, NULL);
+
+  cache_dir = g_dir_make_tmp ("libfprint-calibration-XXXXXX", NULL);
+  g_assert_nonnull (cache_dir);
+  g_setenv ("FP_CALIBRATION_CACHE", cache_dir, TRUE);
+
+  g_test_add_func ("/calibration-cache/roundtrip", test_calibration_cache_roundtrip);
+  g_test_add_func ("/calibration-cache/corrupt", test_calibration_cache_corrupt);
+
+  ret = g_test_run ();
+
+  g_rmdir (cache_dir);
+  g_free (cache_dir);
+
+  return ret;
+}
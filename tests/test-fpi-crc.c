@@ -0,0 +1,81 @@
+/*
+ * Unit tests for the CRC helpers
+ * Copyright (C) 2026 libfprint contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <glib.h>
+
+#include "fpi-crc.h"
+
+static const guint8 check_data[] = "123456789";
+
+static void
+test_crc32 (void)
+{
+  g_autoptr(GRand) rand = g_rand_new_with_seed (0x63726333);
+  guint8 buf[1000];
+  guint32 bitwise = 0xffffffff;
+  gsize i, j;
+
+  g_assert_cmpuint (fpi_crc32 (0, check_data, 9), ==, 0xcbf43926);
+  g_assert_cmpuint (fpi_crc32 (0, NULL, 0), ==, 0);
+
+  for (i = 0; i < sizeof (buf); i++)
+    buf[i] = g_rand_int_range (rand, 0, 256);
+
+  for (i = 0; i < sizeof (buf); i++)
+    {
+      bitwise ^= buf[i];
+      for (j = 0; j < 8; j++)
+        bitwise = (bitwise >> 1) ^ (bitwise & 1 ? 0xedb88320 : 0);
+    }
+
+  /* Unaligned start and lengths that are not a multiple of 8 */
+  g_assert_cmpuint (fpi_crc32 (0, buf, sizeof (buf)), ==, ~bitwise);
+  for (i = 0; i < 16; i++)
+    g_assert_cmpuint (fpi_crc32 (fpi_crc32 (0, buf, i), buf + i, sizeof (buf) - i),
+                      ==, ~bitwise);
+}
+
+static void
+test_crc16_ccitt (void)
+{
+  g_assert_cmpuint (fpi_crc16_ccitt (0, check_data, 9), ==, 0x31c3);
+  g_assert_cmpuint (fpi_crc16_ccitt (0xffff, check_data, 9), ==, 0x29b1);
+  g_assert_cmpuint (fpi_crc16_ccitt (fpi_crc16_ccitt (0, check_data, 4), check_data + 4, 5),
+                    ==, 0x31c3);
+}
+
+static void
+test_crc8 (void)
+{
+  g_assert_cmpuint (fpi_crc8 (0, check_data, 9), ==, 0xf4);
+  g_assert_cmpuint (fpi_crc8 (fpi_crc8 (0, check_data, 3), check_data + 3, 6),
+                    ==, 0xf4);
+}
+
+int
+main (int argc, char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/crc/crc32", test_crc32);
+  g_test_add_func ("/crc/crc16-ccitt", test_crc16_ccitt);
+  g_test_add_func ("/crc/crc8", test_crc8);
+
+  return g_test_run ();
+}
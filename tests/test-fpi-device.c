@@ -24,8 +24,10 @@
 #define FP_COMPONENT "device"
 
 #include "fpi-device.h"
+#include "fp-device-private.h"
 #include "fpi-compat.h"
 #include "fpi-log.h"
+#include "fpi-usb-transfer.h"
 #include "test-device-fake.h"
 
 /* Utility functions */
@@ -512,6 +514,243 @@ test_driver_get_driver_data (void)
   g_assert_cmpuint (fpi_device_get_driver_data (device), ==, driver_data);
 }
 
+static void
+test_driver_get_transfer_stats (void)
+{
+  g_autoptr(FpDevice) device = g_object_new (FPI_TYPE_DEVICE_FAKE, NULL);
+  g_autoptr(GError) timeout_error = NULL;
+  g_autoptr(GError) cancel_error = NULL;
+  g_autoptr(GVariant) stats = NULL;
+  g_autoptr(GVariant) endpoint = NULL;
+  g_autoptr(GVariant) histogram = NULL;
+  const guint64 *buckets;
+  gsize n_buckets;
+  guint64 value;
+  guint8 address;
+
+  stats = fp_device_get_transfer_stats (device);
+  g_assert_cmpstr (g_variant_get_type_string (stats), ==, "aa{sv}");
+  g_assert_cmpuint (g_variant_n_children (stats), ==, 0);
+  g_clear_pointer (&stats, g_variant_unref);
+
+  timeout_error = g_error_new_literal (G_USB_DEVICE_ERROR, G_USB_DEVICE_ERROR_TIMED_OUT, "Timed out");
+  cancel_error = g_error_new_literal (G_IO_ERROR, G_IO_ERROR_CANCELLED, "Cancelled");
+
+  fpi_device_update_transfer_stats (device, FPI_TRANSFER_TRACE_BUS_USB, 0x81, 64, 500, NULL);
+  fpi_device_update_transfer_stats (device, FPI_TRANSFER_TRACE_BUS_USB, 0x81, 32, 3000, NULL);
+  fpi_device_update_transfer_stats (device, FPI_TRANSFER_TRACE_BUS_USB, 0x81, -1, 20 * G_USEC_PER_SEC, timeout_error);
+  fpi_device_update_transfer_stats (device, FPI_TRANSFER_TRACE_BUS_USB, 0x81, 0, 100, cancel_error);
+  fpi_device_update_transfer_stats (device, FPI_TRANSFER_TRACE_BUS_SPI, 0, 10, 100, NULL);
+
+  g_object_get (device, "transfer-stats", &stats, NULL);
+  g_assert_cmpuint (g_variant_n_children (stats), ==, 2);
+
+  endpoint = g_variant_get_child_value (stats, 0);
+  g_assert_true (g_variant_lookup (endpoint, "endpoint", "y", &address));
+  g_assert_cmpuint (address, ==, 0x81);
+  g_assert_true (g_variant_lookup (endpoint, "transfers", "t", &value));
+  g_assert_cmpuint (value, ==, 4);
+  g_assert_true (g_variant_lookup (endpoint, "bytes", "t", &value));
+  g_assert_cmpuint (value, ==, 96);
+  g_assert_true (g_variant_lookup (endpoint, "errors", "t", &value));
+  g_assert_cmpuint (value, ==, 0);
+  g_assert_true (g_variant_lookup (endpoint, "timeouts", "t", &value));
+  g_assert_cmpuint (value, ==, 1);
+  g_assert_true (g_variant_lookup (endpoint, "cancelled", "t", &value));
+  g_assert_cmpuint (value, ==, 1);
+  g_assert_true (g_variant_lookup (endpoint, "latency-max", "t", &value));
+  g_assert_cmpuint (value, ==, 20 * G_USEC_PER_SEC);
+
+  histogram = g_variant_lookup_value (endpoint, "latency-histogram", G_VARIANT_TYPE ("at"));
+  buckets = g_variant_get_fixed_array (histogram, &n_buckets, sizeof (guint64));
+  g_assert_cmpuint (n_buckets, ==, 15);
+  g_assert_cmpuint (buckets[0], ==, 2);
+  g_assert_cmpuint (buckets[2], ==, 1);
+  g_assert_cmpuint (buckets[14], ==, 1);
+  g_clear_pointer (&histogram, g_variant_unref);
+
+  /* 64 and 32 bytes, the failed transfers count as transferring nothing */
+  histogram = g_variant_lookup_value (endpoint, "bytes-histogram", G_VARIANT_TYPE ("at"));
+  buckets = g_variant_get_fixed_array (histogram, &n_buckets, sizeof (guint64));
+  g_assert_cmpuint (n_buckets, ==, 18);
+  g_assert_cmpuint (buckets[0], ==, 2);
+  g_assert_cmpuint (buckets[1], ==, 0);
+  g_assert_cmpuint (buckets[6], ==, 1);
+  g_assert_cmpuint (buckets[7], ==, 1);
+  g_clear_pointer (&histogram, g_variant_unref);
+  g_clear_pointer (&endpoint, g_variant_unref);
+
+  endpoint = g_variant_get_child_value (stats, 1);
+  g_assert_false (g_variant_lookup (endpoint, "endpoint", "y", &address));
+  g_assert_true (g_variant_lookup (endpoint, "bytes", "t", &value));
+  g_assert_cmpuint (value, ==, 10);
+}
+
+static void
+test_driver_usb_transfer_pool (void)
+{
+  g_autoptr(FpDevice) device = g_object_new (FPI_TYPE_DEVICE_FAKE, NULL);
+  g_autoptr(FpiUsbTransfer) kept = NULL;
+  FpiUsbTransfer *transfer;
+  FpiUsbTransfer *recycled;
+  guint8 *buffer;
+  guint8 *large;
+
+  transfer = fpi_usb_transfer_new (device);
+  fpi_usb_transfer_fill_bulk (transfer, FPI_USB_ENDPOINT_IN | 0x01, 100);
+  transfer->buffer[0] = 0xff;
+  transfer->buffer[99] = 0xff;
+  buffer = transfer->buffer;
+  fpi_usb_transfer_unref (transfer);
+
+  /* The transfer and its buffer are reused and cleared */
+  recycled = fpi_usb_transfer_new (device);
+  g_assert_true (recycled == transfer);
+  g_assert_cmpint (recycled->type, ==, FP_TRANSFER_NONE);
+  g_assert_null (recycled->buffer);
+
+  fpi_usb_transfer_fill_bulk (recycled, FPI_USB_ENDPOINT_IN | 0x01, 128);
+  g_assert_true (recycled->buffer == buffer);
+  g_assert_cmpuint (recycled->buffer[0], ==, 0);
+  g_assert_cmpuint (recycled->buffer[99], ==, 0);
+  fpi_usb_transfer_unref (recycled);
+
+  /* Explicitly allocated buffers share the pool */
+  buffer = fpi_usb_buffer_new (device, 64);
+  fpi_usb_buffer_free (buffer);
+  g_assert_true (fpi_usb_buffer_new (device, 33) == buffer);
+  fpi_usb_buffer_free (buffer);
+
+  /* Buffers larger than the largest size class are not cached */
+  large = fpi_usb_buffer_new (device, 1024 * 1024);
+  g_assert_cmpuint (large[1024 * 1024 - 1], ==, 0);
+  fpi_usb_buffer_free (large);
+
+  /* A transfer may outlive the device */
+  kept = fpi_usb_transfer_new (device);
+  fpi_usb_transfer_fill_bulk (kept, FPI_USB_ENDPOINT_OUT | 0x01, 16);
+  g_clear_object (&device);
+}
+
+static void
+test_driver_usb_stream_data_cb (FpiUsbStream *stream, FpiUsbTransfer *transfer,
+                                FpDevice *device, gpointer user_data,
+                                GError *error)
+{
+  g_assert_not_reached ();
+}
+
+static void
+test_driver_usb_stream_stopped_cb (FpiUsbStream *stream, FpDevice *device,
+                                   gpointer user_data, GError *error)
+{
+  GError **stop_error = user_data;
+
+  g_assert_false (fpi_usb_stream_is_running (stream));
+  g_assert_null (*stop_error);
+
+  if (error)
+    *stop_error = error;
+  else
+    *stop_error = g_error_new_literal (G_IO_ERROR, G_IO_ERROR_FAILED, "Stopped");
+}
+
+static void
+test_driver_usb_stream (void)
+{
+  g_autoptr(FpDevice) device = g_object_new (FPI_TYPE_DEVICE_FAKE, NULL);
+  g_autoptr(GCancellable) cancellable = g_cancellable_new ();
+  g_autoptr(FpiUsbStream) stream = NULL;
+  g_autoptr(GError) error = NULL;
+
+  /* Transfers submitted with a cancelled cancellable complete without
+   * touching the USB device, which lets us run the stream here. */
+  g_cancellable_cancel (cancellable);
+
+  stream = fpi_usb_stream_new (device, FPI_USB_ENDPOINT_IN | 0x01, 64, 3);
+  g_assert_false (fpi_usb_stream_is_running (stream));
+
+  /* Cancellation stops the stream and is reported */
+  fpi_usb_stream_start (stream, 0, cancellable,
+                        test_driver_usb_stream_data_cb,
+                        test_driver_usb_stream_stopped_cb, &error);
+  g_assert_true (fpi_usb_stream_is_running (stream));
+  while (fpi_usb_stream_is_running (stream))
+    g_main_context_iteration (NULL, TRUE);
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+  g_clear_error (&error);
+
+  /* A stopped stream can be started again, stopping it reports no error */
+  fpi_usb_stream_start (stream, 0, cancellable,
+                        test_driver_usb_stream_data_cb,
+                        test_driver_usb_stream_stopped_cb, &error);
+  fpi_usb_stream_stop (stream);
+  fpi_usb_stream_stop (stream);
+  g_assert_true (fpi_usb_stream_is_running (stream));
+  while (fpi_usb_stream_is_running (stream))
+    g_main_context_iteration (NULL, TRUE);
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_FAILED);
+  g_clear_error (&error);
+
+  /* Freeing a running stream neither warns nor calls back */
+  fpi_usb_stream_start (stream, 0, cancellable,
+                        test_driver_usb_stream_data_cb,
+                        test_driver_usb_stream_stopped_cb, &error);
+  g_clear_pointer (&stream, fpi_usb_stream_free);
+  while (g_main_context_iteration (NULL, FALSE))
+    continue;
+  g_assert_no_error (error);
+}
+
+static void
+test_driver_usb_transfer_batch_cb (FpDevice *device, gpointer user_data,
+                                   GError *error)
+{
+  GError **batch_error = user_data;
+
+  g_assert_null (*batch_error);
+  g_assert_nonnull (error);
+
+  *batch_error = error;
+}
+
+static void
+test_driver_usb_transfer_batch (void)
+{
+  g_autoptr(FpDevice) device = g_object_new (FPI_TYPE_DEVICE_FAKE, NULL);
+  g_autoptr(GCancellable) cancellable = g_cancellable_new ();
+  g_autoptr(FpiUsbTransfer) recycled = NULL;
+  g_autoptr(GError) error = NULL;
+  FpiUsbTransfer *transfers[4];
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (transfers); i++)
+    {
+      transfers[i] = fpi_usb_transfer_new (device);
+      fpi_usb_transfer_fill_bulk (transfers[i], FPI_USB_ENDPOINT_OUT | 0x01, 16);
+    }
+
+  /* Transfers submitted with a cancelled cancellable complete without
+   * touching the USB device. The callback only runs once all of them have
+   * returned and gets the first error. */
+  g_cancellable_cancel (cancellable);
+  fpi_usb_transfer_submit_batch (transfers, G_N_ELEMENTS (transfers), 0,
+                                 cancellable,
+                                 test_driver_usb_transfer_batch_cb, &error);
+  g_assert_null (error);
+
+  while (!error)
+    g_main_context_iteration (NULL, TRUE);
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+
+  /* The batch released the transfers, so they are recycled */
+  recycled = fpi_usb_transfer_new (device);
+  for (i = 0; i < G_N_ELEMENTS (transfers); i++)
+    if (recycled == transfers[i])
+      break;
+  g_assert_cmpuint (i, <, G_N_ELEMENTS (transfers));
+}
+
 static void
 test_driver_features_probe_updates (void)
 {
@@ -2467,6 +2706,67 @@ test_driver_list_no_storage (void)
   g_assert_error (error, FP_DEVICE_ERROR, FP_DEVICE_ERROR_NOT_SUPPORTED);
 }
 
+static void
+test_driver_list_cached (void)
+{
+  g_autoptr(FpAutoResetClass) dev_class = auto_reset_device_class ();
+  g_autoptr(FpAutoCloseDevice) device = NULL;
+  g_autoptr(GPtrArray) prints = NULL;
+  g_autoptr(GPtrArray) cached_prints = NULL;
+  g_autoptr(GPtrArray) new_prints = NULL;
+  g_autoptr(GError) error = NULL;
+  FpiDeviceFake *fake_dev;
+  guint i;
+
+  dev_class->cache_stored_prints = TRUE;
+
+  device = auto_close_fake_device_new ();
+  fake_dev = FPI_DEVICE_FAKE (device);
+
+  fake_dev->ret_list = make_fake_prints_gallery (device, 10);
+  prints = fp_device_list_prints_sync (device, NULL, &error);
+  g_assert (fake_dev->last_called_function == dev_class->list);
+  g_assert_no_error (error);
+  g_assert (prints == fake_dev->ret_list);
+
+  /* The second listing does not reach the driver */
+  fake_dev->ret_list = NULL;
+  fake_dev->last_called_function = NULL;
+  cached_prints = fp_device_list_prints_sync (device, NULL, &error);
+  g_assert_null (fake_dev->last_called_function);
+  g_assert_no_error (error);
+  g_assert (cached_prints != prints);
+  g_assert_cmpuint (cached_prints->len, ==, prints->len);
+  for (i = 0; i < prints->len; i++)
+    {
+      g_assert (g_ptr_array_index (cached_prints, i) != g_ptr_array_index (prints, i));
+      g_assert_true (fp_print_equal (g_ptr_array_index (cached_prints, i),
+                                     g_ptr_array_index (prints, i)));
+    }
+
+  /* Modifying the returned prints does not modify the cache */
+  fp_print_set_description (g_ptr_array_index (prints, 0), "Modified");
+  fp_print_set_description (g_ptr_array_index (cached_prints, 1), "Modified");
+  g_clear_pointer (&cached_prints, g_ptr_array_unref);
+  cached_prints = fp_device_list_prints_sync (device, NULL, &error);
+  g_assert_null (fake_dev->last_called_function);
+  g_assert_no_error (error);
+  g_assert_null (fp_print_get_description (g_ptr_array_index (cached_prints, 0)));
+  g_assert_null (fp_print_get_description (g_ptr_array_index (cached_prints, 1)));
+
+  /* Modifying the storage drops the cache */
+  g_assert_true (fp_device_delete_print_sync (device, g_ptr_array_index (prints, 0),
+                                              NULL, &error));
+  g_assert_no_error (error);
+  g_assert (fake_dev->last_called_function == dev_class->delete);
+
+  fake_dev->ret_list = make_fake_prints_gallery (device, 9);
+  new_prints = fp_device_list_prints_sync (device, NULL, &error);
+  g_assert (fake_dev->last_called_function == dev_class->list);
+  g_assert_no_error (error);
+  g_assert (new_prints == fake_dev->ret_list);
+}
+
 static void
 test_driver_delete (void)
 {
@@ -3283,6 +3583,10 @@ main (int argc, char *argv[])
   g_test_add_func ("/driver/get_usb_device", test_driver_get_usb_device);
   g_test_add_func ("/driver/get_virtual_env", test_driver_get_virtual_env);
   g_test_add_func ("/driver/get_driver_data", test_driver_get_driver_data);
+  g_test_add_func ("/driver/get_transfer_stats", test_driver_get_transfer_stats);
+  g_test_add_func ("/driver/usb_transfer_pool", test_driver_usb_transfer_pool);
+  g_test_add_func ("/driver/usb_stream", test_driver_usb_stream);
+  g_test_add_func ("/driver/usb_transfer_batch", test_driver_usb_transfer_batch);
   g_test_add_func ("/driver/features/probe_updates", test_driver_features_probe_updates);
   g_test_add_func ("/driver/initial_features", test_driver_initial_features);
   g_test_add_func ("/driver/initial_features/none", test_driver_initial_features_none);
@@ -3335,6 +3639,7 @@ main (int argc, char *argv[])
   g_test_add_func ("/driver/list", test_driver_list);
   g_test_add_func ("/driver/list/error", test_driver_list_error);
   g_test_add_func ("/driver/list/no_storage", test_driver_list_no_storage);
+  g_test_add_func ("/driver/list/cached", test_driver_list_cached);
   g_test_add_func ("/driver/delete", test_driver_delete);
   g_test_add_func ("/driver/delete/error", test_driver_delete_error);
   g_test_add_func ("/driver/clear_storage", test_driver_clear_storage);
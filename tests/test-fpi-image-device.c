@@ -0,0 +1,407 @@
+/*
+ * Unit tests for keeping image devices active between actions
+ * Copyright (C) 2026 libfprint contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <math.h>
+#include <libfprint/fprint.h>
+
+#define FP_COMPONENT "fake_image_test_dev"
+
+#include "fpi-image-device.h"
+#include "fpi-image.h"
+
+/* An image device that puts a finger on the sensor whenever it waits for one */
+#define FPI_TYPE_DEVICE_FAKE_IMAGE (fpi_device_fake_image_get_type ())
+G_DECLARE_FINAL_TYPE (FpiDeviceFakeImage, fpi_device_fake_image, FPI, DEVICE_FAKE_IMAGE, FpImageDevice)
+
+struct _FpiDeviceFakeImage
+{
+  FpImageDevice parent;
+
+  guint         activations;
+  guint         deactivations;
+  gboolean      defer_deactivate;
+};
+
+G_DEFINE_TYPE (FpiDeviceFakeImage, fpi_device_fake_image, FP_TYPE_IMAGE_DEVICE)
+
+static const FpIdEntry driver_ids[] = {
+  { .virtual_envvar = "FP_VIRTUAL_FAKE_IMAGE_DEVICE" },
+  { .virtual_envvar = NULL }
+};
+
+/* Parallel ridges with a few dislocations, each of which creates a minutia */
+static FpImage *
+synthetic_image (void)
+{
+  const double centers[][2] = { { 0.3, 0.3 }, { 0.7, 0.4 }, { 0.4, 0.7 } };
+  const int width = 160, height = 160;
+  FpImage *image = fp_image_new (width, height);
+
+  for (int y = 0; y < height; y++)
+    for (int x = 0; x < width; x++)
+      {
+        double phase = 2 * G_PI * (x + 0.3 * y) / 9.0;
+
+        for (guint i = 0; i < G_N_ELEMENTS (centers); i++)
+          phase += atan2 (y - centers[i][1] * height, x - centers[i][0] * width);
+
+        image->data[y * width + x] = 128 + 100 * sin (phase);
+      }
+
+  return image;
+}
+
+static void
+fake_image_open (FpImageDevice *dev)
+{
+  fpi_image_device_open_complete (dev, NULL);
+}
+
+static void
+fake_image_close (FpImageDevice *dev)
+{
+  fpi_image_device_close_complete (dev, NULL);
+}
+
+static void
+fake_image_activate (FpImageDevice *dev)
+{
+  FpiDeviceFakeImage *self = FPI_DEVICE_FAKE_IMAGE (dev);
+
+  self->activations += 1;
+  fpi_image_device_activate_complete (dev, NULL);
+}
+
+static void
+fake_image_deactivate (FpImageDevice *dev)
+{
+  FpiDeviceFakeImage *self = FPI_DEVICE_FAKE_IMAGE (dev);
+
+  self->deactivations += 1;
+
+  /* The test completes the deactivation itself */
+  if (self->defer_deactivate)
+    return;
+
+  fpi_image_device_deactivate_complete (dev, NULL);
+}
+
+static void
+fake_image_finger_on (FpDevice *dev, gpointer user_data)
+{
+  fpi_image_device_report_finger_status (FP_IMAGE_DEVICE (dev), TRUE);
+}
+
+static void
+fake_image_submit (FpDevice *dev, gpointer user_data)
+{
+  fpi_image_device_image_captured (FP_IMAGE_DEVICE (dev), synthetic_image ());
+}
+
+static void
+fake_image_finger_off (FpDevice *dev, gpointer user_data)
+{
+  fpi_image_device_report_finger_status (FP_IMAGE_DEVICE (dev), FALSE);
+}
+
+static void
+fake_image_change_state (FpImageDevice *dev, FpiImageDeviceState state)
+{
+  /* Continue from the main loop, we are inside the state change here */
+  switch (state)
+    {
+    case FPI_IMAGE_DEVICE_STATE_AWAIT_FINGER_ON:
+      fpi_device_add_timeout (FP_DEVICE (dev), 0, fake_image_finger_on, NULL, NULL);
+      break;
+
+    case FPI_IMAGE_DEVICE_STATE_CAPTURE:
+      fpi_device_add_timeout (FP_DEVICE (dev), 0, fake_image_submit, NULL, NULL);
+      break;
+
+    case FPI_IMAGE_DEVICE_STATE_AWAIT_FINGER_OFF:
+      fpi_device_add_timeout (FP_DEVICE (dev), 0, fake_image_finger_off, NULL, NULL);
+      break;
+
+    default:
+      break;
+    }
+}
+
+static void
+fpi_device_fake_image_init (FpiDeviceFakeImage *self)
+{
+}
+
+static void
+fpi_device_fake_image_class_init (FpiDeviceFakeImageClass *klass)
+{
+  FpDeviceClass *dev_class = FP_DEVICE_CLASS (klass);
+  FpImageDeviceClass *img_class = FP_IMAGE_DEVICE_CLASS (klass);
+
+  dev_class->id = FP_COMPONENT;
+  dev_class->full_name = "Fake image device for testing";
+  dev_class->type = FP_DEVICE_TYPE_VIRTUAL;
+  dev_class->id_table = driver_ids;
+
+  /* Tests that need the temperature model enable it */
+  dev_class->temp_hot_seconds = -1;
+
+  img_class->img_open = fake_image_open;
+  img_class->img_close = fake_image_close;
+  img_class->activate = fake_image_activate;
+  img_class->deactivate = fake_image_deactivate;
+  img_class->change_state = fake_image_change_state;
+}
+
+/* Utility functions */
+
+static FpDevice *
+fake_image_device_new (void)
+{
+  g_autoptr(GError) error = NULL;
+  FpDevice *device = g_object_new (FPI_TYPE_DEVICE_FAKE_IMAGE, NULL);
+
+  if (!fp_device_open_sync (device, NULL, &error))
+    g_error ("Could not open device: %s", error->message);
+
+  return device;
+}
+
+static FpiImageDeviceState
+image_device_state (FpDevice *device)
+{
+  FpiImageDeviceState state;
+
+  g_object_get (device, "fpi-image-device-state", &state, NULL);
+
+  return state;
+}
+
+static void
+capture_and_check (FpDevice *device)
+{
+  g_autoptr(FpImage) image = NULL;
+  g_autoptr(GError) error = NULL;
+
+  image = fp_device_capture_sync (device, TRUE, NULL, &error);
+  g_assert_no_error (error);
+  g_assert_nonnull (image);
+}
+
+typedef struct
+{
+  gboolean completed;
+  FpImage *image;
+  GError  *error;
+} CaptureData;
+
+static void
+on_capture_done (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+  CaptureData *data = user_data;
+
+  data->image = fp_device_capture_finish (FP_DEVICE (source), res, &data->error);
+  data->completed = TRUE;
+}
+
+/* Tests */
+
+static void
+test_keep_active_timeout (void)
+{
+  g_autoptr(FpDevice) device = fake_image_device_new ();
+  FpiDeviceFakeImage *fake_dev = FPI_DEVICE_FAKE_IMAGE (device);
+  gint64 start_time;
+
+  fp_image_device_set_keep_active_timeout (FP_IMAGE_DEVICE (device), 200);
+
+  capture_and_check (device);
+  g_assert_cmpint (image_device_state (device), ==, FPI_IMAGE_DEVICE_STATE_IDLE);
+  g_assert_cmpuint (fake_dev->activations, ==, 1);
+  g_assert_cmpuint (fake_dev->deactivations, ==, 0);
+
+  /* The next action continues without activating again */
+  capture_and_check (device);
+  g_assert_cmpuint (fake_dev->activations, ==, 1);
+  g_assert_cmpuint (fake_dev->deactivations, ==, 0);
+
+  start_time = g_get_monotonic_time ();
+  while (image_device_state (device) != FPI_IMAGE_DEVICE_STATE_INACTIVE)
+    g_main_context_iteration (NULL, TRUE);
+  g_assert_cmpint (g_get_monotonic_time () - start_time, >=, 150000);
+  g_assert_cmpuint (fake_dev->deactivations, ==, 1);
+
+  capture_and_check (device);
+  g_assert_cmpuint (fake_dev->activations, ==, 2);
+
+  g_assert_true (fp_device_close_sync (device, NULL, NULL));
+  g_assert_cmpuint (fake_dev->deactivations, ==, 2);
+}
+
+static void
+test_keep_active_temperature (void)
+{
+  g_autoptr(FpDevice) device = NULL;
+  FpDeviceClass *dev_class = g_type_class_ref (FPI_TYPE_DEVICE_FAKE_IMAGE);
+  FpiDeviceFakeImage *fake_dev;
+
+  dev_class->temp_hot_seconds = 2;
+  dev_class->temp_cold_seconds = 1;
+  device = fake_image_device_new ();
+  fake_dev = FPI_DEVICE_FAKE_IMAGE (device);
+  dev_class->temp_hot_seconds = -1;
+  dev_class->temp_cold_seconds = 0;
+  g_type_class_unref (dev_class);
+
+  /* Cool down, so that the device is still cold after the capture */
+  g_usleep (G_USEC_PER_SEC);
+
+  fp_image_device_set_keep_active_timeout (FP_IMAGE_DEVICE (device), 60000);
+  capture_and_check (device);
+  g_assert_cmpint (fp_device_get_temperature (device), ==, FP_TEMPERATURE_COLD);
+  g_assert_cmpint (image_device_state (device), ==, FPI_IMAGE_DEVICE_STATE_IDLE);
+
+  /* Being kept active warms the device up, which releases it */
+  while (fp_device_get_temperature (device) == FP_TEMPERATURE_COLD)
+    g_main_context_iteration (NULL, TRUE);
+  g_assert_cmpint (image_device_state (device), ==, FPI_IMAGE_DEVICE_STATE_INACTIVE);
+  g_assert_cmpuint (fake_dev->deactivations, ==, 1);
+
+  g_assert_true (fp_device_close_sync (device, NULL, NULL));
+}
+
+static void
+test_keep_active_activate_pending (void)
+{
+  g_autoptr(FpDevice) device = fake_image_device_new ();
+  g_autoptr(GCancellable) cancellable = g_cancellable_new ();
+  FpiDeviceFakeImage *fake_dev = FPI_DEVICE_FAKE_IMAGE (device);
+  CaptureData data = { 0 };
+
+  fp_image_device_set_keep_active_timeout (FP_IMAGE_DEVICE (device), 60000);
+  capture_and_check (device);
+
+  /* Start an action while the device is being released */
+  fake_dev->defer_deactivate = TRUE;
+  fp_image_device_set_keep_active_timeout (FP_IMAGE_DEVICE (device), 0);
+  g_assert_cmpint (image_device_state (device), ==, FPI_IMAGE_DEVICE_STATE_DEACTIVATING);
+  g_assert_cmpuint (fake_dev->deactivations, ==, 1);
+
+  fp_device_capture (device, TRUE, NULL, on_capture_done, &data);
+  while (g_main_context_iteration (NULL, FALSE))
+    continue;
+  g_assert_false (data.completed);
+  g_assert_cmpuint (fake_dev->activations, ==, 1);
+
+  /* It activates again once the deactivation is done */
+  fake_dev->defer_deactivate = FALSE;
+  fpi_image_device_deactivate_complete (FP_IMAGE_DEVICE (device), NULL);
+  g_assert_cmpuint (fake_dev->activations, ==, 2);
+
+  while (!data.completed)
+    g_main_context_iteration (NULL, TRUE);
+  g_assert_no_error (data.error);
+  g_assert_nonnull (data.image);
+  g_clear_object (&data.image);
+  g_assert_cmpuint (fake_dev->deactivations, ==, 2);
+
+  /* An action cancelled in the meantime does not activate again */
+  fp_image_device_set_keep_active_timeout (FP_IMAGE_DEVICE (device), 60000);
+  capture_and_check (device);
+  g_assert_cmpuint (fake_dev->activations, ==, 3);
+
+  fake_dev->defer_deactivate = TRUE;
+  fp_image_device_set_keep_active_timeout (FP_IMAGE_DEVICE (device), 0);
+
+  data.completed = FALSE;
+  fp_device_capture (device, TRUE, cancellable, on_capture_done, &data);
+  while (g_main_context_iteration (NULL, FALSE))
+    continue;
+  g_cancellable_cancel (cancellable);
+  while (g_main_context_iteration (NULL, FALSE))
+    continue;
+  g_assert_false (data.completed);
+
+  fake_dev->defer_deactivate = FALSE;
+  fpi_image_device_deactivate_complete (FP_IMAGE_DEVICE (device), NULL);
+  while (!data.completed)
+    g_main_context_iteration (NULL, TRUE);
+  g_assert_error (data.error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+  g_assert_null (data.image);
+  g_clear_error (&data.error);
+  g_assert_cmpuint (fake_dev->activations, ==, 3);
+
+  g_assert_true (fp_device_close_sync (device, NULL, NULL));
+}
+
+static void
+test_keep_active_suspend (void)
+{
+  g_autoptr(FpDevice) device = fake_image_device_new ();
+  g_autoptr(GError) error = NULL;
+  FpiDeviceFakeImage *fake_dev = FPI_DEVICE_FAKE_IMAGE (device);
+
+  fp_image_device_set_keep_active_timeout (FP_IMAGE_DEVICE (device), 60000);
+  capture_and_check (device);
+  g_assert_cmpint (image_device_state (device), ==, FPI_IMAGE_DEVICE_STATE_IDLE);
+
+  /* The sensor is powered down before suspending */
+  g_assert_true (fp_device_suspend_sync (device, NULL, &error));
+  g_assert_no_error (error);
+  g_assert_cmpint (image_device_state (device), ==, FPI_IMAGE_DEVICE_STATE_INACTIVE);
+  g_assert_cmpuint (fake_dev->deactivations, ==, 1);
+
+  g_assert_true (fp_device_resume_sync (device, NULL, &error));
+  g_assert_no_error (error);
+
+  capture_and_check (device);
+  g_assert_cmpuint (fake_dev->activations, ==, 2);
+
+  g_assert_true (fp_device_close_sync (device, NULL, NULL));
+}
+
+static void
+test_keep_active_destroy (void)
+{
+  FpDevice *device = fake_image_device_new ();
+
+  fp_image_device_set_keep_active_timeout (FP_IMAGE_DEVICE (device), 60000);
+  capture_and_check (device);
+  g_assert_cmpint (image_device_state (device), ==, FPI_IMAGE_DEVICE_STATE_IDLE);
+
+  /* Only warns, like for any other open device */
+  g_test_expect_message ("libfprint-device", G_LOG_LEVEL_WARNING,
+                         "*User destroyed open device*");
+  g_object_unref (device);
+  g_test_assert_expected_messages ();
+}
+
+int
+main (int argc, char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/image-device/keep-active/timeout", test_keep_active_timeout);
+  g_test_add_func ("/image-device/keep-active/temperature", test_keep_active_temperature);
+  g_test_add_func ("/image-device/keep-active/activate-pending", test_keep_active_activate_pending);
+  g_test_add_func ("/image-device/keep-active/suspend", test_keep_active_suspend);
+  g_test_add_func ("/image-device/keep-active/destroy", test_keep_active_destroy);
+
+  return g_test_run ();
+}
@@ -0,0 +1,141 @@
+/*
+ * Unit tests for creating NBIS prints
+ * Copyright (C) 2026 libfprint contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <libfprint/fprint.h>
+#include <nbis.h>
+
+#include "fp-print-private.h"
+#include "fpi-image.h"
+#include "test-device-fake.h"
+
+/* Minutiae along a line, the x coordinate identifies each of them */
+static FpImage *
+image_with_minutiae (guint n_minutiae, double (*reliability)(guint i))
+{
+  FpImage *image = fp_image_new (300, 100);
+  guint i;
+
+  image->minutiae = g_ptr_array_new_with_free_func (g_free);
+  for (i = 0; i < n_minutiae; i++)
+    {
+      struct fp_minutia *minutia = g_new0 (struct fp_minutia, 1);
+
+      minutia->x = 10 + i;
+      minutia->y = 50;
+      minutia->reliability = reliability (i);
+      g_ptr_array_add (image->minutiae, minutia);
+    }
+
+  return image;
+}
+
+static double
+increasing_reliability (guint i)
+{
+  return i / 1000.0;
+}
+
+static double
+same_reliability (guint i)
+{
+  return 0.5;
+}
+
+static struct xyt_struct *
+print_from_image (FpDevice *device, FpImage *image, gint max_minutiae)
+{
+  g_autoptr(FpPrint) print = fp_print_new (device);
+  g_autoptr(GError) error = NULL;
+
+  fpi_print_set_type (print, FPI_PRINT_NBIS);
+  g_assert_true (fpi_print_add_from_image (print, image, max_minutiae, &error));
+  g_assert_no_error (error);
+  g_assert_cmpuint (print->prints->len, ==, 1);
+
+  return g_memdup (g_ptr_array_index (print->prints, 0), sizeof (struct xyt_struct));
+}
+
+static void
+test_print_default_truncation (void)
+{
+  g_autoptr(FpDevice) device = g_object_new (FPI_TYPE_DEVICE_FAKE, NULL);
+  g_autoptr(FpImage) image = image_with_minutiae (250, increasing_reliability);
+  g_autofree struct xyt_struct *xyt = NULL;
+  int i;
+
+  /* Without a limit, the first 200 in detection order are kept */
+  xyt = print_from_image (device, image, 0);
+  g_assert_cmpint (xyt->nrows, ==, MAX_BOZORTH_MINUTIAE);
+  for (i = 0; i < xyt->nrows; i++)
+    g_assert_cmpint (xyt->xcol[i], ==, 10 + i);
+}
+
+static void
+test_print_quality_pruning (void)
+{
+  g_autoptr(FpDevice) device = g_object_new (FPI_TYPE_DEVICE_FAKE, NULL);
+  g_autoptr(FpImage) image = image_with_minutiae (250, increasing_reliability);
+  g_autofree struct xyt_struct *xyt = NULL;
+  int i;
+
+  /* The 50 most reliable ones are kept, sorted by position */
+  xyt = print_from_image (device, image, 50);
+  g_assert_cmpint (xyt->nrows, ==, 50);
+  for (i = 0; i < xyt->nrows; i++)
+    g_assert_cmpint (xyt->xcol[i], ==, 10 + 200 + i);
+  g_clear_pointer (&xyt, g_free);
+
+  /* Limits above what bozorth3 handles still prune to 200 */
+  xyt = print_from_image (device, image, 1000);
+  g_assert_cmpint (xyt->nrows, ==, MAX_BOZORTH_MINUTIAE);
+  for (i = 0; i < xyt->nrows; i++)
+    g_assert_cmpint (xyt->xcol[i], ==, 10 + 50 + i);
+}
+
+static void
+test_print_quality_pruning_ties (void)
+{
+  g_autoptr(FpDevice) device = g_object_new (FPI_TYPE_DEVICE_FAKE, NULL);
+  g_autoptr(FpImage) image = image_with_minutiae (30, same_reliability);
+  g_autofree struct xyt_struct *xyt = NULL;
+  int i;
+
+  /* Minutiae of the same quality are kept in detection order */
+  xyt = print_from_image (device, image, 10);
+  g_assert_cmpint (xyt->nrows, ==, 10);
+  for (i = 0; i < xyt->nrows; i++)
+    g_assert_cmpint (xyt->xcol[i], ==, 10 + i);
+  g_clear_pointer (&xyt, g_free);
+
+  /* Nothing is pruned below the limit */
+  xyt = print_from_image (device, image, 30);
+  g_assert_cmpint (xyt->nrows, ==, 30);
+}
+
+int
+main (int argc, char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/print/default-truncation", test_print_default_truncation);
+  g_test_add_func ("/print/quality-pruning", test_print_quality_pruning);
+  g_test_add_func ("/print/quality-pruning/ties", test_print_quality_pruning_ties);
+
+  return g_test_run ();
+}
@@ -0,0 +1,182 @@
+/*
+ * Unit tests for the sensor frame normalization
+ * Copyright (C) 2026 libfprint contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <glib.h>
+#include <string.h>
+
+#include "fpi-sensor-normalize.h"
+
+static gint
+cmp_u16 (gconstpointer a, gconstpointer b)
+{
+  return (gint) * (guint16 *) a - (gint) * (guint16 *) b;
+}
+
+static void
+test_subtract_background (void)
+{
+  g_autoptr(GRand) rand = g_rand_new_with_seed (0x62676e64);
+  guint16 frame[1003], background[1003], out[1003];
+  gsize darker = 0, i;
+  guint16 max = 0, result_max;
+
+  for (i = 0; i < G_N_ELEMENTS (frame); i++)
+    {
+      frame[i] = g_rand_int_range (rand, 0, 1 << 14);
+      background[i] = g_rand_int_range (rand, 0, 1 << 13);
+      if (frame[i] < background[i])
+        darker++;
+      else
+        max = MAX (max, frame[i] - background[i]);
+    }
+
+  /* Odd length to also cover the tail after the vectorized part */
+  g_assert_cmpuint (fpi_sensor_subtract_background (out, frame, background,
+                                                    G_N_ELEMENTS (frame),
+                                                    &result_max), ==, darker);
+  g_assert_cmpuint (result_max, ==, max);
+
+  for (i = 0; i < G_N_ELEMENTS (frame); i++)
+    g_assert_cmpuint (out[i], ==, frame[i] < background[i] ? 0 : frame[i] - background[i]);
+
+  /* In place */
+  g_assert_cmpuint (fpi_sensor_subtract_background (frame, frame, background,
+                                                    G_N_ELEMENTS (frame),
+                                                    NULL), ==, darker);
+  g_assert_cmpmem (frame, sizeof (frame), out, sizeof (out));
+}
+
+static void
+test_select_ranks (void)
+{
+  g_autoptr(GRand) rand = g_rand_new_with_seed (0x72616e6b);
+  guint16 frame[96 * 96], sorted[96 * 96];
+  guint16 values[5];
+  gsize ranks[5];
+  guint round, i;
+
+  for (round = 0; round < 20; round++)
+    {
+      gsize len = g_rand_int_range (rand, 1, G_N_ELEMENTS (frame));
+      /* Narrow ranges result in many equal pixels */
+      gint range = round % 2 ? 1 << 16 : g_rand_int_range (rand, 1, 600);
+
+      for (i = 0; i < len; i++)
+        frame[i] = g_rand_int_range (rand, 0, range);
+      memcpy (sorted, frame, len * sizeof (guint16));
+      qsort (sorted, len, sizeof (guint16), cmp_u16);
+
+      ranks[0] = len - 1;
+      ranks[1] = 0;
+      ranks[2] = len * 3 / 10;
+      ranks[3] = len * 65 / 100;
+      ranks[4] = g_rand_int_range (rand, 0, len);
+
+      fpi_sensor_select_ranks (frame, len, ranks, values, G_N_ELEMENTS (ranks));
+      for (i = 0; i < G_N_ELEMENTS (ranks); i++)
+        g_assert_cmpuint (values[i], ==, sorted[ranks[i]]);
+    }
+}
+
+static void
+test_rotate (void)
+{
+  /* A 4x3 sensor, the output is the top left 3x2 of the rotated frame */
+  const guint16 in[] = {
+    0, 1, 2, 3,
+    4, 5, 6, 7,
+    8, 9, 10, 11,
+  };
+  const guint16 none[] = { 0, 1, 2, 4, 5, 6 };
+  const guint16 rotated_180[] = { 11, 10, 9, 7, 6, 5 };
+  const guint16 right[] = { 2, 6, 10, 1, 5, 9 };
+  /* Only square sensors are rotated by 90 degrees counterclockwise */
+  const guint16 square[] = {
+    0, 1, 2,
+    3, 4, 5,
+    6, 7, 8,
+  };
+  const guint16 left[] = { 6, 3, 0, 7, 4, 1 };
+  guint16 out[6];
+
+  fpi_sensor_rotate (out, 3, 2, in, 4, 3, FPI_SENSOR_ROTATE_NONE);
+  g_assert_cmpmem (out, sizeof (out), none, sizeof (none));
+
+  fpi_sensor_rotate (out, 3, 2, in, 4, 3, FPI_SENSOR_ROTATE_180);
+  g_assert_cmpmem (out, sizeof (out), rotated_180, sizeof (rotated_180));
+
+  fpi_sensor_rotate (out, 3, 2, in, 4, 3, FPI_SENSOR_ROTATE_90_RIGHT);
+  g_assert_cmpmem (out, sizeof (out), right, sizeof (right));
+
+  fpi_sensor_rotate (out, 3, 2, square, 3, 3, FPI_SENSOR_ROTATE_90_LEFT);
+  g_assert_cmpmem (out, sizeof (out), left, sizeof (left));
+}
+
+static void
+test_map_levels (void)
+{
+  const guint8 values[] = { 0, 99, 155, 255 };
+  const guint16 levels[] = { 100, 200, 1000, 16383 };
+  const guint16 wide[] = { 0, 65535 };
+  const guint8 linear[] = { 0, 255 };
+  guint16 in[65536];
+  guint8 out[65536];
+  guint i, s;
+
+  for (i = 0; i < G_N_ELEMENTS (in); i++)
+    in[i] = i;
+
+  /* Same result as dividing by the width of each segment */
+  fpi_sensor_map_levels (out, in, 20000, levels, values, G_N_ELEMENTS (levels));
+  for (i = 0; i < 20000; i++)
+    {
+      guint expected;
+
+      if (i < levels[0])
+        expected = values[0];
+      else if (i >= levels[3])
+        expected = values[3];
+      else
+        {
+          for (s = 2; s > 0 && i < levels[s]; s--)
+            ;
+          expected = values[s] + (i - levels[s]) * (values[s + 1] - values[s]) /
+                     (levels[s + 1] - levels[s]);
+        }
+
+      g_assert_cmpuint (out[i], ==, expected);
+    }
+
+  fpi_sensor_map_levels (out, in, G_N_ELEMENTS (in), wide, linear, G_N_ELEMENTS (wide));
+  for (i = 0; i < G_N_ELEMENTS (in); i++)
+    g_assert_cmpuint (out[i], ==, i * 255 / 65535);
+}
+
+int
+main (int argc, char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/sensor-normalize/subtract-background", test_subtract_background);
+  g_test_add_func ("/sensor-normalize/select-ranks", test_select_ranks);
+  g_test_add_func ("/sensor-normalize/rotate", test_rotate);
+  g_test_add_func ("/sensor-normalize/map-levels", test_map_levels);
+
+  return g_test_run ();
+}
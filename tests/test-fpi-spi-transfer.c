@@ -0,0 +1,389 @@
+/*
+ * Unit tests for the SPI transfer worker
+ * Copyright (C) 2026 libfprint contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <errno.h>
+#include <stdarg.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <linux/spi/spidev.h>
+#include <libfprint/fprint.h>
+
+#include "fpi-spi-transfer.h"
+#include "test-device-fake.h"
+
+/* A file descriptor number that is never opened by the test */
+#define FAKE_SPIDEV_FD 1021
+
+/* The fake spidev answers each read segment with the inverted last byte of
+ * the write segment before it, and records the messages it received.
+ */
+static struct
+{
+  GMutex  lock;
+  GCond   cond;
+  gboolean block;
+  gboolean blocked;
+  int      fail_errno;
+
+  /* Number of segments and their cs_change flags for each message */
+  GArray  *segments;
+  GArray  *cs_change;
+} fake_spidev;
+
+typedef struct
+{
+  guint8  sent;
+  guint8  received;
+  GError *error;
+} TransferResult;
+
+/* Replaces the libc function for this test binary, everything except the
+ * fake spidev is passed on to the kernel.
+ */
+int
+ioctl (int fd, unsigned long request, ...)
+{
+  struct spi_ioc_transfer *xfer;
+  guint8 last_written = 0;
+  guint32 cs_change = 0;
+  int n_xfer, i, err;
+  va_list args;
+  int len = 0;
+
+  va_start (args, request);
+  xfer = va_arg (args, gpointer);
+  va_end (args);
+
+  if (fd != FAKE_SPIDEV_FD)
+    return syscall (SYS_ioctl, fd, request, xfer);
+
+  g_assert_cmpint (_IOC_TYPE (request), ==, SPI_IOC_MAGIC);
+  n_xfer = _IOC_SIZE (request) / sizeof (struct spi_ioc_transfer);
+
+  g_mutex_lock (&fake_spidev.lock);
+
+  if (fake_spidev.block)
+    {
+      fake_spidev.blocked = TRUE;
+      g_cond_broadcast (&fake_spidev.cond);
+      while (fake_spidev.block)
+        g_cond_wait (&fake_spidev.cond, &fake_spidev.lock);
+      fake_spidev.blocked = FALSE;
+    }
+
+  for (i = 0; i < n_xfer; i++)
+    if (xfer[i].cs_change)
+      cs_change |= 1 << i;
+  g_array_append_val (fake_spidev.segments, n_xfer);
+  g_array_append_val (fake_spidev.cs_change, cs_change);
+  err = fake_spidev.fail_errno;
+
+  g_mutex_unlock (&fake_spidev.lock);
+
+  if (err)
+    {
+      errno = err;
+      return -1;
+    }
+
+  for (i = 0; i < n_xfer; i++)
+    {
+      if (xfer[i].tx_buf)
+        last_written = ((guint8 *) (gsize) xfer[i].tx_buf)[xfer[i].len - 1];
+      if (xfer[i].rx_buf)
+        memset ((guint8 *) (gsize) xfer[i].rx_buf, last_written ^ 0xff, xfer[i].len);
+      len += xfer[i].len;
+    }
+
+  return len;
+}
+
+static void
+fake_spidev_reset (void)
+{
+  g_mutex_lock (&fake_spidev.lock);
+  g_clear_pointer (&fake_spidev.segments, g_array_unref);
+  g_clear_pointer (&fake_spidev.cs_change, g_array_unref);
+  fake_spidev.segments = g_array_new (FALSE, FALSE, sizeof (int));
+  fake_spidev.cs_change = g_array_new (FALSE, FALSE, sizeof (guint32));
+  fake_spidev.fail_errno = 0;
+  g_mutex_unlock (&fake_spidev.lock);
+}
+
+static void
+fake_spidev_block (void)
+{
+  g_mutex_lock (&fake_spidev.lock);
+  fake_spidev.block = TRUE;
+  g_mutex_unlock (&fake_spidev.lock);
+}
+
+static void
+fake_spidev_wait_blocked (void)
+{
+  g_mutex_lock (&fake_spidev.lock);
+  while (!fake_spidev.blocked)
+    g_cond_wait (&fake_spidev.cond, &fake_spidev.lock);
+  g_mutex_unlock (&fake_spidev.lock);
+}
+
+static void
+fake_spidev_unblock (void)
+{
+  g_mutex_lock (&fake_spidev.lock);
+  fake_spidev.block = FALSE;
+  g_cond_broadcast (&fake_spidev.cond);
+  g_mutex_unlock (&fake_spidev.lock);
+}
+
+static void
+transfer_result_clear (TransferResult *result)
+{
+  g_clear_error (&result->error);
+}
+
+static void
+transfer_done_cb (FpiSpiTransfer *transfer, FpDevice *device,
+                  gpointer user_data, GError *error)
+{
+  GArray *results = user_data;
+  TransferResult result = { 0 };
+
+  result.sent = transfer->buffer_wr ? transfer->buffer_wr[0] : 0;
+  result.received = transfer->buffer_rd ? transfer->buffer_rd[0] : 0;
+  result.error = error;
+
+  g_array_append_val (results, result);
+}
+
+static void
+submit_command (FpDevice     *device,
+                guint8        value,
+                GCancellable *cancellable,
+                GArray       *results)
+{
+  FpiSpiTransfer *transfer = fpi_spi_transfer_new (device, FAKE_SPIDEV_FD);
+
+  fpi_spi_transfer_write (transfer, 2);
+  transfer->buffer_wr[0] = value;
+  transfer->buffer_wr[1] = value;
+  fpi_spi_transfer_read (transfer, 1);
+
+  fpi_spi_transfer_submit (transfer, cancellable, transfer_done_cb, results);
+}
+
+static GArray *
+results_new (void)
+{
+  GArray *results = g_array_new (FALSE, TRUE, sizeof (TransferResult));
+
+  g_array_set_clear_func (results, (GDestroyNotify) transfer_result_clear);
+
+  return results;
+}
+
+static void
+wait_for_results (GArray *results, guint n_results)
+{
+  while (results->len < n_results)
+    g_main_context_iteration (NULL, TRUE);
+}
+
+static void
+test_spi_transfer_order (void)
+{
+  g_autoptr(FpDevice) device = g_object_new (FPI_TYPE_DEVICE_FAKE, NULL);
+  g_autoptr(GArray) results = results_new ();
+  guint i;
+
+  fake_spidev_reset ();
+
+  for (i = 0; i < 40; i++)
+    submit_command (device, i, NULL, results);
+  wait_for_results (results, 40);
+
+  for (i = 0; i < 40; i++)
+    {
+      TransferResult *result = &g_array_index (results, TransferResult, i);
+
+      g_assert_no_error (result->error);
+      g_assert_cmpuint (result->sent, ==, i);
+      g_assert_cmpuint (result->received, ==, i ^ 0xff);
+    }
+}
+
+static void
+test_spi_transfer_batch (void)
+{
+  g_autoptr(FpDevice) device = g_object_new (FPI_TYPE_DEVICE_FAKE, NULL);
+  g_autoptr(GArray) results = results_new ();
+  guint i;
+
+  fake_spidev_reset ();
+
+  /* Hold the worker in the first ioctl so that the others pile up */
+  fake_spidev_block ();
+  submit_command (device, 0, NULL, results);
+  fake_spidev_wait_blocked ();
+  for (i = 1; i < 10; i++)
+    submit_command (device, i, NULL, results);
+  fake_spidev_unblock ();
+
+  wait_for_results (results, 10);
+
+  for (i = 0; i < 10; i++)
+    {
+      TransferResult *result = &g_array_index (results, TransferResult, i);
+
+      g_assert_no_error (result->error);
+      g_assert_cmpuint (result->sent, ==, i);
+      g_assert_cmpuint (result->received, ==, i ^ 0xff);
+    }
+
+  /* The nine waiting transfers went out as one message, with the chip
+   * select toggled after each of them except the last. */
+  g_assert_cmpuint (fake_spidev.segments->len, ==, 2);
+  g_assert_cmpint (g_array_index (fake_spidev.segments, int, 0), ==, 2);
+  g_assert_cmpuint (g_array_index (fake_spidev.cs_change, guint32, 0), ==, 0);
+  g_assert_cmpint (g_array_index (fake_spidev.segments, int, 1), ==, 18);
+  g_assert_cmpuint (g_array_index (fake_spidev.cs_change, guint32, 1), ==, 0xaaaa);
+}
+
+static void
+test_spi_transfer_batch_error (void)
+{
+  g_autoptr(FpDevice) device = g_object_new (FPI_TYPE_DEVICE_FAKE, NULL);
+  g_autoptr(GArray) results = results_new ();
+  TransferResult *result;
+  FpiSpiTransfer *empty;
+  guint i;
+
+  fake_spidev_reset ();
+
+  fake_spidev_block ();
+  submit_command (device, 0, NULL, results);
+  fake_spidev_wait_blocked ();
+  for (i = 1; i < 4; i++)
+    submit_command (device, i, NULL, results);
+
+  /* Invalid transfers fail on their own and end the batch */
+  empty = fpi_spi_transfer_new (device, FAKE_SPIDEV_FD);
+  fpi_spi_transfer_submit (empty, NULL, transfer_done_cb, results);
+  submit_command (device, 5, NULL, results);
+
+  g_mutex_lock (&fake_spidev.lock);
+  fake_spidev.fail_errno = EIO;
+  g_mutex_unlock (&fake_spidev.lock);
+  fake_spidev_unblock ();
+
+  wait_for_results (results, 6);
+
+  /* Every transfer of a failed message reports the error */
+  for (i = 0; i < 4; i++)
+    {
+      result = &g_array_index (results, TransferResult, i);
+      g_assert_cmpuint (result->sent, ==, i);
+      g_assert_error (result->error, G_IO_ERROR, G_IO_ERROR_FAILED);
+    }
+
+  result = &g_array_index (results, TransferResult, 4);
+  g_assert_error (result->error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT);
+
+  result = &g_array_index (results, TransferResult, 5);
+  g_assert_cmpuint (result->sent, ==, 5);
+  g_assert_error (result->error, G_IO_ERROR, G_IO_ERROR_FAILED);
+
+  g_assert_cmpuint (fake_spidev.segments->len, ==, 3);
+  g_assert_cmpint (g_array_index (fake_spidev.segments, int, 1), ==, 6);
+  g_assert_cmpint (g_array_index (fake_spidev.segments, int, 2), ==, 2);
+}
+
+static void
+test_spi_transfer_cancel (void)
+{
+  g_autoptr(FpDevice) device = g_object_new (FPI_TYPE_DEVICE_FAKE, NULL);
+  g_autoptr(GCancellable) cancellable = g_cancellable_new ();
+  g_autoptr(GArray) results = results_new ();
+  TransferResult *result;
+
+  fake_spidev_reset ();
+
+  /* The transfer cannot be aborted, but reports the cancellation */
+  fake_spidev_block ();
+  submit_command (device, 1, cancellable, results);
+  submit_command (device, 2, NULL, results);
+  fake_spidev_wait_blocked ();
+  g_cancellable_cancel (cancellable);
+  fake_spidev_unblock ();
+
+  wait_for_results (results, 2);
+
+  result = &g_array_index (results, TransferResult, 0);
+  g_assert_cmpuint (result->sent, ==, 1);
+  g_assert_error (result->error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+
+  /* Later transfers are not affected */
+  result = &g_array_index (results, TransferResult, 1);
+  g_assert_cmpuint (result->sent, ==, 2);
+  g_assert_no_error (result->error);
+  g_assert_cmpuint (result->received, ==, 2 ^ 0xff);
+
+  g_assert_cmpuint (fake_spidev.segments->len, >=, 1);
+}
+
+static void
+test_spi_transfer_sync (void)
+{
+  g_autoptr(FpDevice) device = g_object_new (FPI_TYPE_DEVICE_FAKE, NULL);
+  g_autoptr(FpiSpiTransfer) transfer = NULL;
+  g_autoptr(GArray) results = results_new ();
+  g_autoptr(GError) error = NULL;
+
+  fake_spidev_reset ();
+
+  /* Synchronous transfers are serialized with the queued ones */
+  submit_command (device, 1, NULL, results);
+
+  transfer = fpi_spi_transfer_new (device, FAKE_SPIDEV_FD);
+  fpi_spi_transfer_write (transfer, 1);
+  transfer->buffer_wr[0] = 0x0f;
+  fpi_spi_transfer_read (transfer, 4);
+  g_assert_true (fpi_spi_transfer_submit_sync (transfer, &error));
+  g_assert_no_error (error);
+  g_assert_cmpuint (transfer->buffer_rd[3], ==, 0xf0);
+
+  wait_for_results (results, 1);
+  g_assert_no_error (g_array_index (results, TransferResult, 0).error);
+}
+
+int
+main (int argc, char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/spi-transfer/order", test_spi_transfer_order);
+  g_test_add_func ("/spi-transfer/batch", test_spi_transfer_batch);
+  g_test_add_func ("/spi-transfer/batch/error", test_spi_transfer_batch_error);
+  g_test_add_func ("/spi-transfer/cancel", test_spi_transfer_cancel);
+  g_test_add_func ("/spi-transfer/sync", test_spi_transfer_sync);
+
+  return g_test_run ();
+}
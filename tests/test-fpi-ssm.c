@@ -960,6 +960,87 @@ test_ssm_delayed_jump_to_state_wrong (void)
   g_assert_no_error (data->error);
 }
 
+static void
+test_ssm_polled_jump_to_state (void)
+{
+  g_autoptr(FpiSsm) ssm = ssm_test_new ();
+  FpiSsmTestData *data = fpi_ssm_get_data (ssm);
+  FpiSsmPoller poller;
+  gint64 start_time;
+
+  /* Back off on every poll */
+  fpi_ssm_poller_init (&poller, 0, 4, 0);
+
+  fpi_ssm_start (ssm, test_ssm_completed_callback);
+  g_assert_cmpint (data->handler_state, ==, FPI_TEST_SSM_STATE_0);
+
+  /* The first poll is not delayed */
+  fpi_ssm_jump_to_state_polled (ssm, FPI_TEST_SSM_STATE_1, &poller);
+  g_assert_cmpint (data->handler_state, ==, FPI_TEST_SSM_STATE_1);
+  g_assert_cmpuint (g_slist_length (data->handlers_chain), ==, 2);
+  g_assert_cmpuint (poller.delay, ==, 1);
+
+  fpi_ssm_jump_to_state_polled (ssm, FPI_TEST_SSM_STATE_2, &poller);
+  g_assert_cmpint (data->handler_state, ==, FPI_TEST_SSM_STATE_1);
+  g_assert_cmpuint (poller.delay, ==, 2);
+
+  while (data->handler_state == FPI_TEST_SSM_STATE_1)
+    g_main_context_iteration (NULL, TRUE);
+  g_assert_cmpint (data->handler_state, ==, FPI_TEST_SSM_STATE_2);
+
+  fpi_ssm_jump_to_state_polled (ssm, FPI_TEST_SSM_STATE_1, &poller);
+  g_assert_cmpuint (poller.delay, ==, 4);
+
+  while (data->handler_state == FPI_TEST_SSM_STATE_2)
+    g_main_context_iteration (NULL, TRUE);
+
+  /* Capped at the maximum delay */
+  fpi_ssm_jump_to_state_polled (ssm, FPI_TEST_SSM_STATE_2, &poller);
+  g_assert_cmpuint (poller.delay, ==, 4);
+
+  while (data->handler_state == FPI_TEST_SSM_STATE_1)
+    g_main_context_iteration (NULL, TRUE);
+  g_assert_cmpuint (g_slist_length (data->handlers_chain), ==, 5);
+
+  /* Activity resets the delay */
+  fpi_ssm_poller_activity (&poller);
+  fpi_ssm_jump_to_state_polled (ssm, FPI_TEST_SSM_STATE_3, &poller);
+  g_assert_cmpint (data->handler_state, ==, FPI_TEST_SSM_STATE_3);
+
+  /* No back off while there was recent activity */
+  fpi_ssm_poller_init (&poller, 0, 4, 60000);
+  fpi_ssm_jump_to_state_polled (ssm, FPI_TEST_SSM_STATE_0, &poller);
+  g_assert_cmpint (data->handler_state, ==, FPI_TEST_SSM_STATE_0);
+  g_assert_cmpuint (poller.delay, ==, 0);
+
+  /* The rate is known once polling ran for a second */
+  fpi_ssm_poller_init (&poller, 4, 4, 60000);
+  g_assert_cmpfloat (fpi_ssm_poller_get_wakeups_per_second (&poller), ==, 0);
+  start_time = g_get_monotonic_time ();
+
+  while (fpi_ssm_poller_get_wakeups_per_second (&poller) == 0)
+    {
+      int next_state = data->handler_state == FPI_TEST_SSM_STATE_0 ?
+                       FPI_TEST_SSM_STATE_1 : FPI_TEST_SSM_STATE_0;
+
+      fpi_ssm_jump_to_state_polled (ssm, next_state, &poller);
+      while (data->handler_state != next_state)
+        g_main_context_iteration (NULL, TRUE);
+    }
+
+  g_assert_cmpint (g_get_monotonic_time () - start_time, >=, G_USEC_PER_SEC);
+  g_assert_cmpfloat (fpi_ssm_poller_get_wakeups_per_second (&poller), >, 0);
+  g_assert_cmpfloat (fpi_ssm_poller_get_wakeups_per_second (&poller), <=, 1000 / 4 + 1);
+
+  /* Activity, like the start of a wait, starts a new measurement */
+  fpi_ssm_poller_activity (&poller);
+  g_assert_cmpuint (poller.window_polls, ==, 0);
+  g_assert_cmpint (g_get_monotonic_time () - poller.window_start, <, G_USEC_PER_SEC);
+
+  g_assert_false (data->completed);
+  g_assert_no_error (data->error);
+}
+
 static void
 test_ssm_delayed_mark_completed (void)
 {
@@ -1358,6 +1439,7 @@ main (int argc, char *argv[])
   g_test_add_func ("/ssm/delayed/mark_completed/cancel", test_ssm_delayed_mark_completed_cancel);
   g_test_add_func ("/ssm/delayed/mark_completed/not_started", test_ssm_delayed_mark_completed_not_started);
   g_test_add_func ("/ssm/delayed/cancel/error", test_ssm_delayed_cancel_error);
+  g_test_add_func ("/ssm/polled/jump_to_state", test_ssm_polled_jump_to_state);
   g_test_add_func ("/ssm/subssm/start", test_ssm_subssm_start);
   g_test_add_func ("/ssm/subssm/start/with_started", test_ssm_subssm_start_with_started);
   g_test_add_func ("/ssm/subssm/start/with_delayed", test_ssm_subssm_start_with_delayed);
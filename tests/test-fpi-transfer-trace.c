@@ -0,0 +1,232 @@
+/*
+ * Unit tests for the transfer trace recorder
+ * Copyright (C) 2026 libfprint contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <glib/gstdio.h>
+#include <string.h>
+#include <libfprint/fprint.h>
+
+#include "fpi-byte-utils.h"
+#include "fpi-transfer-trace.h"
+#include "fpi-usb-transfer.h"
+#include "test-device-fake.h"
+
+static gchar *trace_dir = NULL;
+
+static void
+record_bulk_out (FpDevice *device, guint64 id, const guint8 *data, gsize length)
+{
+  FpiTransferTraceRecord record = { 0 };
+
+  record.id = id;
+  record.bus = FPI_TRANSFER_TRACE_BUS_USB;
+  record.type = FP_TRANSFER_BULK;
+  record.endpoint = FPI_USB_ENDPOINT_OUT | 0x01;
+  record.length = length;
+
+  record.submit = TRUE;
+  fpi_transfer_trace_record (device, &record, data);
+
+  record.submit = FALSE;
+  fpi_transfer_trace_record (device, &record, NULL);
+}
+
+static gchar *
+write_json (FpDevice *device)
+{
+  g_autoptr(GOutputStream) stream = g_memory_output_stream_new_resizable ();
+  g_autoptr(GError) error = NULL;
+
+  g_assert_true (fpi_transfer_trace_write_json (device, stream, NULL, &error));
+  g_assert_no_error (error);
+  g_assert_true (g_output_stream_write_all (stream, "", 1, NULL, NULL, NULL));
+  g_assert_true (g_output_stream_close (stream, NULL, NULL));
+
+  return g_memory_output_stream_steal_data (G_MEMORY_OUTPUT_STREAM (stream));
+}
+
+static void
+test_transfer_trace_flags (void)
+{
+  g_assert_cmpint (fpi_transfer_trace_get_flags (), ==, FPI_TRANSFER_TRACE_RECORD);
+
+  /* The environment is only read once */
+  g_setenv ("FP_DEBUG_TRANSFER", "1", TRUE);
+  g_assert_cmpint (fpi_transfer_trace_get_flags (), ==, FPI_TRANSFER_TRACE_RECORD);
+  g_unsetenv ("FP_DEBUG_TRANSFER");
+}
+
+static void
+test_transfer_trace_json (void)
+{
+  g_autoptr(FpDevice) device = g_object_new (FPI_TYPE_DEVICE_FAKE, NULL);
+  const guint8 data[] = { 0x01, 0xab, 0xff };
+  g_autofree gchar *json = NULL;
+
+  json = write_json (device);
+  g_assert_cmpstr (json, ==, "[\n\n]\n");
+  g_clear_pointer (&json, g_free);
+
+  record_bulk_out (device, 42, data, sizeof (data));
+  json = write_json (device);
+
+  g_assert_nonnull (strstr (json, "\"id\": 42, \"bus\": \"usb\", \"event\": \"submit\", "
+                                  "\"type\": \"bulk\", \"endpoint\": 1, "
+                                  "\"status\": 0, \"length\": 3, \"data\": \"01abff\" }"));
+  g_assert_nonnull (strstr (json, "\"event\": \"complete\", "
+                                  "\"type\": \"bulk\", \"endpoint\": 1, "
+                                  "\"status\": 0, \"length\": 3, \"data\": \"\" }"));
+}
+
+static void
+test_transfer_trace_ring (void)
+{
+  g_autoptr(FpDevice) device = g_object_new (FPI_TYPE_DEVICE_FAKE, NULL);
+  g_autofree gchar *json = NULL;
+  g_auto(GStrv) events = NULL;
+  guint64 i;
+
+  for (i = 0; i < 1500; i++)
+    record_bulk_out (device, i, (const guint8 *) &i, sizeof (i));
+
+  /* Only the newest 1024 events are kept */
+  json = write_json (device);
+  events = g_strsplit (json, "\"timestamp\"", -1);
+  g_assert_cmpuint (g_strv_length (events), ==, 1024 + 1);
+  g_assert_true (g_str_has_prefix (strstr (events[1], "\"id\""), "\"id\": 988,"));
+  g_assert_true (g_str_has_prefix (strstr (events[1024], "\"id\""), "\"id\": 1499,"));
+}
+
+static void
+test_transfer_trace_pcapng (void)
+{
+  g_autoptr(FpDevice) device = g_object_new (FPI_TYPE_DEVICE_FAKE, NULL);
+  g_autoptr(GOutputStream) stream = g_memory_output_stream_new_resizable ();
+  g_autoptr(GError) error = NULL;
+  const guint8 data[] = { 0x10, 0x20, 0x30, 0x40, 0x50 };
+  const guint8 *usbmon;
+  guint8 *pcapng;
+  gsize size, pos;
+  guint n_blocks;
+
+  record_bulk_out (device, 7, data, sizeof (data));
+
+  g_assert_true (fpi_transfer_trace_write_pcapng (device, stream, NULL, &error));
+  g_assert_no_error (error);
+  g_assert_true (g_output_stream_close (stream, NULL, NULL));
+
+  pcapng = g_memory_output_stream_get_data (G_MEMORY_OUTPUT_STREAM (stream));
+  size = g_memory_output_stream_get_data_size (G_MEMORY_OUTPUT_STREAM (stream));
+
+  /* Section header, two interfaces and two packets */
+  g_assert_cmpuint (FP_READ_UINT32_LE (pcapng), ==, 0x0a0d0d0a);
+  g_assert_cmpuint (FP_READ_UINT32_LE (pcapng + 8), ==, 0x1a2b3c4d);
+  for (pos = 0, n_blocks = 0; pos < size; n_blocks++)
+    {
+      guint32 length = FP_READ_UINT32_LE (pcapng + pos + 4);
+
+      g_assert_cmpuint (length % 4, ==, 0);
+      g_assert_cmpuint (FP_READ_UINT32_LE (pcapng + pos + length - 4), ==, length);
+      pos += length;
+    }
+  g_assert_cmpuint (pos, ==, size);
+  g_assert_cmpuint (n_blocks, ==, 5);
+
+  /* USB interface uses the usbmon link type */
+  g_assert_cmpuint (FP_READ_UINT32_LE (pcapng + 28), ==, 1);
+  g_assert_cmpuint (FP_READ_UINT16_LE (pcapng + 36), ==, 220);
+
+  /* First packet, the submission including the data */
+  g_assert_cmpuint (FP_READ_UINT32_LE (pcapng + 68), ==, 6);
+  g_assert_cmpuint (FP_READ_UINT32_LE (pcapng + 68 + 20), ==, 64 + sizeof (data));
+  usbmon = pcapng + 68 + 28;
+  g_assert_cmpuint (FP_READ_UINT64_LE (usbmon), ==, 7);
+  g_assert_cmpint (usbmon[8], ==, 'S');
+  g_assert_cmpint (usbmon[9], ==, 3);
+  g_assert_cmpint (usbmon[10], ==, 0x01);
+  g_assert_cmpuint (FP_READ_UINT32_LE (usbmon + 36), ==, sizeof (data));
+  g_assert_cmpmem (usbmon + 64, sizeof (data), data, sizeof (data));
+}
+
+static void
+test_transfer_trace_save_on_close (void)
+{
+  g_autoptr(FpDevice) device = g_object_new (FPI_TYPE_DEVICE_FAKE, NULL);
+  g_autoptr(GError) error = NULL;
+  g_autoptr(GDir) dir = NULL;
+  g_autofree gchar *json = NULL;
+  const gchar *name;
+  const guint8 data[] = { 0x00 };
+
+  g_assert_true (fp_device_open_sync (device, NULL, &error));
+  record_bulk_out (device, 1, data, sizeof (data));
+  g_assert_true (fp_device_close_sync (device, NULL, &error));
+  g_assert_no_error (error);
+
+  /* The trace is written out and discarded */
+  dir = g_dir_open (trace_dir, 0, &error);
+  g_assert_no_error (error);
+  name = g_dir_read_name (dir);
+  g_assert_nonnull (name);
+  g_assert_true (g_str_has_suffix (name, ".pcapng"));
+
+  json = write_json (device);
+  g_assert_cmpstr (json, ==, "[\n\n]\n");
+}
+
+static void
+remove_trace_dir (void)
+{
+  g_autoptr(GDir) dir = g_dir_open (trace_dir, 0, NULL);
+  const gchar *name;
+
+  while ((name = g_dir_read_name (dir)))
+    {
+      g_autofree gchar *path = g_build_filename (trace_dir, name, NULL);
+
+      g_unlink (path);
+    }
+
+  g_rmdir (trace_dir);
+}
+
+int
+main (int argc, char *argv[])
+{
+  int ret;
+
+  g_test_init (&argc, &argv, NULL);
+
+  trace_dir = g_dir_make_tmp ("libfprint-trace-XXXXXX", NULL);
+  g_assert_nonnull (trace_dir);
+  g_unsetenv ("FP_DEBUG_TRANSFER");
+  g_setenv ("FP_TRACE_TRANSFER", trace_dir, TRUE);
+
+  g_test_add_func ("/transfer-trace/flags", test_transfer_trace_flags);
+  g_test_add_func ("/transfer-trace/json", test_transfer_trace_json);
+  g_test_add_func ("/transfer-trace/ring", test_transfer_trace_ring);
+  g_test_add_func ("/transfer-trace/pcapng", test_transfer_trace_pcapng);
+  g_test_add_func ("/transfer-trace/save-on-close", test_transfer_trace_save_on_close);
+
+  ret = g_test_run ();
+
+  remove_trace_dir ();
+  g_free (trace_dir);
+
+  return ret;
+}
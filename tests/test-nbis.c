@@ -0,0 +1,425 @@
+/*
+ * Unit tests for the NBIS minutiae detection routines
+ * Copyright (C) 2026 libfprint contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <glib.h>
+#include <math.h>
+#include <nbis.h>
+
+#define TEST_IMAGE_WIDTH 67
+#define TEST_IMAGE_HEIGHT 13
+
+static guchar *
+padded_noise_image (GRand *rand, int pad, guchar max)
+{
+  int pw = TEST_IMAGE_WIDTH + 2 * pad;
+  int ph = TEST_IMAGE_HEIGHT + 2 * pad;
+  guchar *pdata = g_malloc (pw * ph);
+
+  for (int i = 0; i < pw * ph; i++)
+    pdata[i] = g_rand_int_range (rand, 0, max + 1);
+
+  return pdata;
+}
+
+static void
+test_dirbinarize_run (void)
+{
+  g_autoptr(GRand) rand = g_rand_new_with_seed (0x6e626973);
+  const LFSPARMS *lfsparms = &g_lfsparms_V2;
+  ROTGRIDS *dirbingrids;
+  int maxpad;
+  int pw;
+
+  maxpad = get_max_padding_V2 (lfsparms->windowsize, lfsparms->windowoffset,
+                               lfsparms->dirbin_grid_w, lfsparms->dirbin_grid_h);
+  g_assert_cmpint (init_rotgrids (&dirbingrids,
+                                  TEST_IMAGE_WIDTH, TEST_IMAGE_HEIGHT, maxpad,
+                                  lfsparms->start_dir_angle,
+                                  lfsparms->num_directions,
+                                  lfsparms->dirbin_grid_w,
+                                  lfsparms->dirbin_grid_h,
+                                  RELATIVE2CENTER), ==, 0);
+  pw = TEST_IMAGE_WIDTH + 2 * dirbingrids->pad;
+
+  /* Use both 6-bit (as seen after bits_8to6) and full 8-bit input */
+  for (int round = 0; round < 8; round++)
+    {
+      g_autofree guchar *pdata = NULL;
+      guchar max = round % 2 ? 255 : 63;
+
+      pdata = padded_noise_image (rand, dirbingrids->pad, max);
+
+      for (int dir = 0; dir < dirbingrids->ngrids; dir++)
+        {
+          for (int y = 0; y < TEST_IMAGE_HEIGHT; y++)
+            {
+              const guchar *pptr = pdata + (y + dirbingrids->pad) * pw + dirbingrids->pad;
+              guchar bdata[TEST_IMAGE_WIDTH];
+              int start = g_rand_int_range (rand, 0, 9);
+              int n = TEST_IMAGE_WIDTH - start;
+
+              dirbinarize_run (bdata, pptr + start, n, dir, dirbingrids);
+
+              /* Must be identical to binarizing each pixel on its own */
+              for (int x = 0; x < n; x++)
+                g_assert_cmpint (bdata[x], ==,
+                                 dirbinarize (pptr + start + x, dir, dirbingrids));
+            }
+        }
+    }
+
+  free_rotgrids (dirbingrids);
+}
+
+static void
+test_fill_holes_packed (void)
+{
+  g_autoptr(GRand) rand = g_rand_new_with_seed (0x686f6c65);
+
+  for (int round = 0; round < 64; round++)
+    {
+      int width = g_rand_int_range (rand, 1, 200);
+      int height = g_rand_int_range (rand, 1, 24);
+      g_autofree guchar *bdata = g_malloc (width * height);
+      g_autofree guchar *unpacked = g_malloc (width * height);
+      g_autofree guint64 *packed = g_new (guint64, PACKED_ROW_WORDS (width) * height);
+
+      /* Alternating pixels produce long runs of holes */
+      for (int i = 0; i < width * height; i++)
+        if (round % 2)
+          bdata[i] = g_rand_boolean (rand) ? WHITE_PIXEL : BLACK_PIXEL;
+        else
+          bdata[i] = (i % 2) ^ (g_rand_int_range (rand, 0, 8) == 0) ? WHITE_PIXEL : BLACK_PIXEL;
+
+      pack_binary_image (packed, bdata, width, height);
+      for (int i = 0; i < NUM_FILL_HOLES; i++)
+        {
+          fill_holes (bdata, width, height);
+          fill_holes_packed (packed, width, height);
+        }
+      unpack_binary_image (unpacked, packed, width, height);
+
+      g_assert_cmpmem (unpacked, width * height, bdata, width * height);
+    }
+}
+
+static void
+test_label_components (void)
+{
+  /* A ring with a hole, a diagonal line and the background */
+  static const char *rows[] = {
+    "........",
+    ".###..#.",
+    ".#.#.#..",
+    ".###....",
+    "........",
+  };
+  const int width = 8, height = G_N_ELEMENTS (rows);
+  guchar bdata[8 * G_N_ELEMENTS (rows)];
+  g_autofree int *labels = NULL;
+
+  for (int y = 0; y < height; y++)
+    for (int x = 0; x < width; x++)
+      bdata[y * width + x] = rows[y][x] == '#';
+
+  g_assert_cmpint (label_components (&labels, bdata, width, height), ==, 0);
+
+  /* The diagonal is 8-connected, the ring separates hole and background */
+  g_assert_cmpint (labels[1 * width + 6], ==, labels[2 * width + 5]);
+  g_assert_cmpint (labels[1 * width + 1], ==, labels[3 * width + 3]);
+  g_assert_cmpint (labels[1 * width + 1], !=, labels[1 * width + 6]);
+  g_assert_cmpint (labels[2 * width + 2], !=, labels[0]);
+  g_assert_cmpint (labels[0], ==, labels[4 * width + 7]);
+  g_assert_cmpint (labels[0], ==, labels[1 * width + 7]);
+}
+
+/* Parallel ridges with a few dislocations, each of which creates a minutia */
+static guchar *
+synthetic_print (int width, int height)
+{
+  const double centers[][2] = { { 0.3, 0.3 }, { 0.7, 0.4 }, { 0.4, 0.7 } };
+  guchar *data = g_malloc (width * height);
+
+  for (int y = 0; y < height; y++)
+    for (int x = 0; x < width; x++)
+      {
+        double phase = 2 * G_PI * (x + 0.3 * y) / 9.0;
+
+        for (guint i = 0; i < G_N_ELEMENTS (centers); i++)
+          phase += atan2 (y - centers[i][1] * height, x - centers[i][0] * width);
+
+        data[y * width + x] = 128 + 100 * sin (phase);
+      }
+
+  return data;
+}
+
+static void
+detect_test_minutiae (MINUTIAE **minutiae, int **quality_map,
+                      guchar *data, int width, int height, int outputs)
+{
+  LFSPARMS lfsparms = g_lfsparms_V2;
+  int *direction_map, *low_contrast_map, *low_flow_map, *high_curve_map;
+  unsigned char *bdata;
+  int map_w, map_h, bw, bh, bd;
+
+  lfsparms.outputs = outputs;
+  g_assert_cmpint (get_minutiae (minutiae, quality_map, &direction_map,
+                                 &low_contrast_map, &low_flow_map,
+                                 &high_curve_map, &map_w, &map_h,
+                                 &bdata, &bw, &bh, &bd,
+                                 data, width, height, 8, 19.685,
+                                 &lfsparms, NULL), ==, 0);
+
+  g_free (direction_map);
+  g_free (low_contrast_map);
+  g_free (low_flow_map);
+  g_free (high_curve_map);
+  g_free (bdata);
+}
+
+static void
+test_optional_outputs (void)
+{
+  const int width = 160, height = 160;
+  g_autofree guchar *all_data = synthetic_print (width, height);
+  g_autofree guchar *none_data = g_memdup (all_data, width * height);
+  MINUTIAE *all, *none;
+  int *all_quality, *none_quality;
+
+  detect_test_minutiae (&all, &all_quality, all_data, width, height, LFS_OUTPUT_ALL);
+  detect_test_minutiae (&none, &none_quality, none_data, width, height, 0);
+
+  g_assert_nonnull (all_quality);
+  g_assert_null (none_quality);
+
+  /* Skipped stages must not change what is detected */
+  g_assert_cmpint (none->num, ==, all->num);
+  for (int i = 0; i < all->num; i++)
+    {
+      g_assert_cmpint (none->list[i]->x, ==, all->list[i]->x);
+      g_assert_cmpint (none->list[i]->y, ==, all->list[i]->y);
+      g_assert_cmpint (none->list[i]->direction, ==, all->list[i]->direction);
+      g_assert_cmpint (none->list[i]->num_nbrs, ==, 0);
+    }
+
+  free_minutiae (all);
+  free_minutiae (none);
+  g_free (all_quality);
+}
+
+/* The minutia scans as they were before candidates were found on packed
+ * scan lines, the results must not change. */
+static int
+scan_horizontally_reference (MINUTIAE *minutiae, guchar *bdata, int iw, int ih,
+                             int *direction_map, int *low_flow_map,
+                             int *high_curve_map, const LFSPARMS *lfsparms)
+{
+  int possible[NFEATURES], nposs;
+  int cx, cy, x2, ret;
+
+  for (cy = 0; cy + 1 < ih; cy++)
+    {
+      cx = 0;
+      while (cx < iw)
+        {
+          guchar *p1ptr = bdata + cy * iw + cx;
+          guchar *p2ptr = p1ptr + iw;
+
+          if (!match_1st_pair (*p1ptr, *p2ptr, possible, &nposs))
+            {
+              cx++;
+              continue;
+            }
+
+          cx++;
+          p1ptr++;
+          p2ptr++;
+          if (cx >= iw || !match_2nd_pair (*p1ptr, *p2ptr, possible, &nposs))
+            continue;
+
+          x2 = cx;
+          skip_repeated_horizontal_pair (&cx, iw, &p1ptr, &p2ptr, iw, ih);
+          if (cx >= iw)
+            continue;
+
+          if (match_3rd_pair (*p1ptr, *p2ptr, possible, &nposs))
+            {
+              ret = process_horizontal_scan_minutia_V2 (minutiae, cx, cy, x2,
+                                                        possible[0], bdata, iw, ih,
+                                                        direction_map, low_flow_map,
+                                                        high_curve_map, lfsparms);
+              if (ret < 0)
+                return ret;
+            }
+
+          /* The 3rd pair may be the next 2nd pair */
+          if (*p1ptr != *p2ptr)
+            cx--;
+        }
+    }
+
+  return 0;
+}
+
+static int
+scan_vertically_reference (MINUTIAE *minutiae, guchar *bdata, int iw, int ih,
+                           int *direction_map, int *low_flow_map,
+                           int *high_curve_map, const LFSPARMS *lfsparms)
+{
+  int possible[NFEATURES], nposs;
+  int cx, cy, y2, ret;
+
+  for (cx = 0; cx + 1 < iw; cx++)
+    {
+      cy = 0;
+      while (cy < ih)
+        {
+          guchar *p1ptr = bdata + cy * iw + cx;
+          guchar *p2ptr = p1ptr + 1;
+
+          if (!match_1st_pair (*p1ptr, *p2ptr, possible, &nposs))
+            {
+              cy++;
+              continue;
+            }
+
+          cy++;
+          p1ptr += iw;
+          p2ptr += iw;
+          if (cy >= ih || !match_2nd_pair (*p1ptr, *p2ptr, possible, &nposs))
+            continue;
+
+          y2 = cy;
+          skip_repeated_vertical_pair (&cy, ih, &p1ptr, &p2ptr, iw, ih);
+          if (cy >= ih)
+            continue;
+
+          if (match_3rd_pair (*p1ptr, *p2ptr, possible, &nposs))
+            {
+              ret = process_vertical_scan_minutia_V2 (minutiae, cx, cy, y2,
+                                                      possible[0], bdata, iw, ih,
+                                                      direction_map, low_flow_map,
+                                                      high_curve_map, lfsparms);
+              if (ret < 0)
+                return ret;
+            }
+
+          /* The 3rd pair may be the next 2nd pair */
+          if (*p1ptr != *p2ptr)
+            cy--;
+        }
+    }
+
+  return 0;
+}
+
+static void
+assert_same_minutiae (MINUTIAE *a, MINUTIAE *b)
+{
+  g_assert_cmpint (a->num, ==, b->num);
+  for (int i = 0; i < a->num; i++)
+    {
+      g_assert_cmpint (a->list[i]->x, ==, b->list[i]->x);
+      g_assert_cmpint (a->list[i]->y, ==, b->list[i]->y);
+      g_assert_cmpint (a->list[i]->ex, ==, b->list[i]->ex);
+      g_assert_cmpint (a->list[i]->ey, ==, b->list[i]->ey);
+      g_assert_cmpint (a->list[i]->direction, ==, b->list[i]->direction);
+      g_assert_cmpint (a->list[i]->feature_id, ==, b->list[i]->feature_id);
+      g_assert_cmpfloat (a->list[i]->reliability, ==, b->list[i]->reliability);
+    }
+}
+
+static void
+test_scan4minutiae (void)
+{
+  g_autoptr(GRand) rand = g_rand_new_with_seed (0x7363616e);
+  LFSPARMS lfsparms = g_lfsparms_V2;
+
+  /* Never merge nearby minutiae, so every processed pattern is recorded */
+  lfsparms.max_minutia_delta = 0;
+
+  for (int round = 0; round < 32; round++)
+    {
+      int width = g_rand_int_range (rand, 2, 160);
+      int height = g_rand_int_range (rand, 2, 160);
+      g_autofree guchar *bdata = NULL;
+      g_autofree int *direction_map = g_new (int, width * height);
+      g_autofree int *low_flow_map = g_new (int, width * height);
+      g_autofree int *high_curve_map = g_new0 (int, width * height);
+      MINUTIAE *reference, *minutiae;
+
+      /* Alternate between noise and ridges, 1 is black as in the scans */
+      if (round % 2)
+        {
+          bdata = g_malloc (width * height);
+          for (int i = 0; i < width * height; i++)
+            bdata[i] = g_rand_boolean (rand);
+        }
+      else
+        {
+          bdata = synthetic_print (width, height);
+          for (int i = 0; i < width * height; i++)
+            bdata[i] = bdata[i] < 128;
+        }
+
+      for (int i = 0; i < width * height; i++)
+        {
+          direction_map[i] = g_rand_int_range (rand, INVALID_DIR,
+                                               lfsparms.num_directions);
+          low_flow_map[i] = g_rand_boolean (rand);
+        }
+
+      g_assert_cmpint (alloc_minutiae (&reference, MAX_MINUTIAE), ==, 0);
+      g_assert_cmpint (alloc_minutiae (&minutiae, MAX_MINUTIAE), ==, 0);
+
+      g_assert_cmpint (scan_horizontally_reference (reference, bdata, width, height,
+                                                    direction_map, low_flow_map,
+                                                    high_curve_map, &lfsparms), ==, 0);
+      g_assert_cmpint (scan4minutiae_horizontally_V2 (minutiae, bdata, width, height,
+                                                      direction_map, low_flow_map,
+                                                      high_curve_map, &lfsparms), ==, 0);
+      assert_same_minutiae (reference, minutiae);
+
+      g_assert_cmpint (scan_vertically_reference (reference, bdata, width, height,
+                                                  direction_map, low_flow_map,
+                                                  high_curve_map, &lfsparms), ==, 0);
+      g_assert_cmpint (scan4minutiae_vertically_V2 (minutiae, bdata, width, height,
+                                                    direction_map, low_flow_map,
+                                                    high_curve_map, &lfsparms), ==, 0);
+      assert_same_minutiae (reference, minutiae);
+
+      free_minutiae (reference);
+      free_minutiae (minutiae);
+    }
+}
+
+int
+main (int argc, char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/nbis/dirbinarize-run", test_dirbinarize_run);
+  g_test_add_func ("/nbis/fill-holes-packed", test_fill_holes_packed);
+  g_test_add_func ("/nbis/label-components", test_label_components);
+  g_test_add_func ("/nbis/optional-outputs", test_optional_outputs);
+  g_test_add_func ("/nbis/scan4minutiae", test_scan4minutiae);
+
+  return g_test_run ();
+}
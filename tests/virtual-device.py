@@ -574,6 +574,31 @@ class VirtualDevice(VirtualDeviceBase):
 
         return enrolled
 
+    def test_enroll_script_stream(self):
+        stages = 50
+
+        with Connection(self.sockaddr) as con:
+            def send(command, *args):
+                data = ' '.join([command] + [str(a) for a in args]).encode('utf-8')
+                con.sendall(struct.pack('>I', len(data)) + data)
+
+            send('SET_ENROLL_STAGES', stages)
+            for i in range(stages):
+                send('RETRY', int(FPrint.DeviceRetry.TOO_SHORT))
+                send('SCAN', 'print-id')
+
+            while ctx.pending():
+                ctx.iteration(False)
+
+            enrolled = self.dev.enroll_sync(FPrint.Print.new(self.dev))
+            self.assertEqual(enrolled.props.fpi_data.unpack(), 'print-id')
+
+            # The connection stays usable for further commands
+            send('SCAN', 'print-id')
+            verify_match, verify_fp = self.dev.verify_sync(enrolled)
+            self.assertTrue(verify_match)
+            self.assertTrue(verify_fp.equal(enrolled))
+
     def test_enroll_verify_script(self):
         enrolled = self.test_enroll_script()
         self.send_auto(FPrint.DeviceRetry.CENTER_FINGER)
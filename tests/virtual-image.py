@@ -15,6 +15,7 @@ try:
     import glob
     import cairo
     import tempfile
+    import threading
 except Exception as e:
     print("Missing dependencies: %s" % str(e))
     sys.exit(77)
@@ -118,7 +119,13 @@ class VirtualImage(unittest.TestCase):
         while iterate and ctx.pending():
             ctx.iteration(False)
 
-    def send_image(self, image, iterate=True):
+    def send_stream_mode(self, enabled, iterate=True):
+        # Hold back images until the device waits for a finger
+        self.con.sendall(struct.pack('ii', -6, 1 if enabled else 0))
+        while iterate and ctx.pending():
+            ctx.iteration(False)
+
+    def encode_image(self, image):
         img = self.prints[image]
 
         mem = img.get_data()
@@ -128,7 +135,10 @@ class VirtualImage(unittest.TestCase):
         encoded_img = struct.pack('ii', img.get_width(), img.get_height())
         encoded_img += mem
 
-        self.con.sendall(encoded_img)
+        return encoded_img
+
+    def send_image(self, image, iterate=True):
+        self.con.sendall(self.encode_image(image))
         while iterate and ctx.pending():
             ctx.iteration(False)
 
@@ -284,6 +294,26 @@ class VirtualImage(unittest.TestCase):
         print(self._verify_error)
         assert(self._verify_error.matches(FPrint.device_error_quark(), FPrint.DeviceError.GENERAL))
 
+    def test_enroll_verify_stream(self):
+        self.send_stream_mode(True)
+
+        # Write all images at once, one is consumed for every scan.
+        # Note: Assumes 5 enroll steps for this device!
+        images = ['whorl'] * 6 + ['tented_arch']
+        data = b''.join(self.encode_image(i) for i in images)
+        writer = threading.Thread(target=self.con.sendall, args=(data,))
+        writer.start()
+
+        enrolled = self.dev.enroll_sync(FPrint.Print.new(self.dev))
+
+        verify_match, verify_fp = self.dev.verify_sync(enrolled)
+        self.assertTrue(verify_match)
+
+        verify_match, verify_fp = self.dev.verify_sync(enrolled)
+        self.assertFalse(verify_match)
+
+        writer.join()
+
     def test_identify(self):
         done = False
 
@@ -372,6 +402,45 @@ class VirtualImage(unittest.TestCase):
             ctx.iteration(True)
         assert(not self._verify_match)
 
+    def test_verify_keep_active(self):
+        def verify_cb(dev, res):
+            self._verify_match, self._verify_fp = dev.verify_finish(res)
+
+        def state():
+            return self.dev.get_property('fpi-image-device-state').value_nick
+
+        fp_whorl = self.enroll_print('whorl')
+        self.assertEqual(state(), 'inactive')
+
+        self.dev.props.keep_active_timeout = 60000
+        for i in range(2):
+            self._verify_match = None
+            self.dev.verify(fp_whorl, callback=verify_cb)
+            self.send_image('whorl')
+            while self._verify_match is None:
+                ctx.iteration(True)
+            assert(self._verify_match)
+
+            # The device stays active for the next verification
+            self.assertEqual(state(), 'idle')
+
+        self.dev.props.keep_active_timeout = 0
+        self.assertEqual(state(), 'inactive')
+
+        # Closing also deactivates a device that is kept active
+        self.dev.props.keep_active_timeout = 60000
+        self._verify_match = None
+        self.dev.verify(fp_whorl, callback=verify_cb)
+        self.send_image('whorl')
+        while self._verify_match is None:
+            ctx.iteration(True)
+        self.assertEqual(state(), 'idle')
+
+        self.dev.close_sync()
+        self.assertEqual(state(), 'inactive')
+        self.dev.open_sync()
+        self.dev.props.keep_active_timeout = 0
+
 if __name__ == '__main__':
     try:
         gi.require_version('FPrint', '2.0')